@@ -0,0 +1,115 @@
+/*
+ *      Copyright (C) 2010-2019 Hendrik Leppkes
+ *      http://www.1f0.de
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+//
+// Pool of PCM buffers, reused across PostProcess calls so the audio thread does not hit the heap for every buffer.
+// Buffers are binned into power-of-two size classes by their allocated size. A buffer taken out of the arena
+// is owned by the caller until it is handed back with Release, or deleted by the caller.
+//
+class CBufferArena
+{
+public:
+  CBufferArena() {}
+  ~CBufferArena() { Clear(); }
+
+  // Get a buffer with at least dwSize bytes allocated, its count is reset to zero
+  GrowableArray<BYTE> *Acquire(DWORD dwSize);
+  // Return a buffer into the arena, buffers the arena has no room for are freed.
+  // dwLeasedSize is the allocated size the buffer had when it was acquired, growth beyond it counts as an allocation
+  void Release(GrowableArray<BYTE> *pBuffer, DWORD dwLeasedSize);
+  void Clear();
+
+  // Number of buffers allocated by the arena or grown by their user while acquired,
+  // stops increasing once the stream reached its steady state
+  DWORD GetAllocations() const { return m_dwAllocations; }
+  // Largest buffer size requested so far
+  DWORD GetHighWater() const { return m_dwHighWater; }
+
+private:
+  enum { MIN_CLASS = 12, NUM_CLASSES = 24, MAX_PER_CLASS = 4 }; // 4 KB .. 8 MB
+
+  // Largest class whose size fits into dwSize
+  static int SizeClassFloor(DWORD dwSize);
+
+  GrowableArray<BYTE> *m_Free[NUM_CLASSES][MAX_PER_CLASS] = {};
+  int   m_nFree[NUM_CLASSES] = {};
+  DWORD m_dwAllocations = 0;
+  DWORD m_dwHighWater = 0;
+};
+
+inline int CBufferArena::SizeClassFloor(DWORD dwSize)
+{
+  int c = 0;
+  while (c < 31 && (2U << c) <= dwSize)
+    c++;
+  return c;
+}
+
+inline GrowableArray<BYTE> *CBufferArena::Acquire(DWORD dwSize)
+{
+  if (dwSize > m_dwHighWater) {
+    m_dwHighWater = dwSize;
+    DbgLog((LOG_TRACE, 10, L"CBufferArena::Acquire(): new high-water mark of %u bytes", dwSize));
+  }
+
+  // round the size up to the next class, so the buffer can be binned again when it comes back
+  int c = max(SizeClassFloor(dwSize), (int)MIN_CLASS);
+  if ((1U << c) < dwSize)
+    c++;
+
+  for (int i = c; i < NUM_CLASSES; i++) {
+    if (m_nFree[i] > 0) {
+      GrowableArray<BYTE> *pBuffer = m_Free[i][--m_nFree[i]];
+      pBuffer->SetSize(0);
+      return pBuffer;
+    }
+  }
+
+  GrowableArray<BYTE> *pBuffer = new GrowableArray<BYTE>();
+  pBuffer->Allocate(c < NUM_CLASSES ? (1U << c) : dwSize);
+  m_dwAllocations++;
+  return pBuffer;
+}
+
+inline void CBufferArena::Release(GrowableArray<BYTE> *pBuffer, DWORD dwLeasedSize)
+{
+  if (!pBuffer)
+    return;
+
+  // a buffer that had to grow while in use counts as another allocation
+  if (pBuffer->GetAllocated() > dwLeasedSize)
+    m_dwAllocations++;
+
+  const int c = SizeClassFloor(pBuffer->GetAllocated());
+  if (c >= MIN_CLASS && c < NUM_CLASSES && m_nFree[c] < MAX_PER_CLASS) {
+    m_Free[c][m_nFree[c]++] = pBuffer;
+  } else {
+    delete pBuffer;
+  }
+}
+
+inline void CBufferArena::Clear()
+{
+  for (int c = 0; c < NUM_CLASSES; c++) {
+    while (m_nFree[c] > 0)
+      delete m_Free[c][--m_nFree[c]];
+  }
+}
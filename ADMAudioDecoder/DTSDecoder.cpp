@@ -326,7 +326,7 @@ HRESULT CLAVAudio::DecodeDTS(const BYTE * pDataBuffer, int buffsize, int &consum
 
   BOOL bFlush = (pDataBuffer == nullptr);
 
-  BufferDetails out;
+  BufferDetails out(&m_BufferArena);
 
   consumed = 0;
   while (buffsize > 0) {
@@ -1657,7 +1657,7 @@ HRESULT CLAVAudio::Decode(const BYTE * pDataBuffer, int buffsize, int &consumed,
   AVPacket avpkt;
   av_init_packet(&avpkt);
 
-  BufferDetails out;
+  BufferDetails out(&m_BufferArena);
   const MediaSideDataFFMpeg *pFFSideData = nullptr;
 
   if (!bFlush && (m_raData.deint_id == MKBETAG('g', 'e', 'n', 'r') || m_raData.deint_id == MKBETAG('s', 'i', 'p', 'r'))) {
@@ -2000,6 +2000,7 @@ HRESULT CLAVAudio::QueueOutput(BufferDetails &buffer)
   // Try to retain the buffer, if possible
   if (m_OutputQueue.nSamples == 0) {
     FFSWAP(GrowableArray<BYTE>*, m_OutputQueue.bBuffer, buffer.bBuffer);
+    FFSWAP(DWORD, m_OutputQueue.dwLeasedSize, buffer.dwLeasedSize);
   } else {
     m_OutputQueue.bBuffer->Append(buffer.bBuffer);
   }
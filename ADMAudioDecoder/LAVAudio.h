@@ -64,11 +64,18 @@ struct BufferDetails {
   BOOL                  bPlanar         = FALSE;           // Planar (not used)
 
 
-  BufferDetails() {
-    bBuffer = new GrowableArray<BYTE>();
+  CBufferArena          *pArena         = nullptr;         // Arena the PCM buffer is taken from, and returned to
+  DWORD                 dwLeasedSize    = 0;               // Allocated size of the PCM buffer when it was taken, to count its growth
+
+  BufferDetails(CBufferArena *arena = nullptr) : pArena(arena) {
+    bBuffer = arena ? arena->Acquire(0) : new GrowableArray<BYTE>();
+    dwLeasedSize = bBuffer->GetAllocated();
   };
   ~BufferDetails() {
-    delete bBuffer;
+    if (pArena)
+      pArena->Release(bBuffer, dwLeasedSize);
+    else
+      delete bBuffer;
   }
 };
 
@@ -314,6 +321,7 @@ private:
   BOOL                m_bResyncTimestamp = FALSE;
   BOOL                m_bNeedSyncpoint   = FALSE;
   BOOL                m_bJustFlushed     = TRUE;
+  CBufferArena        m_BufferArena;               // PCM buffers reused by decoding and post-processing
   BufferDetails       m_OutputQueue;
 
   AVIOContext        *m_avioBitstream = nullptr;
@@ -19,6 +19,7 @@
 
 #include "stdafx.h"
 #include "LAVAudio.h"
+#include "SampleKernels.h"
 
 #include <MMReg.h>
 
@@ -572,23 +573,53 @@ T get_sample_from_buffer(const BYTE * const pBuffer, LAVAudioSampleFormat sfForm
   return fSample;
 }
 
+// Sum of the squared samples of every channel (up to 8), samples of type T in the format sfFormat
+template <LAVAudioSampleFormat sfFormat, typename T>
+static void sum_squares(const BYTE *pBuffer, DWORD nSamples, WORD wChannels, float *fChAvg)
+{
+  const BYTE bSampleSize = get_byte_per_sample(sfFormat);
+  DWORD i = sum_squares_sse2<T>(pBuffer, nSamples, wChannels, fChAvg);
+  pBuffer += (size_t)i * wChannels * bSampleSize;
+
+  for (; i < nSamples; ++i) {
+    for (WORD ch = 0; ch < wChannels; ++ch) {
+      const float fSample = get_sample_from_buffer<float>(pBuffer, sfFormat);
+      fChAvg[ch] += fSample * fSample;
+      pBuffer += bSampleSize;
+    }
+  }
+}
+
 // This function calculates the Root mean square (RMS) of all samples in the buffer,
 // converts the result into a reference dB value, and adds it to the volume floating average
+// Only the first 8 channels are tracked, see m_faVolume
 void CLAVAudio::UpdateVolumeStats(const BufferDetails &buffer)
 {
   const BYTE bSampleSize = get_byte_per_sample(buffer.sfFormat);
   const DWORD dwSamplesPerChannel = buffer.nSamples;
+  const WORD wChannels = min(buffer.wChannels, (WORD)countof(m_faVolume));
   const BYTE *pBuffer = buffer.bBuffer->Ptr();
-  float * const fChAvg = (float *)calloc(buffer.wChannels, sizeof(float));
-  for (DWORD i = 0; i < dwSamplesPerChannel; ++i) {
-    for (WORD ch = 0; ch < buffer.wChannels; ++ch) {
-      const float fSample = get_sample_from_buffer<float>(pBuffer, buffer.sfFormat);
-      fChAvg[ch] += fSample * fSample;
-      pBuffer += bSampleSize;
+  float fChAvg[8] = { 0.0f };
+
+  if (buffer.wChannels <= 8 && buffer.sfFormat == SampleFormat_FP32) {
+    sum_squares<SampleFormat_FP32, float>(pBuffer, dwSamplesPerChannel, buffer.wChannels, fChAvg);
+  } else if (buffer.wChannels <= 8 && buffer.sfFormat == SampleFormat_16) {
+    sum_squares<SampleFormat_16, int16_t>(pBuffer, dwSamplesPerChannel, buffer.wChannels, fChAvg);
+  } else if (buffer.wChannels <= 8 && buffer.sfFormat == SampleFormat_32) {
+    sum_squares<SampleFormat_32, int32_t>(pBuffer, dwSamplesPerChannel, buffer.wChannels, fChAvg);
+  } else {
+    for (DWORD i = 0; i < dwSamplesPerChannel; ++i) {
+      for (WORD ch = 0; ch < buffer.wChannels; ++ch) {
+        if (ch < wChannels) {
+          const float fSample = get_sample_from_buffer<float>(pBuffer, buffer.sfFormat);
+          fChAvg[ch] += fSample * fSample;
+        }
+        pBuffer += bSampleSize;
+      }
     }
   }
 
-  for (int ch = 0; ch < buffer.wChannels; ++ch) {
+  for (int ch = 0; ch < wChannels; ++ch) {
     if (fChAvg[ch] > FLT_EPSILON) {
       const float fAvgSqrt =  sqrt(fChAvg[ch] / dwSamplesPerChannel);
       const float fDb = 20.0f * log10(fAvgSqrt);
@@ -597,7 +628,6 @@ void CLAVAudio::UpdateVolumeStats(const BufferDetails &buffer)
       m_faVolume[ch].Sample(-100.0f);
     }
   }
-  free(fChAvg);
 }
 
 #define MAX_SPEAKER_LAYOUT 18
@@ -21,20 +21,22 @@
 #include "PostProcessor.h"
 #include "LAVAudio.h"
 #include "Media.h"
+#include "SampleKernels.h"
 
 extern "C" {
 #include "libavutil/intreadwrite.h"
 };
 
-// PCM Volume Adjustment Factors, both for integer and float math
-// entries start at 2 channel mixing, half volume
-static int pcm_volume_adjust_integer[7] = {
-  362, 443, 512, 572, 627, 677, 724
-};
-
-static float pcm_volume_adjust_float[7] = {
-  1.41421356f, 1.73205081f, 2.00000000f, 2.23606798f, 2.44948974f, 2.64575131f, 2.82842712f
-};
+// Replace the PCM buffer, handing the old one back to the arena
+static inline void ReplaceBuffer(BufferDetails *pcm, GrowableArray<BYTE> *pNew, CBufferArena *pArena)
+{
+  if (pArena)
+    pArena->Release(pcm->bBuffer, pcm->dwLeasedSize);
+  else
+    delete pcm->bBuffer;
+  pcm->bBuffer = pNew;
+  pcm->dwLeasedSize = pNew->GetAllocated();
+}
 
 // SCALE_CA helper macro for SampleCopyAdjust
 #define SCALE_CA(sample, iFactor, factor) { \
@@ -109,32 +111,12 @@ static inline void SampleCopyAdjust(BYTE *pOut, const BYTE *pIn, int iFactor, LA
   }
 }
 
-//
-// Writes one sample of silence into the buffer
-//
-static inline void Silence(BYTE *pBuffer, LAVAudioSampleFormat sfSampleFormat)
-{
-  switch (sfSampleFormat) {
-  case SampleFormat_16:
-  case SampleFormat_24:
-  case SampleFormat_32:
-  case SampleFormat_FP32:
-    memset(pBuffer, 0, get_byte_per_sample(sfSampleFormat));
-    break;
-  case SampleFormat_U8:
-    *pBuffer = 128U;
-    break;
-  default:
-    ASSERT(0);
-  }
-}
-
 //
 // Channel Remapping Processor
 // This function can process a PCM buffer of any sample format, and remap the channels
 // into any arbitrary layout and channel count.
 //
-// The samples are copied byte-by-byte, without any conversion or loss.
+// The samples are copied as a whole, without any conversion or loss.
 //
 // The ChannelMap is assumed to always have at least uOutChannels valid entries.
 // Its layout is in output format:
@@ -153,7 +135,7 @@ static inline void Silence(BYTE *pBuffer, LAVAudioSampleFormat sfSampleFormat)
 // Mono Input Buffer, Convert to Stereo
 // uOutChannels == 2; map = {0, 0}
 //
-HRESULT ChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const ChannelMap map)
+HRESULT ChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const ChannelMap map, CBufferArena *pArena)
 {
   ExtendedChannelMap extMap;
   for (unsigned ch = 0; ch < uOutChannels; ++ch) {
@@ -162,7 +144,7 @@ HRESULT ChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const Ch
     extMap[ch].factor = 0;
   }
 
-  return ExtendedChannelMapping(pcm, uOutChannels, extMap);
+  return ExtendedChannelMapping(pcm, uOutChannels, extMap, pArena);
 }
 
 //
@@ -175,8 +157,11 @@ HRESULT ChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const Ch
 // A Factor of -2 will produce half volume, -3 one third, etc.
 // The limit is a factor of 8/-8
 //
+// The channels are remapped first, with a copy loop specialized for the sample size,
+// the volume factors are then applied in a second pass over the output buffer.
+//
 // Otherwise, see ChannelMapping
-HRESULT ExtendedChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const ExtendedChannelMap extMap)
+HRESULT ExtendedChannelMapping(BufferDetails *pcm, const unsigned uOutChannels, const ExtendedChannelMap extMap, CBufferArena *pArena)
 {
 #ifdef DEBUG
   ASSERT(pcm && pcm->bBuffer);
@@ -188,30 +173,58 @@ HRESULT ExtendedChannelMapping(BufferDetails *pcm, const unsigned uOutChannels,
   // Sample Size
   const unsigned uSampleSize = get_byte_per_sample(pcm->sfFormat);
 
+  // Map of source channels and factors, factors only apply to channels which are not silent
+  int idx[8], factor[8];
+  BOOL bAdjust = FALSE;
+  for (unsigned ch = 0; ch < uOutChannels; ++ch) {
+    idx[ch] = extMap[ch].idx;
+    factor[ch] = (idx[ch] >= 0 && abs(extMap[ch].factor) > 1) ? extMap[ch].factor : 0;
+    bAdjust |= (factor[ch] != 0);
+  }
+
   // New Output Buffer
-  GrowableArray<BYTE> *out = new GrowableArray<BYTE>();
-  out->SetSize(uOutChannels * pcm->nSamples * uSampleSize);
+  const DWORD size = uOutChannels * pcm->nSamples * uSampleSize;
+  GrowableArray<BYTE> *out = pArena ? pArena->Acquire(size) : new GrowableArray<BYTE>();
+  out->SetSize(size);
 
   const BYTE *pIn = pcm->bBuffer->Ptr();
   BYTE *pOut = out->Ptr();
 
-  for(unsigned i = 0; i < pcm->nSamples; ++i) {
-    for (unsigned ch = 0; ch < uOutChannels; ++ch) {
-      if (extMap[ch].idx >= 0) {
-        if (!extMap[ch].factor || abs(extMap[ch].factor) == 1)
-          memcpy(pOut, pIn + (extMap[ch].idx * uSampleSize), uSampleSize);
-        else
-          SampleCopyAdjust(pOut, pIn + (extMap[ch].idx * uSampleSize), extMap[ch].factor, pcm->sfFormat);
-      } else
-        Silence(pOut, pcm->sfFormat);
-      pOut += uSampleSize;
+  switch (uSampleSize) {
+  case 1:
+    RemapChannels<uint8_t>(pOut, pIn, pcm->nSamples, pcm->wChannels, uOutChannels, idx, 128U);
+    break;
+  case 2:
+    RemapChannels<int16_t>((int16_t *)pOut, (const int16_t *)pIn, pcm->nSamples, pcm->wChannels, uOutChannels, idx, 0);
+    break;
+  case 3:
+    RemapChannels<Sample24>((Sample24 *)pOut, (const Sample24 *)pIn, pcm->nSamples, pcm->wChannels, uOutChannels, idx, Sample24());
+    break;
+  case 4:
+    RemapChannels<int32_t>((int32_t *)pOut, (const int32_t *)pIn, pcm->nSamples, pcm->wChannels, uOutChannels, idx, 0);
+    break;
+  default:
+    ASSERT(0);
+    break;
+  }
+
+  if (bAdjust) {
+    const size_t nTotal = (size_t)pcm->nSamples * uOutChannels;
+    size_t n = 0;
+    if (pcm->sfFormat == SampleFormat_FP32)
+      n = AdjustVolumeFloat((float *)pOut, nTotal, uOutChannels, factor);
+    else if (pcm->sfFormat == SampleFormat_16)
+      n = AdjustVolume16((int16_t *)pOut, nTotal, uOutChannels, factor);
+
+    // samples after the last whole block of the SSE2 kernels, and the other formats
+    for (; n < nTotal; ++n) {
+      if (factor[n % uOutChannels])
+        SampleCopyAdjust(pOut + n * uSampleSize, pOut + n * uSampleSize, factor[n % uOutChannels], pcm->sfFormat);
     }
-    pIn += uSampleSize * pcm->wChannels;
   }
 
   // Apply changes to buffer
-  delete pcm->bBuffer;
-  pcm->bBuffer       = out;
+  ReplaceBuffer(pcm, out, pArena);
   pcm->wChannels     = uOutChannels;
 
   return S_OK;
@@ -394,7 +407,7 @@ HRESULT CLAVAudio::PadTo32(BufferDetails *buffer)
   ASSERT(buffer->sfFormat == SampleFormat_24);
 
   const DWORD size = (buffer->nSamples * buffer->wChannels) * 4;
-  GrowableArray<BYTE> *pcmOut = new GrowableArray<BYTE>();
+  GrowableArray<BYTE> *pcmOut = m_BufferArena.Acquire(size);
   pcmOut->SetSize(size);
 
   const BYTE *pDataIn = buffer->bBuffer->Ptr();
@@ -407,8 +420,7 @@ HRESULT CLAVAudio::PadTo32(BufferDetails *buffer)
       pDataIn += 3;
     }
   }
-  delete buffer->bBuffer;
-  buffer->bBuffer = pcmOut;
+  ReplaceBuffer(buffer, pcmOut, &m_BufferArena);
   buffer->sfFormat = SampleFormat_32;
   buffer->wBitsPerSample = 24;
 
@@ -426,7 +438,7 @@ HRESULT CLAVAudio::Truncate32Buffer(BufferDetails *buffer)
 
   const int skip = 4 - bytes_per_sample;
   const DWORD size = (buffer->nSamples * buffer->wChannels) * bytes_per_sample;
-  GrowableArray<BYTE> *pcmOut = new GrowableArray<BYTE>();
+  GrowableArray<BYTE> *pcmOut = m_BufferArena.Acquire(size);
   pcmOut->SetSize(size);
 
   const BYTE *pDataIn = buffer->bBuffer->Ptr();
@@ -441,8 +453,7 @@ HRESULT CLAVAudio::Truncate32Buffer(BufferDetails *buffer)
     }
   }
 
-  delete buffer->bBuffer;
-  buffer->bBuffer = pcmOut;
+  ReplaceBuffer(buffer, pcmOut, &m_BufferArena);
   buffer->sfFormat = bytes_per_sample == 3 ? SampleFormat_24 : SampleFormat_16;
 
   return S_OK;
@@ -542,20 +553,19 @@ HRESULT CLAVAudio::PerformAVRProcessing(BufferDetails *buffer)
 
   LAVAudioSampleFormat bufferFormat = (m_sfRemixFormat == SampleFormat_24) ? SampleFormat_32 : m_sfRemixFormat; // avresample always outputs 32-bit
 
-  GrowableArray<BYTE> *pcmOut = new GrowableArray<BYTE>();
-  pcmOut->Allocate(FFALIGN(buffer->nSamples, 32) * av_get_channel_layout_nb_channels(m_dwRemixLayout) * get_byte_per_sample(bufferFormat));
+  GrowableArray<BYTE> *pcmOut = m_BufferArena.Acquire(FFALIGN(buffer->nSamples, 32) * av_get_channel_layout_nb_channels(m_dwRemixLayout) * get_byte_per_sample(bufferFormat));
+  const DWORD dwLeasedSize = pcmOut->GetAllocated();
   BYTE *pOut = pcmOut->Ptr();
 
   BYTE *pIn = buffer->bBuffer->Ptr();
   ret = avresample_convert(m_avrContext, &pOut, pcmOut->GetAllocated(), buffer->nSamples, &pIn, buffer->bBuffer->GetAllocated(), buffer->nSamples);
   if (ret < 0) {
     DbgLog((LOG_ERROR, 10, L"avresample_convert failed"));
-    delete pcmOut;
+    m_BufferArena.Release(pcmOut, dwLeasedSize);
     return S_FALSE;
   }
 
-  delete buffer->bBuffer;
-  buffer->bBuffer = pcmOut;
+  ReplaceBuffer(buffer, pcmOut, &m_BufferArena);
   buffer->dwChannelMask = m_dwRemixLayout;
   buffer->sfFormat = bufferFormat;
   buffer->wBitsPerSample = get_byte_per_sample(m_sfRemixFormat) << 3;
@@ -614,7 +624,7 @@ HRESULT CLAVAudio::PostProcess(BufferDetails *buffer)
       CheckChannelLayoutConformity(buffer->dwChannelMask);
     }
     if (m_bChannelMappingRequired) {
-      ExtendedChannelMapping(buffer, m_ChannelMapOutputChannels, m_ChannelMap);
+      ExtendedChannelMapping(buffer, m_ChannelMapOutputChannels, m_ChannelMap, &m_BufferArena);
       buffer->dwChannelMask = m_ChannelMapOutputLayout;
     }
   }
@@ -638,7 +648,7 @@ HRESULT CLAVAudio::PostProcess(BufferDetails *buffer)
   // Mono -> Stereo expansion
   if (buffer->wChannels == 1 && m_settings.ExpandMono) {
     ExtendedChannelMap map = {{0,-2}, {0, -2}};
-    ExtendedChannelMapping(buffer, 2, map);
+    ExtendedChannelMapping(buffer, 2, map, &m_BufferArena);
     buffer->dwChannelMask = AV_CH_LAYOUT_STEREO;
   }
 
@@ -646,11 +656,11 @@ HRESULT CLAVAudio::PostProcess(BufferDetails *buffer)
   if (m_settings.Expand61) {
     if (buffer->dwChannelMask == AV_CH_LAYOUT_6POINT1_BACK) {
       ExtendedChannelMap map = {{0,0}, {1,0}, {2,0}, {3,0}, {6,-2}, {6,-2}, {4,0}, {5,0}};
-      ExtendedChannelMapping(buffer, 8, map);
+      ExtendedChannelMapping(buffer, 8, map, &m_BufferArena);
       buffer->dwChannelMask = AV_CH_LAYOUT_7POINT1;
     } else if (buffer->dwChannelMask == AV_CH_LAYOUT_6POINT1) {
       ExtendedChannelMap map = {{0,0}, {1,0}, {2,0}, {3,0}, {4,-2}, {4,-2}, {5,0}, {6,0}};
-      ExtendedChannelMapping(buffer, 8, map);
+      ExtendedChannelMapping(buffer, 8, map, &m_BufferArena);
       buffer->dwChannelMask = AV_CH_LAYOUT_7POINT1;
     }
   }
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include "BufferArena.h"
+
 struct BufferDetails;
 
 typedef int ChannelMap[8];
@@ -42,5 +44,5 @@ inline void ExtChMapClear(ExtendedChannelMap *map)
   }
 }
 
-HRESULT ChannelMapping(BufferDetails *pcm, unsigned uOutChannels, const ChannelMap map);
-HRESULT ExtendedChannelMapping(BufferDetails *pcm, unsigned uOutChannels, const ExtendedChannelMap extMap);
+HRESULT ChannelMapping(BufferDetails *pcm, unsigned uOutChannels, const ChannelMap map, CBufferArena *pArena = nullptr);
+HRESULT ExtendedChannelMapping(BufferDetails *pcm, unsigned uOutChannels, const ExtendedChannelMap extMap, CBufferArena *pArena = nullptr);
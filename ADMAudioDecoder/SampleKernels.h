@@ -0,0 +1,186 @@
+/*
+ *      Copyright (C) 2010-2019 Hendrik Leppkes
+ *      http://www.1f0.de
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+// Sample processing loops of the post-processor and the volume statistics.
+// The SSE2 kernels only process whole blocks and return how many samples they covered,
+// the caller finishes the rest with the scalar code they have to match bit for bit.
+
+#include <emmintrin.h>
+
+// PCM Volume Adjustment Factors, both for integer and float math
+// entries start at 2 channel mixing, half volume
+static int pcm_volume_adjust_integer[7] = {
+  362, 443, 512, 572, 627, 677, 724
+};
+
+static float pcm_volume_adjust_float[7] = {
+  1.41421356f, 1.73205081f, 2.00000000f, 2.23606798f, 2.44948974f, 2.64575131f, 2.82842712f
+};
+
+// 24-bit samples are copied as a whole, without any interpretation
+#pragma pack(push, 1)
+struct Sample24 { BYTE b[3]; };
+#pragma pack(pop)
+
+//
+// Typed channel remapping loop, the sample size is known at compile time
+//
+template <typename T>
+static void RemapChannels(T *pOut, const T *pIn, unsigned nSamples, unsigned uInChannels, unsigned uOutChannels, const int *idx, T silence)
+{
+  for (unsigned i = 0; i < nSamples; ++i) {
+    for (unsigned ch = 0; ch < uOutChannels; ++ch)
+      pOut[ch] = idx[ch] >= 0 ? pIn[idx[ch]] : silence;
+    pOut += uOutChannels;
+    pIn += uInChannels;
+  }
+}
+
+//
+// Volume adjustment of interleaved float samples, bit-exact to SampleCopyAdjust
+// The per-channel factors repeat every uChannels samples, so the SSE2 loop works on blocks of
+// 4 * uChannels samples, using one multiplier/divisor/mask vector per 4 samples in the block.
+// Channels without adjustment are passed through unclipped.
+// Returns the number of samples adjusted, the samples after the last whole block are left to the caller.
+//
+static size_t AdjustVolumeFloat(float *pBuffer, size_t nTotal, unsigned uChannels, const int *factor)
+{
+  alignas(16) float mul[32], div[32];
+  alignas(16) int mask[32];
+  const unsigned nBlock = uChannels * 4;
+  for (unsigned i = 0; i < nBlock; ++i) {
+    const int f = factor[i % uChannels];
+    mask[i] = abs(f) > 1 ? -1 : 0;
+    mul[i] = f > 1 ? pcm_volume_adjust_float[f - 2] : 1.0f;
+    div[i] = f < -1 ? pcm_volume_adjust_float[-f - 2] : 1.0f;
+  }
+
+  const __m128 vMin = _mm_set1_ps(-1.0f);
+  const __m128 vMax = _mm_set1_ps(1.0f);
+  size_t n = 0;
+  for (; n + nBlock <= nTotal; n += nBlock) {
+    for (unsigned i = 0; i < nBlock; i += 4) {
+      __m128 in = _mm_loadu_ps(pBuffer + n + i);
+      __m128 out = _mm_div_ps(_mm_mul_ps(in, _mm_load_ps(mul + i)), _mm_load_ps(div + i));
+      out = _mm_min_ps(_mm_max_ps(out, vMin), vMax);
+      __m128 m = _mm_castsi128_ps(_mm_load_si128((const __m128i *)(mask + i)));
+      _mm_storeu_ps(pBuffer + n + i, _mm_or_ps(_mm_and_ps(m, out), _mm_andnot_ps(m, in)));
+    }
+  }
+  return n;
+}
+
+//
+// Volume adjustment of interleaved 16-bit samples, bit-exact to SampleCopyAdjust
+// Amplification (sample * factor >> 8) is done with 16x16->32 multiplies, attenuation ((sample << 8) / factor)
+// through a float division: the quotient is at most 2^23/362, so the float result is always closer than
+// 1/724 to the exact one and truncates to the same integer. packs_epi32 performs the int16 clipping.
+// Returns the number of samples adjusted, the samples after the last whole block are left to the caller.
+//
+static size_t AdjustVolume16(int16_t *pBuffer, size_t nTotal, unsigned uChannels, const int *factor)
+{
+  alignas(16) int16_t mul[64];
+  alignas(16) float div[64];
+  alignas(16) int mask[64];
+  const unsigned nBlock = uChannels * 8;
+  for (unsigned i = 0; i < nBlock; ++i) {
+    const int f = factor[i % uChannels];
+    mul[i] = f > 1 ? (int16_t)pcm_volume_adjust_integer[f - 2] : 256;
+    div[i] = f < -1 ? (float)pcm_volume_adjust_integer[-f - 2] : 256.0f;
+    mask[i] = f < -1 ? -1 : 0;
+  }
+
+  size_t n = 0;
+  for (; n + nBlock <= nTotal; n += nBlock) {
+    for (unsigned i = 0; i < nBlock; i += 8) {
+      __m128i in = _mm_loadu_si128((const __m128i *)(pBuffer + n + i));
+      __m128i m = _mm_load_si128((const __m128i *)(mul + i));
+      __m128i lo = _mm_mullo_epi16(in, m);
+      __m128i hi = _mm_mulhi_epi16(in, m);
+      __m128i a0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+      __m128i a1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+
+      __m128i s0 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16), 8);
+      __m128i s1 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16), 8);
+      __m128i d0 = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(s0), _mm_load_ps(div + i)));
+      __m128i d1 = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(s1), _mm_load_ps(div + i + 4)));
+
+      __m128i m0 = _mm_load_si128((const __m128i *)(mask + i));
+      __m128i m1 = _mm_load_si128((const __m128i *)(mask + i + 4));
+      a0 = _mm_or_si128(_mm_and_si128(m0, d0), _mm_andnot_si128(m0, a0));
+      a1 = _mm_or_si128(_mm_and_si128(m1, d1), _mm_andnot_si128(m1, a1));
+      _mm_storeu_si128((__m128i *)(pBuffer + n + i), _mm_packs_epi32(a0, a1));
+    }
+  }
+  return n;
+}
+
+// Load the first 8 samples of one frame as float, converted exactly like get_sample_from_buffer
+template <typename T>
+static inline void load_frame_sse2(const BYTE * const pBuffer, __m128 &lo, __m128 &hi);
+
+template <>
+inline void load_frame_sse2<float>(const BYTE * const pBuffer, __m128 &lo, __m128 &hi)
+{
+  lo = _mm_loadu_ps((const float *)pBuffer);
+  hi = _mm_loadu_ps((const float *)pBuffer + 4);
+}
+
+template <>
+inline void load_frame_sse2<int16_t>(const BYTE * const pBuffer, __m128 &lo, __m128 &hi)
+{
+  const __m128 scale = _mm_set1_ps((float)INT16_MAX);
+  __m128i in = _mm_loadu_si128((const __m128i *)pBuffer);
+  lo = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16)), scale);
+  hi = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16)), scale);
+}
+
+template <>
+inline void load_frame_sse2<int32_t>(const BYTE * const pBuffer, __m128 &lo, __m128 &hi)
+{
+  const __m128 scale = _mm_set1_ps((float)INT32_MAX);
+  lo = _mm_div_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)pBuffer)), scale);
+  hi = _mm_div_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)pBuffer + 1)), scale);
+}
+
+// Sum of the squared samples of every channel (up to 8), for samples of type T
+// The SSE2 loop processes one frame per iteration, with one lane per channel, so that every channel
+// is still summed in sample order and the result is identical to the scalar loop.
+// Sets all 8 sums, and returns the number of frames summed, the remaining frames are left to the caller.
+template <typename T>
+static DWORD sum_squares_sse2(const BYTE *pBuffer, DWORD nSamples, WORD wChannels, float *fChAvg)
+{
+  const size_t nTotal = (size_t)nSamples * wChannels;
+  DWORD i = 0;
+
+  // every load reads 8 samples, stop before reading past the end of the buffer
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  for (; (size_t)i * wChannels + 8 <= nTotal; ++i) {
+    __m128 lo, hi;
+    load_frame_sse2<T>(pBuffer, lo, hi);
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(lo, lo));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(hi, hi));
+    pBuffer += sizeof(T) * wChannels;
+  }
+  _mm_storeu_ps(fChAvg, acc0);
+  _mm_storeu_ps(fChAvg + 4, acc1);
+  return i;
+}
@@ -0,0 +1,159 @@
+/*
+ *      Copyright (C) 2010-2019 Hendrik Leppkes
+ *      http://www.1f0.de
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// CBufferArena: a long synthetic stream must reach a steady state without allocations,
+// and growth of a buffer while it is out of the arena must be counted.
+
+#include "DShowUtil.h"
+#include "growarray.h"
+#include "../BufferArena.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; \
+  } \
+} while (0)
+
+// The part of BufferDetails that deals with the arena
+struct Pcm {
+  GrowableArray<BYTE> *bBuffer;
+  DWORD dwLeasedSize;
+};
+
+static void Take(CBufferArena &arena, Pcm &pcm, DWORD dwSize)
+{
+  pcm.bBuffer = arena.Acquire(dwSize);
+  pcm.dwLeasedSize = pcm.bBuffer->GetAllocated();
+}
+
+// What ReplaceBuffer does after a post-processing step
+static void Replace(CBufferArena &arena, Pcm &pcm, DWORD dwSize)
+{
+  GrowableArray<BYTE> *out = arena.Acquire(dwSize);
+  out->SetSize(dwSize);
+  memcpy(out->Ptr(), pcm.bBuffer->Ptr(), min(dwSize, pcm.bBuffer->GetCount()));
+  arena.Release(pcm.bBuffer, pcm.dwLeasedSize);
+  pcm.bBuffer = out;
+  pcm.dwLeasedSize = out->GetAllocated();
+}
+
+// Decode, post-process and queue packets the way CLAVAudio does, with frame sizes of the
+// common codecs and a changing channel count.
+static void TestSteadyState()
+{
+  static const DWORD frameSamples[] = { 1024, 1152, 1536, 2048, 512 };
+  static const DWORD channels[] = { 2, 6, 8 };
+  const int nWarmup = 1000, nPackets = 200000;
+
+  CBufferArena arena;
+  Pcm queue = { new GrowableArray<BYTE>(), 0 };
+  DWORD dwQueued = 0;
+  DWORD dwAfterWarmup = 0;
+  unsigned seed = 1;
+
+  for (int n = 0; n < nWarmup + nPackets; n++) {
+    if (n == nWarmup)
+      dwAfterWarmup = arena.GetAllocations();
+
+    seed = seed * 1103515245 + 12345;
+    const DWORD nSamples = frameSamples[(seed >> 16) % 5];
+    const DWORD nChannels = channels[(seed >> 8) % 3];
+
+    // decode into a buffer taken with no size hint, 16-bit samples
+    Pcm out;
+    Take(arena, out, 0);
+    out.bBuffer->SetSize(nSamples * nChannels * 2);
+
+    // channel remapping to 8 channels, then 24-bit padding
+    Replace(arena, out, nSamples * 8 * 2);
+    Replace(arena, out, nSamples * 8 * 4);
+
+    // retain the buffer in the output queue when it is empty, append otherwise
+    if (dwQueued == 0) {
+      GrowableArray<BYTE> *pTmp = queue.bBuffer;
+      queue.bBuffer = out.bBuffer;
+      out.bBuffer = pTmp;
+      DWORD dwTmp = queue.dwLeasedSize;
+      queue.dwLeasedSize = out.dwLeasedSize;
+      out.dwLeasedSize = dwTmp;
+    } else {
+      queue.bBuffer->Append(out.bBuffer);
+    }
+    dwQueued += nSamples;
+    out.bBuffer->SetSize(0);
+    arena.Release(out.bBuffer, out.dwLeasedSize);
+
+    // deliver about every 100 ms at 48 kHz
+    if (dwQueued >= 4800) {
+      queue.bBuffer->SetSize(0);
+      dwQueued = 0;
+    }
+  }
+
+  printf("steady state: %u allocations during warm-up, %u in %d packets after it, high-water mark %u bytes\n",
+         dwAfterWarmup, arena.GetAllocations() - dwAfterWarmup, nPackets, arena.GetHighWater());
+  CHECK(dwAfterWarmup > 0);
+  CHECK(arena.GetAllocations() == dwAfterWarmup);
+
+  delete queue.bBuffer;
+}
+
+// Each buffer carries its own record, however many are out of the arena at once.
+static void TestGrowthWhileLeased()
+{
+  const int nLeases = 32;
+  CBufferArena arena;
+  Pcm pcm[nLeases];
+
+  for (int i = 0; i < nLeases; i++)
+    Take(arena, pcm[i], 4096);
+  CHECK(arena.GetAllocations() == nLeases);
+
+  // the first buffer taken grows past its class, the others stay within it
+  pcm[0].bBuffer->SetSize(3 * 4096);
+  for (int i = 1; i < nLeases; i++)
+    pcm[i].bBuffer->SetSize(4096);
+
+  for (int i = 0; i < nLeases; i++)
+    arena.Release(pcm[i].bBuffer, pcm[i].dwLeasedSize);
+  CHECK(arena.GetAllocations() == nLeases + 1);
+
+  // buffers handed back come out again without another allocation
+  Take(arena, pcm[0], 4096);
+  CHECK(arena.GetAllocations() == nLeases + 1);
+  arena.Release(pcm[0].bBuffer, pcm[0].dwLeasedSize);
+}
+
+int main()
+{
+  TestSteadyState();
+  TestGrowthWhileLeased();
+
+  if (failures) {
+    fprintf(stderr, "BufferArenaTest: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("BufferArenaTest: OK\n");
+  return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ *      Copyright (C) 2010-2019 Hendrik Leppkes
+ *      http://www.1f0.de
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// The SSE2 kernels of SampleKernels.h must produce the same bits as the scalar loops they replaced.
+// Run with --bench to also measure their throughput against those loops.
+
+// the standard headers come first, before the shim defines min and max like <Windows.h> does
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "DShowUtil.h"
+#include "../SampleKernels.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; \
+  } \
+} while (0)
+
+static unsigned seed = 1;
+static unsigned Random()
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+//
+// Scalar references, as the post-processor and the volume statistics did it before the kernels
+//
+
+// ExtendedChannelMapping: one memcpy or silence per sample
+static void RefRemap(BYTE *pOut, const BYTE *pIn, unsigned nSamples, unsigned uInChannels, unsigned uOutChannels, const int *idx, unsigned uSampleSize)
+{
+  for (unsigned i = 0; i < nSamples; ++i) {
+    for (unsigned ch = 0; ch < uOutChannels; ++ch) {
+      if (idx[ch] >= 0)
+        memcpy(pOut, pIn + idx[ch] * uSampleSize, uSampleSize);
+      else
+        memset(pOut, uSampleSize == 1 ? 128 : 0, uSampleSize);
+      pOut += uSampleSize;
+    }
+    pIn += uSampleSize * uInChannels;
+  }
+}
+
+// SampleCopyAdjust for SampleFormat_FP32, av_clipf as in libavutil
+static void RefAdjustFloat(float *pSample, int iFactor)
+{
+  const int factorIndex = abs(iFactor) - 2;
+  float sample = *pSample;
+  if (iFactor > 0) {
+    sample *= pcm_volume_adjust_float[factorIndex];
+  } else {
+    sample /= pcm_volume_adjust_float[factorIndex];
+  }
+  *pSample = sample < -1.0f ? -1.0f : sample > 1.0f ? 1.0f : sample;
+}
+
+// SampleCopyAdjust for SampleFormat_16, SCALE_CA and av_clip_int16
+static void RefAdjust16(int16_t *pSample, int iFactor)
+{
+  const int factorIndex = abs(iFactor) - 2;
+  int32_t sample = *pSample;
+  if (iFactor > 0) {
+    sample *= pcm_volume_adjust_integer[factorIndex];
+    sample >>= 8;
+  } else {
+    sample <<= 8;
+    sample /= pcm_volume_adjust_integer[factorIndex];
+  }
+  *pSample = (int16_t)(sample < INT16_MIN ? INT16_MIN : sample > INT16_MAX ? INT16_MAX : sample);
+}
+
+// get_sample_from_buffer<float> for the formats the kernels cover
+template <typename T>
+static float RefSample(const BYTE *pBuffer);
+template <> float RefSample<float>(const BYTE *pBuffer) { return *(const float *)pBuffer; }
+template <> float RefSample<int16_t>(const BYTE *pBuffer) { float f = (float)*(const int16_t *)pBuffer; f /= INT16_MAX; return f; }
+template <> float RefSample<int32_t>(const BYTE *pBuffer) { float f = (float)*(const int32_t *)pBuffer; f /= INT32_MAX; return f; }
+
+// UpdateVolumeStats: one channel after the other, frame by frame
+template <typename T>
+static void RefSumSquares(const BYTE *pBuffer, DWORD nSamples, WORD wChannels, float *fChAvg, DWORD nStart = 0)
+{
+  pBuffer += (size_t)nStart * wChannels * sizeof(T);
+  for (DWORD i = nStart; i < nSamples; ++i) {
+    for (WORD ch = 0; ch < wChannels; ++ch) {
+      const float fSample = RefSample<T>(pBuffer);
+      fChAvg[ch] += fSample * fSample;
+      pBuffer += sizeof(T);
+    }
+  }
+}
+
+//
+// Kernels as the post-processor calls them, finishing with the scalar code
+//
+static void AdjustFloat(float *pBuffer, size_t nTotal, unsigned uChannels, const int *factor)
+{
+  size_t n = AdjustVolumeFloat(pBuffer, nTotal, uChannels, factor);
+  CHECK(n == nTotal - nTotal % (uChannels * 4));
+  for (; n < nTotal; ++n) {
+    if (factor[n % uChannels])
+      RefAdjustFloat(pBuffer + n, factor[n % uChannels]);
+  }
+}
+
+static void Adjust16(int16_t *pBuffer, size_t nTotal, unsigned uChannels, const int *factor)
+{
+  size_t n = AdjustVolume16(pBuffer, nTotal, uChannels, factor);
+  CHECK(n == nTotal - nTotal % (uChannels * 8));
+  for (; n < nTotal; ++n) {
+    if (factor[n % uChannels])
+      RefAdjust16(pBuffer + n, factor[n % uChannels]);
+  }
+}
+
+template <typename T>
+static void SumSquares(const BYTE *pBuffer, DWORD nSamples, WORD wChannels, float *fChAvg)
+{
+  DWORD i = sum_squares_sse2<T>(pBuffer, nSamples, wChannels, fChAvg);
+  RefSumSquares<T>(pBuffer, nSamples, wChannels, fChAvg, i);
+}
+
+static void RandomFactors(int *factor, unsigned uChannels)
+{
+  for (unsigned ch = 0; ch < uChannels; ++ch) {
+    const int f = (int)(Random() % 15) - 7; // -7 .. 7, -1 .. 1 mean no adjustment
+    factor[ch] = abs(f) > 1 ? (f > 0 ? f + 1 : f - 1) : 0;
+  }
+}
+
+static float RandomFloat()
+{
+  switch (Random() % 16) {
+  case 0: return 0.0f;
+  case 1: return -0.0f;
+  case 2: return 1.0f;
+  case 3: return -1.0f;
+  case 4: return 1e-40f; // denormal
+  }
+  return ((float)(Random() % 2000001) - 1000000.0f) / 700000.0f; // about -1.43 .. 1.43
+}
+
+template <typename T>
+static T RandomSample() { return (T)((Random() << 8) ^ Random()); }
+template <>
+float RandomSample<float>() { return RandomFloat() / 1.5f; }
+
+template <typename T>
+static void TestRemap(unsigned uSampleSize, T silence)
+{
+  std::vector<BYTE> in, out, ref;
+  for (int iter = 0; iter < 2000; ++iter) {
+    const unsigned uInChannels = 1 + Random() % 8, uOutChannels = 1 + Random() % 8;
+    const unsigned nSamples = Random() % 300;
+    int idx[8];
+    for (unsigned ch = 0; ch < uOutChannels; ++ch)
+      idx[ch] = (int)(Random() % (uInChannels + 1)) - 1;
+
+    in.resize(nSamples * uInChannels * uSampleSize + 1);
+    for (size_t i = 0; i < in.size(); ++i)
+      in[i] = (BYTE)Random();
+    out.assign(nSamples * uOutChannels * uSampleSize + 1, 0);
+    ref.assign(out.size(), 0);
+
+    RemapChannels<T>((T *)out.data(), (const T *)in.data(), nSamples, uInChannels, uOutChannels, idx, silence);
+    RefRemap(ref.data(), in.data(), nSamples, uInChannels, uOutChannels, idx, uSampleSize);
+    CHECK(out == ref);
+  }
+}
+
+static void TestAdjustFloat()
+{
+  std::vector<float> buf, ref;
+  for (int iter = 0; iter < 2000; ++iter) {
+    const unsigned uChannels = 1 + Random() % 8;
+    const size_t nTotal = (Random() % 300) * uChannels;
+    int factor[8];
+    RandomFactors(factor, uChannels);
+
+    buf.resize(nTotal);
+    for (size_t n = 0; n < nTotal; ++n)
+      buf[n] = RandomFloat();
+    ref = buf;
+
+    AdjustFloat(buf.data(), nTotal, uChannels, factor);
+    for (size_t n = 0; n < nTotal; ++n) {
+      if (factor[n % uChannels])
+        RefAdjustFloat(&ref[n], factor[n % uChannels]);
+    }
+    CHECK(nTotal == 0 || memcmp(buf.data(), ref.data(), nTotal * sizeof(float)) == 0);
+  }
+}
+
+static void TestAdjust16()
+{
+  // every 16-bit value with every factor
+  std::vector<int16_t> buf(65536), ref(65536);
+  for (int f = -8; f <= 8; ++f) {
+    if (abs(f) <= 1)
+      continue;
+    for (int v = 0; v < 65536; ++v)
+      buf[v] = ref[v] = (int16_t)(v - 32768);
+    const int factor[1] = { f };
+    Adjust16(buf.data(), buf.size(), 1, factor);
+    for (size_t n = 0; n < ref.size(); ++n)
+      RefAdjust16(&ref[n], f);
+    CHECK(buf == ref);
+  }
+
+  // mixed factors over interleaved channels
+  for (int iter = 0; iter < 2000; ++iter) {
+    const unsigned uChannels = 1 + Random() % 8;
+    const size_t nTotal = (Random() % 300) * uChannels;
+    int factor[8];
+    RandomFactors(factor, uChannels);
+
+    buf.resize(nTotal);
+    for (size_t n = 0; n < nTotal; ++n)
+      buf[n] = (int16_t)Random();
+    ref = buf;
+
+    Adjust16(buf.data(), nTotal, uChannels, factor);
+    for (size_t n = 0; n < nTotal; ++n) {
+      if (factor[n % uChannels])
+        RefAdjust16(&ref[n], factor[n % uChannels]);
+    }
+    CHECK(buf == ref);
+  }
+}
+
+template <typename T>
+static void TestSumSquares()
+{
+  std::vector<T> in;
+  for (int iter = 0; iter < 2000; ++iter) {
+    const WORD wChannels = (WORD)(1 + Random() % 8);
+    const DWORD nSamples = Random() % 300;
+    in.resize((size_t)nSamples * wChannels);
+    for (size_t n = 0; n < in.size(); ++n)
+      in[n] = RandomSample<T>();
+
+    float fChAvg[8] = { 0.0f }, fRef[8] = { 0.0f };
+    SumSquares<T>((const BYTE *)in.data(), nSamples, wChannels, fChAvg);
+    RefSumSquares<T>((const BYTE *)in.data(), nSamples, wChannels, fRef);
+    CHECK(memcmp(fChAvg, fRef, wChannels * sizeof(float)) == 0);
+  }
+}
+
+//
+// Throughput in samples per second, 8 channel frames of 1536 samples
+//
+// results of the sums are stored here, so that the compiler cannot drop them
+static volatile float fSink;
+
+template <typename F>
+static double MSamplesPerSecond(size_t nSamplesPerCall, F f)
+{
+  const int nCalls = 2000;
+  f(); // warm up
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nCalls; ++i)
+    f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return nSamplesPerCall * nCalls / elapsed.count() / 1e6;
+}
+
+static void Benchmark()
+{
+  const unsigned nFrames = 1536, uChannels = 8;
+  const size_t nTotal = nFrames * uChannels;
+  const int idx[8] = { 1, 0, 2, 3, 6, 7, 4, 5 };
+  const int factor[8] = { -2, -2, 0, 3, 0, -4, 8, -8 };
+
+  std::vector<float> f(nTotal), fOut(nTotal);
+  std::vector<int16_t> s(nTotal), sOut(nTotal);
+  std::vector<int32_t> i32(nTotal);
+  // audio-like float samples, without the denormals and special values of the tests
+  for (size_t n = 0; n < nTotal; ++n) {
+    f[n] = ((float)(Random() % 2000001) - 1000000.0f) / 1000000.0f;
+    s[n] = RandomSample<int16_t>();
+    i32[n] = RandomSample<int32_t>();
+  }
+  float fChAvg[8];
+
+  printf("%-28s %12s %12s\n", "Msamples/s", "scalar", "kernel");
+  printf("%-28s %12.0f %12.0f\n", "remap 16-bit",
+         MSamplesPerSecond(nTotal, [&] { RefRemap((BYTE *)sOut.data(), (const BYTE *)s.data(), nFrames, uChannels, uChannels, idx, 2); }),
+         MSamplesPerSecond(nTotal, [&] { RemapChannels<int16_t>(sOut.data(), s.data(), nFrames, uChannels, uChannels, idx, 0); }));
+  printf("%-28s %12.0f %12.0f\n", "remap float",
+         MSamplesPerSecond(nTotal, [&] { RefRemap((BYTE *)fOut.data(), (const BYTE *)f.data(), nFrames, uChannels, uChannels, idx, 4); }),
+         MSamplesPerSecond(nTotal, [&] { RemapChannels<int32_t>((int32_t *)fOut.data(), (const int32_t *)f.data(), nFrames, uChannels, uChannels, idx, 0); }));
+  printf("%-28s %12.0f %12.0f\n", "volume float",
+         MSamplesPerSecond(nTotal, [&] { fOut = f; for (size_t n = 0; n < nTotal; ++n) if (factor[n % uChannels]) RefAdjustFloat(&fOut[n], factor[n % uChannels]); }),
+         MSamplesPerSecond(nTotal, [&] { fOut = f; AdjustFloat(fOut.data(), nTotal, uChannels, factor); }));
+  printf("%-28s %12.0f %12.0f\n", "volume 16-bit",
+         MSamplesPerSecond(nTotal, [&] { sOut = s; for (size_t n = 0; n < nTotal; ++n) if (factor[n % uChannels]) RefAdjust16(&sOut[n], factor[n % uChannels]); }),
+         MSamplesPerSecond(nTotal, [&] { sOut = s; Adjust16(sOut.data(), nTotal, uChannels, factor); }));
+  printf("%-28s %12.0f %12.0f\n", "sum of squares float",
+         MSamplesPerSecond(nTotal, [&] { memset(fChAvg, 0, sizeof(fChAvg)); RefSumSquares<float>((const BYTE *)f.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }),
+         MSamplesPerSecond(nTotal, [&] { SumSquares<float>((const BYTE *)f.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }));
+  printf("%-28s %12.0f %12.0f\n", "sum of squares 16-bit",
+         MSamplesPerSecond(nTotal, [&] { memset(fChAvg, 0, sizeof(fChAvg)); RefSumSquares<int16_t>((const BYTE *)s.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }),
+         MSamplesPerSecond(nTotal, [&] { SumSquares<int16_t>((const BYTE *)s.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }));
+  printf("%-28s %12.0f %12.0f\n", "sum of squares 32-bit",
+         MSamplesPerSecond(nTotal, [&] { memset(fChAvg, 0, sizeof(fChAvg)); RefSumSquares<int32_t>((const BYTE *)i32.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }),
+         MSamplesPerSecond(nTotal, [&] { SumSquares<int32_t>((const BYTE *)i32.data(), nFrames, uChannels, fChAvg); fSink = fChAvg[0]; }));
+}
+
+int main(int argc, char **argv)
+{
+  TestRemap<uint8_t>(1, 128U);
+  TestRemap<int16_t>(2, 0);
+  TestRemap<Sample24>(3, Sample24());
+  TestRemap<int32_t>(4, 0);
+  TestAdjustFloat();
+  TestAdjust16();
+  TestSumSquares<float>();
+  TestSumSquares<int16_t>();
+  TestSumSquares<int32_t>();
+
+  if (failures) {
+    fprintf(stderr, "SampleKernelsTest: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("SampleKernelsTest: OK\n");
+
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    Benchmark();
+  return 0;
+}
@@ -75,6 +75,18 @@ interface __declspec(uuid("5EFA6C3B-E602-4DB1-9C37-83B2B499CEEC")) ILAVVideoConf
     // Set|Get the decode output buffer count
     STDMETHOD(SetOutputBufferCount)(int count) = 0;
     STDMETHOD_(int, GetOutputBufferCount)() = 0;
+
+    // Set the region of interest for digital zoom, in normalized frame coordinates [0,1].
+    // Only this region is converted to RGB. Samples carry the region in pixels in rcSource of
+    // their media type whenever it changes. (0,0,1,1) converts the whole frame.
+    STDMETHOD(SetCropRect)(float left, float top, float right, float bottom) = 0;
+
+    // Set|Get the number of decoding threads, 0 = one per core. Frame threading decodes several
+    // independent pictures (e.g. the tiles of a still image) at once but delays the output by
+    // as many frames, so live streams keep the default of 1. Takes effect when the decoder is
+    // (re)initialized, i.e. on connection or on the next format change.
+    STDMETHOD(SetDecodeThreads)(int count) = 0;
+    STDMETHOD_(int, GetDecodeThreads)() = 0;
 };
 
 // LAV Video status interface
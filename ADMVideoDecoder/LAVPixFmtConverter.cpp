@@ -181,18 +181,80 @@ void CLAVPixFmtConverter::SelectConvertFunction()
     }
 }
 
+void CLAVPixFmtConverter::SetCropRect(float left, float top, float right, float bottom)
+{
+    CAutoLock lock(&m_csCrop);
+    m_cropRect[0] = left;
+    m_cropRect[1] = top;
+    m_cropRect[2] = right;
+    m_cropRect[3] = bottom;
+}
+
+BOOL CLAVPixFmtConverter::UpdateCropRect(int width, int height, RECT* rc)
+{
+    RECT r = { 0, 0, width, height };
+    // ֻRGBתּ֧
+    if (m_bRGBConverter) {
+        CAutoLock lock(&m_csCrop);
+        r.left = (LONG)(m_cropRect[0] * width + 0.5f);
+        r.top = (LONG)(m_cropRect[1] * height + 0.5f);
+        r.right = (LONG)(m_cropRect[2] * width + 0.5f);
+        r.bottom = (LONG)(m_cropRect[3] * height + 0.5f);
+    }
+    // ٱһ4x2ؿ
+    r.left = max(0, min(r.left, (LONG)width - 4));
+    r.top = max(0, min(r.top, (LONG)height - 2));
+    r.right = max(r.left + 4, min(r.right, (LONG)width));
+    r.bottom = max(r.top + 2, min(r.bottom, (LONG)height));
+
+    BOOL bChanged = !EqualRect(&r, &m_rcCrop);
+    m_rcCrop = r;
+    *rc = r;
+    return bChanged;
+}
+
+// ʵתʾ뵽4x2ؿ飨һ4RGB32أ4:2:0йһɫȣ
+// תԵһɫȣҲһУұߺ±߸תһ飬ʾ֮⡣
+RECT CLAVPixFmtConverter::GetConvertRect(int width, int height)
+{
+    RECT rc = m_rcCrop;
+    if (IsRectEmpty(&rc)) {
+        SetRect(&rc, 0, 0, width, height);
+    }
+    rc.left &= ~3;
+    rc.top &= ~1;
+    rc.right = min(FFALIGN(rc.right, 4) + 4, (LONG)width);
+    rc.bottom = min(FFALIGN(rc.bottom, 2) + 2, (LONG)height);
+    return rc;
+}
+
 HRESULT CLAVPixFmtConverter::Convert(const BYTE* const src[4], const ptrdiff_t srcStride[4],
-    uint8_t* dst, int width, int height, ptrdiff_t dstStride, int planeHeight)
+    uint8_t* dst, int width, int height, ptrdiff_t dstStride, int planeHeight, BOOL bFlip)
 {
     HRESULT hr = S_OK;
 
-    uint8_t* out = dst;
-    ptrdiff_t outStride = dstStride, i;
     planeHeight = max(height, planeHeight);
     LAVOutPixFmtDesc& desc = g_lav_out_pixfmt_desc[m_OutputPixFmt];
 
+    // úͷתֻRGBתƽrcdstжӦλã
+    // תʱͼĵyڻĵheight-1-yУԸдʡȥת֡תһ鿽
+    RECT rc = { 0, 0, width, height };
+    if (m_bRGBConverter) {
+        rc = GetConvertRect(width, height);
+    }
+    else {
+        bFlip = FALSE;
+    }
+    int cropWidth = rc.right - rc.left;
+    int cropHeight = rc.bottom - rc.top;
+    uint8_t* cropDst = dst + (bFlip ? height - 1 - rc.top : rc.top) * dstStride * desc.codedbytes + rc.left * desc.codedbytes;
+    ptrdiff_t cropStride = bFlip ? -dstStride : dstStride;
+
+    uint8_t* out = cropDst;
+    ptrdiff_t outStride = cropStride, i;
+
     // Check if we have proper pixel alignment and the dst memory is actually aligned
-    if (m_RequiredAlignment && (FFALIGN(dstStride, m_RequiredAlignment) != dstStride || ((uintptr_t)dst % 16u))) {
+    if (m_RequiredAlignment && (FFALIGN(dstStride, m_RequiredAlignment) != dstStride || ((uintptr_t)cropDst % 16u))) {
         outStride = FFALIGN(dstStride, m_RequiredAlignment);
         size_t requiredSize = (outStride * planeHeight * desc.bpp) >> 3;
         if (requiredSize > m_nAlignedBufferSize || !m_pAlignedBuffer) {
@@ -221,11 +283,11 @@ HRESULT CLAVPixFmtConverter::Convert(const BYTE* const src[4], const ptrdiff_t s
     }
 
     if (m_bRGBConverter) {
-        hr = convert_yuv_to_rgb(src, srcStride, dstArray, dstStrideArray, width, height, m_InputPixFmt, m_InBpp, m_OutputPixFmt);
+        hr = convert_yuv_to_rgb(src, srcStride, dstArray, dstStrideArray, width, height, rc, m_InputPixFmt, m_InBpp, m_OutputPixFmt);
     }
 
-    if (out != dst) {
-        ChangeStride(out, outStride, dst, dstStride, width, height, planeHeight, m_OutputPixFmt);
+    if (out != cropDst) {
+        ChangeStride(out, outStride, cropDst, cropStride, cropWidth, cropHeight, planeHeight, m_OutputPixFmt);
     }
 
     return hr;
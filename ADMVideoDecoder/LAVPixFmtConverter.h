@@ -99,8 +99,14 @@ public:
         DWORD dwAspectX, DWORD dwAspectY, REFERENCE_TIME rtAvgTime);
     BOOL IsAllowedSubtype(const GUID* guid);
 
+    // bFlipΪʱԵϵDIBRGB32Чʱֻתಿֱֲ䡣
     HRESULT Convert(const uint8_t* const src[4], const ptrdiff_t srcStride[4],
-        uint8_t* dst, int width, int height, ptrdiff_t dstStride, int planeHeight);
+        uint8_t* dst, int width, int height, ptrdiff_t dstStride, int planeHeight, BOOL bFlip);
+
+    // ֱ佹ֻת֡ڵһ򣬹һ꣬(0,0,1,1)Ϊ̵֡߳ãһ֡Ч
+    void SetCropRect(float left, float top, float right, float bottom);
+    // ֡ߴ֡ʾһ֡ͬʱTRUEֻڽ̵߳á
+    BOOL UpdateCropRect(int width, int height, RECT* rc);
 
     BOOL IsRGBConverterActive() { return m_bRGBConverter; }
     DWORD GetImageSize(int width, int height, LAVOutPixFmts pixFmt = LAVOutPixFmt_None);
@@ -118,9 +124,10 @@ private:
 
     void SelectConvertFunction();
     void ChangeStride(const uint8_t* src, ptrdiff_t srcStride, uint8_t* dst, ptrdiff_t dstStride, int width, int height, int planeHeight, LAVOutPixFmts format);
+    RECT GetConvertRect(int width, int height);
 
-    // һתһ֡
-    HRESULT convert_yuv_to_rgb(const uint8_t* const src[4], const ptrdiff_t srcStride[4], uint8_t* dst[4], const ptrdiff_t dstStride[4], int width, int height, LAVPixelFormat inputFormat, int bpp, LAVOutPixFmts outputFormat);
+    // һתһֻ֡תrcdstָrcϽǶӦء
+    HRESULT convert_yuv_to_rgb(const uint8_t* const src[4], const ptrdiff_t srcStride[4], uint8_t* dst[4], const ptrdiff_t dstStride[4], int width, int height, const RECT& rc, LAVPixelFormat inputFormat, int bpp, LAVOutPixFmts outputFormat);
 
     const RGBCoeffs* getRGBCoeffs(int width, int height);
     const uint16_t* GetRandomDitherCoeffs(int height, int coeffs, int bits, int line);
@@ -141,6 +148,10 @@ private:
     RGBCoeffs* m_rgbCoeffs = nullptr;
     BOOL m_bRGBConverter = FALSE;
 
+    CCritSec m_csCrop;
+    float m_cropRect[4] = { 0, 0, 1, 1 }; // ļ򣨹һleft,top,right,bottom
+    RECT m_rcCrop = { 0 }; // ǰ֡ʾ򣬿վαʾ֡
+
     uint16_t* m_pRandomDithers = nullptr;
     int m_ditherWidth = 0;
     int m_ditherHeight = 0;
@@ -973,6 +973,13 @@ HRESULT CLAVVideo::DeliverToRenderer(LAVFrame* pFrame)
     BITMAPINFOHEADER* bih = nullptr;
     videoFormatTypeHandler(mt.Format(), mt.FormatType(), &bih);
 
+    // ֱ佹ֻתʾ仯ʱýͣrcSourceΪµʾ
+    // Ⱦʼȡ棬֮ǰŶӵ԰֡
+    RECT rcCrop;
+    if (m_PixFmtConverter.UpdateCropRect(width, height, &rcCrop)) {
+        m_bSendMediaType = TRUE;
+    }
+
     // ظʽת
     {
         long required = m_PixFmtConverter.GetImageSize(bih->biWidth, abs(bih->biHeight));
@@ -986,20 +993,20 @@ HRESULT CLAVVideo::DeliverToRenderer(LAVFrame* pFrame)
         pSampleOut->SetActualDataLength(required);
 
         // תд뵽pDataOutеġ
-        m_PixFmtConverter.Convert(pFrame->data, pFrame->stride, pDataOut, width, height, bih->biWidth, abs(bih->biHeight));
+        // ߴ0ĬΪôŷʽҪ·תתʱֱӰõ
+        BOOL bFlip = (mt.subtype == MEDIASUBTYPE_RGB32 && bih->biHeight > 0);
+        m_PixFmtConverter.Convert(pFrame->data, pFrame->stride, pDataOut, width, height, bih->biWidth, abs(bih->biHeight), bFlip);
 
         FreeLAVFrameBuffers(pFrame);
-
-        // ߴ0ĬΪôŷʽҪ·ת
-        if (mt.subtype == MEDIASUBTYPE_RGB32 && bih->biHeight > 0) {
-            flip_plane(pDataOut, bih->biWidth * 4, height);
-        }
     } // end if(ģʽ)
 
     BOOL bSizeChanged = FALSE;
     // µý͸ʽϢõIMediaSample*С
     if (m_bSendMediaType) {
         AM_MEDIA_TYPE* sendmt = CreateMediaType(&mt);
+        if (sendmt != nullptr && sendmt->formattype == FORMAT_VideoInfo2) {
+            ((VIDEOINFOHEADER2*)sendmt->pbFormat)->rcSource = rcCrop;
+        }
         pSampleOut->SetMediaType(sendmt); // ̫ˣȻÿһýЯƵʽϢ
         // ȾͨIMediaSample2::GetPropertiesӿڻȡܶмֵϢ
         DeleteMediaType(sendmt);
@@ -1105,6 +1112,27 @@ STDMETHODIMP_(int) CLAVVideo::GetOutputBufferCount()
     return m_config.OutputBufferCount;
 }
 
+STDMETHODIMP CLAVVideo::SetCropRect(float left, float top, float right, float bottom)
+{
+    if (!(left >= 0 && left < right && right <= 1 && top >= 0 && top < bottom && bottom <= 1))
+        return E_INVALIDARG;
+    m_PixFmtConverter.SetCropRect(left, top, right, bottom);
+    return S_OK;
+}
+
+STDMETHODIMP CLAVVideo::SetDecodeThreads(int count)
+{
+    if (count < 0)
+        return E_INVALIDARG;
+    m_config.DecodeThreads = count;
+    return S_OK;
+}
+
+STDMETHODIMP_(int) CLAVVideo::GetDecodeThreads()
+{
+    return m_config.DecodeThreads;
+}
+
 HRESULT WINAPI LAVVideo_CreateInstance(IBaseFilter** ppObj)
 {
     HRESULT hr = S_OK;
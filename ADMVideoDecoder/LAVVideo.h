@@ -71,6 +71,9 @@ public:
     STDMETHODIMP_(LAVDitherMode) GetDitherMode();
     STDMETHODIMP SetOutputBufferCount(int count);
     STDMETHODIMP_(int) GetOutputBufferCount();
+    STDMETHODIMP SetCropRect(float left, float top, float right, float bottom);
+    STDMETHODIMP SetDecodeThreads(int count);
+    STDMETHODIMP_(int) GetDecodeThreads();
 
 
     // ILAVVideoStatus
@@ -182,5 +185,6 @@ private:
         DWORD RGBRange = 2;
         DWORD DitherMode = LAVDither_Random;
         int OutputBufferCount = 5;
+        int DecodeThreads = 1;
     } m_config;
 };
@@ -250,6 +250,11 @@ interface ILAVVideoCallback
      * Check if the input is using a dynamic allocator
      */
     STDMETHOD_(BOOL, HasDynamicInputAllocator)() PURE;
+
+    /**
+     * Get the number of decoding threads, 0 for one per core
+     */
+    STDMETHOD_(int, GetDecodeThreads)() PURE;
 };
 
 /**
@@ -217,7 +217,7 @@ STDMETHODIMP CDecAvcodec::InitDecoder(AVCodecID codec, const CMediaType* pmt)
     m_pAVCtx->err_recognition = 0;
     m_pAVCtx->workaround_bugs = FF_BUG_AUTODETECT;
     //m_pAVCtx->refcounted_frames     = 1;
-    m_pAVCtx->thread_count = 1;
+    m_pAVCtx->thread_count = m_pCallback->GetDecodeThreads();
 
     m_pFrame = av_frame_alloc();
     CheckPointer(m_pFrame, E_POINTER);
@@ -344,6 +344,11 @@ STDMETHODIMP CDecAvcodec::DestroyDecoder()
     av_freep(&m_pFFBuffer);
     m_nFFBufferSize = 0;
 
+    av_freep(&m_pAUBuffer);
+    m_nAUBufferSize = 0;
+    m_nAUBufferLen = 0;
+    m_bAUPending = FALSE;
+
     m_nCodecId = AV_CODEC_ID_NONE;
 
     return S_OK;
@@ -361,9 +366,9 @@ static void avpacket_mediasample_free(void* opaque, uint8_t* buffer)
     SafeRelease(&pSample);
 }
 
-STDMETHODIMP CDecAvcodec::FillAVPacketData(AVPacket* avpkt, const uint8_t* buffer, int buflen, IMediaSample* pSample, bool bRefCounting)
+STDMETHODIMP CDecAvcodec::FillAVPacketData(AVPacket* avpkt, const uint8_t* buffer, int buflen, IMediaSample* pSample, bool bRefCounting, bool bPadded)
 {
-    if (m_bInputPadded && (m_pParser == nullptr))
+    if ((m_bInputPadded && (m_pParser == nullptr)) || bPadded)
     {
         avpkt->data = (uint8_t*)buffer;
         avpkt->size = buflen;
@@ -405,10 +410,42 @@ STDMETHODIMP CDecAvcodec::FillAVPacketData(AVPacket* avpkt, const uint8_t* buffe
     return S_OK;
 }
 
+static const MediaSideDataAccessUnit* GetAccessUnitSideData(IMediaSample* pSample)
+{
+    if (pSample == nullptr)
+        return nullptr;
+
+    const MediaSideDataAccessUnit* pAU = nullptr;
+    IMediaSideData* pSideData = nullptr;
+    if (SUCCEEDED(pSample->QueryInterface(&pSideData))) {
+        size_t nSize = 0;
+        if (FAILED(pSideData->GetSideData(IID_MediaSideDataAccessUnit, (const BYTE**)&pAU, &nSize)) || nSize != sizeof(MediaSideDataAccessUnit)) {
+            pAU = nullptr;
+        }
+        // the side data is owned by the sample, which outlives this call
+        SafeRelease(&pSideData);
+    }
+    return pAU;
+}
+
 STDMETHODIMP CDecAvcodec::Decode(const BYTE* buffer, int buflen, REFERENCE_TIME rtStartIn, REFERENCE_TIME rtStopIn, BOOL bSyncPoint, BOOL bDiscontinuity, IMediaSample* pSample)
 {
     CheckPointer(m_pAVCtx, E_UNEXPECTED);
 
+    // The source already marks access unit boundaries, so there is no need to run the parser
+    // to scan for start codes and split the stream again.
+    BOOL bAccessUnit = FALSE;
+    bool bPadded = false;
+    if (m_pParser && buffer) {
+        const MediaSideDataAccessUnit* pAU = GetAccessUnitSideData(pSample);
+        if (pAU) {
+            HRESULT hr = AssembleAccessUnit(pAU, &buffer, &buflen, &rtStartIn, &rtStopIn, &bSyncPoint, &bPadded);
+            if (hr != S_OK)
+                return SUCCEEDED(hr) ? S_OK : hr; // S_FALSE: access unit incomplete, wait for more fragments
+            bAccessUnit = TRUE;
+        }
+    }
+
     // Put timestamps into the buffers if appropriate
     if (m_pAVCtx->active_thread_type & FF_THREAD_FRAME)
     {
@@ -426,7 +463,7 @@ STDMETHODIMP CDecAvcodec::Decode(const BYTE* buffer, int buflen, REFERENCE_TIME
     }
 
     // if we have a parser, it'll handle calling the decode function
-    if (m_pParser)
+    if (m_pParser && !bAccessUnit)
     {
         return ParsePacket(buffer, buflen, rtStartIn, rtStopIn, pSample);
     }
@@ -442,7 +479,8 @@ STDMETHODIMP CDecAvcodec::Decode(const BYTE* buffer, int buflen, REFERENCE_TIME
         AVPacket* avpkt = av_packet_alloc();
 
         // set data pointers
-        if (FAILED(FillAVPacketData(avpkt, buffer, buflen, pSample, true)))
+        // an assembled access unit lives in our own buffer and cannot reference the sample
+        if (FAILED(FillAVPacketData(avpkt, buffer, buflen, pSample, buffer != m_pAUBuffer, bPadded)))
         {
             return E_OUTOFMEMORY;
         }
@@ -569,6 +607,55 @@ STDMETHODIMP CDecAvcodec::ParsePacket(const BYTE* buffer, int buflen, REFERENCE_
     return S_OK;
 }
 
+// Returns S_OK right away when a sample holds a complete access unit; with enough padding behind it
+// the sample is decoded in place. Otherwise the fragments are collected in m_pAUBuffer and S_FALSE is
+// returned until the last fragment arrives.
+STDMETHODIMP CDecAvcodec::AssembleAccessUnit(const MediaSideDataAccessUnit* pAU, const BYTE** pBuffer, int* pBuflen, REFERENCE_TIME* prtStart, REFERENCE_TIME* prtStop, BOOL* pbSyncPoint, bool* pbPadded)
+{
+    if (pAU->au_start && pAU->au_end) {
+        m_bAUPending = FALSE;
+        *pbPadded = (pAU->padding >= AV_INPUT_BUFFER_PADDING_SIZE);
+        return S_OK;
+    }
+
+    if (pAU->au_start) {
+        m_nAUBufferLen = 0;
+        m_bAUPending = TRUE;
+        m_bAUSyncPoint = FALSE;
+        m_rtAUStart = *prtStart;
+        m_rtAUStop = *prtStop;
+    }
+    else if (!m_bAUPending) {
+        // lost the beginning of this access unit, drop fragments until the next one starts
+        return S_FALSE;
+    }
+
+    BYTE* pBuf = (BYTE*)av_fast_realloc(m_pAUBuffer, &m_nAUBufferSize, m_nAUBufferLen + *pBuflen + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!pBuf) {
+        m_bAUPending = FALSE;
+        return E_OUTOFMEMORY;
+    }
+    m_pAUBuffer = pBuf;
+
+    memcpy(m_pAUBuffer + m_nAUBufferLen, *pBuffer, *pBuflen);
+    m_nAUBufferLen += *pBuflen;
+    m_bAUSyncPoint |= *pbSyncPoint;
+
+    if (!pAU->au_end)
+        return S_FALSE;
+
+    memset(m_pAUBuffer + m_nAUBufferLen, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    m_bAUPending = FALSE;
+
+    *pBuffer = m_pAUBuffer;
+    *pBuflen = m_nAUBufferLen;
+    *prtStart = m_rtAUStart;
+    *prtStop = m_rtAUStop;
+    *pbSyncPoint = m_bAUSyncPoint;
+    *pbPadded = true;
+    return S_OK;
+}
+
 STDMETHODIMP CDecAvcodec::DecodePacket(AVPacket* avpkt, REFERENCE_TIME rtStartIn, REFERENCE_TIME rtStopIn)
 {
     int ret = 0;
@@ -760,6 +847,8 @@ STDMETHODIMP CDecAvcodec::Flush()
 
     m_CurrentThread = 0;
     m_rtStartCache = AV_NOPTS_VALUE;
+    m_nAUBufferLen = 0;
+    m_bAUPending = FALSE;
     m_bWaitingForKeyFrame = TRUE;
     m_nSoftTelecine = 0;
 
@@ -25,6 +25,8 @@
 
 #define AVCODEC_MAX_THREADS 32
 
+struct MediaSideDataAccessUnit;
+
 typedef struct {
     REFERENCE_TIME rtStart;
     REFERENCE_TIME rtStop;
@@ -56,9 +58,10 @@ protected:
     virtual HRESULT HandleDXVA2Frame(LAVFrame* pFrame) { return S_FALSE; }
     STDMETHODIMP DestroyDecoder();
 
-    STDMETHODIMP FillAVPacketData(AVPacket* avpkt, const BYTE* buffer, int buflen, IMediaSample* pSample, bool bRefCounting);
+    STDMETHODIMP FillAVPacketData(AVPacket* avpkt, const BYTE* buffer, int buflen, IMediaSample* pSample, bool bRefCounting, bool bPadded = false);
     STDMETHODIMP DecodePacket(AVPacket* avpkt, REFERENCE_TIME rtStartIn, REFERENCE_TIME rtStopIn);
     STDMETHODIMP ParsePacket(const BYTE* buffer, int buflen, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, IMediaSample* pSample);
+    STDMETHODIMP AssembleAccessUnit(const MediaSideDataAccessUnit* pAU, const BYTE** pBuffer, int* pBuflen, REFERENCE_TIME* prtStart, REFERENCE_TIME* prtStop, BOOL* pbSyncPoint, bool* pbPadded);
 
 private:
     STDMETHODIMP ConvertPixFmt(AVFrame* pFrame, LAVFrame* pOutFrame);
@@ -76,6 +79,15 @@ private:
     BYTE* m_pFFBuffer = nullptr;
     UINT m_nFFBufferSize = 0;
 
+    // Access unit assembly, used when the source flags access unit boundaries
+    BYTE* m_pAUBuffer = nullptr;
+    UINT m_nAUBufferSize = 0;
+    int m_nAUBufferLen = 0;
+    BOOL m_bAUPending = FALSE;
+    BOOL m_bAUSyncPoint = FALSE;
+    REFERENCE_TIME m_rtAUStart = AV_NOPTS_VALUE;
+    REFERENCE_TIME m_rtAUStop = AV_NOPTS_VALUE;
+
     // Timing settings
     BOOL m_bFFReordering = FALSE;
     BOOL m_bCalculateStopTime = FALSE;
@@ -307,9 +307,10 @@ static int __stdcall yuv2rgb_convert(const uint8_t* srcY, const uint8_t* srcU, c
 }
 
 HRESULT CLAVPixFmtConverter::convert_yuv_to_rgb(const uint8_t* const src[4], const ptrdiff_t srcStride[4],
-    uint8_t* dst[4], const ptrdiff_t dstStride[4], int width, int height,
+    uint8_t* dst[4], const ptrdiff_t dstStride[4], int width, int height, const RECT& rc,
     LAVPixelFormat inputFormat, int bpp, LAVOutPixFmts outputFormat)
 {
+    // ϵ֡ߴѡȡδʱֱʲBT.601/BT.709佹ʱɫ䡣
     const RGBCoeffs* coeffs = getRGBCoeffs(width, height);
     if (coeffs == nullptr)
         return E_OUTOFMEMORY;
@@ -317,8 +318,14 @@ HRESULT CLAVPixFmtConverter::convert_yuv_to_rgb(const uint8_t* const src[4], con
     BOOL bYCgCo = (m_ColorProps.VideoTransferMatrix == 7);
     //const uint16_t* dithers = GetRandomDitherCoeffs(height, DITHER_STEPS * 3, 4, 0);
     const uint16_t* dithers = nullptr;
-    yuv2rgb_convert(src[0], src[1], src[2], dst[0], width, height,
-        srcStride[0], srcStride[1], dstStride[0], 0, height, coeffs, dithers);
+    // rcϽѶ뵽4x2ؿ飬ɫƽ水ֱƫơ
+    const uint8_t* srcY = src[0] + rc.top * srcStride[0] + rc.left;
+    const uint8_t* srcU = src[1] + (rc.top >> 1) * srcStride[1] + (rc.left >> 1);
+    const uint8_t* srcV = src[2] + (rc.top >> 1) * srcStride[1] + (rc.left >> 1);
+    int cropWidth = rc.right - rc.left;
+    int cropHeight = rc.bottom - rc.top;
+    yuv2rgb_convert(srcY, srcU, srcV, dst[0], cropWidth, cropHeight,
+        srcStride[0], srcStride[1], dstStride[0], 0, cropHeight, coeffs, dithers);
 
     return S_OK;
 }
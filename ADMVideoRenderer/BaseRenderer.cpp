@@ -36,11 +36,13 @@ namespace VideoRenderer {
 
     STDMETHODIMP CRendererInputPin::BeginFlush()
     {
-        CAutoLock channelLock(&m_pRenderer->m_InterfaceLock[m_channel]);
         {
+            CAutoLock channelLock(&m_pRenderer->m_InterfaceLock[m_channel]);
             CBaseInputPin::BeginFlush();
-            m_pRenderer->BeginFlush(m_channel);
         }
+        // ȴ߳˳ReceiveʱܳͨReceiveβʱҲҪȡ
+        // Ѿ˳ϴ־½Receiveء
+        m_pRenderer->BeginFlush(m_channel);
         return m_pRenderer->ResetEndOfStream(m_channel);
     }
 
@@ -484,10 +486,10 @@ namespace VideoRenderer {
         return S_OK;
     }
 
+    // ļԴλʱγϴBeginFlushѾ˴ֶвλEOS
+    // ûб״̬Ҫָλõ֡ճŶӳ֡
     HRESULT CBaseRenderer::EndFlush(int channel)
     {
-        // ν̬ʱڴ䳬100msȻûгɹ˷ͽ֪ͨ
-        ::DebugBreak();
         return S_OK;
     }
 
@@ -704,6 +706,10 @@ namespace VideoRenderer {
             ms->AddRef();
             m_isFirstSampleReceived[channel] = true;
         }
+        OnSampleReceived(channel, ms);
+        // ѵȴ̡֡߳
+        if (m_frameReadyEvent != NULL)
+            ::SetEvent(m_frameReadyEvent);
     }
 
     HRESULT CBaseRenderer::TryNotifyEndOfStream(int channel)
@@ -855,13 +861,70 @@ namespace VideoRenderer {
 
     void CBaseRenderer::CalcChannelLayout(int mode, int channel)
     {
-        const ViewportDesc_t& vd = _viewportDesc[mode][channel];
-        RECT& vr = _viewportRect[mode][channel];
+        CalcViewportRect(_viewportDesc[mode][channel], &_viewportRect[mode][channel]);
+    }
+
+    void CBaseRenderer::CalcViewportRect(const ViewportDesc_t& vd, RECT* vr)
+    {
         LONG tw = WIDTH(&_posRect);
         LONG th = HEIGHT(&_posRect);
-        vr.left = (LONG)(vd.x * tw + 0.999f);
-        vr.top = (LONG)(vd.y * th + 0.999f);
-        vr.right = vr.left + (LONG)(vd.w * tw + 0.999f);
-        vr.bottom = vr.top + (LONG)(vd.h * th + 0.999f);
+        vr->left = (LONG)(vd.x * tw + 0.999f);
+        vr->top = (LONG)(vd.y * th + 0.999f);
+        vr->right = vr->left + (LONG)(vd.w * tw + 0.999f);
+        vr->bottom = vr->top + (LONG)(vd.h * th + 0.999f);
+    }
+
+    // ̵߳áδǰĶݴϲύĸύġ
+    void CBaseRenderer::StageLayout(int mode, int count, const int* channels, const ViewportDesc_t* descs)
+    {
+        CAutoLock lock(&m_stagedLayoutLock);
+        if (mode >= 0)
+            m_stagedViewMode = mode;
+        // SetLayoutһ£ӿڣлģǰͼģʽ
+        int target = m_stagedViewMode >= 0 ? m_stagedViewMode : (int)_viewMode;
+        for (int i = 0; i < count; ++i) {
+            m_stagedViewportDesc[target][channels[i]] = descs[i];
+            m_isViewportStaged[target][channels[i]] = true;
+        }
+        m_hasStagedLayout = true;
+    }
+
+    // ̵߳ãǷµĲ֡
+    bool CBaseRenderer::AdoptStagedLayout()
+    {
+        if (!m_hasStagedLayout)
+            return false;
+
+        CAutoLock lock(&m_stagedLayoutLock);
+        if (m_stagedViewMode >= 0)
+            _viewMode = (VIEW_MODE)m_stagedViewMode;
+        for (int mode = VIEW_MODE_1x1; mode < VIEW_MODE_COUNT; ++mode) {
+            for (int channel = 0; channel < INPUT_PIN_COUNT; ++channel) {
+                if (m_isViewportStaged[mode][channel]) {
+                    _viewportDesc[mode][channel] = m_stagedViewportDesc[mode][channel];
+                    m_isViewportStaged[mode][channel] = false;
+                }
+            }
+        }
+        m_stagedViewMode = -1;
+        m_hasStagedLayout = false;
+        CalcLayout();
+        return true;
+    }
+
+    // ͨ߳ѡʱãδЧʱݴĲּӿھΡ
+    bool CBaseRenderer::GetStagedViewportRect(int channel, RECT* rect)
+    {
+        if (!m_hasStagedLayout)
+            return false;
+
+        CAutoLock lock(&m_stagedLayoutLock);
+        if (!m_hasStagedLayout)
+            return false;
+        int mode = m_stagedViewMode >= 0 ? m_stagedViewMode : (int)_viewMode;
+        const ViewportDesc_t& vd = m_isViewportStaged[mode][channel]
+            ? m_stagedViewportDesc[mode][channel] : _viewportDesc[mode][channel];
+        CalcViewportRect(vd, rect);
+        return true;
     }
 } // end namespace VideoRenderer
\ No newline at end of file
@@ -101,6 +101,13 @@ namespace VideoRenderer {
         ViewportDesc_t _viewportDesc[VIEW_MODE_COUNT][INPUT_PIN_COUNT]; // ÿͼģʽµÿͨӦӿ꣩
         RECT _viewportRect[VIEW_MODE_COUNT][INPUT_PIN_COUNT]; // ÿͼģʽµÿͨı߽Σͼ仯ʱ̬꣩
 
+        // ֣߳ݴ棬߳Updateͷɡ
+        CCritSec m_stagedLayoutLock;
+        volatile bool m_hasStagedLayout = false;
+        int m_stagedViewMode = -1; // -1ʾлͼģʽ
+        ViewportDesc_t m_stagedViewportDesc[VIEW_MODE_COUNT][INPUT_PIN_COUNT];
+        bool m_isViewportStaged[VIEW_MODE_COUNT][INPUT_PIN_COUNT] = { false };
+
         CRefTime m_ChannelStart[INPUT_PIN_COUNT]; // offset from stream time to reference time
         FILTER_STATE m_ChannelState[INPUT_PIN_COUNT]; // channel current state: running, paused, m_StateΪPresenter״̬
 
@@ -121,6 +128,7 @@ namespace VideoRenderer {
         int m_receivedSampleCount[INPUT_PIN_COUNT] = { 0 }; // ͳƽ߳ÿ5ۼʱá
         DWORD m_lastPrintTime[INPUT_PIN_COUNT] = { 0 }; // ÿ5ӡһν̵߳֡ʡ
         volatile bool m_isFirstSampleReceived[INPUT_PIN_COUNT] = { false }; // Pause|RunʼǷյһ,Stopʱá
+        volatile HANDLE m_frameReadyEvent = NULL; // ͨõ֡¼С
         //
         // -----------------------------------------------------------------------------------------------
 
@@ -204,6 +212,8 @@ namespace VideoRenderer {
         virtual HRESULT EndOfStream(int channel);
         virtual HRESULT ClearPendingSample(int channel);
         void PushPendingSample(int channel, IMediaSample* ms);
+        // ߳ÿյһһΣ֮󡣲
+        virtual void OnSampleReceived(int channel, IMediaSample* ms) {}
 
         // Called when the filter changes state
         virtual HRESULT Active(int channel);
@@ -234,5 +244,10 @@ namespace VideoRenderer {
         virtual void SetDefaultViewportDesc();
         virtual void CalcLayout();
         virtual void CalcChannelLayout(int mode, int channel);
+        void CalcViewportRect(const ViewportDesc_t& vd, RECT* vr);
+
+        void StageLayout(int mode, int count, const int* channels, const ViewportDesc_t* descs);
+        bool AdoptStagedLayout();
+        bool GetStagedViewportRect(int channel, RECT* rect);
     };
 } // end namespace VideoRenderer
\ No newline at end of file
@@ -7,6 +7,23 @@ DEFINE_GUID(CLSID_SampleRenderer,
 
 namespace VideoRenderer {
 
+    enum { MAX_PTS_DEVIATION_MS = 2000 }; // ʱ뵱ǰʱֵΪڱʱϡ
+
+    // RtspSourceѰRTP/RTCPʱѳʱ任㵽timeGetTime()ʱᣨ룩нĿӳ١
+    // ûʱʱԲڱʱϵfalseɳų̡
+    static bool GetPresentTime(IMediaSample* ms, DWORD curTime, DWORD* pts)
+    {
+        REFERENCE_TIME tsStart = 0;
+        REFERENCE_TIME tsStop = 0;
+        if (ms == nullptr || FAILED(ms->GetTime(&tsStart, &tsStop)))
+            return false;
+        LONG delta = (LONG)((DWORD)tsStart - curTime);
+        if (delta > MAX_PTS_DEVIATION_MS || delta < -MAX_PTS_DEVIATION_MS)
+            return false;
+        *pts = (DWORD)tsStart;
+        return true;
+    }
+
     //-------------------------------------------------------------------------------------------------
     // CGDIVideoInputPin implementation
     //-------------------------------------------------------------------------------------------------
@@ -79,6 +96,7 @@ namespace VideoRenderer {
         // 仯ôҪSourceRectĳߴ硣ZoomôӦöZoomԴΡ
         // ǲֱʹõĳʼֵ
         RECT sr = { 0, 0, 640, 360 };
+        memset(_sampleFormat, 0, sizeof(_sampleFormat));
         for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
             _imageAllocator[i] = new CImageAllocator(this, TEXT(""), phr),
 
@@ -168,10 +186,27 @@ namespace VideoRenderer {
         HRESULT hr = S_OK;
 
         _viewportDesc[(int)_viewMode][channel] = *desc;
+        CalcChannelLayout((int)_viewMode, channel);
 
         return hr;
     }
 
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::SetLayoutBatch(int mode, int count, const int* channels, const ViewportDesc_t* descs)
+    {
+        if (mode < -1 || mode >= VIEW_MODE_COUNT)
+            return E_INVALIDARG;
+        if (count < 0 || (count > 0 && (channels == nullptr || descs == nullptr)))
+            return E_POINTER;
+        for (int i = 0; i < count; ++i) {
+            if (channels[i] < 0 || channels[i] >= INPUT_PIN_COUNT)
+                return E_INVALIDARG;
+        }
+
+        StageLayout(mode, count, channels, descs);
+
+        return S_OK;
+    }
+
     STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::SetSourceFrameInterval(int channel, DWORD frameInterval)
     {
         HRESULT hr = S_OK;
@@ -181,11 +216,72 @@ namespace VideoRenderer {
         return hr;
     }
         
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::GetViewportSize(int channel, SIZE* size)
+    {
+        CheckPointer(size, E_POINTER);
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return E_INVALIDARG;
+
+        RECT vr;
+        if (!GetStagedViewportRect(channel, &vr))
+            vr = _viewportRect[(int)_viewMode][channel];
+        size->cx = WIDTH(&vr);
+        size->cy = HEIGHT(&vr);
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::Snapshot(int channel, const SnapshotDesc_t* desc)
+    {
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return E_INVALIDARG;
+        if (m_ChannelState[channel] == State_Stopped)
+            return VFW_E_NOT_RUNNING;
+
+        return _snapshotWorker.Request(channel, desc);
+    }
+
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::GetPresentJitter(PresentJitter_t* jitter)
+    {
+        CheckPointer(jitter, E_POINTER);
+        CAutoLock lock(&_jitterLock);
+        *jitter = _presentJitter;
+        return S_OK;
+    }
+
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::SetMosaic(int channel, const MosaicDesc_t* desc)
+    {
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return E_INVALIDARG;
+        if (m_ChannelState[channel] != State_Stopped)
+            return VFW_E_NOT_STOPPED;
+        return _mosaic.Reset(channel, desc);
+    }
+
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::GetMosaicProgress(int channel, MosaicProgress_t* progress)
+    {
+        CheckPointer(progress, E_POINTER);
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return E_INVALIDARG;
+        if (!_mosaic.IsEnabled(channel))
+            return E_UNEXPECTED;
+        _mosaic.GetProgress(channel, progress);
+        return S_OK;
+    }
+
     STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::SetNotifyReceiver(INotify* receiver)
     {
         return E_NOTIMPL;
     }
 
+    STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::SetFrameReadyEvent(HANDLE hEvent)
+    {
+        m_frameReadyEvent = hEvent;
+        return S_OK;
+    }
+
+    // Դ˰RTPʱĳʱѾ˸ǽ붶Ŀӳ٣ʱʱ֡
+    // ûʱų̷
     // ԴʱڽʱľҶѾûκγֲοֵˡ
     // ʱҪյĵǰʱ̣¹㣬õƽЧʱ䡣
     // һΪ˵ĸƽĳʱ
@@ -196,7 +292,7 @@ namespace VideoRenderer {
     // TODO:UI̲߳Żʱ߳̽Уκʱؼ㡣
     STDMETHODIMP_(BOOL __stdcall) CGDIVideoRenderer::Update(TimeContext* tc)
     {
-        BOOL isChanged = FALSE;
+        BOOL isChanged = AdoptStagedLayout() ? TRUE : FALSE; // ڳֱ߽Ч
         for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
             if (Update(i, tc))
                 isChanged = TRUE;
@@ -236,7 +332,17 @@ namespace VideoRenderer {
 #endif
 
         // ʱߣǰʱ
-        if (m_isFirstSample[channel]) {
+        DWORD pts = 0;
+        bool hasPts = count > 0 && GetPresentTime(m_presentSampleQueue[channel][0], curTime, &pts);
+        if (hasPts) {
+            // ͷʱ֣ݶгȼӼ١
+            m_isFirstSample[channel] = false;
+            m_presentTimeBaseLine[channel] = curTime;
+            m_nextPTS[channel] = pts != 0 ? pts : 1; // 0ʾδų̡
+            m_boostState[channel] = BS_NORMAL;
+            m_presentIntervalAdjust[channel] = 100;
+        }
+        else if (m_isFirstSample[channel]) {
             m_isFirstSample[channel] = false;
 
             dt = m_presentInterval[channel] = m_sourceFrameInterval[channel];
@@ -289,7 +395,7 @@ namespace VideoRenderer {
         }
 
         // жǷҪ
-        needPresent = (count > 0 && m_nextPTS[channel] > 0 && curTime >= m_nextPTS[channel]);
+        needPresent = (count > 0 && m_nextPTS[channel] > 0 && (LONG)(curTime - m_nextPTS[channel]) >= 0);
 
         // TODO:ʱ̫Ķ߼ӿ첥ţ
         // ӿ֣һֱֹڣԴδѻ
@@ -305,6 +411,17 @@ namespace VideoRenderer {
         REFERENCE_TIME tsStart = 0;
         REFERENCE_TIME tsStop = 0;
 
+        // ֡ĳֶʵʳʱUpdateų̵ĳʱ֮
+        if (m_presentSampleCount[channel] > 0 && m_nextPTS[channel] != 0) {
+            LONG jitter = abs((LONG)(curTime - m_nextPTS[channel]));
+            CAutoLock lock(&_jitterLock);
+            ++_presentJitter.frames;
+            ++_presentJitter.channelFrames[channel];
+            _presentJitter.totalMs += jitter;
+            if (jitter > PresentJitter_t::LATE_FRAME_MS)
+                ++_presentJitter.lateFrames;
+        }
+
         // ʹö
         if (m_presentSampleCount[channel] > 0) {
             // ȹ黹һ
@@ -370,6 +487,7 @@ namespace VideoRenderer {
 
     STDMETHODIMP_(HRESULT __stdcall) CGDIVideoRenderer::Stop(int channel)
     {
+        _snapshotWorker.Cancel(channel, VFW_E_NOT_RUNNING);
         return StopChannel(channel);
     }
 
@@ -417,6 +535,7 @@ namespace VideoRenderer {
         RECT sr = { 0, 0, vih2->bmiHeader.biWidth, vih2->bmiHeader.biHeight };
         _drawImage[i]->SetSourceRect(&sr);
         _imageAllocator[i]->NotifyMediaType(&_mtIn[i]);
+        _sampleFormat[i] = *vih2;
 
         return S_OK;
     }
@@ -444,9 +563,49 @@ namespace VideoRenderer {
 
     HRESULT CGDIVideoRenderer::DoRenderSample(int channel, IMediaSample* pMediaSample, HDC hdcDraw)
     {
+        // ƴͼʱѾڽ̻߳ˣÿζ黭
+        if (_mosaic.IsEnabled(channel)) {
+            RECT tr;
+            _drawImage[channel]->GetTargetRect(&tr);
+            _mosaic.Draw(channel, hdcDraw, &tr);
+            return S_OK;
+        }
+
+        // ֱ佹ʱֻת˻һ֣ýrcSourceЧ
+        // ʼȡ棬StretchBltŴӿڡ
+        AM_MEDIA_TYPE* pmt = nullptr;
+        if (pMediaSample->GetMediaType(&pmt) == S_OK && pmt != nullptr) {
+            if (pmt->formattype == FORMAT_VideoInfo2 && pmt->cbFormat >= sizeof(VIDEOINFOHEADER2)) {
+                const VIDEOINFOHEADER2* vih2 = (const VIDEOINFOHEADER2*)pmt->pbFormat;
+                RECT sr = vih2->rcSource;
+                if (IsRectEmpty(&sr)) {
+                    SetRect(&sr, 0, 0, vih2->bmiHeader.biWidth, abs(vih2->bmiHeader.biHeight));
+                }
+                _drawImage[channel]->SetSourceRect(&sr);
+            }
+            DeleteMediaType(pmt);
+        }
         return _drawImage[channel]->DrawImage(pMediaSample, hdcDraw);
     }
 
+    // ̡̣߳߳
+    void CGDIVideoRenderer::OnSampleReceived(int channel, IMediaSample* ms)
+    {
+        AM_MEDIA_TYPE* pmt = nullptr;
+        if (ms->GetMediaType(&pmt) == S_OK && pmt != nullptr) {
+            if (pmt->formattype == FORMAT_VideoInfo2 && pmt->cbFormat >= sizeof(VIDEOINFOHEADER2)) {
+                _sampleFormat[channel] = *(const VIDEOINFOHEADER2*)pmt->pbFormat;
+            }
+            DeleteMediaType(pmt);
+        }
+        if (_mosaic.IsEnabled(channel)) {
+            _mosaic.Compose(channel, ms, &_sampleFormat[channel]);
+        }
+        if (_snapshotWorker.IsRequested(channel)) {
+            _snapshotWorker.Capture(channel, ms, &_sampleFormat[channel]);
+        }
+    }
+
 } // end namespace VideoRenderer
 
 HRESULT WINAPI GDIRenderer_CreateInstance(HWND hwndHost, IBaseFilter** ppObj)
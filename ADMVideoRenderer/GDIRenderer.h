@@ -60,8 +60,15 @@ namespace VideoRenderer {
         STDMETHOD(SetObjectRects)(LPCRECT posRect, LPCRECT clipRect);
         STDMETHOD(SetViewMode)(int mode);
         STDMETHOD(SetLayout)(int channel, const ViewportDesc_t* desc);
+        STDMETHOD(SetLayoutBatch)(int mode, int count, const int* channels, const ViewportDesc_t* descs);
         STDMETHOD(SetSourceFrameInterval)(int channel, DWORD frameInterval);
+        STDMETHOD(GetViewportSize)(int channel, SIZE* size);
+        STDMETHOD(Snapshot)(int channel, const SnapshotDesc_t* desc);
+        STDMETHOD(GetPresentJitter)(PresentJitter_t* jitter);
+        STDMETHOD(SetMosaic)(int channel, const MosaicDesc_t* desc);
+        STDMETHOD(GetMosaicProgress)(int channel, MosaicProgress_t* progress);
         STDMETHOD(SetNotifyReceiver)(INotify* receiver);
+        STDMETHOD(SetFrameReadyEvent)(HANDLE hEvent);
 
         STDMETHOD_(BOOL, Update(TimeContext* tc));
         STDMETHOD_(void, Render(DeviceContext* dc));
@@ -81,6 +88,7 @@ namespace VideoRenderer {
         BOOL Update(int channel, TimeContext* tc);
         HRESULT Render(int channel, HDC hdcDraw);
         HRESULT DoRenderSample(int channel, IMediaSample* pMediaSample, HDC hdcDraw);
+        void OnSampleReceived(int channel, IMediaSample* ms);
 
     public:
 
@@ -111,6 +119,16 @@ namespace VideoRenderer {
         // ICommand::DrawӿڷʵֻȡߣһϳɺõDIB
         // ڵHDCضأ
         Statistics_t _sts; // ͳϢ
+
+        // ߳άÿͨһĸʽֻڸʽ仯ʱýֱͣ佹ırcSource
+        // Ҫһ֡ĸʽȡ档
+        VIDEOINFOHEADER2 _sampleFormat[INPUT_PIN_COUNT];
+        CSnapshotWorker _snapshotWorker;
+        CMosaicCanvas _mosaic;
+
+        // ߳ۼӣ̶ͨ߳ȡ
+        CCritSec _jitterLock;
+        PresentJitter_t _presentJitter = { 0 };
     };
 
 } // end namespace VideoRenderer
\ No newline at end of file
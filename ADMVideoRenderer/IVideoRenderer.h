@@ -63,6 +63,69 @@ namespace VideoRenderer {
         LONGLONG cur_draw_begin_time;  // ڳͳĿġ
     };
 
+    enum SnapshotFormat_t {
+        SF_JPEG,
+        SF_PNG,
+    };
+
+    // ɽڿ߳лص
+    struct SnapshotResult_t {
+        HRESULT hr; // S_OKɹVFW_E_TIMEOUTʱûеȵ֡VFW_E_NOT_RUNNINGֹͨͣ
+        int width; // ͼĿ
+        int height;
+        DWORD bytes; // ͼļֽ
+        DWORD captureMs; // ύ󵽽̲߳֡ĺʱ
+        DWORD encodeMs; // źͱдļĺʱ
+    };
+
+    typedef void (CALLBACK* SnapshotCallback_t)(void* ctx, const SnapshotResult_t* result);
+
+    // 󣬲ͨһѽ֡
+    struct SnapshotDesc_t {
+        const wchar_t* path; // ͼļ·ύʱơ
+        SnapshotFormat_t format;
+        int maxWidth; // С˿ߣŴ0ʾޡ
+        int maxHeight;
+        int quality; // JPEG[1,100]
+        DWORD timeoutMs; // ȴ֡ʱ
+        SnapshotCallback_t cb; // ṩÿǡûصһΡ
+        void* ctx;
+    };
+
+    // ֶۼֵֻȡֵ֮Ϊڼͳơ
+    //  = ʵʳʱ - ų̵ĳʱ̣ȡֵۼӡ
+    struct PresentJitter_t {
+        enum { LATE_FRAME_MS = 10 };
+
+        LONGLONG frames; // ѳֵ֡
+        LONGLONG totalMs; // ֵ֮
+        LONGLONG lateFrames; // LATE_FRAME_MS֡
+        LONGLONG channelFrames[INPUT_PIN_COUNT]; // ͨѳֵ֡
+    };
+
+    // ̬ͼƴͼ֡HEIFͼɶͼɣդ˳
+    // Ⱦÿһ黭ͨĻϣȵͼŴΪռλͼ½ȥ
+    // ĿʼʱͼеλãTHUMBNAIL_TIMEΪͼkͼΪk + 1
+    struct MosaicDesc_t {
+        enum { THUMBNAIL_TIME = 0 };
+
+        int width; // ͼĿߡұߺ±ߵͼܳĲֱõ
+        int height;
+        int columns;
+        int rows;
+        int tileWidth;
+        int tileHeight;
+    };
+
+    // ƴͼȣʱΪtimeGetTime()룩0ʾûз
+    struct MosaicProgress_t {
+        int tiles; // ѻϻͼ
+        int totalTiles;
+        DWORD resetTime; // SetMosaicʱ
+        DWORD thumbnailTime; // ͼϻʱ
+        DWORD completeTime; // һͼ黭ϻʱ
+    };
+
     // ƵȾȾ¼
     interface INotify : public IUnknown
     {
@@ -92,11 +155,26 @@ namespace VideoRenderer {
     {
         // MixedGraphȾ߹߳רõýӿ
         STDMETHOD(SetNotifyReceiver)(INotify* receiver) = 0;
+        // ߳ÿֶзһ֡λ¼߳̿ԵȴѯUpdate
+        // ¼ɵߴ͹رգȾֹܹͣرա
+        STDMETHOD(SetFrameReadyEvent)(HANDLE hEvent) = 0;
 
         // MixedGraphִ߳רõýӿ
         STDMETHOD(SetViewMode)(int mode) = 0;
         STDMETHOD(SetLayout)(int channel, const ViewportDesc_t* desc) = 0;
+        // һύͼģʽ-1ʾлͶͨӿڲ֣ݴ浽߳һUpdateʱЧ
+        // һӿлһֻûлĻ档ݴڼGetViewportSize²ַء
+        STDMETHOD(SetLayoutBatch)(int mode, int count, const int* channels, const ViewportDesc_t* descs) = 0;
         STDMETHOD(SetSourceFrameInterval)(int channel, DWORD frameInterval) = 0;
+        // ǰͼģʽͨӿڵسߴ磬ͨڵǰͼʱΪ0ݴѡ/
+        STDMETHOD(GetViewportSize)(int channel, SIZE* size) = 0;
+        // ͨһѽֻ֡߳üźͱȾĿ߳ɣ
+        // ռý̺߳ʹ̡߳󱻽ʱS_OK֮һصdesc->cb
+        STDMETHOD(Snapshot)(int channel, const SnapshotDesc_t* desc) = 0;
+        STDMETHOD(GetPresentJitter)(PresentJitter_t* jitter) = 0;
+        // ͨΪƴͼֲջdescΪnullptrʱָֹ֡֡ͨͣʱá
+        STDMETHOD(SetMosaic)(int channel, const MosaicDesc_t* desc) = 0;
+        STDMETHOD(GetMosaicProgress)(int channel, MosaicProgress_t* progress) = 0;
 
         // MixedGraphִͨ߳רÿƽӿ
         STDMETHOD(Stop)(int channel) = 0;
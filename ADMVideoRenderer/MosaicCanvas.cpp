@@ -0,0 +1,171 @@
+#include "stdafx.h"
+#include "global.h"
+
+namespace VideoRenderer {
+
+    CMosaicCanvas::CMosaicCanvas()
+    {
+        for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
+            _enabled[i] = 0;
+        }
+    }
+
+    HRESULT CMosaicCanvas::Reset(int channel, const MosaicDesc_t* desc)
+    {
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return E_INVALIDARG;
+        if (desc != nullptr && (desc->width <= 0 || desc->height <= 0 || desc->columns <= 0 || desc->rows <= 0
+                                || desc->tileWidth <= 0 || desc->tileHeight <= 0))
+            return E_INVALIDARG;
+
+        CAutoLock lock(&_lock[channel]);
+        Canvas& c = _canvas[channel];
+        c = Canvas();
+        if (desc == nullptr) {
+            _enabled[channel] = 0;
+            return S_OK;
+        }
+
+        double scale = min(1.0, (double)MAX_CANVAS_SIZE / max(desc->width, desc->height));
+        c.desc = *desc;
+        c.width = max(1, (int)(desc->width * scale + 0.5));
+        c.height = max(1, (int)(desc->height * scale + 0.5));
+        c.pixels.assign((size_t)c.width * c.height, 0);
+        c.drawn.assign((size_t)desc->columns * desc->rows, false);
+        c.progress.totalTiles = desc->columns * desc->rows;
+        c.progress.resetTime = timeGetTime();
+        _enabled[channel] = 1;
+        return S_OK;
+    }
+
+    void CMosaicCanvas::GetProgress(int channel, MosaicProgress_t* progress)
+    {
+        CAutoLock lock(&_lock[channel]);
+        *progress = _canvas[channel].progress;
+    }
+
+    // ̡̣߳߳
+    void CMosaicCanvas::Compose(int channel, IMediaSample* ms, const VIDEOINFOHEADER2* vih)
+    {
+        const BITMAPINFOHEADER& bih = vih->bmiHeader;
+        if (bih.biBitCount != 32 || bih.biWidth <= 0 || bih.biHeight == 0)
+            return;
+
+        REFERENCE_TIME tsStart = 0;
+        REFERENCE_TIME tsStop = 0;
+        BYTE* data = nullptr;
+        if (FAILED(ms->GetTime(&tsStart, &tsStop)) || FAILED(ms->GetPointer(&data)))
+            return;
+        int imageHeight = abs(bih.biHeight);
+        int stride = DIBWIDTHBYTES(bih);
+        if ((LONGLONG)stride * imageHeight > ms->GetSize())
+            return;
+        RECT image = { 0, 0, bih.biWidth, imageHeight };
+
+        CAutoLock lock(&_lock[channel]);
+        Canvas& c = _canvas[channel];
+        if (!_enabled[channel])
+            return;
+
+        const MosaicDesc_t& d = c.desc;
+        DWORD now = timeGetTime();
+        if (tsStart == MosaicDesc_t::THUMBNAIL_TIME) {
+            // ͼֻռλͼѾʼʱٻ
+            if (c.progress.tiles > 0)
+                return;
+            RECT dst = { 0, 0, c.width, c.height };
+            Blit(data, stride, imageHeight, bih.biHeight > 0, image, c, dst);
+            c.empty = false;
+            c.progress.thumbnailTime = now;
+            return;
+        }
+
+        LONGLONG k = tsStart - 1;
+        if (k < 0 || k >= (LONGLONG)c.drawn.size())
+            return;
+        int col = (int)(k % d.columns);
+        int row = (int)(k / d.columns);
+        RECT tile = { col * d.tileWidth, row * d.tileHeight, (col + 1) * d.tileWidth, (row + 1) * d.tileHeight };
+        RECT bounds = { 0, 0, d.width, d.height };
+        if (!IntersectRect(&tile, &tile, &bounds))
+            return;
+        RECT src = { 0, 0, tile.right - tile.left, tile.bottom - tile.top };
+        if (!IntersectRect(&src, &src, &image))
+            return;
+        RECT dst = {
+            (int)((LONGLONG)tile.left * c.width / d.width),
+            (int)((LONGLONG)tile.top * c.height / d.height),
+            (int)((LONGLONG)(tile.left + src.right) * c.width / d.width),
+            (int)((LONGLONG)(tile.top + src.bottom) * c.height / d.height),
+        };
+        if (IsRectEmpty(&dst))
+            return;
+        Blit(data, stride, imageHeight, bih.biHeight > 0, src, c, dst);
+        c.empty = false;
+        if (!c.drawn[(size_t)k]) {
+            c.drawn[(size_t)k] = true;
+            if (++c.progress.tiles == c.progress.totalTiles) {
+                c.progress.completeTime = now;
+            }
+        }
+    }
+
+    void CMosaicCanvas::Blit(const BYTE* data, int stride, int imageHeight, bool bottomUp, const RECT& src,
+                             Canvas& canvas, const RECT& dst)
+    {
+        int srcW = src.right - src.left;
+        int srcH = src.bottom - src.top;
+        int w = dst.right - dst.left;
+        int h = dst.bottom - dst.top;
+
+        std::vector<int> xs(w + 1);
+        for (int x = 0; x <= w; ++x) {
+            xs[x] = src.left + (int)((LONGLONG)x * srcW / w);
+        }
+        for (int y = 0; y < h; ++y) {
+            int y0 = src.top + (int)((LONGLONG)y * srcH / h);
+            int y1 = max(y0 + 1, src.top + (int)((LONGLONG)(y + 1) * srcH / h));
+            DWORD* out = &canvas.pixels[(size_t)(dst.top + y) * canvas.width + dst.left];
+            for (int x = 0; x < w; ++x) {
+                int x0 = xs[x];
+                int x1 = max(x0 + 1, xs[x + 1]);
+                DWORD b = 0, g = 0, r = 0;
+                for (int sy = y0; sy < y1; ++sy) {
+                    int row = bottomUp ? imageHeight - 1 - sy : sy;
+                    const BYTE* p = data + (size_t)row * stride + x0 * 4;
+                    for (int sx = x0; sx < x1; ++sx, p += 4) {
+                        b += p[0];
+                        g += p[1];
+                        r += p[2];
+                    }
+                }
+                DWORD n = (DWORD)((y1 - y0) * (x1 - x0));
+                out[x] = (r / n) << 16 | (g / n) << 8 | (b / n);
+            }
+        }
+    }
+
+    // ̡̣߳߳
+    bool CMosaicCanvas::Draw(int channel, HDC hdc, const RECT* target)
+    {
+        CAutoLock lock(&_lock[channel]);
+        const Canvas& c = _canvas[channel];
+        if (c.empty)
+            return false;
+
+        BITMAPINFO bmi = { 0 };
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = c.width;
+        bmi.bmiHeader.biHeight = -c.height; // ϶
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        SetStretchBltMode(hdc, HALFTONE);
+        SetBrushOrgEx(hdc, 0, 0, nullptr);
+        StretchDIBits(hdc, target->left, target->top, target->right - target->left, target->bottom - target->top,
+                      0, 0, c.width, c.height, c.pixels.data(), &bmi, DIB_RGB_COLORS, SRCCOPY);
+        return true;
+    }
+
+} // end namespace VideoRenderer
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+namespace VideoRenderer {
+
+    //
+    // ƴͼÿͨһ飬϶µ32λBGRXλͼ
+    // ߳ÿյһͰĿʼʱҵͼеλãź󻭵ϣ
+    // ̳߳ʱ黭쵽ӿڣٻڴֶǷӰ컭档
+    // ͼ߲MAX_CANVAS_SIZEС棬ӿһСʲӰ졣
+    // һͼֻмؼźܿ죬̹߳һ
+    //
+    class CMosaicCanvas
+    {
+    public:
+        enum { MAX_CANVAS_SIZE = 2048 };
+
+        CMosaicCanvas();
+
+        CMosaicCanvas(const CMosaicCanvas&) = delete;
+        CMosaicCanvas& operator=(const CMosaicCanvas&) = delete;
+
+        // ̵ͨ߳ádescΪnullptrʱرƴͼ֣ͷŻ
+        HRESULT Reset(int channel, const MosaicDesc_t* desc);
+        bool IsEnabled(int channel) const { return _enabled[channel] != 0; }
+        void GetProgress(int channel, MosaicProgress_t* progress);
+        // ̵߳ávihΪĸʽ
+        void Compose(int channel, IMediaSample* ms, const VIDEOINFOHEADER2* vih);
+        // ̵߳áϻʲôûʱfalse
+        bool Draw(int channel, HDC hdc, const RECT* target);
+
+    private:
+        struct Canvas {
+            MosaicDesc_t desc = { 0 };
+            int width = 0; // Ŀ
+            int height = 0;
+            std::vector<DWORD> pixels;
+            std::vector<bool> drawn; // ͼǷѻ
+            bool empty = true;
+            MosaicProgress_t progress = { 0 };
+        };
+
+        // еsrcƽŵdst򣬷Ŵʱ൱ڡ
+        static void Blit(const BYTE* data, int stride, int imageHeight, bool bottomUp, const RECT& src,
+                         Canvas& canvas, const RECT& dst);
+
+        CCritSec _lock[INPUT_PIN_COUNT];
+        Canvas _canvas[INPUT_PIN_COUNT];
+        volatile LONG _enabled[INPUT_PIN_COUNT];
+    };
+
+} // end namespace VideoRenderer
@@ -0,0 +1,341 @@
+#include "stdafx.h"
+#include "global.h"
+#include <wincodec.h>
+
+namespace VideoRenderer {
+
+    CSnapshotWorker::CSnapshotWorker()
+    {
+        for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
+            _requested[i] = 0;
+        }
+        _thread = std::thread(&CSnapshotWorker::WorkerThread, this);
+    }
+
+    CSnapshotWorker::~CSnapshotWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _exit = true;
+        }
+        _cond.notify_one();
+        _thread.join();
+    }
+
+    HRESULT CSnapshotWorker::Request(int channel, const SnapshotDesc_t* desc)
+    {
+        if (channel < 0 || channel >= INPUT_PIN_COUNT || desc == nullptr || desc->cb == nullptr
+            || desc->path == nullptr || desc->path[0] == 0
+            || (desc->format != SF_JPEG && desc->format != SF_PNG)
+            || desc->maxWidth < 0 || desc->maxHeight < 0)
+            return E_INVALIDARG;
+
+        Job* job = new Job;
+        job->desc = *desc;
+        job->path = desc->path;
+        job->desc.path = job->path.c_str();
+        if (job->desc.quality < 1 || job->desc.quality > 100) {
+            job->desc.quality = DEFAULT_QUALITY;
+        }
+        job->requestTime = timeGetTime();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_waiting[channel].size() >= MAX_PENDING_REQUESTS) {
+            delete job;
+            return HRESULT_FROM_WIN32(ERROR_BUSY);
+        }
+        _waiting[channel].push_back(job);
+        _requested[channel] = 1;
+        return S_OK;
+    }
+
+    // ֻ̡̣߳߳ĸʽͬһ֡ϵĶһ
+    void CSnapshotWorker::Capture(int channel, IMediaSample* ms, const VIDEOINFOHEADER2* vih)
+    {
+        const BITMAPINFOHEADER& bih = vih->bmiHeader;
+        if (bih.biBitCount != 32 || bih.biWidth <= 0 || bih.biHeight == 0)
+            return; // ʽһ֡
+
+        int imageHeight = abs(bih.biHeight);
+        RECT image = { 0, 0, bih.biWidth, imageHeight };
+        RECT source = vih->rcSource;
+        if (IsRectEmpty(&source)) {
+            source = image;
+        }
+        if (!IntersectRect(&source, &source, &image))
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            DWORD now = timeGetTime();
+            for (Job* job : _waiting[channel]) {
+                ms->AddRef();
+                job->sample = ms;
+                job->captureTime = now;
+                job->source = source;
+                job->imageHeight = imageHeight;
+                job->stride = DIBWIDTHBYTES(bih);
+                job->bottomUp = bih.biHeight > 0;
+                _captured.push_back(job);
+            }
+            _waiting[channel].clear();
+            _requested[channel] = 0;
+        }
+        _cond.notify_one();
+    }
+
+    void CSnapshotWorker::Cancel(int channel, HRESULT hr)
+    {
+        if (channel < 0 || channel >= INPUT_PIN_COUNT)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_waiting[channel].empty())
+                return;
+            // û񽻸ֱ߳ӻصʧܣصǷڿ̡߳
+            for (Job* job : _waiting[channel]) {
+                job->error = hr;
+                _captured.push_back(job);
+            }
+            _waiting[channel].clear();
+            _requested[channel] = 0;
+        }
+        _cond.notify_one();
+    }
+
+    // ڱ룺ÿһ֮ǰȰ²ȫŲ黹
+    // 16ͨͬʱʱÿֻͨռü룬Ŷӵǰıɡ
+    void CSnapshotWorker::WorkerThread()
+    {
+        ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+        HRESULT hrCom = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+        std::deque<Job*> scaled; // ţȴ
+        for (;;) {
+            std::deque<Job*> captured;
+            std::vector<Job*> expired;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (scaled.empty()) {
+                    _cond.wait_for(lock, std::chrono::milliseconds(POLL_MS), [this] { return _exit || !_captured.empty(); });
+                }
+                if (_exit)
+                    break;
+                captured.swap(_captured);
+
+                DWORD now = timeGetTime();
+                for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
+                    std::deque<Job*>& waiting = _waiting[i];
+                    for (auto it = waiting.begin(); it != waiting.end();) {
+                        if (now - (*it)->requestTime >= (*it)->desc.timeoutMs) {
+                            expired.push_back(*it);
+                            it = waiting.erase(it);
+                        }
+                        else {
+                            ++it;
+                        }
+                    }
+                    _requested[i] = waiting.empty() ? 0 : 1;
+                }
+            }
+
+            for (Job* job : expired) {
+                Complete(job, VFW_E_TIMEOUT, 0, 0);
+            }
+            for (Job* job : captured) {
+                DWORD begin = timeGetTime();
+                HRESULT hr = job->sample != nullptr ? Scale(job) : job->error;
+                SAFE_RELEASE(job->sample);
+                if (FAILED(hr)) {
+                    Complete(job, hr, 0, 0);
+                    continue;
+                }
+                job->encodeMs = timeGetTime() - begin;
+                scaled.push_back(job);
+            }
+
+            if (!scaled.empty()) {
+                Job* job = scaled.front();
+                scaled.pop_front();
+                DWORD begin = timeGetTime();
+                DWORD bytes = 0;
+                HRESULT hr = Encode(job, &bytes);
+                Complete(job, hr, bytes, job->encodeMs + (timeGetTime() - begin));
+            }
+        }
+
+        // Ⱦʱûɵȫصʧܡ
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (int i = 0; i < INPUT_PIN_COUNT; ++i) {
+                scaled.insert(scaled.end(), _waiting[i].begin(), _waiting[i].end());
+                _waiting[i].clear();
+                _requested[i] = 0;
+            }
+            scaled.insert(scaled.end(), _captured.begin(), _captured.end());
+            _captured.clear();
+        }
+        for (Job* job : scaled) {
+            Complete(job, E_ABORT, 0, 0);
+        }
+
+        if (SUCCEEDED(hrCom)) {
+            ::CoUninitialize();
+        }
+    }
+
+    // СmaxWidth x maxHeightÿĿȡǵԴؿƽֵ
+    // ͬʱ32λBGRXתΪͨõ24λBGRXû壬ܵ͸ȣ
+    HRESULT CSnapshotWorker::Scale(Job* job)
+    {
+        BYTE* data = nullptr;
+        HRESULT hr = job->sample->GetPointer(&data);
+        if (FAILED(hr))
+            return hr;
+        if ((LONGLONG)job->stride * job->imageHeight > job->sample->GetSize())
+            return E_UNEXPECTED;
+
+        const RECT& sr = job->source;
+        int srcW = sr.right - sr.left;
+        int srcH = sr.bottom - sr.top;
+        double scale = 1.0;
+        if (job->desc.maxWidth > 0 && srcW > job->desc.maxWidth) {
+            scale = min(scale, (double)job->desc.maxWidth / srcW);
+        }
+        if (job->desc.maxHeight > 0 && srcH > job->desc.maxHeight) {
+            scale = min(scale, (double)job->desc.maxHeight / srcH);
+        }
+        int w = max(1, (int)(srcW * scale + 0.5));
+        int h = max(1, (int)(srcH * scale + 0.5));
+        int dstStride = (w * 3 + 3) & ~3;
+        job->width = w;
+        job->height = h;
+        job->pixels.assign((size_t)dstStride * h, 0);
+
+        std::vector<int> xs(w + 1);
+        for (int x = 0; x <= w; ++x) {
+            xs[x] = sr.left + (int)((LONGLONG)x * srcW / w);
+        }
+        for (int y = 0; y < h; ++y) {
+            int y0 = sr.top + (int)((LONGLONG)y * srcH / h);
+            int y1 = max(y0 + 1, sr.top + (int)((LONGLONG)(y + 1) * srcH / h));
+            BYTE* dst = &job->pixels[(size_t)y * dstStride];
+            for (int x = 0; x < w; ++x) {
+                int x0 = xs[x];
+                int x1 = max(x0 + 1, xs[x + 1]);
+                DWORD b = 0, g = 0, r = 0;
+                for (int sy = y0; sy < y1; ++sy) {
+                    int row = job->bottomUp ? job->imageHeight - 1 - sy : sy;
+                    const BYTE* src = data + (size_t)row * job->stride + x0 * 4;
+                    for (int sx = x0; sx < x1; ++sx, src += 4) {
+                        b += src[0];
+                        g += src[1];
+                        r += src[2];
+                    }
+                }
+                DWORD n = (DWORD)((y1 - y0) * (x1 - x0));
+                dst[0] = (BYTE)(b / n);
+                dst[1] = (BYTE)(g / n);
+                dst[2] = (BYTE)(r / n);
+                dst += 3;
+            }
+        }
+        return S_OK;
+    }
+
+    HRESULT CSnapshotWorker::Encode(const Job* job, DWORD* bytes)
+    {
+        IWICImagingFactory* factory = nullptr;
+        IWICStream* stream = nullptr;
+        IWICBitmapEncoder* encoder = nullptr;
+        IWICBitmapFrameEncode* frame = nullptr;
+        IPropertyBag2* props = nullptr;
+        bool created = false;
+        UINT stride = (job->width * 3 + 3) & ~3;
+        WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+
+        HRESULT hr = ::CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+            IID_IWICImagingFactory, (void**)&factory);
+        if (SUCCEEDED(hr)) {
+            hr = factory->CreateStream(&stream);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = stream->InitializeFromFilename(job->path.c_str(), GENERIC_WRITE);
+            created = SUCCEEDED(hr);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = factory->CreateEncoder(job->desc.format == SF_PNG ? GUID_ContainerFormatPng : GUID_ContainerFormatJpeg,
+                nullptr, &encoder);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = encoder->Initialize(stream, WICBitmapEncoderNoCache);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = encoder->CreateNewFrame(&frame, &props);
+        }
+        if (SUCCEEDED(hr) && job->desc.format == SF_JPEG) {
+            PROPBAG2 option = { 0 };
+            option.pstrName = const_cast<LPOLESTR>(L"ImageQuality");
+            VARIANT value;
+            VariantInit(&value);
+            value.vt = VT_R4;
+            value.fltVal = job->desc.quality / 100.0f;
+            hr = props->Write(1, &option, &value);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = frame->Initialize(props);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = frame->SetSize(job->width, job->height);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = frame->SetPixelFormat(&format);
+        }
+        if (SUCCEEDED(hr) && !IsEqualGUID(format, GUID_WICPixelFormat24bppBGR)) {
+            hr = WINCODEC_ERR_UNSUPPORTEDPIXELFORMAT;
+        }
+        if (SUCCEEDED(hr)) {
+            hr = frame->WritePixels(job->height, stride, (UINT)job->pixels.size(), const_cast<BYTE*>(job->pixels.data()));
+        }
+        if (SUCCEEDED(hr)) {
+            hr = frame->Commit();
+        }
+        if (SUCCEEDED(hr)) {
+            hr = encoder->Commit();
+        }
+        if (SUCCEEDED(hr)) {
+            LARGE_INTEGER zero = { 0 };
+            ULARGE_INTEGER end = { 0 };
+            hr = stream->Seek(zero, STREAM_SEEK_END, &end);
+            *bytes = (DWORD)end.QuadPart;
+        }
+
+        SAFE_RELEASE(props);
+        SAFE_RELEASE(frame);
+        SAFE_RELEASE(encoder);
+        SAFE_RELEASE(stream);
+        SAFE_RELEASE(factory);
+        if (FAILED(hr) && created) {
+            ::DeleteFileW(job->path.c_str()); // дһļ
+        }
+        return hr;
+    }
+
+    void CSnapshotWorker::Complete(Job* job, HRESULT hr, DWORD bytes, DWORD encodeMs)
+    {
+        SAFE_RELEASE(job->sample);
+        SnapshotResult_t result = { 0 };
+        result.hr = hr;
+        if (SUCCEEDED(hr)) {
+            result.width = job->width;
+            result.height = job->height;
+            result.bytes = bytes;
+        }
+        result.captureMs = job->captureTime != 0 ? job->captureTime - job->requestTime : 0;
+        result.encodeMs = encodeMs;
+        job->desc.cb(job->desc.ctx, &result);
+        delete job;
+    }
+
+} // end namespace VideoRenderer
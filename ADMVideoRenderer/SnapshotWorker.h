@@ -0,0 +1,71 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace VideoRenderer {
+
+    //
+    // ̣߳ÿȾһ߳ȼڽ̺߳ʹ̡߳
+    // ͨеȴ֡ʱ̰߳Ѹյֻüء
+    // ߳ȰѲŸƳ黹Ļأдļ
+    // ͨͻʱȲ᳤ʱռסҲƳٴ̵߳ĳ֡
+    //
+    class CSnapshotWorker
+    {
+    public:
+        enum { MAX_PENDING_REQUESTS = 4 }; // ÿͨͬʱȴ֡
+        enum { DEFAULT_QUALITY = 90 };
+        enum { POLL_MS = 100 }; // ʱļ
+
+        CSnapshotWorker();
+        ~CSnapshotWorker();
+
+        CSnapshotWorker(const CSnapshotWorker&) = delete;
+        CSnapshotWorker& operator=(const CSnapshotWorker&) = delete;
+
+        // ̵ͨ߳á
+        HRESULT Request(int channel, const SnapshotDesc_t* desc);
+        // ̵߳áûʱֻһ־ͷء
+        bool IsRequested(int channel) const { return _requested[channel] != 0; }
+        void Capture(int channel, IMediaSample* ms, const VIDEOINFOHEADER2* vih);
+        // ֹͨͣʱãڵȴ֡hrص
+        void Cancel(int channel, HRESULT hr);
+
+    private:
+        struct Job {
+            SnapshotDesc_t desc; // desc.pathָpath
+            std::wstring path;
+            DWORD requestTime = 0;
+            DWORD captureTime = 0;
+            DWORD encodeMs = 0; // ŵĺʱϱĺʱ
+            HRESULT error = S_OK; // ȡʱʧ룬ʱû
+            IMediaSample* sample = nullptr; // Ѳźͷ
+            RECT source = { 0 }; // еЧԶµ꣩
+            int imageHeight = 0; // ͼĸ߶
+            int stride = 0; // ֽ
+            bool bottomUp = false; // ԵϵDIB
+            int width = 0; // źĿ
+            int height = 0;
+            std::vector<BYTE> pixels; // ź24λBGRͼԶ
+        };
+
+        void WorkerThread();
+        static HRESULT Scale(Job* job);
+        static HRESULT Encode(const Job* job, DWORD* bytes);
+        static void Complete(Job* job, HRESULT hr, DWORD bytes, DWORD encodeMs);
+
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        bool _exit = false;
+        std::deque<Job*> _waiting[INPUT_PIN_COUNT]; // ȴ֡
+        std::deque<Job*> _captured; // Ѳ񣬵ȴ
+        volatile LONG _requested[INPUT_PIN_COUNT]; // _waitingǿգ߳
+        std::thread _thread;
+    };
+
+} // end namespace VideoRenderer
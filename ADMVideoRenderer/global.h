@@ -54,4 +54,6 @@ namespace VideoRenderer {
 } // end namespace VideoRenderer
 
 #include "BaseRenderer.h"
+#include "SnapshotWorker.h"
+#include "MosaicCanvas.h"
 #include "GDIRenderer.h"
@@ -61,6 +61,25 @@ public:
         _condition_variable.notify_one();
     }
 
+    /**
+     * Enqueue an item at tail of queue, discarding items from the head
+     * so that at most maxSize items remain queued.
+     * Returns the number of discarded items.
+     */
+    size_t push_bounded(T&& data, size_t maxSize)
+    {
+        size_t dropped = 0;
+        std::unique_lock<mutex_type> lock(_mutex);
+        while (maxSize > 0 && _queue.size() >= maxSize) {
+            _queue.pop_front();
+            ++dropped;
+        }
+        _queue.push_back(std::forward<T>(data));
+        lock.unlock();
+        _condition_variable.notify_one();
+        return dropped;
+    }
+
     /**
      * Attempt to dequeue an item from head of queue.
      * Does not wait for item to become available.
@@ -149,3 +149,75 @@ STDMETHODIMP CMediaSampleSideData::GetSideData(GUID guidType, const BYTE **pData
 
   return E_FAIL;
 }
+
+CMediaSampleSideDataAllocator::CMediaSampleSideDataAllocator(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT *phr)
+  : CMemAllocator(pName, pUnk, phr)
+{
+}
+
+CMediaSampleSideDataAllocator::~CMediaSampleSideDataAllocator()
+{
+  // CMemAllocator::~CMemAllocator releases the samples through their virtual destructor
+}
+
+HRESULT CMediaSampleSideDataAllocator::Alloc(void)
+{
+  CAutoLock lck(this);
+
+  /* Check he has called SetProperties */
+  HRESULT hr = CBaseAllocator::Alloc();
+  if (FAILED(hr))
+    return hr;
+
+  /* If the requirements haven't changed then don't reallocate */
+  if (hr == S_FALSE) {
+    ASSERT(m_pBuffer);
+    return NOERROR;
+  }
+
+  /* Free the old resources */
+  if (m_pBuffer)
+    ReallyFree();
+
+  if (m_lSize < 0 || m_lPrefix < 0 || m_lCount < 0)
+    return E_OUTOFMEMORY;
+
+  /* Compute the aligned size */
+  LONG lAlignedSize = m_lSize + m_lPrefix;
+  if (lAlignedSize < m_lSize)
+    return E_OUTOFMEMORY;
+
+  if (m_lAlignment > 1) {
+    LONG lRemainder = lAlignedSize % m_lAlignment;
+    if (lRemainder != 0) {
+      LONG lNewSize = lAlignedSize + m_lAlignment - lRemainder;
+      if (lNewSize < lAlignedSize)
+        return E_OUTOFMEMORY;
+      lAlignedSize = lNewSize;
+    }
+  }
+
+  LONGLONG lToAllocate = m_lCount * (LONGLONG)lAlignedSize;
+  if (lToAllocate > MAXLONG)
+    return E_OUTOFMEMORY;
+
+  m_pBuffer = (PBYTE)VirtualAlloc(NULL, (LONG)lToAllocate, MEM_COMMIT, PAGE_READWRITE);
+  if (m_pBuffer == NULL)
+    return E_OUTOFMEMORY;
+
+  LPBYTE pNext = m_pBuffer;
+  ASSERT(m_lAllocated == 0);
+
+  for (; m_lAllocated < m_lCount; m_lAllocated++, pNext += lAlignedSize) {
+    CMediaSampleSideData *pSample = new CMediaSampleSideData(TEXT("Side data media sample"), this, &hr, pNext + m_lPrefix, m_lSize);
+    ASSERT(SUCCEEDED(hr));
+    if (pSample == NULL)
+      return E_OUTOFMEMORY;
+
+    // This CANNOT fail
+    m_lFree.Add(pSample);
+  }
+
+  m_bChanged = FALSE;
+  return NOERROR;
+}
@@ -57,3 +57,17 @@ private:
   CCritSec m_csSideData;
   std::map<GUID, SideDataEntry, SideDataGUIDComparer> m_SideData;
 };
+
+// Memory allocator handing out CMediaSampleSideData samples, so that an output pin
+// can attach side data to the samples it delivers even if the downstream input pin
+// only offers a plain CMemAllocator.
+class CMediaSampleSideDataAllocator : public CMemAllocator
+{
+public:
+  CMediaSampleSideDataAllocator(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT *phr);
+  virtual ~CMediaSampleSideDataAllocator();
+
+protected:
+  // Same as CMemAllocator::Alloc, but creates CMediaSampleSideData objects
+  HRESULT Alloc(void);
+};
@@ -0,0 +1,399 @@
+#include "stdafx.h"
+#include "HeifIndex.h"
+#include "IsoBox.h"
+#include <algorithm>
+
+namespace
+{
+    const int64_t MAX_META_SIZE = 16 * 1024 * 1024; // meta˴СΪļ
+    const uint32_t MAX_ITEM_SIZE = 64 * 1024 * 1024;
+    const uint32_t MAX_GRID_TILES = 1024;
+}
+
+using namespace IsoBox;
+
+namespace
+{
+    // ilocеı䳤ֶΣΪ048ֽڡ
+    bool ReadSized(BoxCursor& c, int size, uint64_t* value)
+    {
+        switch (size) {
+        case 0: *value = 0; return true;
+        case 4: *value = c.u32(); return !c.failed();
+        case 8: *value = c.u64(); return !c.failed();
+        }
+        return false;
+    }
+}
+
+// ˳ӣֻftypmetamdatֻȡ
+bool HeifIndex::Open(Mp4Index::ReadFunc read, void* ctx, int64_t fileSize)
+{
+    *this = HeifIndex();
+    _read = read;
+    _ctx = ctx;
+    _fileSize = fileSize;
+
+    bool isHeif = false;
+    bool hasMeta = false;
+    int64_t offset = 0;
+    std::vector<uint8_t> box;
+    while (fileSize - offset >= 8 && !hasMeta) {
+        uint8_t header[16];
+        size_t headerBytes = (size_t)min((int64_t)sizeof(header), fileSize - offset);
+        if (_read(_ctx, offset, header, headerBytes) != headerBytes)
+            return false;
+
+        uint64_t size = BE32(header);
+        uint32_t type = BE32(header + 4);
+        size_t headerSize = 8;
+        if (size == 1) {
+            if (headerBytes < 16)
+                return false;
+            size = BE64(header + 8);
+            headerSize = 16;
+        }
+        else if (size == 0) {
+            size = fileSize - offset;
+        }
+        if (size < headerSize || size > (uint64_t)(fileSize - offset))
+            return false;
+
+        if (type == FourCC('f', 't', 'y', 'p') || type == FourCC('m', 'e', 't', 'a')) {
+            if (size > MAX_META_SIZE)
+                return false;
+            box.resize((size_t)size);
+            if (_read(_ctx, offset, box.data(), box.size()) != box.size())
+                return false;
+            const uint8_t* p = box.data() + headerSize;
+            size_t n = box.size() - headerSize;
+            if (type == FourCC('f', 't', 'y', 'p')) {
+                // ƷƺͼƷһHEVCͼƷƾ
+                for (size_t i = 0; i + 4 <= n; i += 4) {
+                    uint32_t brand = BE32(p + i);
+                    if (i == 4)
+                        continue; // minor_version
+                    if (brand == FourCC('h', 'e', 'i', 'c') || brand == FourCC('h', 'e', 'i', 'x')
+                        || brand == FourCC('m', 'i', 'f', '1'))
+                        isHeif = true;
+                }
+            }
+            else {
+                if (!isHeif || !ParseMeta(p, n))
+                    return false;
+                hasMeta = true;
+            }
+        }
+        offset += size;
+    }
+    if (!hasMeta || !_isPicture || _primaryId == 0)
+        return false;
+
+    const Item* primary = FindItem(_primaryId);
+    if (primary == nullptr)
+        return false;
+    if (primary->type == FourCC('g', 'r', 'i', 'd')) {
+        if (!ParseGrid(*primary))
+            return false;
+    }
+    else {
+        _tiles.resize(1);
+        if (!MakeImage(_primaryId, &_tiles[0]))
+            return false;
+        _columns = _rows = 1;
+        _width = _tiles[0].width;
+        _height = _tiles[0].height;
+    }
+
+    // ͼͨthmbָͼжʱȡһܽġ
+    for (const Reference& ref : _references) {
+        if (ref.type != FourCC('t', 'h', 'm', 'b') || std::find(ref.to.begin(), ref.to.end(), _primaryId) == ref.to.end())
+            continue;
+        if (MakeImage(ref.from, &_thumbnail))
+            break;
+        _thumbnail = Image();
+    }
+
+    for (const Image& tile : _tiles)
+        _maxImageSize = max(_maxImageSize, tile.size + (uint32_t)tile.parameterSets.size());
+    if (HasThumbnail())
+        _maxImageSize = max(_maxImageSize, _thumbnail.size + (uint32_t)_thumbnail.parameterSets.size());
+    return true;
+}
+
+bool HeifIndex::ReadImage(const Image& image, uint8_t* buf) const
+{
+    return ReadExtents(image.extents, image.inIdat, buf);
+}
+
+bool HeifIndex::ParseMeta(const uint8_t* p, size_t n)
+{
+    if (n < 4)
+        return false;
+    // metaFullBoxӺ֮ûȺ˳ԼĿ贴
+    return ForEachBox(p + 4, n - 4, [this](uint32_t type, const uint8_t* q, size_t m) {
+        switch (type) {
+        case FourCC('h', 'd', 'l', 'r'): {
+            BoxCursor c(q, m);
+            c.u32(); // version, flags
+            c.u32(); // pre_defined
+            _isPicture = c.u32() == FourCC('p', 'i', 'c', 't');
+            return !c.failed();
+        }
+        case FourCC('p', 'i', 't', 'm'): {
+            BoxCursor c(q, m);
+            int version = c.u8();
+            c.skip(3);
+            _primaryId = version == 0 ? c.u16() : c.u32();
+            return !c.failed();
+        }
+        case FourCC('i', 'i', 'n', 'f'): return ParseIinf(q, m);
+        case FourCC('i', 'l', 'o', 'c'): return ParseIloc(q, m);
+        case FourCC('i', 'r', 'e', 'f'): return ParseIref(q, m);
+        case FourCC('i', 'p', 'r', 'p'): return ParseIprp(q, m);
+        case FourCC('i', 'd', 'a', 't'):
+            _idat.assign(q, q + m);
+            return true;
+        }
+        return true;
+    });
+}
+
+bool HeifIndex::ParseIinf(const uint8_t* p, size_t n)
+{
+    BoxCursor c(p, n);
+    int version = c.u8();
+    c.skip(3);
+    if (version == 0)
+        c.u16(); // entry_count
+    else
+        c.u32();
+    if (c.failed())
+        return false;
+
+    return ForEachBox(c.current(), c.remaining(), [this](uint32_t type, const uint8_t* q, size_t m) {
+        if (type != FourCC('i', 'n', 'f', 'e'))
+            return true;
+        BoxCursor e(q, m);
+        int version = e.u8();
+        e.skip(3);
+        if (version < 2)
+            return true; // ڰ汾ûitem_typeͼ
+        uint32_t id = version == 2 ? e.u16() : e.u32();
+        e.u16(); // item_protection_index
+        uint32_t itemType = e.u32();
+        if (e.failed())
+            return false;
+        AddItem(id).type = itemType;
+        return true;
+    });
+}
+
+bool HeifIndex::ParseIloc(const uint8_t* p, size_t n)
+{
+    BoxCursor c(p, n);
+    int version = c.u8();
+    c.skip(3);
+    int sizes = c.u8();
+    int offsetSize = sizes >> 4;
+    int lengthSize = sizes & 0x0f;
+    sizes = c.u8();
+    int baseOffsetSize = sizes >> 4;
+    int indexSize = version == 1 || version == 2 ? sizes & 0x0f : 0;
+    uint32_t count = version < 2 ? c.u16() : c.u32();
+
+    for (uint32_t i = 0; i < count && !c.failed(); ++i) {
+        uint32_t id = version < 2 ? c.u16() : c.u32();
+        int method = version == 1 || version == 2 ? c.u16() & 0x0f : 0;
+        c.u16(); // data_reference_indexֻ֧ͬһļ
+        uint64_t baseOffset = 0;
+        if (!ReadSized(c, baseOffsetSize, &baseOffset))
+            return false;
+        int extentCount = c.u16();
+
+        Item& item = AddItem(id);
+        item.constructionMethod = method;
+        item.extents.clear();
+        for (int k = 0; k < extentCount && !c.failed(); ++k) {
+            uint64_t index = 0, offset = 0, length = 0;
+            if (!ReadSized(c, indexSize, &index) || !ReadSized(c, offsetSize, &offset) || !ReadSized(c, lengthSize, &length))
+                return false;
+            Extent e;
+            e.offset = (int64_t)(baseOffset + offset);
+            if (length == 0 && method == 0)
+                length = (uint64_t)max(_fileSize - e.offset, (int64_t)0); // 쵽ļĩβ
+            if (length > MAX_ITEM_SIZE)
+                return false;
+            e.size = (uint32_t)length;
+            item.extents.push_back(e);
+        }
+    }
+    return !c.failed();
+}
+
+bool HeifIndex::ParseIref(const uint8_t* p, size_t n)
+{
+    if (n < 4)
+        return false;
+    bool largeIds = p[0] != 0;
+    return ForEachBox(p + 4, n - 4, [this, largeIds](uint32_t type, const uint8_t* q, size_t m) {
+        BoxCursor c(q, m);
+        Reference ref;
+        ref.type = type;
+        ref.from = largeIds ? c.u32() : c.u16();
+        int count = c.u16();
+        for (int i = 0; i < count && !c.failed(); ++i)
+            ref.to.push_back(largeIds ? c.u32() : c.u16());
+        if (c.failed())
+            return false;
+        _references.push_back(std::move(ref));
+        return true;
+    });
+}
+
+bool HeifIndex::ParseIprp(const uint8_t* p, size_t n)
+{
+    return ForEachBox(p, n, [this](uint32_t type, const uint8_t* q, size_t m) {
+        if (type == FourCC('i', 'p', 'c', 'o')) {
+            return ForEachBox(q, m, [this](uint32_t type, const uint8_t* r, size_t k) {
+                Property prop;
+                prop.type = type;
+                prop.payload.assign(r, r + k);
+                _properties.push_back(std::move(prop));
+                return true;
+            });
+        }
+        if (type == FourCC('i', 'p', 'm', 'a')) {
+            BoxCursor c(q, m);
+            int version = c.u8();
+            c.skip(2);
+            bool largeIndex = (c.u8() & 1) != 0;
+            uint32_t count = c.u32();
+            for (uint32_t i = 0; i < count && !c.failed(); ++i) {
+                uint32_t id = version < 1 ? c.u16() : c.u32();
+                int associations = c.u8();
+                Item& item = AddItem(id);
+                for (int k = 0; k < associations && !c.failed(); ++k) {
+                    // λessential־
+                    uint16_t index = largeIndex ? c.u16() & 0x7fff : c.u8() & 0x7f;
+                    if (index != 0)
+                        item.properties.push_back(index);
+                }
+            }
+            return !c.failed();
+        }
+        return true;
+    });
+}
+
+// versionflagsrows_minus_onecolumns_minus_oneߣflags0λΪ1ʱ32λ16λ
+bool HeifIndex::ParseGrid(const Item& grid)
+{
+    uint32_t size = 0;
+    for (const Extent& e : grid.extents) {
+        if (e.size > 64 - size)
+            return false;
+        size += e.size;
+    }
+    if (size < 8)
+        return false;
+    std::vector<uint8_t> data(size);
+    if (!ReadExtents(grid.extents, grid.constructionMethod == 1, data.data()))
+        return false;
+
+    BoxCursor c(data.data(), data.size());
+    c.u8(); // version
+    bool large = (c.u8() & 1) != 0;
+    _rows = c.u8() + 1u;
+    _columns = c.u8() + 1u;
+    _width = large ? c.u32() : c.u16();
+    _height = large ? c.u32() : c.u16();
+    if (c.failed() || _width == 0 || _height == 0 || _rows * _columns > MAX_GRID_TILES)
+        return false;
+
+    const Reference* dimg = FindReference(FourCC('d', 'i', 'm', 'g'), grid.id);
+    if (dimg == nullptr || dimg->to.size() != _rows * _columns)
+        return false;
+    _tiles.resize(dimg->to.size());
+    for (size_t i = 0; i < _tiles.size(); ++i) {
+        if (!MakeImage(dimg->to[i], &_tiles[i]))
+            return false;
+        // ͼĳߴͬƴܸסߴ
+        if (_tiles[i].width != _tiles[0].width || _tiles[i].height != _tiles[0].height)
+            return false;
+    }
+    return (uint64_t)_tiles[0].width * _columns >= _width && (uint64_t)_tiles[0].height * _rows >= _height;
+}
+
+bool HeifIndex::ReadExtents(const std::vector<Extent>& extents, bool inIdat, uint8_t* buf) const
+{
+    for (const Extent& e : extents) {
+        if (inIdat) {
+            if (e.offset < 0 || e.size > _idat.size() || e.offset > (int64_t)(_idat.size() - e.size))
+                return false;
+            memcpy(buf, _idat.data() + e.offset, e.size);
+        }
+        else if (_read(_ctx, e.offset, buf, e.size) != e.size) {
+            return false;
+        }
+        buf += e.size;
+    }
+    return true;
+}
+
+bool HeifIndex::MakeImage(uint32_t id, Image* image) const
+{
+    const Item* item = FindItem(id);
+    if (item == nullptr || item->type != FourCC('h', 'v', 'c', '1') || item->extents.empty()
+        || (item->constructionMethod != 0 && item->constructionMethod != 1))
+        return false;
+
+    *image = Image();
+    image->id = id;
+    image->inIdat = item->constructionMethod == 1;
+    image->extents = item->extents;
+    for (const Extent& e : item->extents) {
+        if (e.size > MAX_ITEM_SIZE - image->size)
+            return false;
+        image->size += e.size;
+    }
+
+    bool hasConfig = false;
+    for (uint16_t index : item->properties) {
+        if (index > _properties.size())
+            return false;
+        const Property& prop = _properties[index - 1];
+        if (prop.type == FourCC('h', 'v', 'c', 'C') && !hasConfig) {
+            hasConfig = ParseHvcC(prop.payload.data(), prop.payload.size(), &image->nalLengthSize, &image->parameterSets);
+        }
+        else if (prop.type == FourCC('i', 's', 'p', 'e')) {
+            BoxCursor c(prop.payload.data(), prop.payload.size());
+            c.u32(); // version, flags
+            image->width = c.u32();
+            image->height = c.u32();
+        }
+    }
+    return hasConfig && image->width != 0 && image->height != 0;
+}
+
+HeifIndex::Item& HeifIndex::AddItem(uint32_t id)
+{
+    Item& item = _items[id];
+    item.id = id;
+    return item;
+}
+
+const HeifIndex::Item* HeifIndex::FindItem(uint32_t id) const
+{
+    auto it = _items.find(id);
+    return it != _items.end() ? &it->second : nullptr;
+}
+
+const HeifIndex::Reference* HeifIndex::FindReference(uint32_t type, uint32_t from) const
+{
+    for (const Reference& ref : _references) {
+        if (ref.type == type && ref.from == from)
+            return &ref;
+    }
+    return nullptr;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Mp4Index.h"
+
+//
+// HEIF/HEIC̬ͼ(ISO/IEC 23008-12)Ŀ
+// ļʱһԽmetaӣhdlrpictpitmͼiinf/infeĿͣ
+// ilocĿݵλãļƫƻmetaڵidatirefеdimgͼ顢thmbͼ
+// iprpipco/ipmahvcCispeĿ
+// ͼgridʱȡߴ磬ͼ鰴dimg˳򣨹դ˳У
+// ͼǵhvc1ʱ1x1ÿͼ鶼ǶHEVC֡Բн롣
+// ת(irot)ü(clap)AlphaȵȸͼExifԡ
+// Win32ļȡͨMp4Index::ReadFuncصɡ
+//
+class HeifIndex
+{
+public:
+    struct Extent
+    {
+        int64_t offset; // ļƫƣidatʱΪidatڵƫ
+        uint32_t size;
+    };
+
+    // һHEVCͼĿ
+    struct Image
+    {
+        uint32_t id = 0;
+        uint32_t width = 0; // ȡispe
+        uint32_t height = 0;
+        bool inIdat = false;
+        std::vector<Extent> extents;
+        uint32_t size = 0; // ֮ͣǰ׺ʽNALU
+        int nalLengthSize = 4;
+        std::vector<uint8_t> parameterSets; // hvcCеVPS/SPS/PPS4ֽʼAnnex-Bʽ
+    };
+
+    bool Open(Mp4Index::ReadFunc read, void* ctx, int64_t fileSize);
+    // Ŀȫݵbufimage.sizeֽڣβӡ
+    bool ReadImage(const Image& image, uint8_t* buf) const;
+
+    uint32_t Width() const { return _width; }
+    uint32_t Height() const { return _height; }
+    uint32_t Columns() const { return _columns; }
+    uint32_t Rows() const { return _rows; }
+    uint32_t TileWidth() const { return _tiles.empty() ? 0 : _tiles[0].width; }
+    uint32_t TileHeight() const { return _tiles.empty() ? 0 : _tiles[0].height; }
+    // ͼ飬դ˳УΪColumns() * Rows()
+    const std::vector<Image>& Tiles() const { return _tiles; }
+    bool HasThumbnail() const { return _thumbnail.id != 0; }
+    const Image& Thumbnail() const { return _thumbnail; }
+    uint32_t MaxImageSize() const { return _maxImageSize; }
+
+private:
+    struct Item
+    {
+        uint32_t id = 0;
+        uint32_t type = 0;
+        int constructionMethod = 0; // 0ļƫƣ1 idat
+        std::vector<Extent> extents;
+        std::vector<uint16_t> properties; // ipcoеţ1ʼ
+    };
+
+    struct Property
+    {
+        uint32_t type;
+        std::vector<uint8_t> payload;
+    };
+
+    struct Reference
+    {
+        uint32_t type;
+        uint32_t from;
+        std::vector<uint32_t> to;
+    };
+
+    bool ParseMeta(const uint8_t* p, size_t n);
+    bool ParseIinf(const uint8_t* p, size_t n);
+    bool ParseIloc(const uint8_t* p, size_t n);
+    bool ParseIref(const uint8_t* p, size_t n);
+    bool ParseIprp(const uint8_t* p, size_t n);
+    bool ParseGrid(const Item& grid);
+    bool ReadExtents(const std::vector<Extent>& extents, bool inIdat, uint8_t* buf) const;
+    bool MakeImage(uint32_t id, Image* image) const;
+    Item& AddItem(uint32_t id);
+    const Item* FindItem(uint32_t id) const;
+    const Reference* FindReference(uint32_t type, uint32_t from) const;
+
+    Mp4Index::ReadFunc _read = nullptr;
+    void* _ctx = nullptr;
+    int64_t _fileSize = 0;
+
+    bool _isPicture = false;
+    uint32_t _primaryId = 0;
+    std::map<uint32_t, Item> _items; // ĿIDiinf/iloc/ipmaÿһҪĿ
+    std::vector<Reference> _references;
+    std::vector<Property> _properties; // ipcoеԣ
+    std::vector<uint8_t> _idat;
+
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint32_t _columns = 0;
+    uint32_t _rows = 0;
+    std::vector<Image> _tiles;
+    Image _thumbnail;
+    uint32_t _maxImageSize = 0;
+};
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include "HeifSource.h"
+#include "Mp4Reader.h"
+
+namespace
+{
+    const int constNALUStartCodesSize = 4;
+
+    // ýRTSPƵPinͬVIDEOINFOHEADER2Annex-BʽVPS/SPS/PPSȡͼġ
+    // ͼķֱʲͬԼĲͳڲ롣
+    HRESULT GetMediaTypeH265(CMediaType& mediaType, const HeifIndex& index)
+    {
+        const HeifIndex::Image& tile = index.Tiles()[0];
+        ULONG formatSize = sizeof(VIDEOINFOHEADER2) + (ULONG)tile.parameterSets.size();
+        VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mediaType.AllocFormatBuffer(formatSize);
+        if (vih2 == nullptr)
+            return E_OUTOFMEMORY;
+        ZeroMemory(vih2, sizeof(VIDEOINFOHEADER2));
+        memcpy(vih2 + 1, tile.parameterSets.data(), tile.parameterSets.size());
+
+        SetRect(&vih2->rcSource, 0, 0, tile.width, tile.height);
+        SetRect(&vih2->rcTarget, 0, 0, tile.width, tile.height);
+        vih2->AvgTimePerFrame = CHeifSource::FRAME_INTERVAL_MS * 10000;
+        vih2->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        vih2->bmiHeader.biWidth = tile.width;
+        vih2->bmiHeader.biHeight = tile.height;
+        vih2->bmiHeader.biCompression = MAKEFOURCC('H', '2', '6', '5');
+
+        mediaType.SetType(&MEDIATYPE_Video);
+        mediaType.SetSubtype(&MEDIASUBTYPE_HEVC);
+        mediaType.SetFormatType(&FORMAT_VideoInfo2);
+        mediaType.SetTemporalCompression(FALSE);
+        mediaType.SetSampleSize(0);
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+// CHeifSourcePin implementation
+//-------------------------------------------------------------------------------------------------
+CHeifSourcePin::CHeifSourcePin(HRESULT* phr, CHeifSource* pFilter)
+    : RtspH265SourcePin(phr, pFilter, nullptr)
+{
+}
+
+void CHeifSourcePin::ResetIndex(const HeifIndex* index)
+{
+    _index = index;
+    GetMediaTypeH265(_mediaType, *index);
+    _initAvgTimePerFrame = ((VIDEOINFOHEADER2*)_mediaType.Format())->AvgTimePerFrame;
+    _sendMediaType = true;
+    _maxAuSize = (long)min((size_t)index->MaxImageSize(), (size_t)ALLOCATOR_BUF_MAX_SIZE);
+    _next = 0;
+}
+
+HRESULT CHeifSourcePin::OnThreadStartPlay()
+{
+    _next = 0;
+    _sendMediaType = true;
+    return __super::OnThreadStartPlay();
+}
+
+// ϳǰ׺תΪ4ֽʼĿݣдֽװʱ-1
+long CHeifSourcePin::ConvertImage(const HeifIndex::Image& image, BYTE* pData, long length)
+{
+    long parameterSetsSize = (long)image.parameterSets.size();
+    if (parameterSetsSize > length)
+        return -1;
+    memcpy(pData, image.parameterSets.data(), parameterSetsSize);
+
+    const int nalLengthSize = image.nalLengthSize;
+    const uint8_t* src = _itemData.data();
+    const uint8_t* end = src + image.size;
+    BYTE* dst = pData + parameterSetsSize;
+
+    while (end - src > nalLengthSize) {
+        uint32_t naluSize = 0;
+        for (int i = 0; i < nalLengthSize; ++i)
+            naluSize = naluSize << 8 | src[i];
+        src += nalLengthSize;
+        if (naluSize > (size_t)(end - src))
+            naluSize = (uint32_t)(end - src); // 𻵵ĿʣݵһNALU
+
+        if (constNALUStartCodesSize + (long)naluSize > length - (long)(dst - pData))
+            return -1;
+
+        ((uint32_t*)dst)[0] = 0x01000000;
+        dst += constNALUStartCodesSize;
+        memcpy(dst, src, naluSize);
+        dst += naluSize;
+        src += naluSize;
+    }
+
+    return (long)(dst - pData);
+}
+
+HRESULT CHeifSourcePin::FillBuffer(IMediaSample* pSample)
+{
+    CHeifSource* filter = static_cast<CHeifSource*>(m_pFilter);
+
+    BYTE* pBuffer;
+    HRESULT hr = pSample->GetPointer(&pBuffer);
+    if (FAILED(hr))
+        return hr;
+
+    bool hasThumbnail = _index->HasThumbnail();
+    size_t count = _index->Tiles().size() + (hasThumbnail ? 1 : 0);
+    if (_next >= count)
+        return S_FALSE; // ͼѾ
+
+    // ʼʱĿλã0ΪͼkͼΪk + 1
+    bool isThumbnail = hasThumbnail && _next == 0;
+    size_t tile = hasThumbnail ? _next - 1 : _next;
+    const HeifIndex::Image& image = isThumbnail ? _index->Thumbnail() : _index->Tiles()[tile];
+    REFERENCE_TIME tsStart = isThumbnail ? 0 : (REFERENCE_TIME)tile + 1;
+
+    _itemData.resize(image.size);
+    if (!_index->ReadImage(image, _itemData.data())) {
+        fprintf(stderr, "%S pin: read %s %u failed\n", m_pName, isThumbnail ? "thumbnail" : "tile", (unsigned)tile);
+        ++_next;
+        pSample->SetActualDataLength(0);
+        return S_OK;
+    }
+
+    long length = pSample->GetSize() - ALLOCATOR_BUF_PADDING;
+    long converted = ConvertImage(image, pBuffer, length);
+    if (converted < 0) {
+        // ǰ׺4ֽʱת󣬳ԤĻ
+        // ͳһֱװĿ
+        if (_bufferSize < ALLOCATOR_BUF_MAX_SIZE) {
+            _maxAuSize = max(_maxAuSize, _bufferSize * 2);
+        }
+        else {
+            fprintf(stderr, "%S pin: drop %u bytes image, too large for sample buffer!\n", m_pName, image.size);
+            ++_next;
+        }
+        pSample->SetActualDataLength(0);
+        return S_OK;
+    }
+
+    memset(pBuffer + converted, 0, ALLOCATOR_BUF_PADDING);
+    pSample->SetActualDataLength(converted);
+    pSample->SetSyncPoint(TRUE);
+    if (_next == 0)
+        pSample->SetDiscontinuity(TRUE);
+    ++_next;
+
+    // ÿǡһķʵԪ
+    SetAccessUnitSideData(pSample, true, true);
+
+    if (_sendMediaType) {
+        pSample->SetMediaType(&_mediaType);
+        _sendMediaType = false;
+    }
+
+    REFERENCE_TIME tsStop = tsStart + 1;
+    pSample->SetTime(&tsStart, &tsStop);
+    return S_OK;
+}
+
+//-------------------------------------------------------------------------------------------------
+// CHeifSource implementation
+//-------------------------------------------------------------------------------------------------
+CHeifSource::CHeifSource(IUnknown* pUnk, HRESULT* phr)
+    : CSource(TEXT("HeifSourceFilter"), pUnk, CLSID_NULL)
+{
+    _pin = new CHeifSourcePin(phr, this);
+}
+
+CHeifSource::~CHeifSource()
+{
+    SAFE_DELETE(_pin);
+    CloseFile();
+}
+
+HRESULT CHeifSource::NonDelegatingQueryInterface(REFIID riid, void** ppv)
+{
+    if (riid == IID_IHeifSourceCommand)
+        return GetInterface((HeifSource::ICommand*)this, ppv);
+    return CSource::NonDelegatingQueryInterface(riid, ppv);
+}
+
+HRESULT CHeifSource::Pause()
+{
+    if (m_State == State_Stopped && !IsOpen())
+        return E_UNEXPECTED;
+    return CSource::Pause();
+}
+
+void CHeifSource::SetChannelId(int channel)
+{
+    _channelId = channel;
+}
+
+void CHeifSource::SetNotifyReceiver(RtspSource::INotify* receiver)
+{
+    _notifyReceiver = receiver;
+}
+
+HRESULT CHeifSource::OpenFile(PCWSTR path)
+{
+    CAutoLock cAutoLock(pStateLock());
+    if (m_State != State_Stopped)
+        return VFW_E_NOT_STOPPED;
+
+    CloseFile();
+
+    _file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        fprintf(stderr, "%s - open %S failed, error=%u\n", __FUNCTION__, path, error);
+        return HRESULT_FROM_WIN32(error);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize) || !_index.Open(CMp4Reader::ReadAt, _file, fileSize.QuadPart)) {
+        fprintf(stderr, "%s - %S is not a HEVC coded HEIF image\n", __FUNCTION__, path);
+        CloseFile();
+        return VFW_E_INVALID_FILE_FORMAT;
+    }
+    fprintf(stderr, "%s - %S: %ux%u, %ux%u tiles of %ux%u%s\n", __FUNCTION__, path,
+            _index.Width(), _index.Height(), _index.Columns(), _index.Rows(), _index.TileWidth(), _index.TileHeight(),
+            _index.HasThumbnail() ? ", with thumbnail" : "");
+
+    _pin->ResetIndex(&_index);
+    if (_notifyReceiver != nullptr) {
+        _notifyReceiver->OnFrameIntervalChanged(_channelId, FRAME_INTERVAL_MS);
+    }
+
+    return S_OK;
+}
+
+HRESULT CHeifSource::GetImageInfo(HeifSource::ImageInfo* info)
+{
+    CheckPointer(info, E_POINTER);
+    if (!IsOpen())
+        return E_UNEXPECTED;
+    info->width = _index.Width();
+    info->height = _index.Height();
+    info->columns = _index.Columns();
+    info->rows = _index.Rows();
+    info->tileWidth = _index.TileWidth();
+    info->tileHeight = _index.TileHeight();
+    info->hasThumbnail = _index.HasThumbnail() ? TRUE : FALSE;
+    info->thumbnailWidth = _index.Thumbnail().width;
+    info->thumbnailHeight = _index.Thumbnail().height;
+    return S_OK;
+}
+
+void CHeifSource::CloseFile()
+{
+    _index = HeifIndex();
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// HeifSourceFilter module exported API
+//-------------------------------------------------------------------------------------------------
+HRESULT WINAPI HeifSource_CreateInstance(IBaseFilter** ppObj)
+{
+    HRESULT hr = S_OK;
+
+    CHeifSource* o = new CHeifSource(nullptr, &hr);
+    ULONG ul = o->AddRef();
+    *ppObj = static_cast<IBaseFilter*>(o);
+
+    return hr;
+}
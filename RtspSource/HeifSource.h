@@ -0,0 +1,75 @@
+#pragma once
+
+#include "IHeifSource.h"
+#include "RtspSourcePin.h"
+#include "HeifIndex.h"
+
+class CHeifSource;
+
+// HEIFԴƵPinRTSPƵPinķͷʵԪϢ
+// ߳ÿοʼͼʼͼһ飬귵S_FALSE
+// յ֪ͨ߳̽ʣµ֡
+class CHeifSourcePin : public RtspH265SourcePin
+{
+public:
+    CHeifSourcePin(HRESULT* phr, CHeifSource* pFilter);
+    void ResetIndex(const HeifIndex* index);
+    HRESULT FillBuffer(IMediaSample* pSample) override;
+
+protected:
+    HRESULT OnThreadStartPlay() override;
+
+private:
+    long ConvertImage(const HeifIndex::Image& image, BYTE* pData, long length);
+
+    const HeifIndex* _index = nullptr;
+    size_t _next = 0; // һҪ͵Ŀͼʱ0ͼǸͼ
+    std::vector<uint8_t> _itemData; // Ŀݣǰ׺ʽ
+};
+
+class CHeifSource : public CSource, public HeifSource::ICommand
+{
+public:
+    enum { FRAME_INTERVAL_MS = 1 }; // ͼûгʱ䣬һһ
+
+    CHeifSource(IUnknown* pUnk, HRESULT* phr);
+    virtual ~CHeifSource();
+
+    CHeifSource(const CHeifSource&) = delete;
+    CHeifSource& operator=(const CHeifSource&) = delete;
+
+    STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void** ppv) override;
+
+    // CBaseFilter
+    STDMETHODIMP Pause() override;
+
+    // HeifSource::ICommand
+    STDMETHODIMP_(void) SetChannelId(int channel);
+    STDMETHODIMP_(void) SetNotifyReceiver(RtspSource::INotify* receiver);
+    STDMETHODIMP OpenFile(PCWSTR path);
+    STDMETHODIMP GetImageInfo(HeifSource::ImageInfo* info);
+
+    STDMETHODIMP QueryInterface(REFIID riid, __deref_out void** ppv) {
+        return GetOwner()->QueryInterface(riid, ppv);
+    };
+    STDMETHODIMP_(ULONG) AddRef() {
+        ULONG r = GetOwner()->AddRef();
+        return r;
+    };
+    STDMETHODIMP_(ULONG) Release() {
+        ULONG r = GetOwner()->Release();
+        return r;
+    };
+
+private:
+    friend class CHeifSourcePin;
+
+    void CloseFile();
+    bool IsOpen() const { return _file != INVALID_HANDLE_VALUE; }
+
+    int _channelId = -1;
+    RtspSource::INotify* _notifyReceiver = nullptr;
+    CHeifSourcePin* _pin = nullptr;
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HeifIndex _index;
+};
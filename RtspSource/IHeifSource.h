@@ -0,0 +1,40 @@
+#pragma once
+
+#include <initguid.h>
+#include "IRtspSource.h"
+
+namespace HeifSource {
+
+    struct ImageInfo
+    {
+        int width; // ͼĿ
+        int height;
+        int columns; // ͼΪ1x1
+        int rows;
+        int tileWidth;
+        int tileHeight;
+        BOOL hasThumbnail;
+        int thumbnailWidth;
+        int thumbnailHeight;
+    };
+
+    // HEIF/HEIC̬ͼԴPinRtspSourceƵPinһ£ֱӽӵͬһƵϡ
+    // ÿһͼĿԼĲͼٰդ˳ĸͼ飬
+    // ĿʼʱĿͼеλã0ΪͼkͼΪk + 1
+    // Ⱦƴͼ֣VideoRenderer::MosaicDesc_tԼһ¡
+    // ͼ֮ụ̂֡߳ILAVVideoConfig::SetDecodeThreadsܲн롣
+    interface ICommand : public IUnknown
+    {
+        STDMETHOD_(void, SetChannelId(int channel)) = 0;
+        STDMETHOD_(void, SetNotifyReceiver(RtspSource::INotify* receiver)) = 0;
+        // ļĿֹֻͣ״̬µá
+        STDMETHOD(OpenFile(PCWSTR path)) = 0;
+        STDMETHOD(GetImageInfo(ImageInfo* info)) = 0;
+    };
+} // end namespace HeifSource
+
+// {5BA117F3-D635-4690-A768-E0264EA411C9}
+DEFINE_GUID(IID_IHeifSourceCommand,
+    0x5ba117f3, 0xd635, 0x4690, 0xa7, 0x68, 0xe0, 0x26, 0x4e, 0xa4, 0x11, 0xc9);
+
+extern HRESULT WINAPI HeifSource_CreateInstance(IBaseFilter** ppObj);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <initguid.h>
+#include "IRtspSource.h"
+
+class CReplayBuffer;
+
+namespace Mp4Source {
+
+    // ٲʱѡ֡ʽٶԽ߽֡Խ٣·Ľ븺²ٵȫ롣
+    enum FrameSelection
+    {
+        SelectAll, // ȫ
+        SelectReference, // ο֡ʱӲеӲǲοͼ
+        SelectIrap, // ֻʵ
+        SelectIrapSubsampled // ʵ̫ʱÿһ
+    };
+
+    // MP4/fMP4¼ļԴֻһHEVCƵPinRtspSourceƵPinһ£
+    // ֱӽӵͬһƵȾϡ
+    interface ICommand : public IUnknown
+    {
+        STDMETHOD_(void, SetChannelId(int channel)) = 0;
+        STDMETHOD_(void, SetNotifyReceiver(RtspSource::INotify* receiver)) = 0;
+        // ļֹֻͣ״̬µá
+        STDMETHOD(OpenFile(PCWSTR path)) = 0;
+        // ѼʱطŻchannelͨsecondsĿյļ򿪣ֹֻͣ״̬µá
+        // մӹؼ֡ʼܱsecondsԳ򿪺ļһԶλٺ͵š
+        STDMETHOD(OpenReplay(CReplayBuffer* replay, int channel, int seconds)) = 0;
+        // ļطƬεʱ룩
+        STDMETHOD(GetDuration(LONGLONG* pMSecs)) = 0;
+        // ƽ֡
+        STDMETHOD(GetFrameRate(double* pFps)) = 0;
+        // ͳĳʱ䣨룬ļͷ
+        STDMETHOD(GetPosition(LONGLONG* pMSecs)) = 0;
+        // λmsecsļͷǴӲmsecsʵ㿪ʼ룺
+        // keyframeOnlyΪTRUEʱ뵽ʵ㣨϶ãӦ죩
+        // Ŀ֮ǰֻ֡벻֣ӳʱ䲻msecsһ֡ʼ
+        // presentTimeΪĿ֡ĳʱ̣timeGetTime()룩0ʾþ;֣
+        // ͨͬλʱͨͬһʱ̡pActualMSecsʵʳֵĵһ֡ʱ䡣
+        // ֹͣ״̬µʱ´οʼʱЧ
+        STDMETHOD(Seek(LONGLONG msecs, BOOL keyframeOnly, DWORD presentTime, LONGLONG* pActualMSecs)) = 0;
+        // ȴһζλĵһ֡Receiveͬ룩
+        // pLatencyشӶλ˵ĺʱ룩ʱS_FALSE
+        STDMETHOD(WaitSeekComplete(DWORD dwMSecs, DWORD* pLatency)) = 0;
+        // òʣ1.0ΪٶȣΪţֻʵ㣩ѡЩ֡
+        // ӵǰλ¿ʼڶеľʵ֡pSelectionزõѡ֡ʽ
+        STDMETHOD(SetRate(double rate, FrameSelection* pSelection)) = 0;
+    };
+} // end namespace Mp4Source
+
+// {834DCB4E-40B7-420B-A5AC-420D09F1F731}
+DEFINE_GUID(IID_IMp4SourceCommand,
+    0x834dcb4e, 0x40b7, 0x420b, 0xa5, 0xac, 0x42, 0x0d, 0x09, 0xf1, 0xf7, 0x31);
+
+extern HRESULT WINAPI Mp4Source_CreateInstance(IBaseFilter** ppObj);
@@ -2,6 +2,11 @@
 
 #include <initguid.h>
 
+class CSyncGroup;
+class CRtspRelay;
+class CReconnectLimiter;
+class CReplayBuffer;
+
 namespace RtspSource {
 
     enum OpCode
@@ -11,6 +16,7 @@ namespace RtspSource {
         Play,
         Stop,
         Reconnect,
+        Switch,
         Done
     };
 
@@ -31,6 +37,29 @@ namespace RtspSource {
         ReconnectFailed
     };
 
+    // Ƶȡ᷽ʽڲɼͣĺ̨ͨ
+    // Ȼӡպתֻlive555߳̾ͶҪİ
+    // KeyframesOnlyNoneصFullʱһֱһIRAPյȱٲο֡ͼ
+    enum VideoMode
+    {
+        VideoFull, // ȫ
+        VideoKeyframesOnly, // ֻIRAPͼͬǰĲ
+        VideoNone // 
+    };
+
+    // ״live555̸߳RTCPͳƺ͵㣬StreamHealth.h
+    struct Health
+    {
+        int score; // [0,100]100ΪȫδڲʱΪ0
+        int lossPermille; // һĶʣǧֱȣ
+        int jitterMs; // RTPﶶRFC 3550
+        int srAgeMs; // һRTCP SRʱ䣬-1ʾûյ
+        int silenceMs; // һյýʱ
+        int gapThresholdMs; // ѧϰĶжֵ
+        unsigned reconnects; // ۼƵ
+        unsigned droppedNalus; // ۼƶĳNALUNALUޣ֡޷͸
+    };
+
     // called in ICommand calling thread apartment
     interface INotify : public IUnknown
     {
@@ -57,7 +86,30 @@ namespace RtspSource {
         STDMETHOD_(void, SetLatency(DWORD dwMSecs)) = 0;
         STDMETHOD_(void, SetSendLivenessCommand(BOOL sendLiveness)) = 0;
         STDMETHOD_(void, SetNotifyReceiver(INotify* receiver)) = 0;
+        STDMETHOD_(void, SetAudioMute(BOOL mute)) = 0;
+        // ͨͬ飬nullptrʾ֡OpenURL֮ǰá
+        STDMETHOD_(void, SetSyncGroup(CSyncGroup* group)) = 0;
+        // յİתRTSPתnullptrʾתOpenURL֮ǰá
+        STDMETHOD_(void, SetRelay(CRtspRelay* relay)) = 0;
+        // ǰȫ̵nullptrʾOpenURL֮ǰá
+        STDMETHOD_(void, SetReconnectLimiter(CReconnectLimiter* limiter)) = 0;
+        // յƵͬʱȫ̵ļʱطŻ壬nullptrʾ塣OpenURL֮ǰá
+        STDMETHOD_(void, SetReplayBuffer(CReplayBuffer* replay)) = 0;
+        // Ƶȡ᷽ʽ̡߳״̬µá
+        STDMETHOD_(void, SetVideoMode(VideoMode mode)) = 0;
+        // VideoNoneƵdwMSecsRTSP PAUSEռôָʱPLAY
+        // ܾPAUSEֱʱλỰٳԡ0ʾͣĬϣ
+        STDMETHOD_(void, SetIdlePauseDelay(DWORD dwMSecs)) = 0;
+        // Ƶ̵߳Windows߳ȼTHREAD_PRIORITY_*߳ͬεĽ
+        // ȼһ·ĽCPUʱķݶ״̬µã߳ѴʱЧ
+        STDMETHOD_(void, SetStreamingPriority(int priority)) = 0;
+        // ȡǰ״̵߳á
+        STDMETHOD_(void, GetHealth(Health* health)) = 0;
         STDMETHOD(OpenURL(PCWSTR url, PCWSTR userName, PCWSTR password)) = 0;
+        // лͬһ豸һ·/OpenURLû롣
+        // ں̨ỰյһIRAP滻ǰڼ仭治жϡ
+        // ʱлδɣδڲʱֻסURL´ȡʱЧ
+        STDMETHOD(SwitchURL(PCWSTR url)) = 0;
     };
 } // end namespace RtspSource
 
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//
+// ISOýļʽ(ISO/IEC 14496-12)ĺӽߣMP4HEIFá
+// ֻڴеĺӸϹWin32
+//
+namespace IsoBox {
+
+    constexpr uint32_t FourCC(char a, char b, char c, char d)
+    {
+        return (uint32_t)(uint8_t)a << 24 | (uint32_t)(uint8_t)b << 16 | (uint32_t)(uint8_t)c << 8 | (uint32_t)(uint8_t)d;
+    }
+
+    inline uint16_t BE16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+    inline uint32_t BE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+    inline uint64_t BE64(const uint8_t* p) { return (uint64_t)BE32(p) << 32 | BE32(p + 4); }
+
+    // ߽Ĵ˶ȡԽжȡ0λfailed
+    class BoxCursor
+    {
+    public:
+        BoxCursor(const uint8_t* p, size_t n) : _p(p), _n(n) {}
+
+        bool failed() const { return _failed; }
+        size_t remaining() const { return _n - _pos; }
+        const uint8_t* current() const { return _p + _pos; }
+
+        bool skip(size_t k)
+        {
+            if (_failed || k > remaining()) {
+                _failed = true;
+                _pos = _n;
+                return false;
+            }
+            _pos += k;
+            return true;
+        }
+        uint8_t u8() { const uint8_t* p = _p + _pos; return skip(1) ? p[0] : 0; }
+        uint16_t u16() { const uint8_t* p = _p + _pos; return skip(2) ? BE16(p) : 0; }
+        uint32_t u32() { const uint8_t* p = _p + _pos; return skip(4) ? BE32(p) : 0; }
+        uint64_t u64() { const uint8_t* p = _p + _pos; return skip(8) ? BE64(p) : 0; }
+
+    private:
+        const uint8_t* _p;
+        size_t _n;
+        size_t _pos = 0;
+        bool _failed = false;
+    };
+
+    // ζ[p, p+n)еÿӺӵfn(type, payload, payloadSize)Խfnfalseʱfalse
+    template<typename Fn>
+    bool ForEachBox(const uint8_t* p, size_t n, Fn fn)
+    {
+        size_t pos = 0;
+        while (n - pos >= 8) {
+            uint64_t size = BE32(p + pos);
+            uint32_t type = BE32(p + pos + 4);
+            size_t header = 8;
+            if (size == 1) {
+                if (n - pos < 16)
+                    return false;
+                size = BE64(p + pos + 8);
+                header = 16;
+            }
+            else if (size == 0) {
+                size = n - pos; // 쵽ĩβ
+            }
+            if (size < header || size > n - pos)
+                return false;
+            if (!fn(type, p + pos + header, (size_t)size - header))
+                return false;
+            pos += (size_t)size;
+        }
+        return true;
+    }
+
+    struct Span
+    {
+        const uint8_t* p = nullptr;
+        size_t n = 0;
+    };
+
+    // hvcCHEVCDecoderConfigurationRecordȡNALUǰ׺ֽеVPS/SPS/PPS
+    // תΪ4ֽʼAnnex-Bʽ׷ӵparameterSets
+    inline bool ParseHvcC(const uint8_t* p, size_t n, int* nalLengthSize, std::vector<uint8_t>* parameterSets)
+    {
+        if (n < 23)
+            return false;
+        *nalLengthSize = (p[21] & 0x03) + 1;
+        if (*nalLengthSize == 3)
+            return false; // 淶3ֽڳǰ׺
+
+        BoxCursor c(p + 23, n - 23);
+        int numArrays = p[22];
+        for (int i = 0; i < numArrays && !c.failed(); ++i) {
+            c.u8(); // array_completeness, NAL_unit_type
+            int numNalus = c.u16();
+            for (int j = 0; j < numNalus && !c.failed(); ++j) {
+                uint16_t length = c.u16();
+                const uint8_t* nalu = c.current();
+                if (!c.skip(length))
+                    break;
+                static const uint8_t startCode[4] = { 0, 0, 0, 1 };
+                parameterSets->insert(parameterSets->end(), startCode, startCode + 4);
+                parameterSets->insert(parameterSets->end(), nalu, nalu + length);
+            }
+        }
+        return !c.failed() && !parameterSets->empty();
+    }
+
+} // end namespace IsoBox
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include "ConcurrentQueue.h"
 
 class MediaPacketSample
@@ -11,10 +12,12 @@ public:
     MediaPacketSample() {}
 
     MediaPacketSample(std::uint8_t* buffer, size_t bufSize, timeval presentationTime,
-                      bool isRtcpSynced)
-        : _buffer(buffer, buffer + bufSize)
+                      bool isRtcpSynced, bool isMarker = false)
+        : _buffer(std::make_shared<std::vector<std::uint8_t>>(buffer, buffer + bufSize))
         , _presentationTime(presentationTime)
         , _isRtcpSynced(isRtcpSynced)
+        , _isMarker(isMarker)
+        , _arrivalTime(timeGetTime())
     {
     }
 
@@ -28,6 +31,9 @@ public:
         : _buffer(std::move(other._buffer))
         , _presentationTime(other._presentationTime)
         , _isRtcpSynced(other._isRtcpSynced)
+        , _isMarker(other._isMarker)
+        , _arrivalTime(other._arrivalTime)
+        , _isSwitchPoint(other._isSwitchPoint)
     {
     }
 
@@ -41,6 +47,9 @@ public:
             _buffer = std::move(other._buffer);
             _presentationTime = other._presentationTime;
             _isRtcpSynced = other._isRtcpSynced;
+            _isMarker = other._isMarker;
+            _arrivalTime = other._arrivalTime;
+            _isSwitchPoint = other._isSwitchPoint;
         }
         return *this;
     }
@@ -48,11 +57,22 @@ public:
     ~MediaPacketSample() {}
 
     bool invalid() const { return size() == 0; }
-    size_t size() const { return _buffer.size(); }
-    const std::uint8_t* data() const { return _buffer.data(); }
-    std::uint8_t* data() { return _buffer.data(); }
+    size_t size() const { return _buffer ? _buffer->size() : 0; }
+    const std::uint8_t* data() const { return _buffer ? _buffer->data() : nullptr; }
+    // The payload is immutable once received, so the decode queue, the relay and the
+    // replay ring all hold the same bytes instead of copying them.
+    const std::shared_ptr<const std::vector<std::uint8_t>>& buffer() const { return _buffer; }
     const timeval& presentationTime() const { return _presentationTime; }
     bool isRtcpSynced() const { return _isRtcpSynced; }
+    // RTP marker bit of the packet which completed this frame.
+    // For H.265 it is set on the last packet of an access unit (RFC 7798).
+    bool isMarker() const { return _isMarker; }
+    // Local timeGetTime() (ms) at which the frame was handed over by live555.
+    DWORD arrivalTime() const { return _arrivalTime; }
+    // First packet of a new stream after a stream switch: the output pin starts
+    // a new sample here and takes over the new stream's media type and time base.
+    bool isSwitchPoint() const { return _isSwitchPoint; }
+    void setSwitchPoint(bool isSwitchPoint) { _isSwitchPoint = isSwitchPoint; }
 
     int64_t timestamp() const
     {
@@ -62,9 +82,12 @@ public:
     }
 
 private:
-    std::vector<std::uint8_t> _buffer;
+    std::shared_ptr<const std::vector<std::uint8_t>> _buffer;
     timeval _presentationTime;
     bool _isRtcpSynced;
+    bool _isMarker = false;
+    DWORD _arrivalTime = 0;
+    bool _isSwitchPoint = false;
 };
 
 typedef ConcurrentQueue<MediaPacketSample> MediaPacketQueue;
@@ -0,0 +1,553 @@
+#include "stdafx.h"
+#include "Mp4Index.h"
+#include "IsoBox.h"
+#include <algorithm>
+
+namespace
+{
+    const int64_t MAX_BOX_SIZE = 256 * 1024 * 1024; // moov/moof˴СΪļ
+    const uint32_t MAX_SAMPLE_SIZE = 64 * 1024 * 1024;
+    const size_t MAX_SAMPLES = 8 * 1024 * 1024; // 25֡/ʱԼ93СʱԼ256MB
+}
+
+using namespace IsoBox;
+
+double Mp4Index::FrameRate() const
+{
+    if (_samples.size() < 2 || _timescale == 0)
+        return 25.0;
+    int64_t span = _samples.back().dts - _samples.front().dts;
+    if (span <= 0)
+        return 25.0;
+    return (double)(_samples.size() - 1) * _timescale / span;
+}
+
+bool Mp4Index::FindSeekPoint(int64_t time, size_t* sync, size_t* target) const
+{
+    if (_syncSamples.empty())
+        return false;
+
+    // ʵĳʱ˳ֲҼɣɨ
+    auto it = std::upper_bound(_syncSamples.begin(), _syncSamples.end(), time,
+        [this](int64_t t, uint32_t i) { return t < PresentationTime(i); });
+    size_t k = it == _syncSamples.begin() ? 0 : (size_t)(it - _syncSamples.begin()) - 1;
+    size_t first = _syncSamples[k];
+    size_t last = k + 1 < _syncSamples.size() ? _syncSamples[k + 1] : _samples.size();
+
+    // GOPҳʱ䲻timeһ֡CRARASL֡ʱCRA
+    // CRAʼʱȱٲο֡ᱻѡС
+    size_t best = first;
+    int64_t bestTime = PresentationTime(first);
+    for (size_t i = first + 1; i < last; ++i) {
+        int64_t t = PresentationTime(i);
+        if (t > bestTime && t <= time) {
+            best = i;
+            bestTime = t;
+        }
+    }
+
+    *sync = first;
+    *target = best;
+    return true;
+}
+
+bool Mp4Index::ReadBox(int64_t offset, int64_t size, std::vector<uint8_t>& box)
+{
+    if (size <= 0 || size > MAX_BOX_SIZE)
+        return false;
+    box.resize((size_t)size);
+    return _read(_ctx, offset, box.data(), box.size()) == box.size();
+}
+
+// ˳ӣmoovmoof֮ǰmdatֻȡ
+// ¼;ϵɵĽضļѾĲȻԲš
+bool Mp4Index::Open(ReadFunc read, void* ctx, int64_t fileSize)
+{
+    *this = Mp4Index();
+    _read = read;
+    _ctx = ctx;
+    _fileSize = fileSize;
+
+    bool hasMoov = false;
+    int64_t offset = 0;
+    std::vector<uint8_t> box;
+    while (fileSize - offset >= 8) {
+        uint8_t header[16];
+        size_t headerBytes = (size_t)min((int64_t)sizeof(header), fileSize - offset);
+        if (_read(_ctx, offset, header, headerBytes) != headerBytes)
+            break;
+
+        uint64_t size = BE32(header);
+        uint32_t type = BE32(header + 4);
+        size_t headerSize = 8;
+        if (size == 1) {
+            if (headerBytes < 16)
+                break;
+            size = BE64(header + 8);
+            headerSize = 16;
+        }
+        else if (size == 0) {
+            size = fileSize - offset;
+        }
+        if (size < headerSize || size > (uint64_t)(fileSize - offset))
+            break;
+
+        if (type == FourCC('m', 'o', 'o', 'v')) {
+            if (!ReadBox(offset, size, box) || !ParseMoov(box.data() + headerSize, box.size() - headerSize))
+                return false;
+            hasMoov = true;
+        }
+        else if (type == FourCC('m', 'o', 'o', 'f') && hasMoov && _trackId != 0) {
+            if (!ReadBox(offset, size, box) || !ParseMoof(box.data() + headerSize, box.size() - headerSize, offset))
+                break; // 𻵵Ƭμݲ
+        }
+        offset += size;
+    }
+
+    if (!hasMoov || _trackId == 0)
+        return false;
+    Finish();
+    return !_samples.empty();
+}
+
+bool Mp4Index::ParseMoov(const uint8_t* p, size_t n)
+{
+    // ƵٰĹȡmvexеƬĬֵ
+    bool ok = ForEachBox(p, n, [this](uint32_t type, const uint8_t* q, size_t m) {
+        if (type == FourCC('t', 'r', 'a', 'k') && _trackId == 0)
+            return ParseTrak(q, m);
+        return true;
+    });
+    if (!ok || _trackId == 0)
+        return ok;
+
+    return ForEachBox(p, n, [this](uint32_t type, const uint8_t* q, size_t m) {
+        if (type != FourCC('m', 'v', 'e', 'x'))
+            return true;
+        return ForEachBox(q, m, [this](uint32_t type, const uint8_t* r, size_t k) {
+            if (type != FourCC('t', 'r', 'e', 'x'))
+                return true;
+            BoxCursor c(r, k);
+            c.u32(); // version & flags
+            uint32_t trackId = c.u32();
+            c.u32(); // default_sample_description_index
+            Trex trex;
+            trex.duration = c.u32();
+            trex.size = c.u32();
+            trex.flags = c.u32();
+            if (!c.failed() && trackId == _trackId)
+                _trex = trex;
+            return !c.failed();
+        });
+    });
+}
+
+// HEVCƵĹֱtrueֻкӽṹ𻵲ŷfalse
+bool Mp4Index::ParseTrak(const uint8_t* p, size_t n)
+{
+    uint32_t trackId = 0;
+    uint32_t timescale = 0;
+    bool isVideo = false;
+    bool indexed = false;
+
+    bool ok = ForEachBox(p, n, [&](uint32_t type, const uint8_t* q, size_t m) {
+        if (type == FourCC('t', 'k', 'h', 'd')) {
+            BoxCursor c(q, m);
+            uint8_t version = c.u8();
+            c.skip(3 + (version == 1 ? 16 : 8));
+            trackId = c.u32();
+            return !c.failed();
+        }
+        if (type != FourCC('m', 'd', 'i', 'a'))
+            return true;
+        return ForEachBox(q, m, [&](uint32_t type, const uint8_t* r, size_t k) {
+            BoxCursor c(r, k);
+            if (type == FourCC('m', 'd', 'h', 'd')) {
+                uint8_t version = c.u8();
+                c.skip(3 + (version == 1 ? 16 : 8));
+                timescale = c.u32();
+                return !c.failed();
+            }
+            if (type == FourCC('h', 'd', 'l', 'r')) {
+                c.skip(8); // version & flags, pre_defined
+                isVideo = c.u32() == FourCC('v', 'i', 'd', 'e');
+                return !c.failed();
+            }
+            if (type != FourCC('m', 'i', 'n', 'f') || !isVideo)
+                return true;
+            return ForEachBox(r, k, [&](uint32_t type, const uint8_t* s, size_t l) {
+                if (type == FourCC('s', 't', 'b', 'l'))
+                    indexed = ParseStbl(s, l);
+                return true;
+            });
+        });
+    });
+
+    if (!ok)
+        return false;
+    if (!indexed || trackId == 0 || timescale == 0) {
+        _samples.clear();
+        _parameterSets.clear();
+        return true;
+    }
+    _trackId = trackId;
+    _timescale = timescale;
+    return true;
+}
+
+bool Mp4Index::ParseHvcC(const uint8_t* p, size_t n)
+{
+    return IsoBox::ParseHvcC(p, n, &_nalLengthSize, &_parameterSets);
+}
+
+bool Mp4Index::ParseStbl(const uint8_t* p, size_t n)
+{
+    Span stsd, stts, ctts, stss, stsc, stsz, stz2, stco, co64;
+    bool ok = ForEachBox(p, n, [&](uint32_t type, const uint8_t* q, size_t m) {
+        Span s;
+        s.p = q;
+        s.n = m;
+        switch (type) {
+        case FourCC('s', 't', 's', 'd'): stsd = s; break;
+        case FourCC('s', 't', 't', 's'): stts = s; break;
+        case FourCC('c', 't', 't', 's'): ctts = s; break;
+        case FourCC('s', 't', 's', 's'): stss = s; break;
+        case FourCC('s', 't', 's', 'c'): stsc = s; break;
+        case FourCC('s', 't', 's', 'z'): stsz = s; break;
+        case FourCC('s', 't', 'z', '2'): stz2 = s; break;
+        case FourCC('s', 't', 'c', 'o'): stco = s; break;
+        case FourCC('c', 'o', '6', '4'): co64 = s; break;
+        }
+        return true;
+    });
+    if (!ok || stsd.p == nullptr || stsd.n < 8)
+        return false;
+
+    // һĿhvc1/hev1VisualSampleEntryУhvcC档
+    bool isHevc = false;
+    ForEachBox(stsd.p + 8, stsd.n - 8, [&](uint32_t type, const uint8_t* q, size_t m) {
+        if ((type != FourCC('h', 'v', 'c', '1') && type != FourCC('h', 'e', 'v', '1')) || m < 78)
+            return false;
+        _width = BE16(q + 24);
+        _height = BE16(q + 26);
+        ForEachBox(q + 78, m - 78, [&](uint32_t type, const uint8_t* r, size_t k) {
+            if (type == FourCC('h', 'v', 'c', 'C'))
+                isHevc = ParseHvcC(r, k);
+            return true;
+        });
+        return false; // ֻһĿ
+    });
+    if (!isHevc)
+        return false;
+
+    // ССͬʱstszֻܺӳԼ
+    // ҪȺ˶Թ֮չ
+    std::vector<uint32_t> sizes;
+    uint32_t constantSize = 0;
+    uint32_t constantCount = 0;
+    if (stsz.p != nullptr) {
+        BoxCursor c(stsz.p, stsz.n);
+        c.u32();
+        uint32_t sampleSize = c.u32();
+        uint32_t count = c.u32();
+        if (sampleSize != 0) {
+            constantSize = sampleSize;
+            constantCount = count;
+        }
+        else {
+            if (count > c.remaining() / 4)
+                return false;
+            sizes.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+                sizes[i] = c.u32();
+        }
+        if (c.failed())
+            return false;
+    }
+    else if (stz2.p != nullptr) {
+        BoxCursor c(stz2.p, stz2.n);
+        c.u32();
+        c.skip(3);
+        uint8_t fieldSize = c.u8();
+        uint32_t count = c.u32();
+        if ((fieldSize != 4 && fieldSize != 8 && fieldSize != 16) || (uint64_t)count * fieldSize / 8 > c.remaining())
+            return false;
+        sizes.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (fieldSize == 16)
+                sizes[i] = c.u16();
+            else if (fieldSize == 8)
+                sizes[i] = c.u8();
+            else
+                sizes[i] = (i & 1) ? (c.current()[-1] & 0x0F) : (c.u8() >> 4);
+        }
+        if (c.failed())
+            return false;
+    }
+    if (sizes.empty() && constantCount == 0)
+        return true; // fMP4ĳʼΣmoof
+
+    // ƫ
+    std::vector<int64_t> chunks;
+    {
+        bool large = stco.p == nullptr;
+        Span s = large ? co64 : stco;
+        if (s.p == nullptr)
+            return false;
+        BoxCursor c(s.p, s.n);
+        c.u32();
+        uint32_t count = c.u32();
+        if (count > c.remaining() / (large ? 8 : 4))
+            return false;
+        chunks.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+            chunks[i] = large ? (int64_t)c.u64() : (int64_t)c.u32();
+    }
+
+    // ӳ
+    if (stsc.p == nullptr)
+        return false;
+
+    // Сͬܳļװµĸұһ¡
+    if (constantCount != 0) {
+        BoxCursor c(stsc.p, stsc.n);
+        c.u32();
+        uint32_t entries = c.u32();
+        if (entries > c.remaining() / 12)
+            return false;
+        uint64_t chunkSamples = 0;
+        for (uint32_t e = 0; e < entries; ++e) {
+            uint32_t firstChunk = c.u32();
+            uint32_t samplesPerChunk = c.u32();
+            c.u32(); // sample_description_index
+            uint32_t lastChunk = (uint32_t)chunks.size();
+            if (e + 1 < entries)
+                lastChunk = BE32(c.current()) - 1;
+            if (firstChunk == 0 || lastChunk > chunks.size())
+                return false;
+            if (lastChunk >= firstChunk)
+                chunkSamples += (uint64_t)(lastChunk - firstChunk + 1) * samplesPerChunk;
+        }
+        if (constantCount > MAX_SAMPLES || (int64_t)constantCount > _fileSize / constantSize || constantCount != chunkSamples)
+            return false;
+        sizes.assign(constantCount, constantSize);
+    }
+
+    _samples.resize(sizes.size());
+    size_t total = 0;
+    {
+        BoxCursor c(stsc.p, stsc.n);
+        c.u32();
+        uint32_t entries = c.u32();
+        if (entries > c.remaining() / 12)
+            return false;
+        for (uint32_t e = 0; e < entries && total < _samples.size(); ++e) {
+            uint32_t firstChunk = c.u32();
+            uint32_t samplesPerChunk = c.u32();
+            c.u32(); // sample_description_index
+            uint32_t lastChunk = (uint32_t)chunks.size();
+            if (e + 1 < entries)
+                lastChunk = BE32(c.current()) - 1; // һĿfirst_chunk
+            if (firstChunk == 0 || lastChunk > chunks.size())
+                return false;
+            for (uint32_t chunk = firstChunk; chunk <= lastChunk && total < _samples.size(); ++chunk) {
+                int64_t offset = chunks[chunk - 1];
+                for (uint32_t k = 0; k < samplesPerChunk && total < _samples.size(); ++k) {
+                    _samples[total].offset = offset;
+                    _samples[total].size = sizes[total];
+                    offset += sizes[total];
+                    ++total;
+                }
+            }
+        }
+    }
+    _samples.resize(total);
+
+    // ʱ
+    {
+        BoxCursor c(stts.p, stts.n);
+        c.u32();
+        uint32_t entries = c.u32();
+        int64_t dts = 0;
+        size_t i = 0;
+        for (uint32_t e = 0; e < entries && !c.failed(); ++e) {
+            uint32_t count = c.u32();
+            uint32_t delta = c.u32();
+            for (uint32_t k = 0; k < count && i < total; ++k, ++i) {
+                _samples[i].dts = dts;
+                dts += delta;
+            }
+        }
+        for (; i < total; ++i)
+            _samples[i].dts = dts; // ʱ
+    }
+
+    // ϳʱƫƣB֡ʱУ
+    for (size_t i = 0; i < total; ++i)
+        _samples[i].cto = 0;
+    if (ctts.p != nullptr) {
+        BoxCursor c(ctts.p, ctts.n);
+        c.u32();
+        uint32_t entries = c.u32();
+        size_t i = 0;
+        for (uint32_t e = 0; e < entries && !c.failed() && i < total; ++e) {
+            uint32_t count = c.u32();
+            int32_t offset = (int32_t)c.u32();
+            for (uint32_t k = 0; k < count && i < total; ++k, ++i)
+                _samples[i].cto = offset;
+        }
+    }
+
+    // ؼ֡ûstssʾȫǹؼ֡
+    for (size_t i = 0; i < total; ++i)
+        _samples[i].sync = stss.p == nullptr;
+    if (stss.p != nullptr) {
+        BoxCursor c(stss.p, stss.n);
+        c.u32();
+        uint32_t entries = c.u32();
+        for (uint32_t e = 0; e < entries && !c.failed(); ++e) {
+            uint32_t number = c.u32();
+            if (number >= 1 && number <= total)
+                _samples[number - 1].sync = true;
+        }
+    }
+
+    return true;
+}
+
+bool Mp4Index::ParseMoof(const uint8_t* p, size_t n, int64_t moofOffset)
+{
+    return ForEachBox(p, n, [&](uint32_t type, const uint8_t* q, size_t m) {
+        if (type == FourCC('t', 'r', 'a', 'f'))
+            return ParseTraf(q, m, moofOffset);
+        return true;
+    });
+}
+
+bool Mp4Index::ParseTraf(const uint8_t* p, size_t n, int64_t moofOffset)
+{
+    bool ours = false;
+    int64_t base = moofOffset; // ûbase_data_offsetʱmoofΪ׼
+    int64_t dataPos = base;
+    uint32_t defDuration = _trex.duration;
+    uint32_t defSize = _trex.size;
+    uint32_t defFlags = _trex.flags;
+    int64_t dts = _nextFragmentDts;
+
+    bool ok = ForEachBox(p, n, [&](uint32_t type, const uint8_t* q, size_t m) {
+        BoxCursor c(q, m);
+        if (type == FourCC('t', 'f', 'h', 'd')) {
+            uint32_t flags = c.u32() & 0xFFFFFF;
+            ours = c.u32() == _trackId;
+            if (flags & 0x000001)
+                base = (int64_t)c.u64();
+            dataPos = base;
+            if (flags & 0x000002)
+                c.u32(); // sample_description_index
+            if (flags & 0x000008)
+                defDuration = c.u32();
+            if (flags & 0x000010)
+                defSize = c.u32();
+            if (flags & 0x000020)
+                defFlags = c.u32();
+            return !c.failed();
+        }
+        if (!ours)
+            return true;
+        if (type == FourCC('t', 'f', 'd', 't')) {
+            uint8_t version = c.u8();
+            c.skip(3);
+            dts = version == 1 ? (int64_t)c.u64() : (int64_t)c.u32();
+            return !c.failed();
+        }
+        if (type != FourCC('t', 'r', 'u', 'n'))
+            return true;
+
+        uint32_t flags = c.u32() & 0xFFFFFF;
+        uint32_t count = c.u32();
+        int64_t runPos = dataPos;
+        if (flags & 0x000001)
+            runPos = base + (int32_t)c.u32(); // data_offsetڻ׼ƫ
+        uint32_t firstFlags = (flags & 0x000004) ? c.u32() : defFlags;
+        size_t fieldBytes = 4 * (((flags >> 8) & 1) + ((flags >> 9) & 1) + ((flags >> 10) & 1) + ((flags >> 11) & 1));
+        if (c.failed() || (fieldBytes > 0 && count > c.remaining() / fieldBytes))
+            return false;
+        // ûֶʱcountֻļʣֽںĬСԼ
+        int64_t sizeFloor = (flags & 0x000200) ? 1 : max(defSize, (uint32_t)1);
+        if (runPos < 0 || runPos > _fileSize || (int64_t)count > (_fileSize - runPos) / sizeFloor
+            || count > MAX_SAMPLES - _samples.size())
+            return false;
+        _samples.reserve(_samples.size() + count);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t duration = (flags & 0x000100) ? c.u32() : defDuration;
+            uint32_t size = (flags & 0x000200) ? c.u32() : defSize;
+            uint32_t sampleFlags = (flags & 0x000400) ? c.u32() : (i == 0 ? firstFlags : defFlags);
+            int32_t cto = (flags & 0x000800) ? (int32_t)c.u32() : 0;
+            Sample s;
+            s.offset = runPos;
+            s.size = size;
+            s.sync = ((sampleFlags >> 16) & 1) == 0; // sample_is_non_sync_sample
+            s.dts = dts;
+            s.cto = cto;
+            _samples.push_back(s);
+            runPos += size;
+            dts += duration;
+        }
+        dataPos = runPos; // ͬһtrafеһtrunһ
+        return !c.failed();
+    });
+
+    if (ours) {
+        _fragmented = true;
+        _nextFragmentDts = dts;
+    }
+    return ok;
+}
+
+// ȥļضϺԽͳʼʱʱ
+bool Mp4Index::Build(std::vector<Sample>&& samples, uint32_t timescale, uint32_t width, uint32_t height,
+                     const std::vector<uint8_t>& parameterSets, int64_t dataSize)
+{
+    *this = Mp4Index();
+    _fileSize = dataSize;
+    _timescale = timescale;
+    _width = width;
+    _height = height;
+    _nalLengthSize = 4;
+    _parameterSets = parameterSets;
+    _samples = std::move(samples);
+    Finish();
+    return _timescale != 0 && !_parameterSets.empty() && !_syncSamples.empty();
+}
+
+void Mp4Index::Finish()
+{
+    size_t valid = 0;
+    while (valid < _samples.size()) {
+        const Sample& s = _samples[valid];
+        if (s.size == 0 || s.size > MAX_SAMPLE_SIZE || s.offset < 0 || s.offset + s.size > _fileSize)
+            break;
+        ++valid;
+    }
+    _samples.resize(valid);
+    _syncSamples.clear();
+    if (_samples.empty())
+        return;
+
+    _maxSampleSize = 0;
+    _startTime = _samples[0].dts + _samples[0].cto;
+    int64_t endTime = _startTime;
+    for (size_t i = 0; i < _samples.size(); ++i) {
+        const Sample& s = _samples[i];
+        if (s.sync)
+            _syncSamples.push_back((uint32_t)i);
+        _maxSampleSize = max(_maxSampleSize, s.size);
+        _startTime = min(_startTime, s.dts + s.cto);
+        endTime = max(endTime, s.dts + s.cto);
+    }
+    int64_t frameDuration = 0;
+    if (_samples.size() > 1)
+        frameDuration = (_samples.back().dts - _samples.front().dts) / (int64_t)(_samples.size() - 1);
+    _duration = endTime - _startTime + frameDuration;
+}
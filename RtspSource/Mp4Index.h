@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//
+// MP4/fMP4ļHEVCƵ
+// ļʱһԽmoov(stsd/stts/ctts/stss/stsc/stsz/stco)moof(tfhd/tfdt/trun)
+// ÿļƫơСʱ䡢ϳʱƫƺǷؼ֡չһƽ̹ı
+// ͬʱ˳ʵ(IRAP)ţźͶλʱֻٽӡ
+// ֻһhvc1/hev1Ƶ༭б(elst)ԡ
+// Win32ļȡͨReadFuncصɡ
+//
+class Mp4Index
+{
+public:
+    struct Sample
+    {
+        int64_t offset; // ļƫ
+        uint32_t size; // ֽǰ׺ʽNALUУ
+        bool sync; // ǷΪʵ
+        int64_t dts; // ʱ䣨ʱ̶ȣ
+        int32_t cto; // ϳʱƫƣpts = dts + cto
+    };
+
+    // ļƫoffsetȡsizeֽڣʵʶȡֽ
+    typedef size_t (*ReadFunc)(void* ctx, int64_t offset, void* buf, size_t size);
+
+    bool Open(ReadFunc read, void* ctx, int64_t fileSize);
+    // ӣֱӲø˳򣩣ڴе缴ʱطš
+    // ݰΪ4ֽڵǰ׺ʽɵߵReadFuncȡparameterSetsΪAnnex-Bʽ
+    bool Build(std::vector<Sample>&& samples, uint32_t timescale, uint32_t width, uint32_t height,
+               const std::vector<uint8_t>& parameterSets, int64_t dataSize);
+
+    const std::vector<Sample>& Samples() const { return _samples; }
+    uint32_t Timescale() const { return _timescale; }
+    uint32_t Width() const { return _width; }
+    uint32_t Height() const { return _height; }
+    int NalLengthSize() const { return _nalLengthSize; }
+    // hvcCеVPS/SPS/PPSתΪ4ֽʼAnnex-Bʽ
+    const std::vector<uint8_t>& ParameterSets() const { return _parameterSets; }
+    uint32_t MaxSampleSize() const { return _maxSampleSize; }
+    bool IsFragmented() const { return _fragmented; }
+    // һĳʱ䣬ʱ𣨿̶ȣ
+    int64_t StartTime() const { return _startTime; }
+    // ʱ̶ȣ
+    int64_t Duration() const { return _duration; }
+    // ƽ֡ʣʱ25֡ơ
+    double FrameRate() const;
+    // ʵţ˳С
+    const std::vector<uint32_t>& SyncSamples() const { return _syncSamples; }
+    // sampleStartTime()ĳʱ䣨̶ȣ
+    int64_t PresentationTime(size_t sample) const { return _samples[sample].dts + _samples[sample].cto - _startTime; }
+    // λtimeΪStartTime()Ŀ̶ȡsyncسʱ䲻timeһʵ㣬
+    // targetشsyncʼ롢ʱ䲻timeһȷλʱ뵽Ϊֹ
+    // timeڵһʵʱ߶ǵһʵ㡣ûʵʱfalse
+    bool FindSeekPoint(int64_t time, size_t* sync, size_t* target) const;
+
+private:
+    struct Trex
+    {
+        uint32_t duration = 0;
+        uint32_t size = 0;
+        uint32_t flags = 0;
+    };
+
+    bool ReadBox(int64_t offset, int64_t size, std::vector<uint8_t>& box);
+    bool ParseMoov(const uint8_t* p, size_t n);
+    bool ParseTrak(const uint8_t* p, size_t n);
+    bool ParseStbl(const uint8_t* p, size_t n);
+    bool ParseHvcC(const uint8_t* p, size_t n);
+    bool ParseMoof(const uint8_t* p, size_t n, int64_t moofOffset);
+    bool ParseTraf(const uint8_t* p, size_t n, int64_t moofOffset);
+    void Finish();
+
+    ReadFunc _read = nullptr;
+    void* _ctx = nullptr;
+    int64_t _fileSize = 0;
+
+    uint32_t _trackId = 0;
+    uint32_t _timescale = 0;
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    int _nalLengthSize = 4;
+    std::vector<uint8_t> _parameterSets;
+    Trex _trex;
+    bool _fragmented = false;
+    int64_t _nextFragmentDts = 0;
+
+    std::vector<Sample> _samples;
+    std::vector<uint32_t> _syncSamples;
+    uint32_t _maxSampleSize = 0;
+    int64_t _startTime = 0;
+    int64_t _duration = 0;
+};
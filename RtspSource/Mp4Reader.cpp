@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "Mp4Reader.h"
+#include <algorithm>
+
+CMp4Reader::~CMp4Reader()
+{
+    Stop();
+}
+
+size_t CMp4Reader::ReadAt(void* file, int64_t offset, void* buf, size_t size)
+{
+    // ͬϴƫƵReadFileǶλҲںļָλá
+    OVERLAPPED ov = { 0 };
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD bytesRead = 0;
+    if (!ReadFile((HANDLE)file, buf, (DWORD)size, &bytesRead, &ov))
+        return 0;
+    return bytesRead;
+}
+
+void CMp4Reader::Start(Mp4Index::ReadFunc read, void* ctx, const Mp4Index* index, size_t startSample)
+{
+    Stop();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _read = read;
+        _ctx = ctx;
+        _index = index;
+        _nextRead = startSample;
+        ++_generation;
+        _failed = false;
+        _exit = false;
+    }
+    _thread = std::thread(&CMp4Reader::IoThread, this);
+}
+
+void CMp4Reader::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _exit = true;
+    }
+    _cond.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    DropReady();
+}
+
+CMp4Reader::Packet* CMp4Reader::Next()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [this] {
+        return _exit || !_ready.empty() || (!_reading && (_failed || _nextRead >= _index->Samples().size()));
+    });
+    if (_exit || _ready.empty())
+        return nullptr;
+
+    Packet* packet = _ready.front();
+    _ready.pop_front();
+    _readyBytes -= packet->size;
+    lock.unlock();
+    _cond.notify_all();
+    return packet;
+}
+
+void CMp4Reader::Recycle(Packet* packet)
+{
+    if (packet == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free.push_back(packet);
+}
+
+unsigned CMp4Reader::Seek(size_t sample)
+{
+    unsigned generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        DropReady();
+        _nextRead = sample;
+        _failed = false;
+        generation = ++_generation;
+    }
+    _cond.notify_all();
+    return generation;
+}
+
+void CMp4Reader::SetSyncStep(int step)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _syncStep = step;
+}
+
+// ߳_mutexsample֮Ҫû˷
+size_t CMp4Reader::NextSample(size_t sample) const
+{
+    if (_syncStep == 0)
+        return sample + 1;
+
+    const std::vector<uint32_t>& sync = _index->SyncSamples();
+    if (_syncStep > 0) {
+        size_t after = std::upper_bound(sync.begin(), sync.end(), (uint32_t)sample) - sync.begin();
+        size_t k = after + _syncStep - 1;
+        return k < sync.size() ? sync[k] : _index->Samples().size();
+    }
+    size_t before = std::lower_bound(sync.begin(), sync.end(), (uint32_t)sample) - sync.begin();
+    if (before < (size_t)-_syncStep)
+        return _index->Samples().size();
+    return sync[before + _syncStep];
+}
+
+// ߳_mutex
+void CMp4Reader::DropReady()
+{
+    for (Packet* packet : _ready) {
+        _readyBytes -= packet->size;
+        _free.push_back(packet);
+    }
+    _ready.clear();
+}
+
+// ߳_mutexȸ㹻Ŀаһаûв½
+CMp4Reader::Packet* CMp4Reader::TakeFreePacket(uint32_t size)
+{
+    Packet* packet = nullptr;
+    for (size_t i = 0; i < _free.size(); ++i) {
+        if (_free[i]->buffer.size() >= size + PACKET_PADDING) {
+            packet = _free[i];
+            _free[i] = _free.back();
+            break;
+        }
+    }
+    if (packet != nullptr) {
+        _free.pop_back();
+    }
+    else if (!_free.empty()) {
+        packet = _free.back();
+        _free.pop_back();
+    }
+    else {
+        _pool.push_back(std::unique_ptr<Packet>(new Packet()));
+        packet = _pool.back().get();
+    }
+    if (packet->buffer.size() < size + PACKET_PADDING)
+        packet->buffer.resize(size + PACKET_PADDING);
+    return packet;
+}
+
+void CMp4Reader::IoThread()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _cond.wait(lock, [this] {
+            return _exit || (!_failed && _nextRead < _index->Samples().size()
+                             && _ready.size() < PREFETCH_PACKETS && _readyBytes < PREFETCH_BYTES);
+        });
+        if (_exit)
+            break;
+
+        const Mp4Index::Sample& sample = _index->Samples()[_nextRead];
+        Packet* packet = TakeFreePacket(sample.size);
+        packet->size = sample.size;
+        packet->index = _nextRead;
+        _nextRead = NextSample(_nextRead);
+        packet->generation = _generation;
+        _readyBytes += packet->size;
+        _reading = true;
+
+        // ʱ߳̿Լȡ
+        lock.unlock();
+        bool ok = _read(_ctx, sample.offset, packet->buffer.data(), packet->size) == packet->size;
+        if (ok)
+            memset(packet->buffer.data() + packet->size, 0, PACKET_PADDING);
+        lock.lock();
+
+        _reading = false;
+        if (ok && packet->generation == _generation) {
+            _ready.push_back(packet);
+        }
+        else {
+            // ȡʧܰļȡڼ䷢Seekİֱϡ
+            if (!ok && packet->generation == _generation) {
+                fprintf(stderr, "Mp4Reader: read sample %u failed, error=%u\n", (unsigned)packet->index, GetLastError());
+                _failed = true;
+            }
+            _readyBytes -= packet->size;
+            _free.push_back(packet);
+        }
+        _cond.notify_all();
+    }
+}
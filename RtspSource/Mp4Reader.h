@@ -0,0 +1,80 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <memory>
+#include "Mp4Index.h"
+
+//
+// MP4ļ첽Ԥ
+// I/O̰߳˳ֱӶػİֻ߳Ӿȡȴ̡
+// Ԥͬʱܰ(PREFETCH_PACKETS)ֽ(PREFETCH_BYTES)ƣ16·4KͬʱҲռùڴ棻
+// 黹ȶźٷڴ档
+// SeekʹѾڶİȫϣ֣I/O߳λÿʼ
+// ߱ٺ͵ʱֻʵ㣬ռ̴
+//
+class CMp4Reader
+{
+public:
+    enum { PREFETCH_PACKETS = 24 }; // Լ1Ƶ
+    enum { PREFETCH_BYTES = 8 * 1024 * 1024 };
+    enum { PACKET_PADDING = 64 };
+
+    struct Packet
+    {
+        std::vector<uint8_t> buffer; // Сsize + PACKET_PADDING
+        uint32_t size = 0;
+        size_t index = 0; // 
+        unsigned generation = 0; // ÿStart/Seekһ
+        const uint8_t* data() const { return buffer.data(); }
+    };
+
+    CMp4Reader() = default;
+    ~CMp4Reader();
+    CMp4Reader(const CMp4Reader&) = delete;
+    CMp4Reader& operator=(const CMp4Reader&) = delete;
+
+    // ӵstartSampleʼԤreadctxȡctxindexStop֮ǰ뱣Ч
+    void Start(Mp4Index::ReadFunc read, void* ctx, const Mp4Index* index, size_t startSample);
+    // ֹͣI/Ọ߳Next()е߳nullptr
+    void Stop();
+    // ȡһԤûʱȴꡢȡʧֹܻͣʱnullptr
+    Packet* Next();
+    void Recycle(Packet* packet);
+    // Ԥİӵsample¿ʼµĴš
+    unsigned Seek(size_t sample);
+    // 0ʾ˳nʾֻʵ㣬ÿnһʾŶʵ㡣
+    // StartSeek֮ǰãʼӦʵ㡣
+    void SetSyncStep(int step);
+
+    // ͬȡMp4IndexʹãfileΪHANDLE
+    static size_t ReadAt(void* file, int64_t offset, void* buf, size_t size);
+
+private:
+    void IoThread();
+    Packet* TakeFreePacket(uint32_t size);
+    void DropReady();
+    size_t NextSample(size_t sample) const;
+
+    Mp4Index::ReadFunc _read = nullptr;
+    void* _ctx = nullptr;
+    const Mp4Index* _index = nullptr;
+    std::thread _thread;
+
+    // ³Ա_mutex
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::vector<std::unique_ptr<Packet>> _pool; // а
+    std::vector<Packet*> _free;
+    std::deque<Packet*> _ready;
+    size_t _readyBytes = 0; // кڶİֽ
+    size_t _nextRead = 0; // ʾ
+    int _syncStep = 0;
+    unsigned _generation = 0;
+    bool _reading = false;
+    bool _failed = false;
+    bool _exit = true;
+};
@@ -0,0 +1,646 @@
+#include "stdafx.h"
+#include "Mp4Source.h"
+#include "H265StreamParser.h"
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    const int constNALUStartCodesSize = 4;
+
+    // ýRTSPƵPinͬVIDEOINFOHEADER2Annex-BʽVPS/SPS/PPS
+    HRESULT GetMediaTypeH265(CMediaType& mediaType, const Mp4Index& index)
+    {
+        const std::vector<uint8_t>& parameterSets = index.ParameterSets();
+        ULONG formatSize = sizeof(VIDEOINFOHEADER2) + (ULONG)parameterSets.size();
+        VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mediaType.AllocFormatBuffer(formatSize);
+        if (vih2 == nullptr)
+            return E_OUTOFMEMORY;
+        ZeroMemory(vih2, sizeof(VIDEOINFOHEADER2));
+        memcpy(vih2 + 1, parameterSets.data(), parameterSets.size());
+
+        SetRect(&vih2->rcSource, 0, 0, index.Width(), index.Height());
+        SetRect(&vih2->rcTarget, 0, 0, index.Width(), index.Height());
+        vih2->AvgTimePerFrame = (REFERENCE_TIME)(UNITS_IN_100NS / index.FrameRate());
+        vih2->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        vih2->bmiHeader.biWidth = index.Width();
+        vih2->bmiHeader.biHeight = index.Height();
+        vih2->bmiHeader.biCompression = MAKEFOURCC('H', '2', '6', '5');
+
+        mediaType.SetType(&MEDIATYPE_Video);
+        mediaType.SetSubtype(&MEDIASUBTYPE_HEVC);
+        mediaType.SetFormatType(&FORMAT_VideoInfo2);
+        mediaType.SetTemporalCompression(TRUE);
+        mediaType.SetSampleSize(0);
+
+        return S_OK;
+    }
+
+    // SPSеsps_max_sub_layers_minus1ʱӲ㣨TemporalId
+    int GetMaxTemporalId(const std::vector<uint8_t>& parameterSets)
+    {
+        const uint8_t* p = parameterSets.data();
+        size_t n = parameterSets.size();
+        for (size_t i = 0; i + 6 < n; ++i) {
+            if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 0 && p[i + 3] == 1 && ((p[i + 4] >> 1) & 0x3f) == 33)
+                return (p[i + 6] >> 1) & 7;
+        }
+        return 0;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+// CMp4SourcePin implementation
+//-------------------------------------------------------------------------------------------------
+CMp4SourcePin::CMp4SourcePin(HRESULT* phr, CMp4Source* pFilter)
+    : RtspH265SourcePin(phr, pFilter, nullptr)
+    , _rebase(true)
+    , _seekCompleted(TRUE)
+{
+}
+
+void CMp4SourcePin::ResetIndex(const Mp4Index* index)
+{
+    _index = index;
+    GetMediaTypeH265(_mediaType, *index);
+    _initAvgTimePerFrame = ((VIDEOINFOHEADER2*)_mediaType.Format())->AvgTimePerFrame;
+    _sendMediaType = true;
+    _maxTemporalId = GetMaxTemporalId(index->ParameterSets());
+
+    // ļϲǻҪĴСȡһ֮ǰλ
+    size_t maxAuSize = index->MaxSampleSize() + index->ParameterSets().size();
+    _maxAuSize = (long)min(maxAuSize, (size_t)ALLOCATOR_BUF_MAX_SIZE);
+}
+
+HRESULT CMp4SourcePin::OnThreadStartPlay()
+{
+    CMp4Source* filter = static_cast<CMp4Source*>(m_pFilter);
+    filter->_reader.Recycle(_pendingPacket);
+    _pendingPacket = nullptr;
+    _generation = 0;
+    _rebase = true;
+    return __super::OnThreadStartPlay();
+}
+
+void CMp4SourcePin::PrepareSeek(int64_t prerollTime, DWORD presentTime)
+{
+    CMp4Source* filter = static_cast<CMp4Source*>(m_pFilter);
+    filter->_reader.Recycle(_pendingPacket);
+    _pendingPacket = nullptr;
+    _seekPending = true;
+    _seekTime = prerollTime;
+    _presentTime = presentTime;
+    _seekStartTime = timeGetTime();
+    _seekFrameFilled = false;
+    _seekCompleted.Reset();
+}
+
+void CMp4SourcePin::SetRate(double rate, bool skipNonReference, bool irapOnly)
+{
+    _rate = rate;
+    _skipNonReference = skipNonReference;
+    _irapOnly = irapOnly;
+    _rebase = true;
+}
+
+bool CMp4SourcePin::WaitSeekComplete(DWORD dwMSecs, DWORD* pLatency)
+{
+    if (!_seekCompleted.Wait(dwMSecs))
+        return false;
+    *pLatency = _seekLatency;
+    return true;
+}
+
+// Receiveͬ룬λһֵͳĿ֡ѾȾˡ
+HRESULT CMp4SourcePin::Deliver(IMediaSample* pSample)
+{
+    HRESULT hr = __super::Deliver(pSample);
+    if (_seekFrameFilled) {
+        _seekFrameFilled = false;
+        _seekLatency = timeGetTime() - _seekStartTime;
+        _seekCompleted.Set();
+    }
+    return hr;
+}
+
+// ǰ׺NALUתΪ4ֽʼ룬дֽװʱ-1
+long CMp4SourcePin::ConvertSample(const CMp4Reader::Packet& packet, BYTE* pData, long length)
+{
+    const int nalLengthSize = _index->NalLengthSize();
+    const uint8_t* src = packet.data();
+    const uint8_t* end = src + packet.size;
+    BYTE* dst = pData;
+
+    while (end - src > nalLengthSize) {
+        uint32_t naluSize = 0;
+        for (int i = 0; i < nalLengthSize; ++i)
+            naluSize = naluSize << 8 | src[i];
+        src += nalLengthSize;
+        if (naluSize > (size_t)(end - src))
+            naluSize = (uint32_t)(end - src); // 𻵵ʣݵһNALU
+
+        if (constNALUStartCodesSize + (long)naluSize > length - (long)(dst - pData))
+            return -1;
+
+        // Append 4-byte start code 00 00 00 01 in network byte order that precedes each NALU
+        ((uint32_t*)dst)[0] = 0x01000000;
+        dst += constNALUStartCodesSize;
+        memcpy(dst, src, naluSize);
+        dst += naluSize;
+        src += naluSize;
+    }
+
+    return (long)(dst - pData);
+}
+
+// еһNALU͡ӲǲοͼTRAIL_NTSA_NSTSA_NRADL_NRASL_Nżͣ
+// ͬһʱӲͼολʱӲʱӰκ֡Ľ롣
+bool CMp4SourcePin::IsDroppable(const CMp4Reader::Packet& packet) const
+{
+    const int nalLengthSize = _index->NalLengthSize();
+    const uint8_t* src = packet.data();
+    const uint8_t* end = src + packet.size;
+
+    while (end - src > nalLengthSize + 1) {
+        uint32_t naluSize = 0;
+        for (int i = 0; i < nalLengthSize; ++i)
+            naluSize = naluSize << 8 | src[i];
+        src += nalLengthSize;
+        int type = (src[0] >> 1) & 0x3f;
+        int temporalId = (src[1] & 7) - 1;
+        if (type < 32)
+            return type <= 14 && type % 2 == 0 && temporalId >= _maxTemporalId;
+        if (naluSize > (size_t)(end - src))
+            break;
+        src += naluSize;
+    }
+    return false;
+}
+
+HRESULT CMp4SourcePin::FillBuffer(IMediaSample* pSample)
+{
+    CMp4Source* filter = static_cast<CMp4Source*>(m_pFilter);
+
+    BYTE* pBuffer;
+    HRESULT hr = pSample->GetPointer(&pBuffer);
+    if (FAILED(hr))
+        return hr;
+
+    CMp4Reader::Packet* packet = _pendingPacket;
+    _pendingPacket = nullptr;
+    while (packet == nullptr) {
+        packet = filter->_reader.Next();
+        if (packet == nullptr) {
+            fprintf(stderr, "%S pin: End of file!\n", m_pName);
+            return S_FALSE;
+        }
+        // ٲʱο֡ͽ
+        if (_skipNonReference && IsDroppable(*packet)) {
+            filter->_reader.Recycle(packet);
+            packet = nullptr;
+        }
+    }
+
+    // տʼŻնλλĻһοͷԤֻ벻֡
+    if (packet->generation != _generation) {
+        _generation = packet->generation;
+        _discontinuity = true;
+        _prerollTime = _seekPending && _rate > 0 ? _seekTime : INT64_MIN; // ʱļʱݼûԤ
+        _seekBase = _seekPending;
+        _seekPending = false;
+    }
+
+    const Mp4Index::Sample& sample = _index->Samples()[packet->index];
+    int64_t timescale = _index->Timescale();
+    int64_t dtsMs = (sample.dts - _index->StartTime()) * 1000 / timescale;
+    int64_t ptsMs = _index->PresentationTime(packet->index) * 1000 / timescale;
+    bool preroll = ptsMs < _prerollTime;
+
+    // ͣʱͣͳֱصѭüʱӦ״̬仯
+    if (!preroll && filter->m_State == State_Paused) {
+        _pendingPacket = packet;
+        Sleep(PAUSE_POLL_MS);
+        pSample->SetActualDataLength(0);
+        return S_OK;
+    }
+
+    // տʼŻնλȸϲ¿ʼ
+    BYTE* pData = pBuffer;
+    long length = pSample->GetSize() - ALLOCATOR_BUF_PADDING;
+    bool discontinuity = _discontinuity;
+    if (discontinuity) {
+        long copied = CopyParameterSets(pData, length);
+        pData += copied;
+        length -= copied;
+    }
+
+    long converted = ConvertSample(*packet, pData, length);
+    if (converted < 0) {
+        // ǰ׺4ֽʱת󣬳˰ļԤĻ
+        // ͳһֱװ
+        if (_bufferSize < ALLOCATOR_BUF_MAX_SIZE) {
+            _maxAuSize = max(_maxAuSize, _bufferSize * 2);
+            _pendingPacket = packet;
+        }
+        else {
+            fprintf(stderr, "%S pin: drop %u bytes sample, too large for sample buffer!\n", m_pName, packet->size);
+            filter->_reader.Recycle(packet);
+        }
+        pSample->SetActualDataLength(0);
+        return S_OK;
+    }
+
+    _discontinuity = false;
+    filter->_reader.Recycle(packet);
+
+    long actualLength = (long)(pData - pBuffer) + converted;
+    memset(pBuffer + actualLength, 0, ALLOCATOR_BUF_PADDING);
+    pSample->SetActualDataLength(actualLength);
+    pSample->SetSyncPoint(sample.sync);
+    if (discontinuity)
+        pSample->SetDiscontinuity(TRUE);
+
+    // ÿǡһķʵԪ
+    SetAccessUnitSideData(pSample, true, true);
+
+    if (_sendMediaType) {
+        pSample->SetMediaType(&_mediaType);
+        _sendMediaType = false;
+    }
+
+    // ԤʱֱӶͬӰʱ
+    if (preroll) {
+        REFERENCE_TIME ts = ptsMs - _prerollTime - 1;
+        pSample->SetTime(&ts, NULL);
+        return S_OK;
+    }
+
+    // ʱ = ߱ʱ + (ĳʱ - ߶Ӧļʱ) / ʡ
+    // ԽʱΪߣB֡ʱ֡ҲڻߣλĿ֡Ϊߣ
+    // Ԥˣֵ֮֡Ŀֻ֡ʵʱûԳʱΪߡ
+    if (_seekBase) {
+        _seekBase = false;
+        _rebase = false;
+        _seekFrameFilled = true;
+        _baseTime = _seekTime;
+        // ͨͬλ˹ͬĳʱ̣Ԥ̫ѾĻֻܾ֡
+        DWORD now = timeGetTime();
+        if (_presentTime != 0 && (int32_t)(_presentTime - now) > 0)
+            _baseLocalTime = _presentTime;
+        else
+            _baseLocalTime = now + START_LATENCY_MS;
+    }
+    else if (discontinuity || _rebase.exchange(false)) {
+        _baseTime = _irapOnly ? ptsMs : dtsMs;
+        _baseLocalTime = timeGetTime() + START_LATENCY_MS;
+    }
+    // ʱӷĸǸʱ
+    REFERENCE_TIME ts = _baseLocalTime + (REFERENCE_TIME)((ptsMs - _baseTime) / _rate);
+    pSample->SetTime(&ts, NULL);
+    _lastPresentationTime = ts;
+    _currentPlayTime = ptsMs * 10000;
+
+    return S_OK;
+}
+
+//-------------------------------------------------------------------------------------------------
+// CMp4Source implementation
+//-------------------------------------------------------------------------------------------------
+CMp4Source::CMp4Source(IUnknown* pUnk, HRESULT* phr)
+    : CSource(TEXT("Mp4SourceFilter"), pUnk, CLSID_NULL)
+{
+    _pin = new CMp4SourcePin(phr, this);
+}
+
+CMp4Source::~CMp4Source()
+{
+    _reader.Stop();
+    SAFE_DELETE(_pin);
+    CloseFile();
+}
+
+HRESULT CMp4Source::NonDelegatingQueryInterface(REFIID riid, void** ppv)
+{
+    if (riid == IID_IMp4SourceCommand)
+        return GetInterface((Mp4Source::ICommand*)this, ppv);
+    return CSource::NonDelegatingQueryInterface(riid, ppv);
+}
+
+HRESULT CMp4Source::Stop()
+{
+    // ֹͣԤCMp4Reader::Next()е̷߳ļPin˳ѭ
+    _reader.Stop();
+    return CSource::Stop();
+}
+
+HRESULT CMp4Source::Pause()
+{
+    if (m_State == State_Stopped) {
+        if (!IsOpen())
+            return E_UNEXPECTED;
+        _reader.Start(_read, _readCtx, &_index, _startSample);
+        _startSample = 0;
+    }
+    return CSource::Pause();
+}
+
+HRESULT CMp4Source::Run(REFERENCE_TIME tStart)
+{
+    // ͣڼ䱾ʱһֱߣһʼ½ʱߡ
+    _pin->Rebase();
+    return CSource::Run(tStart);
+}
+
+void CMp4Source::SetChannelId(int channel)
+{
+    _channelId = channel;
+}
+
+void CMp4Source::SetNotifyReceiver(RtspSource::INotify* receiver)
+{
+    _notifyReceiver = receiver;
+}
+
+HRESULT CMp4Source::OpenFile(PCWSTR path)
+{
+    CAutoLock cAutoLock(pStateLock());
+    if (m_State != State_Stopped)
+        return VFW_E_NOT_STOPPED;
+
+    CloseFile();
+
+    // ̼д룬¼ƵļҲܴ򿪣ֻѾдĲ֡
+    _file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        fprintf(stderr, "%s - open %S failed, error=%u\n", __FUNCTION__, path, error);
+        return HRESULT_FROM_WIN32(error);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize) || !_index.Open(CMp4Reader::ReadAt, _file, fileSize.QuadPart)) {
+        fprintf(stderr, "%s - %S has no playable HEVC track\n", __FUNCTION__, path);
+        CloseFile();
+        return VFW_E_INVALID_FILE_FORMAT;
+    }
+    fprintf(stderr, "%s - %S: %ux%u, %u samples, %.2f fps%s\n", __FUNCTION__, path,
+            _index.Width(), _index.Height(), (unsigned)_index.Samples().size(), _index.FrameRate(),
+            _index.IsFragmented() ? ", fragmented" : "");
+
+    _read = CMp4Reader::ReadAt;
+    _readCtx = _file;
+    ResetPlayback();
+
+    return S_OK;
+}
+
+// ֻûյĸأʱֻʵԪһ
+// RTPֻʱ䣬ʱȡĳʱ䣬ǰÿĳʱ䡣
+HRESULT CMp4Source::OpenReplay(CReplayBuffer* replay, int channel, int seconds)
+{
+    CheckPointer(replay, E_POINTER);
+    CAutoLock cAutoLock(pStateLock());
+    if (m_State != State_Stopped)
+        return VFW_E_NOT_STOPPED;
+
+    CloseFile();
+
+    if (!replay->Snapshot(channel, seconds, &_clip)) {
+        fprintf(stderr, "%s - channel %d has nothing to replay\n", __FUNCTION__, channel);
+        return VFW_E_NOT_FOUND;
+    }
+
+    // һʵԪԲͷ
+    std::vector<uint8_t> parameterSets;
+    uint32_t width = 0, height = 0;
+    for (const CReplayBuffer::Buffer& nalu : _clip.units[0].nalus) {
+        int type = ((*nalu)[0] >> 1) & 0x3F;
+        if (type < 32 || type > 34)
+            break;
+        if (type == 33) {
+            H265SPSParser sps(const_cast<uint8_t*>(nalu->data()), (uint32_t)nalu->size());
+            width = sps.GetWidth();
+            height = sps.GetHeight();
+        }
+        static const uint8_t startCode[4] = { 0, 0, 0, 1 };
+        parameterSets.insert(parameterSets.end(), startCode, startCode + 4);
+        parameterSets.insert(parameterSets.end(), nalu->begin(), nalu->end());
+    }
+
+    const uint32_t timescale = 90000;
+    const std::vector<CReplayBuffer::AccessUnit>& units = _clip.units;
+    std::vector<int64_t> pts(units.size());
+    for (size_t i = 0; i < units.size(); ++i)
+        pts[i] = (units[i].timestamp - units[0].timestamp) * 9 / 1000;
+    std::vector<int64_t> dts(pts);
+    std::sort(dts.begin(), dts.end());
+    int64_t shift = 0;
+    for (size_t i = 0; i < units.size(); ++i)
+        shift = max(shift, dts[i] - pts[i]);
+
+    std::vector<Mp4Index::Sample> samples(units.size());
+    for (size_t i = 0; i < units.size(); ++i) {
+        Mp4Index::Sample& s = samples[i];
+        s.offset = _clip.offsets[i];
+        s.size = units[i].size;
+        s.sync = units[i].irap;
+        s.dts = dts[i] - shift;
+        s.cto = (int32_t)(pts[i] - s.dts);
+    }
+    if (!_index.Build(std::move(samples), timescale, width, height, parameterSets, _clip.size)) {
+        fprintf(stderr, "%s - channel %d: replay clip is not decodable\n", __FUNCTION__, channel);
+        CloseFile();
+        return VFW_E_INVALID_FILE_FORMAT;
+    }
+    fprintf(stderr, "%s - channel %d: %ux%u, %u samples, %.2f fps, %lld ms, %u KB\n", __FUNCTION__, channel,
+            _index.Width(), _index.Height(), (unsigned)_index.Samples().size(), _index.FrameRate(),
+            _index.Duration() * 1000 / timescale, (unsigned)(_clip.size / 1024));
+
+    _read = CReplayBuffer::Clip::ReadAt;
+    _readCtx = &_clip;
+    ResetPlayback();
+
+    return S_OK;
+}
+
+HRESULT CMp4Source::GetDuration(LONGLONG* pMSecs)
+{
+    CheckPointer(pMSecs, E_POINTER);
+    if (!IsOpen())
+        return E_UNEXPECTED;
+    *pMSecs = _index.Duration() * 1000 / _index.Timescale();
+    return S_OK;
+}
+
+HRESULT CMp4Source::GetFrameRate(double* pFps)
+{
+    CheckPointer(pFps, E_POINTER);
+    if (!IsOpen())
+        return E_UNEXPECTED;
+    *pFps = _index.FrameRate();
+    return S_OK;
+}
+
+HRESULT CMp4Source::GetPosition(LONGLONG* pMSecs)
+{
+    CheckPointer(pMSecs, E_POINTER);
+    if (!IsOpen())
+        return E_UNEXPECTED;
+    *pMSecs = _pin->CurrentPlayTime() / 10000;
+    return S_OK;
+}
+
+HRESULT CMp4Source::Seek(LONGLONG msecs, BOOL keyframeOnly, DWORD presentTime, LONGLONG* pActualMSecs)
+{
+    CAutoLock cAutoLock(pStateLock());
+    if (!IsOpen())
+        return E_UNEXPECTED;
+
+    int64_t timescale = _index.Timescale();
+    size_t sync, target;
+    if (!_index.FindSeekPoint(msecs * timescale / 1000, &sync, &target))
+        return E_FAIL;
+    if (_syncStep != 0)
+        keyframeOnly = TRUE; // ֻʵʱûԤм֡
+    int64_t actual = _index.PresentationTime(keyframeOnly ? sync : target) * 1000 / timescale;
+    Reposition(sync, actual, presentTime);
+
+    fprintf(stderr, "%s - channel %d: %lld ms -> sample %u, decode from IRAP %u (%u ahead of target)\n", __FUNCTION__,
+            _channelId, actual, (unsigned)target, (unsigned)sync, keyframeOnly ? 0 : (unsigned)(target - sync));
+    if (pActualMSecs != nullptr)
+        *pActualMSecs = actual;
+    return S_OK;
+}
+
+HRESULT CMp4Source::WaitSeekComplete(DWORD dwMSecs, DWORD* pLatency)
+{
+    CheckPointer(pLatency, E_POINTER);
+    return _pin->WaitSeekComplete(dwMSecs, pLatency) ? S_OK : S_FALSE;
+}
+
+// ʾЩ֡ȫ룻ıο֡
+// ٸ߻ߵֻʵ㣬ʵ̫ʱһÿ·ÿMAX_IRAP_FPS֡
+HRESULT CMp4Source::SetRate(double rate, Mp4Source::FrameSelection* pSelection)
+{
+    CAutoLock cAutoLock(pStateLock());
+    if (!IsOpen())
+        return E_UNEXPECTED;
+    double speed = fabs(rate);
+    if (speed < 1.0 / MAX_RATE || speed > MAX_RATE)
+        return E_INVALIDARG;
+
+    int64_t timescale = _index.Timescale();
+    size_t syncCount = max(_index.SyncSamples().size(), (size_t)1);
+    double irapInterval = (double)_index.Duration() * 1000 / timescale / syncCount; // ʵƽ룩
+    double interval = 1000 / _index.FrameRate(); // ֵ֮֡ļʱ䣨룩
+    if (rate > 0 && speed <= MAX_FULL_DECODE_RATE) {
+        _selection = Mp4Source::SelectAll;
+        _syncStep = 0;
+    }
+    else if (rate > 0 && speed <= MAX_REFERENCE_DECODE_RATE) {
+        _selection = Mp4Source::SelectReference;
+        _syncStep = 0;
+    }
+    else {
+        int step = max(1, (int)ceil(speed * 1000 / MAX_IRAP_FPS / irapInterval));
+        _selection = step > 1 ? Mp4Source::SelectIrapSubsampled : Mp4Source::SelectIrap;
+        _syncStep = rate > 0 ? step : -step;
+        interval = irapInterval * step;
+    }
+    _rate = rate;
+
+    if (m_State == State_Stopped) {
+        ApplyRate();
+    }
+    else {
+        // ӵǰλûµѡ֡ʽѾڶľʵ֡
+        size_t sync, target;
+        if (!_index.FindSeekPoint(_pin->CurrentPlayTime() / 10000 * timescale / 1000, &sync, &target))
+            return E_FAIL;
+        size_t first = _syncStep != 0 ? sync : target;
+        Reposition(sync, _index.PresentationTime(first) * 1000 / timescale, 0);
+    }
+    NotifyFrameInterval(interval / speed);
+
+    fprintf(stderr, "%s - channel %d: rate %.2f, frame selection %d, IRAP step %d\n", __FUNCTION__,
+            _channelId, rate, _selection, _syncStep);
+    if (pSelection != nullptr)
+        *pSelection = _selection;
+    return S_OK;
+}
+
+// ӵsyncǰ¿ʼprerollTime֮ǰֻ֡벻֡
+// ߳̿εReceiveߵȴȳˢأ
+// ̣ͣ߳λú½ѭֹͣ״ֻ̬סλã´οʼʱЧ
+void CMp4Source::Reposition(size_t sync, int64_t prerollTime, DWORD presentTime)
+{
+    bool streaming = m_State != State_Stopped;
+    if (streaming) {
+        _pin->DeliverBeginFlush();
+        _pin->Stop();
+    }
+    ApplyRate();
+    _pin->PrepareSeek(prerollTime, presentTime);
+    if (streaming) {
+        _reader.Seek(sync);
+        _pin->DeliverEndFlush();
+        _pin->Pause();
+    }
+    else {
+        _startSample = sync;
+    }
+}
+
+// ֹ߳ͣʱ
+void CMp4Source::ApplyRate()
+{
+    _reader.SetSyncStep(_syncStep);
+    _pin->SetRate(_rate, _selection == Mp4Source::SelectReference, _syncStep != 0);
+}
+
+// Ⱦûʱų
+void CMp4Source::NotifyFrameInterval(double interval)
+{
+    if (_notifyReceiver != nullptr) {
+        _notifyReceiver->OnFrameIntervalChanged(_channelId, max((DWORD)interval, (DWORD)1));
+    }
+}
+
+void CMp4Source::ResetPlayback()
+{
+    _pin->ResetIndex(&_index);
+    _rate = 1.0;
+    _selection = Mp4Source::SelectAll;
+    _syncStep = 0;
+    ApplyRate();
+    NotifyFrameInterval(1000 / _index.FrameRate());
+}
+
+void CMp4Source::CloseFile()
+{
+    _reader.Stop();
+    _index = Mp4Index();
+    _read = nullptr;
+    _readCtx = nullptr;
+    _clip = CReplayBuffer::Clip();
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Mp4SourceFilter module exported API
+//-------------------------------------------------------------------------------------------------
+HRESULT WINAPI Mp4Source_CreateInstance(IBaseFilter** ppObj)
+{
+    HRESULT hr = S_OK;
+
+    CMp4Source* o = new CMp4Source(nullptr, &hr);
+    ULONG ul = o->AddRef();
+    *ppObj = static_cast<IBaseFilter*>(o);
+
+    return hr;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include "IMp4Source.h"
+#include "RtspSourcePin.h"
+#include "Mp4Index.h"
+#include "Mp4Reader.h"
+#include "ReplayBuffer.h"
+
+class CMp4Source;
+
+// ļԴƵPinRTSPƵPinķʵԪϢͻ߼
+// CMp4ReaderԤõİǰ׺NALU͵תΪʼ룬ÿǡһʵԪ
+// ʱ䰴ļʱ㵽timeGetTime()ʱᣬʼšָͣλ½ߡ
+// ͣ״̬²ٶȡµλԤ⣩ָʱͣ
+// ٲʱʱ䰴ѹʱļʱݼʱȻ
+class CMp4SourcePin : public RtspH265SourcePin
+{
+public:
+    enum { START_LATENCY_MS = 100 }; // ½ʱʱ
+    enum { PAUSE_POLL_MS = 20 }; // ͣʱ״̬仯ļ
+
+    CMp4SourcePin(HRESULT* phr, CMp4Source* pFilter);
+    void ResetIndex(const Mp4Index* index);
+    // һ½ʱߣ̵߳á
+    void Rebase() { _rebase = true; }
+    // ֹ߳ͣʱãһοʼĵһУʱprerollTime룩
+    // ֻ벻֣һֵpresentTimeʱߡ
+    void PrepareSeek(int64_t prerollTime, DWORD presentTime);
+    // ֹ߳ͣʱáskipNonReferenceΪʱο֡
+    // irapOnlyΪʱԤֻʵ㣬ûԳʱΪߡ
+    void SetRate(double rate, bool skipNonReference, bool irapOnly);
+    bool WaitSeekComplete(DWORD dwMSecs, DWORD* pLatency);
+    HRESULT FillBuffer(IMediaSample* pSample) override;
+    HRESULT Deliver(IMediaSample* pSample) override;
+
+protected:
+    HRESULT OnThreadStartPlay() override;
+
+private:
+    long ConvertSample(const CMp4Reader::Packet& packet, BYTE* pData, long length);
+    bool IsDroppable(const CMp4Reader::Packet& packet) const;
+
+    const Mp4Index* _index = nullptr;
+    CMp4Reader::Packet* _pendingPacket = nullptr; // װ»ͣʱûͳİ´װ롣
+    std::atomic<bool> _rebase;
+    unsigned _generation = 0; // ȡİԤţ仯˵տʼŻնλ
+    bool _discontinuity = false; // һͳΪ
+    int64_t _baseTime = 0; // ߶Ӧļʱ䣨룩Ľʱ䣬λΪĿĳʱ
+    int64_t _baseLocalTime = 0; // Ӧıʱ䣨룩
+    double _rate = 1.0;
+    bool _skipNonReference = false;
+    bool _irapOnly = false;
+    int _maxTemporalId = 0; // ʱӲ㣬ȡSPS
+
+    // λ³Աֹ߳ͣʱPrepareSeekã̷ֻ֮߳ʡ
+    bool _seekPending = false; // һǶλ
+    bool _seekBase = false; // һֵλĿ꽨ʱ
+    bool _seekFrameFilled = false; // λĵһװãͳӳ
+    int64_t _seekTime = 0; // λĿĳʱ䣨룩
+    int64_t _prerollTime = INT64_MIN; // ǰУʱڴֵֻ벻
+    DWORD _presentTime = 0;
+    DWORD _seekStartTime = 0;
+    DWORD _seekLatency = 0;
+    CAMEvent _seekCompleted;
+};
+
+class CMp4Source : public CSource, public Mp4Source::ICommand
+{
+public:
+    enum { MAX_FULL_DECODE_RATE = 2 }; // ʱȫ
+    enum { MAX_REFERENCE_DECODE_RATE = 4 }; // ʱο֡ٸֻʵ
+    enum { MAX_IRAP_FPS = 8 }; // ֻʵʱÿ֡͸һ
+    enum { MAX_RATE = 32 };
+
+    CMp4Source(IUnknown* pUnk, HRESULT* phr);
+    virtual ~CMp4Source();
+
+    CMp4Source(const CMp4Source&) = delete;
+    CMp4Source& operator=(const CMp4Source&) = delete;
+
+    STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void** ppv) override;
+
+    // CBaseFilter
+    STDMETHODIMP Stop() override;
+    STDMETHODIMP Pause() override;
+    STDMETHODIMP Run(REFERENCE_TIME tStart) override;
+
+    // Mp4Source::ICommand
+    STDMETHODIMP_(void) SetChannelId(int channel);
+    STDMETHODIMP_(void) SetNotifyReceiver(RtspSource::INotify* receiver);
+    STDMETHODIMP OpenFile(PCWSTR path);
+    STDMETHODIMP OpenReplay(CReplayBuffer* replay, int channel, int seconds);
+    STDMETHODIMP GetDuration(LONGLONG* pMSecs);
+    STDMETHODIMP GetFrameRate(double* pFps);
+    STDMETHODIMP GetPosition(LONGLONG* pMSecs);
+    STDMETHODIMP Seek(LONGLONG msecs, BOOL keyframeOnly, DWORD presentTime, LONGLONG* pActualMSecs);
+    STDMETHODIMP WaitSeekComplete(DWORD dwMSecs, DWORD* pLatency);
+    STDMETHODIMP SetRate(double rate, Mp4Source::FrameSelection* pSelection);
+
+    STDMETHODIMP QueryInterface(REFIID riid, __deref_out void** ppv) {
+        return GetOwner()->QueryInterface(riid, ppv);
+    };
+    STDMETHODIMP_(ULONG) AddRef() {
+        ULONG r = GetOwner()->AddRef();
+        return r;
+    };
+    STDMETHODIMP_(ULONG) Release() {
+        ULONG r = GetOwner()->Release();
+        return r;
+    };
+
+private:
+    friend class CMp4SourcePin;
+
+    void CloseFile();
+    bool IsOpen() const { return _read != nullptr; }
+    void ResetPlayback();
+    void Reposition(size_t sync, int64_t prerollTime, DWORD presentTime);
+    void ApplyRate();
+    void NotifyFrameInterval(double interval);
+
+    int _channelId = -1;
+    RtspSource::INotify* _notifyReceiver = nullptr;
+    CMp4SourcePin* _pin = nullptr;
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    CReplayBuffer::Clip _clip; // طƬΣļʱ_file
+    Mp4Index::ReadFunc _read = nullptr; // ȡķʽļطƬΣnullptrʾûд򿪡
+    void* _readCtx = nullptr;
+    Mp4Index _index;
+    CMp4Reader _reader;
+    size_t _startSample = 0; // ֹͣ״̬¶λĽ´οʼʱ
+    double _rate = 1.0;
+    Mp4Source::FrameSelection _selection = Mp4Source::SelectAll;
+    int _syncStep = 0; // CMp4Reader::SetSyncStep
+};
@@ -1,19 +1,69 @@
 #include "stdafx.h"
 #include "ProxyMediaSink.h"
 
+namespace
+{
+    const size_t maxHeldParameterSets = 8;
+}
+
 ProxyMediaSink::ProxyMediaSink(UsageEnvironment& env, MediaSubsession& subsession,
-    MediaPacketQueue& mediaPacketQueue, size_t receiveBufferSize, bool isNullSink)
+    MediaPacketQueue& mediaPacketQueue, size_t receiveBufferSize, bool isNullSink,
+    size_t maxQueuedPackets, const std::atomic<bool>* muted)
     : MediaSink(env)
     , _receiveBufferSize(receiveBufferSize)
     , _receiveBuffer(new uint8_t[receiveBufferSize])
     , _subsession(subsession)
     , _mediaPacketQueue(mediaPacketQueue)
     , _isNullSink(isNullSink)
+    , _maxQueuedPackets(maxQueuedPackets)
+    , _muted(muted)
 {
 }
 
 ProxyMediaSink::~ProxyMediaSink() { delete[] _receiveBuffer; }
 
+void ProxyMediaSink::Hold(StreamReadyProc* readyProc, void* clientData)
+{
+    _holding = true;
+    _readyProc = readyProc;
+    _readyClientData = clientData;
+    _heldParameterSets.clear();
+}
+
+void ProxyMediaSink::SetRelay(CRtspRelay* relay, int channel, CRtspRelay::Track track)
+{
+    _relay = relay;
+    _relayChannel = channel;
+    _relayTrack = track;
+}
+
+void ProxyMediaSink::SetReplayBuffer(CReplayBuffer* replay, int channel)
+{
+    _replay = replay;
+    _replayChannel = channel;
+    _sdpParameterSets.clear();
+    if (_replay == nullptr)
+        return;
+
+    // еֻSDPеIRAPǰûС
+    const char* sprops[] = { _subsession.fmtp_spropvps(), _subsession.fmtp_spropsps(), _subsession.fmtp_sproppps() };
+    for (const char* sprop : sprops)
+    {
+        if (sprop == nullptr)
+            continue;
+        unsigned count = 0;
+        SPropRecord* records = parseSPropParameterSets(sprop, count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            const uint8_t* bytes = records[i].sPropBytes;
+            _sdpParameterSets.push_back(std::make_shared<std::vector<uint8_t>>(bytes, bytes + records[i].sPropLength));
+        }
+        delete[] records;
+    }
+    if (!_holding)
+        _replay->SetParameterSets(_replayChannel, _sdpParameterSets);
+}
+
 void ProxyMediaSink::afterGettingFrame(void* clientData, uint32_t frameSize,
     uint32_t numTruncatedBytes, struct timeval presentationTime, uint32_t durationInMicroseconds)
 {
@@ -26,9 +76,16 @@ void ProxyMediaSink::afterGettingFrame(uint32_t frameSize, uint32_t numTruncated
 {
     if (numTruncatedBytes == 0)
     {
-        if (!_isNullSink) {
-            bool isRtcpSynced = _subsession.rtpSource() && _subsession.rtpSource()->hasBeenSynchronizedUsingRTCP();
-            _mediaPacketQueue.push(MediaPacketSample(_receiveBuffer, frameSize, presentationTime, isRtcpSynced));
+        bool isMuted = _muted && _muted->load(std::memory_order_relaxed);
+        if (!_isNullSink && (!isMuted || _relay != nullptr)) {
+            RTPSource* rtpSource = _subsession.rtpSource();
+            bool isRtcpSynced = rtpSource && rtpSource->hasBeenSynchronizedUsingRTCP();
+            bool isMarker = rtpSource && rtpSource->curPacketMarkerBit();
+            MediaPacketSample sample(_receiveBuffer, frameSize, presentationTime, isRtcpSynced, isMarker);
+            if (_holding)
+                HoldSample(std::move(sample));
+            else
+                PushSample(std::move(sample));
         }
     }
     else
@@ -37,6 +94,95 @@ void ProxyMediaSink::afterGettingFrame(uint32_t frameSize, uint32_t numTruncated
     continuePlaying();
 }
 
+void ProxyMediaSink::PushSample(MediaPacketSample&& sample)
+{
+    if (_relay != nullptr)
+        _relay->Publish(_relayChannel, _relayTrack, sample);
+    if (_replay != nullptr) {
+        if (sample.isSwitchPoint())
+            _replay->SetParameterSets(_replayChannel, _sdpParameterSets);
+        _replay->Append(_replayChannel, sample);
+    }
+    if (_muted && _muted->load(std::memory_order_relaxed))
+        return;
+    if (_videoMode && !FilterVideo(sample))
+        return;
+
+    if (_maxQueuedPackets > 0)
+        _mediaPacketQueue.push_bounded(std::move(sample), _maxQueuedPackets);
+    else
+        _mediaPacketQueue.push(std::move(sample));
+}
+
+// Only H.265 video sinks are given a ready callback (see RtspSourcePin.cpp for the NALU types)
+void ProxyMediaSink::HoldSample(MediaPacketSample&& sample)
+{
+    if (_readyProc == nullptr || sample.size() < 2)
+        return;
+
+    int type = (sample.data()[0] >> 1) & 0x3F;
+    if (type >= 32 && type <= 34) // VPS/SPS/PPS
+    {
+        if (_heldParameterSets.size() >= maxHeldParameterSets)
+            _heldParameterSets.erase(_heldParameterSets.begin());
+        _heldParameterSets.push_back(std::move(sample));
+        return;
+    }
+    if (type < 16 || type > 23)
+    {
+        if (type < 32)
+            _heldParameterSets.clear(); // A non-IRAP picture; its parameter sets are repeated before the next IRAP
+        return;
+    }
+
+    // The current stream is torn down in the callback, so nothing else is queued after this point
+    _holding = false;
+    _readyProc(_readyClientData);
+
+    bool first = true;
+    for (MediaPacketSample& ps : _heldParameterSets)
+    {
+        ps.setSwitchPoint(first);
+        first = false;
+        PushSample(std::move(ps));
+    }
+    _heldParameterSets.clear();
+    sample.setSwitchPoint(first);
+    PushSample(std::move(sample));
+}
+
+// Parameter sets always pass: the decoder needs the ones in front of the next IRAP
+bool ProxyMediaSink::FilterVideo(const MediaPacketSample& sample)
+{
+    if (sample.isSwitchPoint())
+        return true; // The pin applies the new stream's media type when it sees this packet
+    if (sample.size() < 2)
+        return false;
+
+    int mode = _videoMode->load(std::memory_order_relaxed);
+    int type = (sample.data()[0] >> 1) & 0x3F;
+    bool isIrap = type >= 16 && type <= 23;
+    bool isParameterSet = type >= 32 && type <= 34;
+    if (mode != RtspSource::VideoFull)
+    {
+        _waitIrap = true;
+        return mode == RtspSource::VideoKeyframesOnly && (isIrap || isParameterSet);
+    }
+
+    if (_waitIrap)
+    {
+        if (!isIrap)
+            return isParameterSet;
+        _waitIrap = false;
+        _skipRasl = true;
+    }
+    if (type == 8 || type == 9) // RASL_N/RASL_R
+        return !_skipRasl;
+    if (type < 32 && !isIrap)
+        _skipRasl = false;
+    return true;
+}
+
 Boolean ProxyMediaSink::continuePlaying()
 {
     if (fSource == nullptr)
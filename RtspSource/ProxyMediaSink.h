@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <vector>
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
 
 #include "MediaPacketSample.h"
 #include "RtspSource.h"
+#include "RtspRelay.h"
+#include "ReplayBuffer.h"
 
 /*
  * Media sink that accumulates received frames into given queue
@@ -13,9 +17,24 @@ class ProxyMediaSink : public MediaSink
 {
 public:
     ProxyMediaSink(UsageEnvironment& env, MediaSubsession& subsession,
-                   MediaPacketQueue& mediaPacketQueue, size_t receiveBufferSize, bool isNullSink);
+                   MediaPacketQueue& mediaPacketQueue, size_t receiveBufferSize, bool isNullSink,
+                   size_t maxQueuedPackets = 0, const std::atomic<bool>* muted = nullptr);
     virtual ~ProxyMediaSink();
 
+    typedef void (StreamReadyProc)(void* clientData);
+    // ȴлģʽʵ֮ǰյİȫ
+    // ƵsinkյһIRAPʱȻصreadyProcٰIRAPͬǰVPS/SPS/PPSУ
+    // һΪл㡣readyProcΪnullptrʱƵһֱֱReleaseHold()
+    void Hold(StreamReadyProc* readyProc, void* clientData);
+    void ReleaseHold() { _holding = false; }
+    // յİͬʱתRTSPͻˡʱȻתֻǲС
+    void SetRelay(CRtspRelay* relay, int channel, CRtspRelay::Track track);
+    // ƵsinkͨRtspSource::VideoModeȡȡת֮תĿͻյ
+    void SetVideoMode(const std::atomic<int>* videoMode) { _videoMode = videoMode; }
+    // Ƶsinkյİȡ֮ǰͬʱ뼴ʱطŻ壬SDPеĲһ壻
+    // sinkȵлŽ֮ǰĻǾHold֮á
+    void SetReplayBuffer(CReplayBuffer* replay, int channel);
+
     static void afterGettingFrame(void* clientData, uint32_t frameSize, uint32_t numTruncatedBytes,
                                   struct timeval presentationTime, uint32_t durationInMicroseconds);
 
@@ -24,11 +43,29 @@ public:
 
 private:
     virtual Boolean continuePlaying();
+    void HoldSample(MediaPacketSample&& sample);
+    void PushSample(MediaPacketSample&& sample);
+    bool FilterVideo(const MediaPacketSample& sample);
 
 private:
     size_t _receiveBufferSize = 0;
     uint8_t* _receiveBuffer = nullptr;
     MediaSubsession& _subsession;
     MediaPacketQueue& _mediaPacketQueue;
+    bool _holding = false;
+    StreamReadyProc* _readyProc = nullptr;
+    void* _readyClientData = nullptr;
+    std::vector<MediaPacketSample> _heldParameterSets; // ȴIRAPڼյĲIRAPһͳ
     bool _isNullSink = false; // սʲôҲס
+    size_t _maxQueuedPackets = 0; // гޣʱɵİӳ١0ʾơ
+    CRtspRelay* _relay = nullptr;
+    int _relayChannel = -1;
+    CRtspRelay::Track _relayTrack = CRtspRelay::VIDEO_TRACK;
+    CReplayBuffer* _replay = nullptr;
+    int _replayChannel = -1;
+    std::vector<CReplayBuffer::Buffer> _sdpParameterSets;
+    const std::atomic<bool>* _muted = nullptr; // ʱֱӶյİС
+    const std::atomic<int>* _videoMode = nullptr;
+    bool _waitIrap = false; // ָȫٽһIRAP֮ǰͼ
+    bool _skipRasl = false; // CRAָʱRASLͼ˱֡ҲҪ
 };
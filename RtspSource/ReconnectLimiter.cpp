@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "ReconnectLimiter.h"
+
+CReconnectLimiter::CReconnectLimiter()
+{
+}
+
+void CReconnectLimiter::SetLimits(int maxConcurrent, int ratePerSec)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (maxConcurrent > 0)
+        _maxConcurrent = maxConcurrent;
+    if (ratePerSec > 0) {
+        _ratePerSec = ratePerSec;
+        _tokens = std::min(_tokens, _ratePerSec * 1000);
+    }
+}
+
+void CReconnectLimiter::SetPriority(int channel, Priority priority)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slots[channel].priority = priority;
+}
+
+bool CReconnectLimiter::TryAcquire(int channel, DWORD now)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return true; // ܹͨ
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Slot& me = _slots[channel];
+    if (me.holding)
+        return true;
+
+    Expire(now);
+    Refill(now);
+    if (!me.waiting) {
+        me.waiting = true;
+        me.waitSince = now;
+    }
+    me.lastPoll = now;
+
+    if (_inFlight >= _maxConcurrent || _tokens < 1000)
+        return false;
+
+    // ȼ߻ȵøõͬȼͨڵȣø
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        const Slot& s = _slots[i];
+        if (i == channel || !s.waiting)
+            continue;
+        if (s.priority > me.priority
+            || (s.priority == me.priority && (int32_t)(me.waitSince - s.waitSince) > 0))
+            return false;
+    }
+
+    me.waiting = false;
+    me.holding = true;
+    me.grantTime = now;
+    _tokens -= 1000;
+    ++_inFlight;
+    ++_granted;
+    _peakInFlight = std::max(_peakInFlight, _inFlight);
+    return true;
+}
+
+void CReconnectLimiter::Release(int channel)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Slot& s = _slots[channel];
+    s.waiting = false;
+    if (s.holding) {
+        s.holding = false;
+        --_inFlight;
+    }
+}
+
+void CReconnectLimiter::GetStats(Stats* stats)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    stats->inFlight = _inFlight;
+    stats->peakInFlight = _peakInFlight;
+    stats->waiting = 0;
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        if (_slots[i].waiting)
+            ++stats->waiting;
+    }
+    stats->granted = _granted;
+}
+
+// ջسʱδ黹ĵȴߣһͨͨԶȥ
+void CReconnectLimiter::Expire(DWORD now)
+{
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        Slot& s = _slots[i];
+        if (s.holding && now - s.grantTime > LEASE_TIMEOUT_MS) {
+            s.holding = false;
+            --_inFlight;
+        }
+        if (s.waiting && now - s.lastPoll > WAITER_TIMEOUT_MS)
+            s.waiting = false;
+    }
+}
+
+void CReconnectLimiter::Refill(DWORD now)
+{
+    if (!_refilled) {
+        _refilled = true;
+        _lastRefill = now;
+        return;
+    }
+    DWORD elapsed = now - _lastRefill;
+    _lastRefill = now;
+    _tokens = (int)std::min<int64_t>(_tokens + (int64_t)elapsed * _ratePerSec, _ratePerSec * 1000);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+
+//
+// ȫ̵
+// NVRͨͬʱߣԵ˱ܶʱں
+// ͬʱе֣DESCRIBEPLAYӦ𣩲maxConcurrent·ÿ뿪ʼֲratePerSec·
+// ʱȼߵͨȵõͨ > ɼͨ > ɼͨͬȼȵá
+// 벻ͨԺ룬live555̡߳
+// з̰߳ȫģɸͨlive555̵̺߳߳á
+//
+class CReconnectLimiter
+{
+public:
+    enum { MAX_CHANNELS = 16 };
+    enum { DEFAULT_MAX_CONCURRENT = 4 };
+    enum { DEFAULT_RATE_PER_SEC = 4 };
+    enum { LEASE_TIMEOUT_MS = 15000 }; // ռʱ䣬ʱԶջء
+    enum { WAITER_TIMEOUT_MS = 2000 }; // ôʱûͨΪѷȴ
+
+    enum Priority { PRIORITY_HIDDEN, PRIORITY_VISIBLE, PRIORITY_FOCUSED };
+
+    struct Stats
+    {
+        int inFlight; // ֵͨ
+        int peakInFlight; // ֲķֵ
+        int waiting; // ȴͨ
+        unsigned granted; // ۼƷŵ
+    };
+
+    CReconnectLimiter();
+
+    void SetLimits(int maxConcurrent, int ratePerSec);
+    void SetPriority(int channel, Priority priority);
+
+    // һõֽɹʧܣʱRelease
+    bool TryAcquire(int channel, DWORD now);
+    // 黹ͬʱȴͨδʱʲôҲ
+    void Release(int channel);
+
+    void GetStats(Stats* stats);
+
+private:
+    void Expire(DWORD now);
+    void Refill(DWORD now);
+
+    struct Slot
+    {
+        Priority priority = PRIORITY_VISIBLE;
+        bool waiting = false;
+        DWORD waitSince = 0;
+        DWORD lastPoll = 0;
+        bool holding = false;
+        DWORD grantTime = 0;
+    };
+
+    std::mutex _mutex;
+    int _maxConcurrent = DEFAULT_MAX_CONCURRENT;
+    int _ratePerSec = DEFAULT_RATE_PER_SEC;
+    int _tokens = DEFAULT_RATE_PER_SEC * 1000; // ͰλΪǧ֮һ
+    DWORD _lastRefill = 0;
+    bool _refilled = false;
+    int _inFlight = 0;
+    int _peakInFlight = 0;
+    unsigned _granted = 0;
+    Slot _slots[MAX_CHANNELS];
+};
@@ -0,0 +1,279 @@
+#include "stdafx.h"
+#include <algorithm>
+#include "ReplayBuffer.h"
+#include "MediaPacketSample.h"
+
+namespace
+{
+    const size_t naluOverhead = sizeof(std::vector<uint8_t>) + 64; // ֮Ĳǿֵ
+
+    inline int H265NaluType(const uint8_t* nalu)
+    {
+        return (nalu[0] >> 1) & 0x3F;
+    }
+}
+
+CReplayBuffer::CReplayBuffer()
+{
+}
+
+void CReplayBuffer::SetLimits(int keepSeconds, int budgetMB)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (keepSeconds > 0) {
+        _keepTime = std::min(keepSeconds, (int)MAX_SECONDS) * 10000000i64;
+        for (Channel& ch : _channels)
+            Trim(ch);
+    }
+    if (budgetMB > 0)
+        _budget = (size_t)budgetMB * 1024 * 1024;
+    while (_bytes > _budget && EvictOne())
+        ;
+}
+
+void CReplayBuffer::SetPriority(int channel, Priority priority)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _channels[channel].priority = priority;
+}
+
+void CReplayBuffer::SetStream(int channel, const std::string& url)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+    if (ch.url == url)
+        return;
+    ch.url = url;
+    Clear(ch);
+    for (Buffer& ps : ch.parameterSets)
+        ps.reset();
+}
+
+void CReplayBuffer::SetParameterSets(int channel, const std::vector<Buffer>& parameterSets)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+    for (const Buffer& ps : parameterSets) {
+        if (ps == nullptr || ps->size() < 2)
+            continue;
+        int type = H265NaluType(ps->data());
+        if (type >= 32 && type <= 34)
+            ch.parameterSets[type - 32] = ps;
+    }
+}
+
+void CReplayBuffer::Append(int channel, const MediaPacketSample& sample)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS || sample.size() < 2)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+
+    // лֱʿܲͬݲٺһ
+    if (sample.isSwitchPoint())
+        Clear(ch);
+
+    int type = H265NaluType(sample.data());
+    if (type >= 32 && type <= 34) { // VPS/SPS/PPS
+        ch.parameterSets[type - 32] = sample.buffer();
+        return;
+    }
+
+    int64_t time = sample.timestamp() + ch.timeOffset;
+    if (ch.hasTime) {
+        int64_t delta = time - ch.lastTime;
+        if (delta > MAX_TIME_GAP_MS * 10000i64 || delta < -MAX_TIME_GAP_MS * 10000i64) {
+            int64_t adjust = ch.lastTime + DEFAULT_FRAME_INTERVAL_MS * 10000i64 - time;
+            ch.timeOffset += adjust;
+            time += adjust;
+        }
+    }
+    ch.hasTime = true;
+    ch.lastTime = time;
+
+    Nalu nalu = { sample.buffer(), time };
+    if (type >= 32) { // SEIAUDȣһVCL NALU
+        ch.pending.push_back(std::move(nalu));
+        return;
+    }
+
+    bool isIrap = type >= 16 && type <= 23;
+    bool newGop = isIrap && (ch.gops.empty() || ch.gops.back().startTime != time);
+    if (newGop) {
+        if (ch.parameterSets[0] == nullptr || ch.parameterSets[1] == nullptr || ch.parameterSets[2] == nullptr) {
+            ch.pending.clear();
+            return; // ûвû
+        }
+        Gop gop;
+        gop.startTime = time;
+        for (const Buffer& ps : ch.parameterSets) {
+            gop.nalus.push_back({ ps, time });
+            gop.bytes += ps->size() + naluOverhead;
+        }
+        ch.gops.push_back(std::move(gop));
+        ch.bytes += ch.gops.back().bytes;
+        _bytes += ch.gops.back().bytes;
+    }
+    else if (ch.gops.empty()) {
+        ch.pending.clear();
+        return; // ûеȵһIRAP
+    }
+
+    Gop& gop = ch.gops.back();
+    ch.pending.push_back(std::move(nalu));
+    for (Nalu& n : ch.pending) {
+        size_t bytes = n.data->size() + naluOverhead;
+        gop.bytes += bytes;
+        ch.bytes += bytes;
+        _bytes += bytes;
+        gop.nalus.push_back(std::move(n));
+    }
+    ch.pending.clear();
+
+    if (newGop)
+        Trim(ch);
+    while (_bytes > _budget && EvictOne())
+        ;
+}
+
+bool CReplayBuffer::Snapshot(int channel, int seconds, Clip* clip)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return false;
+
+    std::vector<Nalu> nalus;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Channel& ch = _channels[channel];
+        if (ch.gops.empty())
+            return false;
+
+        int64_t from = ch.lastTime - seconds * 10000000i64;
+        size_t first = 0;
+        for (size_t i = 0; i < ch.gops.size(); ++i) {
+            if (ch.gops[i].startTime <= from)
+                first = i;
+        }
+        for (size_t i = first; i < ch.gops.size(); ++i)
+            nalus.insert(nalus.end(), ch.gops[i].nalus.begin(), ch.gops[i].nalus.end());
+    }
+
+    // ʱͬNALUͬһʵԪһʵԪܻûȫҪ
+    *clip = Clip();
+    for (Nalu& n : nalus) {
+        if (clip->units.empty() || clip->units.back().timestamp != n.timestamp) {
+            clip->units.emplace_back();
+            clip->units.back().timestamp = n.timestamp;
+        }
+        AccessUnit& unit = clip->units.back();
+        int type = H265NaluType(n.data->data());
+        unit.irap = unit.irap || (type >= 16 && type <= 23);
+        unit.size += 4 + (uint32_t)n.data->size();
+        unit.nalus.push_back(std::move(n.data));
+    }
+    if (clip->units.size() < 2)
+        return false;
+    clip->units.pop_back();
+
+    clip->offsets.reserve(clip->units.size());
+    for (const AccessUnit& unit : clip->units) {
+        clip->offsets.push_back(clip->size);
+        clip->size += unit.size;
+    }
+    return true;
+}
+
+void CReplayBuffer::GetStats(Stats* stats)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    stats->bytes = _bytes;
+    stats->budget = _budget;
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        const Channel& ch = _channels[i];
+        stats->channelBytes[i] = ch.bytes;
+        stats->channelMs[i] = ch.gops.empty() ? 0 : (DWORD)((ch.lastTime - ch.gops.front().startTime) / 10000);
+    }
+    stats->evictedGops = _evictedGops;
+}
+
+size_t CReplayBuffer::Clip::ReadAt(void* ctx, int64_t offset, void* buf, size_t size)
+{
+    const Clip* clip = static_cast<const Clip*>(ctx);
+    if (offset < 0 || offset >= clip->size)
+        return 0;
+
+    // ӰoffsetķʵԪʼNALUĳǰ׺͸أoffset֮ǰĲ֡
+    size_t i = std::upper_bound(clip->offsets.begin(), clip->offsets.end(), offset) - clip->offsets.begin() - 1;
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    int64_t pos = clip->offsets[i];
+    size_t done = 0;
+    auto Copy = [&](const uint8_t* p, size_t n) {
+        int64_t begin = pos;
+        pos += n;
+        if (pos <= offset + (int64_t)done || done == size)
+            return;
+        size_t skip = (size_t)(offset + done - begin);
+        size_t count = std::min(n - skip, size - done);
+        memcpy(out + done, p + skip, count);
+        done += count;
+    };
+    for (; i < clip->units.size() && done < size; ++i) {
+        for (const Buffer& nalu : clip->units[i].nalus) {
+            uint32_t length = (uint32_t)nalu->size();
+            uint8_t prefix[4] = { (uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length };
+            Copy(prefix, 4);
+            Copy(nalu->data(), length);
+        }
+    }
+    return done;
+}
+
+void CReplayBuffer::Clear(Channel& ch)
+{
+    _bytes -= ch.bytes;
+    ch.bytes = 0;
+    ch.gops.clear();
+    ch.pending.clear();
+    ch.hasTime = false;
+    ch.timeOffset = 0;
+}
+
+// ڶGOPʼѾkeepSecondsʱɵGOPͲҪˡ
+void CReplayBuffer::Trim(Channel& ch)
+{
+    while (ch.gops.size() > 1 && ch.lastTime - ch.gops[1].startTime >= _keepTime) {
+        ch.bytes -= ch.gops.front().bytes;
+        _bytes -= ch.gops.front().bytes;
+        ch.gops.pop_front();
+    }
+}
+
+bool CReplayBuffer::EvictOne()
+{
+    Channel* victim = nullptr;
+    for (Channel& ch : _channels) {
+        if (ch.gops.size() < 2)
+            continue;
+        if (victim == nullptr || ch.priority < victim->priority
+            || (ch.priority == victim->priority && ch.bytes > victim->bytes))
+            victim = &ch;
+    }
+    if (victim == nullptr)
+        return false;
+
+    victim->bytes -= victim->gops.front().bytes;
+    _bytes -= victim->gops.front().bytes;
+    victim->gops.pop_front();
+    ++_evictedGops;
+    return true;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <string>
+
+class MediaPacketSample;
+
+//
+// ʱطŻ壬д̡
+// ÿֱͨڴﱣһѹƵյNALUСתͬһ鸺أٸơ
+// ʵ(IRAP)(GOP)棬ÿԵʱµVPS/SPS/PPSͷ̭ʱ鶪
+// ԻǴӿԶλÿʼһIRAP֮ǰյİ档
+// ÿͨkeepSeconds룻ͨϼƳȫ̵ڴԤʱ
+// ̭ȼ͵ͨɼ < ɼ < 㣩ɵGOPͬȼ̭ռͨ
+// ÿͨٱµһGOP
+// Appendɸͨlive555̵߳ã̵߳ã̰߳ȫġ
+//
+class CReplayBuffer
+{
+public:
+    enum { MAX_CHANNELS = 16 };
+    enum { DEFAULT_SECONDS = 30 };
+    enum { MAX_SECONDS = 600 };
+    enum { DEFAULT_BUDGET_MB = 256 };
+    enum { MAX_TIME_GAP_MS = 3000 }; // ʱ䳬ôΪRTCPͬӵһ֡档
+    enum { DEFAULT_FRAME_INTERVAL_MS = 40 };
+
+    enum Priority { PRIORITY_HIDDEN, PRIORITY_VISIBLE, PRIORITY_FOCUSED };
+
+    typedef std::shared_ptr<const std::vector<uint8_t>> Buffer;
+
+    // һʵԪʱͬһNALU
+    struct AccessUnit
+    {
+        int64_t timestamp = 0; // ʱ䣨100ns
+        bool irap = false;
+        uint32_t size = 0; // ÿNALU4ֽڳǰ׺ֽ
+        std::vector<Buffer> nalus;
+    };
+
+    // ĳͨһƵĿգIRAPʼգ룩˳С
+    // ֻûĸأմڼЩزͷţʹѾ̭
+    struct Clip
+    {
+        std::vector<AccessUnit> units;
+        std::vector<int64_t> offsets; // ʵԪļеƫ
+        int64_t size = 0; // ļֽ
+
+        // ѿտǰ׺ʽķʵԪжɵļctxΪClip*Mp4Index::ReadFunc
+        static size_t ReadAt(void* ctx, int64_t offset, void* buf, size_t size);
+    };
+
+    struct Stats
+    {
+        size_t bytes; // ͨϼ
+        size_t budget;
+        size_t channelBytes[MAX_CHANNELS];
+        DWORD channelMs[MAX_CHANNELS]; // ͨʱ
+        unsigned evictedGops; // 򳬳Ԥ̭GOPʱ̭ġ
+    };
+
+    CReplayBuffer();
+
+    // Сڵ0Ĳ޸ġ
+    void SetLimits(int keepSeconds, int budgetMB);
+    void SetPriority(int channel, Priority priority);
+    // ͨʱá֮ǰĲͬһʱɵݣ
+    // ͬһطźصֱŻ塣
+    void SetStream(int channel, const std::string& url);
+    // ĴSDPеsprop-vps/sps/ppsдĲ滻ͬ͵ġ
+    void SetParameterSets(int channel, const std::vector<Buffer>& parameterSets);
+    // յһƵNALU
+    void Append(int channel, const MediaPacketSample& sample);
+    // ȡsecondsĿգӳʱ䲻ʱ̵IRAPʼ岻ʱɵIRAPʼ
+    // ûGOPʱfalse
+    bool Snapshot(int channel, int seconds, Clip* clip);
+    void GetStats(Stats* stats);
+
+private:
+    struct Nalu
+    {
+        Buffer data;
+        int64_t timestamp;
+    };
+
+    struct Gop
+    {
+        int64_t startTime = 0; // IRAPĳʱ
+        size_t bytes = 0;
+        std::vector<Nalu> nalus;
+    };
+
+    struct Channel
+    {
+        Priority priority = PRIORITY_VISIBLE;
+        std::string url;
+        Buffer parameterSets[3]; // µVPS/SPS/PPSÿֻһ
+        std::vector<Nalu> pending; // ֪ĸGOPķVCL NALUSEIAUDȣ
+        std::deque<Gop> gops;
+        size_t bytes = 0;
+        bool hasTime = false;
+        int64_t lastTime = 0; // һNALUĳʱ䣨ѽ
+        int64_t timeOffset = 0; // ʱĽ
+    };
+
+    void Clear(Channel& ch);
+    void Trim(Channel& ch);
+    bool EvictOne();
+
+    std::mutex _mutex;
+    int64_t _keepTime = DEFAULT_SECONDS * 10000000i64; // 100ns
+    size_t _budget = DEFAULT_BUDGET_MB * 1024 * 1024;
+    size_t _bytes = 0;
+    unsigned _evictedGops = 0;
+    Channel _channels[MAX_CHANNELS];
+};
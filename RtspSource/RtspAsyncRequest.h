@@ -54,6 +54,7 @@ inline const char* GetRtspAsyncRequestTypeString(RtspSource::OpCode oc)
     case RtspSource::Play: return "Play";
     case RtspSource::Stop: return "Stop";
     case RtspSource::Reconnect: return "Reconnect";
+    case RtspSource::Switch: return "Switch";
     case RtspSource::Done: return "Done";
     case RtspSource::Unknown:
     default: return "Unknown";
@@ -0,0 +1,832 @@
+#include "stdafx.h"
+#include <deque>
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "RTSPCommon.hh"
+#include "MediaPacketSample.h"
+#include "RtspRelay.h"
+
+namespace
+{
+    const size_t maxRtpPayloadSize = 1400; // UDPķƬСһ£ݰMTUջĿͻˡ
+    const size_t maxClientBacklog = 2 * 1024 * 1024; // ͻ˻ѹֽޣ򶪰
+    const size_t maxQueuedItems = 1024; // ߳ʱɵİԴ˵live555̡߳
+    const size_t maxRequestSize = 8 * 1024;
+    const unsigned clientSendBufferSize = 512 * 1024;
+    const int64_t reportInterval = 5 * 1000000; // RTCP SRķͼ΢룩
+    const unsigned sessionTimeout = 60;
+    const uint8_t payloadType[CRtspRelay::TRACK_COUNT] = { 96, 97 };
+    const char* cname = "xsplayer";
+
+    // ¿ͻ˺ͶĿͻ˴ӲIRAPʼƵ
+    bool IsResumePoint(const std::vector<uint8_t>& nal)
+    {
+        if (nal.size() < 2)
+            return false;
+        int type = (nal[0] >> 1) & 0x3F;
+        return (type >= 32 && type <= 34) || (type >= 16 && type <= 23);
+    }
+
+    std::string GetHeader(const std::string& request, const char* name)
+    {
+        size_t nameLength = strlen(name);
+        size_t pos = request.find("\r\n");
+        while (pos != std::string::npos) {
+            pos += 2;
+            if (_strnicmp(request.c_str() + pos, name, nameLength) == 0 && request[pos + nameLength] == ':') {
+                size_t begin = request.find_first_not_of(' ', pos + nameLength + 1);
+                size_t end = request.find("\r\n", pos);
+                if (begin == std::string::npos || begin >= end)
+                    return std::string();
+                return request.substr(begin, end - begin);
+            }
+            pos = request.find("\r\n", pos);
+        }
+        return std::string();
+    }
+
+    void Put32(uint8_t* p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
+    // ֻڻصַϵ׽֣˿ڣҲᴥǽķʾ
+    // live555ReceivingInterfaceAddrȫ̹õģӰͨRTSPͻˡ
+    int SetupLoopbackSocket(UsageEnvironment& env, int type, Port port)
+    {
+        int sock = (int)socket(AF_INET, type, 0);
+        if (sock < 0) {
+            env.setResultErrMsg("unable to create socket: ");
+            return -1;
+        }
+        sockaddr_in name = { 0 };
+        name.sin_family = AF_INET;
+        name.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        name.sin_port = port.num();
+        if (bind(sock, (sockaddr*)&name, sizeof(name)) != 0) {
+            env.setResultErrMsg("bind() error: ");
+            closeSocket(sock);
+            return -1;
+        }
+        return sock;
+    }
+}
+
+struct CRtspRelay::Packet
+{
+    std::shared_ptr<const std::vector<uint8_t>> data; // յԭʼأͬһNALUзƬпͻ˹
+    size_t offset = 0;
+    size_t length = 0;
+    uint8_t header[16]; // RTP̶ͷ + FUͷAUͷ
+    size_t headerLength = 0;
+
+    size_t Size() const { return headerLength + length; }
+};
+
+struct CRtspRelay::Client
+{
+    struct Output
+    {
+        std::shared_ptr<Packet> packet;
+        int interleaved; // -1ʾRTSPӦ
+    };
+
+    CRtspRelay* relay = nullptr;
+    int socket = -1;
+    std::string input;
+    std::deque<Output> output;
+    size_t outputBytes = 0; // д͵ֽinterleaved֡ͷ
+    size_t sentBytes = 0; // ѷ͵ֽ
+    bool writeArmed = false;
+    std::string session;
+    int channel = -1;
+    bool setup[TRACK_COUNT] = { false, false };
+    int interleaved[TRACK_COUNT] = { 0, 2 };
+    bool playing = false;
+    bool waitResume = true;
+    bool closing = false;
+};
+
+CRtspRelay::CRtspRelay()
+    : _wakePending(false)
+    , _playingClients(0)
+{
+    for (int i = 0; i < MAX_CHANNELS; ++i)
+        _watchers[i] = 0;
+}
+
+CRtspRelay::~CRtspRelay()
+{
+    Stop();
+}
+
+bool CRtspRelay::Start(uint16_t port)
+{
+    if (_running) {
+        if (port == _port)
+            return true;
+        Stop();
+    }
+
+    _scheduler = BasicTaskScheduler::createNew();
+    _env = BasicUsageEnvironment::createNew(*_scheduler);
+
+    // ֻصַacceptʱټһζԶ˵ַ
+    _listenSocket = SetupLoopbackSocket(*_env, SOCK_STREAM, Port(port));
+    int wakeSocket = SetupLoopbackSocket(*_env, SOCK_DGRAM, Port(0));
+    Port wakePort(0);
+    if (_listenSocket < 0 || listen(_listenSocket, 20) < 0
+        || wakeSocket < 0 || !getSourcePort(*_env, wakeSocket, wakePort)) {
+        fprintf(stderr, "RTSP relay failed to listen on port %u: %s\n", port, _env->getResultMsg());
+        if (_listenSocket >= 0)
+            closeSocket(_listenSocket);
+        if (wakeSocket >= 0)
+            closeSocket(wakeSocket);
+        _listenSocket = -1;
+        _env->reclaim();
+        _env = nullptr;
+        delete _scheduler;
+        _scheduler = nullptr;
+        return false;
+    }
+    makeSocketNonBlocking(_listenSocket);
+    makeSocketNonBlocking(wakeSocket);
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        _wakeSocket = wakeSocket;
+        _wakePort = wakePort.num();
+    }
+
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        for (int j = 0; j < TRACK_COUNT; ++j) {
+            TrackState& ts = _trackState[i][j];
+            ts = TrackState();
+            ts.ssrc = our_random32();
+            ts.seq = (uint16_t)our_random();
+            ts.timestampBase = our_random32();
+        }
+    }
+    _items.clear();
+    _port = port;
+    _quit = false;
+    _wakePending = false;
+    _scheduler->setBackgroundHandling(_listenSocket, SOCKET_READABLE, IncomingConnectionHandler, this);
+    _scheduler->setBackgroundHandling(_wakeSocket, SOCKET_READABLE, WakeHandler, this);
+    _reportTask = _scheduler->scheduleDelayedTask(reportInterval, ReportTimer, this);
+    _running = true;
+    _thread = std::thread(&CRtspRelay::ServerThread, this);
+
+    return true;
+}
+
+void CRtspRelay::Stop()
+{
+    if (!_running)
+        return;
+
+    _running = false;
+    _quit = true;
+    _wakePending = false;
+    Wake();
+    _thread.join();
+
+    for (Client* client : _clients) {
+        closeSocket(client->socket);
+        delete client;
+    }
+    _clients.clear();
+    for (int i = 0; i < MAX_CHANNELS; ++i)
+        _watchers[i] = 0;
+    _playingClients = 0;
+    _items.clear();
+
+    _scheduler->unscheduleDelayedTask(_reportTask);
+    closeSocket(_listenSocket);
+    _listenSocket = -1;
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        closeSocket(_wakeSocket);
+        _wakeSocket = -1;
+    }
+    _env->reclaim();
+    _env = nullptr;
+    delete _scheduler;
+    _scheduler = nullptr;
+}
+
+void CRtspRelay::SetTrack(int channel, Track track, MediaSubsession& subsession)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    auto str = [](char const* s) { return std::string(s != nullptr ? s : ""); };
+    std::lock_guard<std::mutex> lock(_trackLock);
+    TrackInfo& ti = _trackInfo[channel][track];
+    ti.present = true;
+    ti.frequency = subsession.rtpTimestampFrequency();
+    ti.numChannels = subsession.numChannels();
+    ti.vps = str(subsession.fmtp_spropvps());
+    ti.sps = str(subsession.fmtp_spropsps());
+    ti.pps = str(subsession.fmtp_sproppps());
+    ti.config = str(subsession.fmtp_config());
+}
+
+void CRtspRelay::Publish(int channel, Track track, const MediaPacketSample& sample)
+{
+    if (!_running || channel < 0 || channel >= MAX_CHANNELS || sample.invalid())
+        return;
+    if (_watchers[channel] == 0)
+        return;
+
+    Item item;
+    item.channel = channel;
+    item.track = track;
+    item.data = sample.buffer();
+    item.presentationTime = sample.presentationTime();
+    item.isMarker = sample.isMarker();
+    _items.push_bounded(std::move(item), maxQueuedItems);
+    Wake();
+}
+
+// ֻڶɿձΪǿպһΣ߳ȡնǰ־
+void CRtspRelay::Wake()
+{
+    if (_wakePending.exchange(true))
+        return;
+
+    std::lock_guard<std::mutex> lock(_wakeLock);
+    if (_wakeSocket < 0)
+        return;
+    sockaddr_in to = { 0 };
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = _wakePort;
+    char b = 0;
+    sendto(_wakeSocket, &b, 1, 0, (sockaddr*)&to, sizeof(to));
+}
+
+void CRtspRelay::ServerThread()
+{
+    while (!_quit)
+        _scheduler->SingleStep(0);
+}
+
+void CRtspRelay::WakeHandler(void* clientData, int mask)
+{
+    CRtspRelay* self = static_cast<CRtspRelay*>(clientData);
+    char buf[64];
+    while (recv(self->_wakeSocket, buf, sizeof(buf), 0) > 0)
+        ;
+    self->_wakePending = false;
+    self->DrainItems();
+}
+
+void CRtspRelay::DrainItems()
+{
+    Item item;
+    while (_items.try_pop(item))
+        Forward(item);
+
+    // һȫӺٷͣϵͳô
+    for (size_t i = 0; i < _clients.size(); ) {
+        Client* client = _clients[i];
+        if (!client->output.empty() && !Flush(client)) {
+            CloseClient(client);
+            continue;
+        }
+        ++i;
+    }
+}
+
+void CRtspRelay::Forward(Item& item)
+{
+    if (_watchers[item.channel] == 0)
+        return;
+
+    unsigned frequency = 0;
+    {
+        std::lock_guard<std::mutex> lock(_trackLock);
+        frequency = _trackInfo[item.channel][item.track].frequency;
+    }
+    if (frequency == 0)
+        return;
+
+    TrackState& ts = _trackState[item.channel][item.track];
+    const timeval& pt = item.presentationTime;
+    uint32_t timestamp = ts.timestampBase
+        + (uint32_t)((uint64_t)pt.tv_sec * frequency + (uint64_t)pt.tv_usec * frequency / 1000000);
+    std::vector<std::shared_ptr<Packet>> packets;
+    Packetize(item, ts, timestamp, packets);
+    ts.lastTimestamp = timestamp;
+    ts.lastPresentationTime = pt;
+    ts.hasSent = true;
+
+    size_t bytes = 0;
+    for (const std::shared_ptr<Packet>& packet : packets)
+        bytes += packet->Size() + 4;
+
+    bool isVideo = item.track == VIDEO_TRACK;
+    bool isResumePoint = isVideo && IsResumePoint(*item.data);
+    for (Client* client : _clients) {
+        if (!client->playing || client->channel != item.channel || !client->setup[item.track])
+            continue;
+        if (isVideo && client->waitResume) {
+            if (!isResumePoint)
+                continue;
+            client->waitResume = false;
+        }
+        if (client->outputBytes + bytes > maxClientBacklog) {
+            // Ŀǲο֡ƵҪȵһIRAPܼ
+            if (isVideo)
+                client->waitResume = true;
+            continue;
+        }
+        for (const std::shared_ptr<Packet>& packet : packets)
+            Enqueue(client, packet, client->interleaved[item.track]);
+    }
+}
+
+// H.265RFC 7798СNALUɰNALUֳFU
+// AACRFC 3640AAC-hbrģʽÿһ֡ǰ16λAU-headers-lengthһAUͷ
+void CRtspRelay::Packetize(Item& item, TrackState& ts, uint32_t timestamp,
+                           std::vector<std::shared_ptr<Packet>>& packets)
+{
+    const std::vector<uint8_t>& data = *item.data;
+
+    auto NewPacket = [&](size_t offset, size_t length, bool marker) {
+        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+        packet->data = item.data;
+        packet->offset = offset;
+        packet->length = length;
+        uint8_t* h = packet->header;
+        h[0] = 0x80;
+        h[1] = (marker ? 0x80 : 0x00) | payloadType[item.track];
+        h[2] = (uint8_t)(ts.seq >> 8);
+        h[3] = (uint8_t)ts.seq;
+        Put32(h + 4, timestamp);
+        Put32(h + 8, ts.ssrc);
+        packet->headerLength = 12;
+        ++ts.seq;
+        ++ts.packetCount;
+        ts.octetCount += (uint32_t)length;
+        packets.push_back(packet);
+        return packet.get();
+    };
+
+    if (item.track == AUDIO_TRACK) {
+        Packet* packet = NewPacket(0, data.size(), true);
+        uint8_t* h = packet->header + 12;
+        h[0] = 0;
+        h[1] = 16; // һ16λAUͷ
+        h[2] = (uint8_t)(data.size() >> 5);
+        h[3] = (uint8_t)((data.size() & 0x1F) << 3);
+        packet->headerLength += 4;
+        return;
+    }
+
+    if (data.size() <= maxRtpPayloadSize) {
+        NewPacket(0, data.size(), item.isMarker);
+        return;
+    }
+
+    uint8_t type = (data[0] >> 1) & 0x3F;
+    size_t offset = 2; // NALUͷPayloadHdrFUͷЯ
+    while (offset < data.size()) {
+        size_t length = std::min<size_t>(maxRtpPayloadSize - 3, data.size() - offset);
+        bool start = offset == 2;
+        bool end = offset + length == data.size();
+        Packet* packet = NewPacket(offset, length, end && item.isMarker);
+        uint8_t* h = packet->header + 12;
+        h[0] = (data[0] & 0x81) | (49 << 1);
+        h[1] = data[1];
+        h[2] = (start ? 0x80 : 0x00) | (end ? 0x40 : 0x00) | type;
+        packet->headerLength += 3;
+        offset += length;
+    }
+}
+
+void CRtspRelay::ReportTimer(void* clientData)
+{
+    CRtspRelay* self = static_cast<CRtspRelay*>(clientData);
+    self->SendReports();
+    self->_reportTask = self->_scheduler->scheduleDelayedTask(reportInterval, ReportTimer, self);
+}
+
+// RTCP SRͻ˾ݴ˰RTPʱӳ䵽Դ˵ĳʱ䣬Կͨ롣
+void CRtspRelay::SendReports()
+{
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        if (_watchers[i] == 0)
+            continue;
+        for (int j = 0; j < TRACK_COUNT; ++j) {
+            const TrackState& ts = _trackState[i][j];
+            if (!ts.hasSent)
+                continue;
+
+            size_t cnameLength = strlen(cname);
+            size_t sdesLength = (8 + 2 + cnameLength + 1 + 3) & ~3;
+            std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>(28 + sdesLength, 0);
+            uint8_t* p = data->data();
+            p[0] = 0x80;
+            p[1] = 200;
+            p[3] = 6;
+            Put32(p + 4, ts.ssrc);
+            Put32(p + 8, (uint32_t)ts.lastPresentationTime.tv_sec + 2208988800u);
+            Put32(p + 12, (uint32_t)(((uint64_t)ts.lastPresentationTime.tv_usec << 32) / 1000000));
+            Put32(p + 16, ts.lastTimestamp);
+            Put32(p + 20, ts.packetCount);
+            Put32(p + 24, ts.octetCount);
+            p += 28;
+            p[0] = 0x81;
+            p[1] = 202;
+            p[3] = (uint8_t)(sdesLength / 4 - 1);
+            Put32(p + 4, ts.ssrc);
+            p[8] = 1; // CNAME
+            p[9] = (uint8_t)cnameLength;
+            memcpy(p + 10, cname, cnameLength);
+
+            std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+            packet->data = data;
+            packet->length = data->size();
+            for (Client* client : _clients) {
+                if (client->playing && client->channel == i && client->setup[j])
+                    Enqueue(client, packet, client->interleaved[j] + 1);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _clients.size(); ) {
+        Client* client = _clients[i];
+        if (!client->output.empty() && !Flush(client)) {
+            CloseClient(client);
+            continue;
+        }
+        ++i;
+    }
+}
+
+std::string CRtspRelay::DescribeChannel(int channel)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return std::string();
+
+    std::lock_guard<std::mutex> lock(_trackLock);
+    const TrackInfo& video = _trackInfo[channel][VIDEO_TRACK];
+    const TrackInfo& audio = _trackInfo[channel][AUDIO_TRACK];
+    if (!video.present && !audio.present)
+        return std::string();
+
+    char line[512];
+    std::string sdp;
+    sprintf_s(line, "v=0\r\no=- %u 1 IN IP4 127.0.0.1\r\ns=Channel %d\r\nt=0 0\r\na=control:*\r\na=range:npt=0-\r\n",
+              our_random32(), channel);
+    sdp += line;
+    if (video.present) {
+        sprintf_s(line, "m=video 0 RTP/AVP %u\r\nc=IN IP4 0.0.0.0\r\na=rtpmap:%u H265/%u\r\n",
+                  payloadType[VIDEO_TRACK], payloadType[VIDEO_TRACK], video.frequency);
+        sdp += line;
+        if (!video.vps.empty() && !video.sps.empty() && !video.pps.empty()) {
+            sprintf_s(line, "a=fmtp:%u sprop-vps=", payloadType[VIDEO_TRACK]);
+            sdp += line;
+            sdp += video.vps + ";sprop-sps=" + video.sps + ";sprop-pps=" + video.pps + "\r\n";
+        }
+        sdp += "a=control:track0\r\n";
+    }
+    if (audio.present) {
+        sprintf_s(line, "m=audio 0 RTP/AVP %u\r\nc=IN IP4 0.0.0.0\r\na=rtpmap:%u MPEG4-GENERIC/%u/%u\r\n"
+                  "a=fmtp:%u streamtype=5;profile-level-id=1;mode=AAC-hbr;sizelength=13;indexlength=3;indexdeltalength=3;config=",
+                  payloadType[AUDIO_TRACK], payloadType[AUDIO_TRACK], audio.frequency, audio.numChannels,
+                  payloadType[AUDIO_TRACK]);
+        sdp += line;
+        sdp += audio.config + "\r\na=control:track1\r\n";
+    }
+    return sdp;
+}
+
+void CRtspRelay::IncomingConnectionHandler(void* clientData, int mask)
+{
+    CRtspRelay* self = static_cast<CRtspRelay*>(clientData);
+    self->AcceptClient();
+}
+
+void CRtspRelay::AcceptClient()
+{
+    sockaddr_in from = { 0 };
+    SOCKLEN_T fromLength = sizeof(from);
+    int sock = (int)accept(_listenSocket, (sockaddr*)&from, &fromLength);
+    if (sock < 0)
+        return;
+    if (from.sin_addr.s_addr != htonl(INADDR_LOOPBACK)) {
+        closeSocket(sock);
+        return;
+    }
+
+    makeSocketNonBlocking(sock);
+    increaseSendBufferTo(*_env, sock, clientSendBufferSize);
+    Client* client = new Client;
+    client->relay = this;
+    client->socket = sock;
+    _clients.push_back(client);
+    _scheduler->setBackgroundHandling(sock, SOCKET_READABLE, ClientHandler, client);
+}
+
+void CRtspRelay::ClientHandler(void* clientData, int mask)
+{
+    Client* client = static_cast<Client*>(clientData);
+    client->relay->HandleClientEvent(client, mask);
+}
+
+void CRtspRelay::HandleClientEvent(Client* client, int mask)
+{
+    if (mask & SOCKET_READABLE) {
+        char buf[2048];
+        int n = recv(client->socket, buf, sizeof(buf), 0);
+        if (n > 0) {
+            client->input.append(buf, n);
+            if (!ParseInput(client))
+                client->closing = true;
+        }
+        else if (n == 0 || _env->getErrno() != EWOULDBLOCK) {
+            client->closing = true;
+        }
+    }
+    if (!client->closing && !Flush(client))
+        client->closing = true;
+    // TEARDOWNӦѾȥ
+    if (client->closing)
+        CloseClient(client);
+}
+
+bool CRtspRelay::ParseInput(Client* client)
+{
+    std::string& in = client->input;
+    size_t pos = 0;
+    while (pos < in.size() && !client->closing) {
+        // ͻ˷RTCPձ棬ԡ
+        if (in[pos] == '$') {
+            if (in.size() - pos < 4)
+                break;
+            size_t length = ((uint8_t)in[pos + 2] << 8) | (uint8_t)in[pos + 3];
+            if (in.size() - pos < 4 + length)
+                break;
+            pos += 4 + length;
+            continue;
+        }
+
+        size_t end = in.find("\r\n\r\n", pos);
+        if (end == std::string::npos)
+            break;
+        std::string request = in.substr(pos, end + 4 - pos);
+        std::string contentLength = GetHeader(request, "Content-Length");
+        size_t bodyLength = contentLength.empty() ? 0 : strtoul(contentLength.c_str(), nullptr, 10);
+        if (in.size() - (end + 4) < bodyLength)
+            break;
+        pos = end + 4 + bodyLength;
+        HandleRequest(client, request);
+    }
+    in.erase(0, pos);
+    return in.size() <= maxRequestSize;
+}
+
+void CRtspRelay::HandleRequest(Client* client, const std::string& request)
+{
+    char method[32] = { 0 };
+    char url[256] = { 0 };
+    std::string cseq = GetHeader(request, "CSeq");
+    if (sscanf_s(request.c_str(), "%31s %255s", method, (unsigned)sizeof(method), url, (unsigned)sizeof(url)) != 2) {
+        Reply(client, "400 Bad Request", cseq, std::string());
+        client->closing = true;
+        return;
+    }
+
+    // rtsp://127.0.0.1:8554/ch3/track1
+    int channel = -1;
+    int track = VIDEO_TRACK;
+    const char* p = strstr(url, "/ch");
+    if (p != nullptr && isdigit((unsigned char)p[3]))
+        channel = atoi(p + 3);
+    p = strstr(url, "/track");
+    if (p != nullptr && isdigit((unsigned char)p[6]))
+        track = atoi(p + 6);
+
+    char line[512];
+    std::string session;
+    if (!client->session.empty()) {
+        sprintf_s(line, "Session: %s;timeout=%u\r\n", client->session.c_str(), sessionTimeout);
+        session = line;
+    }
+
+    if (strcmp(method, "OPTIONS") == 0) {
+        Reply(client, "200 OK", cseq, "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER, SET_PARAMETER\r\n");
+    }
+    else if (strcmp(method, "DESCRIBE") == 0) {
+        std::string sdp = DescribeChannel(channel);
+        if (sdp.empty()) {
+            Reply(client, "404 Stream Not Found", cseq, std::string());
+            return;
+        }
+        sprintf_s(line, "Content-Base: rtsp://127.0.0.1:%u/ch%d/\r\nContent-Type: application/sdp\r\n", _port, channel);
+        Reply(client, "200 OK", cseq, line, sdp);
+    }
+    else if (strcmp(method, "SETUP") == 0) {
+        bool present = false;
+        if (channel >= 0 && channel < MAX_CHANNELS && track >= 0 && track < TRACK_COUNT) {
+            std::lock_guard<std::mutex> lock(_trackLock);
+            present = _trackInfo[channel][track].present;
+        }
+        if (!present) {
+            Reply(client, "404 Stream Not Found", cseq, std::string());
+            return;
+        }
+        if (client->channel >= 0 && client->channel != channel) {
+            Reply(client, "459 Aggregate Operation Not Allowed", cseq, session);
+            return;
+        }
+        std::string transport = GetHeader(request, "Transport");
+        if (transport.find("RTP/AVP/TCP") == std::string::npos) {
+            Reply(client, "461 Unsupported Transport", cseq, session);
+            return;
+        }
+        int interleaved = track * 2;
+        size_t pos = transport.find("interleaved=");
+        if (pos != std::string::npos) {
+            const char* p = transport.c_str() + pos + strlen("interleaved=");
+            long n = isdigit((unsigned char)*p) ? strtol(p, nullptr, 10) : -1;
+            interleaved = (n >= 0 && n <= 254 && n % 2 == 0) ? (int)n : -1;
+        }
+        // ͨűżRTPnRTCPn+1Ҳһ·ѽͨص
+        for (int i = 0; i < TRACK_COUNT && interleaved >= 0; ++i) {
+            if (i != track && client->setup[i] && client->interleaved[i] == interleaved)
+                interleaved = -1;
+        }
+        if (interleaved < 0) {
+            Reply(client, "461 Unsupported Transport", cseq, session);
+            return;
+        }
+
+        if (client->session.empty()) {
+            sprintf_s(line, "%08X", our_random32());
+            client->session = line;
+            sprintf_s(line, "Session: %s;timeout=%u\r\n", client->session.c_str(), sessionTimeout);
+            session = line;
+        }
+        client->channel = channel;
+        client->setup[track] = true;
+        client->interleaved[track] = interleaved;
+        sprintf_s(line, "Transport: RTP/AVP/TCP;unicast;interleaved=%d-%d;ssrc=%08X\r\n",
+                  interleaved, interleaved + 1, _trackState[channel][track].ssrc);
+        Reply(client, "200 OK", cseq, line + session);
+    }
+    else if (strcmp(method, "PLAY") == 0) {
+        if (client->channel < 0) {
+            Reply(client, "455 Method Not Valid in This State", cseq, session);
+            return;
+        }
+        std::string rtpInfo = "RTP-Info: ";
+        for (int i = 0; i < TRACK_COUNT; ++i) {
+            if (!client->setup[i])
+                continue;
+            const TrackState& ts = _trackState[client->channel][i];
+            sprintf_s(line, "%surl=rtsp://127.0.0.1:%u/ch%d/track%d;seq=%u;rtptime=%u",
+                      rtpInfo.size() > 10 ? "," : "", _port, client->channel, i, ts.seq, ts.lastTimestamp);
+            rtpInfo += line;
+        }
+        Reply(client, "200 OK", cseq, "Range: npt=0.000-\r\n" + session + rtpInfo + "\r\n");
+        client->waitResume = true;
+        SetPlaying(client, true);
+    }
+    else if (strcmp(method, "PAUSE") == 0) {
+        SetPlaying(client, false);
+        Reply(client, "200 OK", cseq, session);
+    }
+    else if (strcmp(method, "TEARDOWN") == 0) {
+        SetPlaying(client, false);
+        Reply(client, "200 OK", cseq, session);
+        client->closing = true;
+    }
+    else if (strcmp(method, "GET_PARAMETER") == 0 || strcmp(method, "SET_PARAMETER") == 0) {
+        Reply(client, "200 OK", cseq, session); // ͻ˵ı
+    }
+    else {
+        Reply(client, "405 Method Not Allowed", cseq,
+              "Allow: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER, SET_PARAMETER\r\n");
+    }
+}
+
+void CRtspRelay::Reply(Client* client, const char* status, const std::string& cseq, const std::string& headers,
+                       const std::string& body)
+{
+    std::string text = "RTSP/1.0 ";
+    text += status;
+    text += "\r\nCSeq: " + cseq + "\r\n";
+    text += dateHeader();
+    text += headers;
+    if (!body.empty()) {
+        char line[64];
+        sprintf_s(line, "Content-Length: %u\r\n", (unsigned)body.size());
+        text += line;
+    }
+    text += "\r\n";
+    text += body;
+
+    std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+    packet->data = std::make_shared<std::vector<uint8_t>>(text.begin(), text.end());
+    packet->length = text.size();
+    Enqueue(client, packet, -1);
+}
+
+void CRtspRelay::Enqueue(Client* client, const std::shared_ptr<Packet>& packet, int interleaved)
+{
+    Client::Output out = { packet, interleaved };
+    client->outputBytes += packet->Size() + (interleaved >= 0 ? 4 : 0);
+    client->output.push_back(out);
+}
+
+// ѿͻ˵ķͶд׽֣дʱȿд֪ͨ׽ֳʱfalse
+bool CRtspRelay::Flush(Client* client)
+{
+    while (!client->output.empty()) {
+        const Client::Output& out = client->output.front();
+        const Packet& packet = *out.packet;
+        uint8_t prefix[4 + sizeof(packet.header)];
+        size_t prefixLength = 0;
+        if (out.interleaved >= 0) {
+            size_t size = packet.Size();
+            prefix[0] = '$';
+            prefix[1] = (uint8_t)out.interleaved;
+            prefix[2] = (uint8_t)(size >> 8);
+            prefix[3] = (uint8_t)size;
+            prefixLength = 4;
+        }
+        memcpy(prefix + prefixLength, packet.header, packet.headerLength);
+        prefixLength += packet.headerLength;
+        size_t total = prefixLength + packet.length;
+
+        while (client->sentBytes < total) {
+            WSABUF bufs[2];
+            DWORD count = 0;
+            size_t sent = client->sentBytes;
+            if (sent < prefixLength) {
+                bufs[count].buf = (char*)prefix + sent;
+                bufs[count].len = (ULONG)(prefixLength - sent);
+                ++count;
+                sent = prefixLength;
+            }
+            if (packet.length > 0) {
+                bufs[count].buf = (char*)packet.data->data() + packet.offset + (sent - prefixLength);
+                bufs[count].len = (ULONG)(total - sent);
+                ++count;
+            }
+            DWORD n = 0;
+            if (WSASend(client->socket, bufs, count, &n, 0, nullptr, nullptr) != 0) {
+                if (WSAGetLastError() != WSAEWOULDBLOCK)
+                    return false;
+                if (!client->writeArmed) {
+                    client->writeArmed = true;
+                    _scheduler->setBackgroundHandling(client->socket, SOCKET_READABLE | SOCKET_WRITABLE,
+                                                      ClientHandler, client);
+                }
+                return true;
+            }
+            client->sentBytes += n;
+        }
+
+        client->outputBytes -= total;
+        client->sentBytes = 0;
+        client->output.pop_front();
+    }
+
+    if (client->writeArmed) {
+        client->writeArmed = false;
+        _scheduler->setBackgroundHandling(client->socket, SOCKET_READABLE, ClientHandler, client);
+    }
+    return true;
+}
+
+void CRtspRelay::SetPlaying(Client* client, bool playing)
+{
+    if (client->playing == playing)
+        return;
+    client->playing = playing;
+    if (playing) {
+        ++_watchers[client->channel];
+        ++_playingClients;
+    }
+    else {
+        --_watchers[client->channel];
+        --_playingClients;
+    }
+}
+
+void CRtspRelay::CloseClient(Client* client)
+{
+    SetPlaying(client, false);
+    _scheduler->disableBackgroundHandling(client->socket);
+    closeSocket(client->socket);
+    _clients.erase(std::find(_clients.begin(), _clients.end(), client));
+    delete client;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include "ConcurrentQueue.h"
+
+class MediaSubsession;
+class MediaPacketSample;
+class UsageEnvironment;
+class BasicTaskScheduler0;
+
+//
+// ڵRTSPת
+// ֻһ·ӣ¼񡢷Ƚ̴ȡrtsp://127.0.0.1:<port>/ch<ͨ>
+// յH.265 NALUAAC֡±룬ֱ´RTPÿֻһΣпͻ˹ͬһݡ
+// ֻ֧RTP over RTSPTCP interleavedֻܱػַӣ֤
+// ϵĿͻ˶ƵȵһIRAPټͻ˺Դˡ
+// Publishɸͨlive555̵߳ãSetTrackɸͨlive555̵߳ãStart/StopMISC̵߳ã
+// RTSPЭ鴦ͷͶڷԼ߳ɡ
+//
+class CRtspRelay
+{
+public:
+    enum { MAX_CHANNELS = 16 };
+    enum { DEFAULT_PORT = 8554 };
+    enum Track { VIDEO_TRACK, AUDIO_TRACK, TRACK_COUNT };
+
+    CRtspRelay();
+    ~CRtspRelay();
+
+    CRtspRelay(const CRtspRelay&) = delete;
+    CRtspRelay& operator=(const CRtspRelay&) = delete;
+
+    bool Start(uint16_t port);
+    void Stop();
+    bool IsRunning() const { return _running; }
+    uint16_t GetPort() const { return _port; }
+    int GetClientCount() const { return _playingClients; } // PLAYĿͻ
+    bool IsWatched(int channel) const { return channel >= 0 && channel < MAX_CHANNELS && _watchers[channel] > 0; }
+
+    // Դ˽лӻỰǼǹDESCRIBEݴSDP
+    void SetTrack(int channel, Track track, MediaSubsession& subsession);
+    // תյһNALUƵһ֡AACƵûпͻȡͨʱء
+    void Publish(int channel, Track track, const MediaPacketSample& sample);
+
+private:
+    struct Client;
+    struct Packet;
+
+    struct Item
+    {
+        int channel = 0;
+        Track track = VIDEO_TRACK;
+        std::shared_ptr<const std::vector<uint8_t>> data; // йյĸ
+        timeval presentationTime = { 0 };
+        bool isMarker = false;
+    };
+
+    struct TrackInfo
+    {
+        bool present = false;
+        unsigned frequency = 0;
+        unsigned numChannels = 0;
+        std::string vps, sps, pps; // Ƶsprop-vps/sps/pps
+        std::string config; // ƵAudioSpecificConfig
+    };
+
+    struct TrackState
+    {
+        uint32_t ssrc = 0;
+        uint16_t seq = 0;
+        uint32_t timestampBase = 0;
+        uint32_t lastTimestamp = 0;
+        timeval lastPresentationTime = { 0 };
+        uint32_t packetCount = 0;
+        uint32_t octetCount = 0;
+        bool hasSent = false;
+    };
+
+    void ServerThread();
+    void Wake();
+    void DrainItems();
+    void Forward(Item& item);
+    void Packetize(Item& item, TrackState& ts, uint32_t timestamp, std::vector<std::shared_ptr<Packet>>& packets);
+    void SendReports();
+    std::string DescribeChannel(int channel);
+
+    void AcceptClient();
+    void HandleClientEvent(Client* client, int mask);
+    bool ParseInput(Client* client);
+    void HandleRequest(Client* client, const std::string& request);
+    void Reply(Client* client, const char* status, const std::string& cseq, const std::string& headers,
+               const std::string& body = std::string());
+    void Enqueue(Client* client, const std::shared_ptr<Packet>& packet, int interleaved);
+    bool Flush(Client* client);
+    void SetPlaying(Client* client, bool playing);
+    void CloseClient(Client* client);
+
+    static void IncomingConnectionHandler(void* clientData, int mask);
+    static void WakeHandler(void* clientData, int mask);
+    static void ClientHandler(void* clientData, int mask);
+    static void ReportTimer(void* clientData);
+
+private:
+    volatile bool _running = false;
+    volatile bool _quit = false;
+    uint16_t _port = 0;
+    BasicTaskScheduler0* _scheduler = nullptr;
+    UsageEnvironment* _env = nullptr;
+    std::thread _thread;
+    int _listenSocket = -1;
+    void* _reportTask = nullptr;
+
+    std::mutex _wakeLock; // _wakeSocketStopرʱPublishڻѷ̡߳
+    int _wakeSocket = -1;
+    uint16_t _wakePort = 0; // ֽ
+    std::atomic<bool> _wakePending;
+    ConcurrentQueue<Item> _items;
+
+    std::mutex _trackLock;
+    TrackInfo _trackInfo[MAX_CHANNELS][TRACK_COUNT];
+
+    // ֻڷ߳зʡ
+    TrackState _trackState[MAX_CHANNELS][TRACK_COUNT];
+    std::vector<Client*> _clients;
+
+    std::atomic<int> _watchers[MAX_CHANNELS]; // ÿͨPLAYĿͻΪ0ʱPublishֱӷء
+    std::atomic<int> _playingClients;
+};
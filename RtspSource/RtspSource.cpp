@@ -20,9 +20,14 @@ namespace
     const millisecond_t defaultLatency = 0;
     const int recvBufferVideo = RtspH265SourcePin::ALLOCATOR_BUF_SIZE; // ̫Сᵼ³ߴϴĸI֡ʧĻ
     const int recvBufferAudio = RtspAACSourcePin::ALLOCATOR_BUF_SIZE;
+    const size_t maxQueuedAudioPackets = 8; // 48kHz AACÿ10248Լ170msɵİ
     const millisecond_t packetReorderingThresholdTime = 0; // TCPҪ
-    const millisecond_t interPacketGapMaxTime = 2 * 1000; // ýʱóֵ,ִж
+    const millisecond_t healthCheckInterval = 250; // RTCPͳƵļĬӦֵ
+    const millisecond_t healthLogInterval = 2 * 1000;
     const millisecond_t firstCallTimeoutTime = 2 * 1000;
+    const millisecond_t standbyTimeoutTime = 10 * 1000; // ỰȵIRAPʱޣGOPϳҲá
+    const millisecond_t maxReconnectionTime = 60 * 1000; // ָ˱ܵ
+    const millisecond_t reconnectPollTime = 200; // û뵽ʱô롣
     const bool forceMulticastOnUnspecified = false;
 
     bool IsSubsessionSupported(MediaSubsession& mediaSubsession);
@@ -90,10 +95,12 @@ CRtspSource::CRtspSource(IUnknown* pUnk, HRESULT* phr)
     , _autoReconnectionMSecs(0)
     , _latencyMSecs(defaultLatency)
     , _sendLivenessCommand(false)
+    , _audioMuted(true)
+    , _audioResync(false)
+    , _videoMode(RtspSource::VideoFull)
     , _state(State::Initial)
     , _scheduler(BasicTaskScheduler::createNew())
     , _env(BasicUsageEnvironment::createNew(*_scheduler))
-    , _totNumPacketsReceived(0)
     , _interPacketGapCheckTimerTask(nullptr)
     , _reconnectionTimerTask(nullptr)
     , _firstCallTimeoutTask(nullptr)
@@ -157,6 +164,8 @@ HRESULT CRtspSource::OpenURL(PCWSTR url, PCWSTR userName, PCWSTR password)
 {
     _rtspUrlOrigin = url;
     ws2s(_rtspUrlOrigin, _rtspUrl);
+    if (_replayBuffer)
+        _replayBuffer->SetStream(_channelId, _rtspUrl); // ͨϿܻ
     {
         std::string _userName;
         std::string _password;
@@ -175,11 +184,26 @@ HRESULT CRtspSource::OpenURL(PCWSTR url, PCWSTR userName, PCWSTR password)
     return S_OK;
 }
 
+HRESULT CRtspSource::SwitchURL(PCWSTR url)
+{
+    std::string switchUrl;
+    ws2s(url, switchUrl);
+    RtspSource::ErrorCode ec = AsyncSwitch(switchUrl).get();
+    if (ec != RtspSource::Success) {
+        (*_env) << "Switch error: " << (int)ec << "\n";
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
 HRESULT CRtspSource::Stop()
 {
     fprintf(stderr,"%s - state: %s\n", __FUNCTION__, GetFilterStateName(m_State));
 
     AsyncShutdown().get();
+    if (_syncGroup)
+        _syncGroup->Leave(_channelId);
     return CSource::Stop();
 }
 
@@ -266,6 +290,63 @@ void CRtspSource::SetNotifyReceiver(RtspSource::INotify* receiver)
     _notifyReceiver = receiver;
 }
 
+void CRtspSource::SetAudioMute(BOOL mute)
+{
+    // ̡߳״̬µá
+    bool muted = mute ? true : false;
+    bool wasMuted = _audioMuted.exchange(muted);
+    if (muted) {
+        _aacMediaPacketQueue.clear(); // ѹƵʱᲥŹʱ
+    }
+    else if (wasMuted) {
+        _audioResync = true;
+    }
+}
+
+void CRtspSource::SetSyncGroup(CSyncGroup* group)
+{
+    _syncGroup = group;
+}
+
+void CRtspSource::SetRelay(CRtspRelay* relay)
+{
+    _relay = relay;
+}
+
+void CRtspSource::SetReconnectLimiter(CReconnectLimiter* limiter)
+{
+    _reconnectLimiter = limiter;
+}
+
+void CRtspSource::SetReplayBuffer(CReplayBuffer* replay)
+{
+    _replayBuffer = replay;
+}
+
+void CRtspSource::SetVideoMode(RtspSource::VideoMode mode)
+{
+    // ̡߳״̬µãlive555̵߳ƵsinkһʼЧ
+    _videoMode = mode;
+}
+
+void CRtspSource::SetIdlePauseDelay(DWORD dwMSecs)
+{
+    // live555̵߳һνʱЧ
+    _idlePauseMSecs = dwMSecs;
+}
+
+void CRtspSource::SetStreamingPriority(int priority)
+{
+    CAutoLock cAutoLock(pStateLock());
+    _h265Pin->SetStreamingPriority(priority);
+}
+
+void CRtspSource::GetHealth(RtspSource::Health* health)
+{
+    _health.Get(timeGetTime(), health);
+    health->droppedNalus = _droppedNalus;
+}
+
 void CRtspSource::Fire_AvgFrameIntervalChanged(DWORD frameInterval)
 {
     _notifyReceiver->OnFrameIntervalChanged(_channelId, frameInterval);
@@ -381,21 +462,7 @@ void CRtspSource::SetupSubsession()
             return;
         }
 
-        RTPSource* rtpSource = subsession->rtpSource();
-        if (rtpSource)
-        {
-            rtpSource->setPacketReorderingThresholdTime(packetReorderingThresholdTime);
-            int recvBuffer = 0;
-            if (!strcmp(subsession->mediumName(), "video"))
-                recvBuffer = recvBufferVideo;
-            else if (!strcmp(subsession->mediumName(), "audio"))
-                recvBuffer = recvBufferAudio;
-
-            // Increase receive buffer for rather big packets (like H.265 IDR)
-            if (recvBuffer > 0 && rtpSource->RTPgs())
-                ::increaseReceiveBufferTo(*_env, rtpSource->RTPgs()->socketNum(), recvBuffer);
-        }
-
+        PrepareRtpSource(*subsession);
         _rtsp->sendSetupCommand(*subsession, HandleSetupResponse, False, _streamOverTcp,
                                 forceMulticastOnUnspecified && !_streamOverTcp, &_authenticator);
         return;
@@ -434,6 +501,24 @@ void CRtspSource::SetupSubsession()
     }
 }
 
+void CRtspSource::PrepareRtpSource(MediaSubsession& subsession)
+{
+    RTPSource* rtpSource = subsession.rtpSource();
+    if (rtpSource)
+    {
+        rtpSource->setPacketReorderingThresholdTime(packetReorderingThresholdTime);
+        int recvBuffer = 0;
+        if (!strcmp(subsession.mediumName(), "video"))
+            recvBuffer = recvBufferVideo;
+        else if (!strcmp(subsession.mediumName(), "audio"))
+            recvBuffer = recvBufferAudio;
+
+        // Increase receive buffer for rather big packets (like H.265 IDR)
+        if (recvBuffer > 0 && rtpSource->RTPgs())
+            ::increaseReceiveBufferTo(*_env, rtpSource->RTPgs()->socketNum(), recvBuffer);
+    }
+}
+
 void CRtspSource::HandleSetupResponse(RTSPClient* client, int resultCode, char* resultString)
 {
     RtspClient* myClient = static_cast<RtspClient*>(client);
@@ -451,17 +536,29 @@ void CRtspSource::HandleSetupResponse(int resultCode, char* resultString)
         {
             assert(0 == strcmp(subsession->codecName(), "H265"));
             subsession->sink = new ProxyMediaSink(*_env, *subsession, _h265MediaPacketQueue, recvBufferVideo, false);
+            static_cast<ProxyMediaSink*>(subsession->sink)->SetVideoMode(&_videoMode);
             _h265Pin->ResetMediaSubsession(subsession);
+            if (_relay) {
+                _relay->SetTrack(_channelId, CRtspRelay::VIDEO_TRACK, *subsession);
+                static_cast<ProxyMediaSink*>(subsession->sink)->SetRelay(_relay, _channelId, CRtspRelay::VIDEO_TRACK);
+            }
+            if (_replayBuffer)
+                static_cast<ProxyMediaSink*>(subsession->sink)->SetReplayBuffer(_replayBuffer, _channelId);
         }
         else if (0 == strcmp(subsession->mediumName(), "audio"))
         {
             assert(0 == strcmp(subsession->codecName(), "MPEG4-GENERIC"));
             HRESULT hr;
-            subsession->sink = new ProxyMediaSink(*_env, *subsession, _aacMediaPacketQueue, recvBufferAudio, true);
+            subsession->sink = new ProxyMediaSink(*_env, *subsession, _aacMediaPacketQueue, recvBufferAudio, false,
+                maxQueuedAudioPackets, &_audioMuted);
             if (_aacPin == nullptr)
                 _aacPin = new RtspAACSourcePin(&hr, this, subsession, &_aacMediaPacketQueue);
             else
                 _aacPin->ResetMediaSubsession(subsession);
+            if (_relay) {
+                _relay->SetTrack(_channelId, CRtspRelay::AUDIO_TRACK, *subsession);
+                static_cast<ProxyMediaSink*>(subsession->sink)->SetRelay(_relay, _channelId, CRtspRelay::AUDIO_TRACK);
+            }
         }
 
         // What about text medium ?
@@ -527,33 +624,11 @@ void CRtspSource::HandlePlayResponse(int resultCode, char* resultString)
 {
     if (resultCode == 0)
     {
+        ReleaseReconnectSlot();
+        _reconnectAttempts = 0;
         _currentRequest.SetValue(RtspSource::Success);
         // State is already Playing
-        _totNumPacketsReceived = 0;
-        _sessionTimeout =
-            _rtsp->sessionTimeoutParameter() != 0 ? _rtsp->sessionTimeoutParameter() : 60;
-
-        // Create timerTask for disconnection recognition
-        _interPacketGapCheckTimerTask = _scheduler->scheduleDelayedTask(
-            interPacketGapMaxTime * 1000, &CRtspSource::CheckInterPacketGaps, this);
-        // Create timerTask for session keep-alive (use OPTIONS request to sustain session)
-        if (_sendLivenessCommand)
-        {
-            _livenessCommandTask = _scheduler->scheduleDelayedTask(
-                _sessionTimeout / 3 * 1000000, &CRtspSource::SendLivenessCommand, this);
-        }
-
-        if (_sessionDuration > 0)
-        {
-            double rangeAdjustment =
-                (_rtsp->mediaSession->playEndTime() - _rtsp->mediaSession->playStartTime()) -
-                (_endTime - _initialSeekTime);
-            if (_sessionDuration + rangeAdjustment > 0.0)
-                _sessionDuration += rangeAdjustment;
-            int64_t uSecsToDelay = (int64_t)(_sessionDuration * 1000000.0);
-            _sessionTimerTask = _scheduler->scheduleDelayedTask(
-                uSecsToDelay, &CRtspSource::HandleMediaEnded, this);
-        }
+        StartSessionTimers();
     }
     else
     {
@@ -563,8 +638,7 @@ void CRtspSource::HandlePlayResponse(int resultCode, char* resultString)
 
         if (_autoReconnectionMSecs > 0)
         {
-            _reconnectionTimerTask = _scheduler->scheduleDelayedTask(
-                _autoReconnectionMSecs * 1000, &CRtspSource::Reconnect, this);
+            ScheduleReconnectTask();
             _state = State::Reconnecting;
             _currentRequest.SetValue(RtspSource::PlayFailed);
         }
@@ -583,15 +657,54 @@ void CRtspSource::HandlePlayResponse(int resultCode, char* resultString)
     delete[] resultString;
 }
 
+void CRtspSource::StartSessionTimers()
+{
+    _sessionTimeout =
+        _rtsp->sessionTimeoutParameter() != 0 ? _rtsp->sessionTimeoutParameter() : 60;
+
+    _remotePause = RemotePause::None;
+    _idleSince = 0;
+    _pauseRefused = false;
+
+    // Create timerTask for disconnection recognition
+    _health.Reset(timeGetTime());
+    _interPacketGapCheckTimerTask = _scheduler->scheduleDelayedTask(
+        healthCheckInterval * 1000, &CRtspSource::CheckInterPacketGaps, this);
+    // Create timerTask for session keep-alive (use OPTIONS request to sustain session)
+    if (_sendLivenessCommand)
+    {
+        _livenessCommandTask = _scheduler->scheduleDelayedTask(
+            _sessionTimeout / 3 * 1000000, &CRtspSource::SendLivenessCommand, this);
+    }
+
+    if (_sessionDuration > 0)
+    {
+        double rangeAdjustment =
+            (_rtsp->mediaSession->playEndTime() - _rtsp->mediaSession->playStartTime()) -
+            (_endTime - _initialSeekTime);
+        if (_sessionDuration + rangeAdjustment > 0.0)
+            _sessionDuration += rangeAdjustment;
+        int64_t uSecsToDelay = (int64_t)(_sessionDuration * 1000000.0);
+        _sessionTimerTask = _scheduler->scheduleDelayedTask(
+            uSecsToDelay, &CRtspSource::HandleMediaEnded, this);
+    }
+}
+
 void CRtspSource::CloseSession()
 {
     if (!_rtsp)
         return; // sane check
-    MediaSession* mediaSession = _rtsp->mediaSession;
+    _health.Stop();
+    CloseMediaSession(_rtsp);
+}
+
+void CRtspSource::CloseMediaSession(RtspClient* rtsp)
+{
+    MediaSession* mediaSession = rtsp->mediaSession;
     if (mediaSession != nullptr)
     {
         // Don't bother waiting for response
-        _rtsp->sendTeardownCommand(*mediaSession, nullptr, &_authenticator);
+        rtsp->sendTeardownCommand(*mediaSession, nullptr, &_authenticator);
         // Close media sinks
         MediaSubsessionIterator iter(*mediaSession);
         MediaSubsession* subsession;
@@ -602,7 +715,7 @@ void CRtspSource::CloseSession()
         }
         // Close media session itself
         Medium::close(mediaSession);
-        _rtsp->mediaSession = nullptr;
+        rtsp->mediaSession = nullptr;
     }
 }
 
@@ -617,6 +730,12 @@ void CRtspSource::HandleSubsessionFinished(void* clientData)
 {
     MediaSubsession* subsession = static_cast<MediaSubsession*>(clientData);
     RtspClient* rtsp = static_cast<RtspClient*>(subsession->miscPtr);
+    CRtspSource* self = rtsp->filter;
+    if (rtsp == self->_standby) {
+        // ûȵIRAPͽˣлǰỰӰ졣
+        self->CloseStandby();
+        return;
+    }
     // Close finished media subsession
     Medium::close(subsession->sink);
     subsession->sink = nullptr;
@@ -629,7 +748,6 @@ void CRtspSource::HandleSubsessionFinished(void* clientData)
             return;
     }
     // No more subsessions active - close the session
-    CRtspSource* self = rtsp->filter;
     self->UnscheduleAllDelayedTasks();
     self->CloseSession();
     self->CloseClient();
@@ -662,9 +780,13 @@ void CRtspSource::UnscheduleAllDelayedTasks()
 
 void CRtspSource::Shutdown()
 {
+    CloseStandby();
+    _pendingSwitchUrl.clear();
     UnscheduleAllDelayedTasks();
     CloseSession();
     CloseClient();
+    ReleaseReconnectSlot();
+    _reconnectAttempts = 0;
 
     _state = State::Initial;
     _currentRequest.SetValue(RtspSource::Success);
@@ -674,12 +796,228 @@ void CRtspSource::Shutdown()
     _aacMediaPacketQueue.push(MediaPacketSample());
 }
 
+/*
+ * л/
+ * ǰỰţûỰͬһlive555߳DESCRIBE/SETUP/PLAY
+ * sinkHold״̬ڵһIRAPǰаƵsinkյIRAPʱصPromoteStandby()
+ * رյǰỰɱûỰȡ֮еĵһлǣ
+ * ƵPinݴڴڸýͺʱߣ治ֿհ׻
+ */
+void CRtspSource::OpenStandby(const std::string& url)
+{
+    CloseStandby(); // лʱһûȵIRAPıûỰ
+    if (url == _rtspUrl)
+        return;
+
+    _standby = RtspClient::CreateRtspClient(this, *_env, url.c_str(),
+        RtspClientVerbosityLevel, RtspClientAppName, _tunnelOverHttpPort);
+    if (!_standby)
+        return;
+    _standbyUrl = url;
+    _numStandbySubsessions = 0;
+    _standbyTimeoutTask = _scheduler->scheduleDelayedTask(
+        standbyTimeoutTime * 1000, &CRtspSource::StandbyTimeout, this);
+    _standby->sendDescribeCommand(HandleStandbyDescribeResponse, &_authenticator);
+}
+
+void CRtspSource::HandleStandbyDescribeResponse(RTSPClient* client, int resultCode, char* resultString)
+{
+    RtspClient* myClient = static_cast<RtspClient*>(client);
+    myClient->filter->HandleStandbyDescribeResponse(resultCode, resultString);
+}
+
+void CRtspSource::HandleStandbyDescribeResponse(int resultCode, char* resultString)
+{
+    MediaSession* mediaSession = nullptr;
+    if (resultCode == 0)
+        mediaSession = MediaSession::createNew(*_env, resultString);
+    delete[] resultString;
+
+    if (mediaSession == nullptr) {
+        fprintf(stderr, "Channel(%d) switching to %s failed: DESCRIBE\n", _channelId, _standbyUrl.c_str());
+        CloseStandby();
+        return;
+    }
+
+    _standby->mediaSession = mediaSession;
+    if (!mediaSession->hasSubsessions()) {
+        fprintf(stderr, "Channel(%d) switching to %s failed: no subsessions\n", _channelId, _standbyUrl.c_str());
+        CloseStandby();
+        return;
+    }
+
+    _standby->iter = new MediaSubsessionIterator(*mediaSession);
+    SetupStandbySubsession();
+}
+
+void CRtspSource::SetupStandbySubsession()
+{
+    MediaSubsession* subsession;
+    while ((subsession = _standby->iter->next()) != nullptr)
+    {
+        // ͼѾӺãֻPinܳнӵý塣
+        bool isVideo = 0 == strcmp(subsession->mediumName(), "video");
+        if (!IsSubsessionSupported(*subsession) || (!isVideo && _aacPin == nullptr))
+            continue;
+        if (!subsession->initiate())
+            continue;
+
+        PrepareRtpSource(*subsession);
+        _standby->subsession = subsession;
+        _standby->sendSetupCommand(*subsession, HandleStandbySetupResponse, False, _streamOverTcp,
+                                   forceMulticastOnUnspecified && !_streamOverTcp, &_authenticator);
+        return;
+    }
+
+    _standby->subsession = nullptr;
+    delete _standby->iter;
+    _standby->iter = nullptr;
+
+    if (_numStandbySubsessions == 0) {
+        fprintf(stderr, "Channel(%d) switching to %s failed: SETUP\n", _channelId, _standbyUrl.c_str());
+        CloseStandby();
+        return;
+    }
+
+    // ֻлֱʼմӵǰʱ̿ʼš
+    _standby->sendPlayCommand(*_standby->mediaSession, HandleStandbyPlayResponse, 0.0, -1.0, 1.0f,
+                              &_authenticator);
+}
+
+void CRtspSource::HandleStandbySetupResponse(RTSPClient* client, int resultCode, char* resultString)
+{
+    RtspClient* myClient = static_cast<RtspClient*>(client);
+    myClient->filter->HandleStandbySetupResponse(resultCode, resultString);
+}
+
+void CRtspSource::HandleStandbySetupResponse(int resultCode, char* resultString)
+{
+    delete[] resultString;
+
+    if (resultCode == 0)
+    {
+        MediaSubsession* subsession = _standby->subsession;
+        ProxyMediaSink* sink = nullptr;
+        if (0 == strcmp(subsession->mediumName(), "video"))
+        {
+            sink = new ProxyMediaSink(*_env, *subsession, _h265MediaPacketQueue, recvBufferVideo, false);
+            sink->Hold(HandleStandbyReady, this);
+            sink->SetVideoMode(&_videoMode);
+            if (_relay)
+                sink->SetRelay(_relay, _channelId, CRtspRelay::VIDEO_TRACK);
+            if (_replayBuffer)
+                sink->SetReplayBuffer(_replayBuffer, _channelId);
+        }
+        else
+        {
+            sink = new ProxyMediaSink(*_env, *subsession, _aacMediaPacketQueue, recvBufferAudio, false,
+                maxQueuedAudioPackets, &_audioMuted);
+            sink->Hold(nullptr, nullptr); // ƵIRAPлʱ̡
+            if (_relay)
+                sink->SetRelay(_relay, _channelId, CRtspRelay::AUDIO_TRACK);
+        }
+
+        subsession->sink = sink;
+        subsession->miscPtr = _standby;
+        sink->startPlaying(*(subsession->readSource()), HandleSubsessionFinished, subsession);
+        if (subsession->rtcpInstance() != nullptr)
+            subsession->rtcpInstance()->setByeHandler(HandleSubsessionByeHandler, subsession);
+
+        ++_numStandbySubsessions;
+    }
+
+    SetupStandbySubsession();
+}
+
+void CRtspSource::HandleStandbyPlayResponse(RTSPClient* client, int resultCode, char* resultString)
+{
+    RtspClient* myClient = static_cast<RtspClient*>(client);
+    myClient->filter->HandleStandbyPlayResponse(resultCode, resultString);
+}
+
+void CRtspSource::HandleStandbyPlayResponse(int resultCode, char* resultString)
+{
+    delete[] resultString;
+    if (resultCode != 0) {
+        fprintf(stderr, "Channel(%d) switching to %s failed: PLAY\n", _channelId, _standbyUrl.c_str());
+        CloseStandby();
+    }
+}
+
+void CRtspSource::HandleStandbyReady(void* clientData)
+{
+    CRtspSource* self = static_cast<CRtspSource*>(clientData);
+    self->PromoteStandby();
+}
+
+void CRtspSource::PromoteStandby()
+{
+    fprintf(stderr, "Channel(%d) switched to %s\n", _channelId, _standbyUrl.c_str());
+    if (_standbyTimeoutTask != nullptr)
+        _scheduler->unscheduleDelayedTask(_standbyTimeoutTask);
+
+    // ɻỰsinkرպ󲻻ŰİǺ档
+    UnscheduleAllDelayedTasks();
+    CloseSession();
+    CloseClient();
+
+    _rtsp = _standby;
+    _standby = nullptr;
+    _rtspUrl = _standbyUrl;
+    _numSubsessions = _numStandbySubsessions;
+
+    MediaSubsessionIterator iter(*_rtsp->mediaSession);
+    MediaSubsession* subsession;
+    while ((subsession = iter.next()) != nullptr)
+    {
+        if (subsession->sink == nullptr)
+            continue;
+        // תĿͻ˴л㿪ʼյĲSDPҲ֮¡
+        if (0 == strcmp(subsession->mediumName(), "video")) {
+            _h265Pin->PrepareStreamSwitch(subsession);
+            if (_relay)
+                _relay->SetTrack(_channelId, CRtspRelay::VIDEO_TRACK, *subsession);
+        }
+        else {
+            _aacPin->ResetMediaSubsession(subsession);
+            if (_relay)
+                _relay->SetTrack(_channelId, CRtspRelay::AUDIO_TRACK, *subsession);
+            _audioResync = true;
+            static_cast<ProxyMediaSink*>(subsession->sink)->ReleaseHold();
+        }
+    }
+
+    StartSessionTimers();
+}
+
+void CRtspSource::StandbyTimeout(void* clientData)
+{
+    CRtspSource* self = static_cast<CRtspSource*>(clientData);
+    self->_standbyTimeoutTask = nullptr;
+    fprintf(stderr, "Channel(%d) switching to %s timed out\n", self->_channelId, self->_standbyUrl.c_str());
+    self->CloseStandby();
+}
+
+void CRtspSource::CloseStandby()
+{
+    if (_standbyTimeoutTask != nullptr)
+        _scheduler->unscheduleDelayedTask(_standbyTimeoutTask);
+    if (_standby == nullptr)
+        return;
+
+    delete _standby->iter;
+    _standby->iter = nullptr;
+    _standby->subsession = nullptr;
+    CloseMediaSession(_standby);
+    Medium::close(_standby);
+    _standby = nullptr;
+}
+
 bool CRtspSource::ScheduleNextReconnect()
 {
     if (_state == State::Reconnecting)
     {
-        _reconnectionTimerTask = _scheduler->scheduleDelayedTask(
-            _autoReconnectionMSecs * 1000, &CRtspSource::Reconnect, this);
+        ScheduleReconnectTask();
         // state is still Reconnecting
         _currentRequest.SetValue(RtspSource::ReconnectFailed);
         return true;
@@ -687,6 +1025,29 @@ bool CRtspSource::ScheduleNextReconnect()
     return false;
 }
 
+/*
+ * ָ˱ܣnǰȴ[T/2, T]T = min(׼ * 2^n, maxReconnectionTime)
+ * ͬʱߵͨÿֶͬʱ豸֡
+ * ʧܣȹ黹ٵȴ
+ */
+void CRtspSource::ScheduleReconnectTask()
+{
+    ReleaseReconnectSlot();
+
+    uint64_t backoff = std::min<uint64_t>((uint64_t)_autoReconnectionMSecs << std::min(_reconnectAttempts, 16u),
+                                          std::max<uint64_t>(_autoReconnectionMSecs, maxReconnectionTime));
+    ++_reconnectAttempts;
+    uint64_t delay = backoff / 2 + our_random32() % (backoff / 2 + 1);
+    _reconnectionTimerTask = _scheduler->scheduleDelayedTask(
+        (int64_t)delay * 1000, &CRtspSource::Reconnect, this);
+}
+
+void CRtspSource::ReleaseReconnectSlot()
+{
+    if (_reconnectLimiter)
+        _reconnectLimiter->Release(_channelId);
+}
+
 /*
  * Task:_firstCallTimeoutTask
  * Allows for customized timeout on first call to the target RTSP server
@@ -716,7 +1077,8 @@ void CRtspSource::DescribeRequestTimeout()
 
 /*
  * Task:_interPacketGapCheckTimerTask:
- * Periodically calculates how many packets arrived allowing to detect connection lost.
+ * Periodically feeds RTCP reception statistics to the health monitor, which learns the stream's
+ * normal silence from its packet cadence and detects connection lost (see StreamHealth.h).
  * Viable only in Playing state.
  */
 void CRtspSource::CheckInterPacketGaps(void* clientData)
@@ -730,27 +1092,66 @@ void CRtspSource::CheckInterPacketGaps()
     _ASSERT(_state == State::Playing);
     _interPacketGapCheckTimerTask = nullptr;
 
+    // ỰRTSP PAUSEͣڼܰĬжߡ
+    DWORD now = timeGetTime();
+    if (UpdateIdlePause(now))
+    {
+        _interPacketGapCheckTimerTask = _scheduler->scheduleDelayedTask(
+            healthCheckInterval * 1000, &CRtspSource::CheckInterPacketGaps, this);
+        return;
+    }
+
     // Aliases
     UsageEnvironment& env = *_env;
     MediaSession& mediaSession = *_rtsp->mediaSession;
 
-    // Check each subsession, counting up how many packets have been received
+    // Check each subsession, counting up how many packets have been received and expected
     MediaSubsessionIterator iter(mediaSession);
     MediaSubsession* subsession;
-    uint32_t newTotNumPacketsReceived = 0;
+    CStreamHealth::Sample sample = { 0, 0, 0, -1 };
+    timeval tvNow;
+    gettimeofday(&tvNow, nullptr);
     while ((subsession = iter.next()) != nullptr)
     {
         RTPSource* src = subsession->rtpSource();
         if (src == nullptr)
             continue;
-        newTotNumPacketsReceived += src->receptionStatsDB().totNumPacketsReceived();
+        RTPReceptionStatsDB::Iterator statsIter(src->receptionStatsDB());
+        RTPReceptionStats* stats;
+        while ((stats = statsIter.next(True)) != nullptr)
+        {
+            sample.received += stats->totNumPacketsReceived();
+            sample.expected += stats->totNumPacketsExpected();
+            unsigned frequency = src->timestampFrequency();
+            if (frequency >= 1000)
+                sample.jitterMs = std::max<int>(sample.jitterMs, stats->jitter() / (frequency / 1000));
+            const timeval& sr = stats->lastReceivedSR_time();
+            if (sr.tv_sec != 0)
+            {
+                int srAge = (int)((tvNow.tv_sec - sr.tv_sec) * 1000 + (tvNow.tv_usec - sr.tv_usec) / 1000);
+                if (sample.srAgeMs < 0 || srAge < sample.srAgeMs)
+                    sample.srAgeMs = std::max(srAge, 0);
+            }
+        }
     }
-    fprintf(stderr,"Channel(%d) total number of packets received: %u, queued packets: %u|%u\n", _channelId,
-             newTotNumPacketsReceived, (DWORD)_h265MediaPacketQueue.size(), (DWORD)_aacMediaPacketQueue.size());
-    // ϴμһֱڶûյµýˣýԴݽ(EndOfStream)ˣ߶ˣ
-    if (newTotNumPacketsReceived == _totNumPacketsReceived)
+    _health.Update(now, sample);
+    bool stalled = _health.IsStalled(now);
+
+    if (stalled || now - _lastHealthLogTime >= healthLogInterval)
     {
-        fprintf(stderr,"No packets has been received since last time!\n");
+        RtspSource::Health health;
+        _health.Get(now, &health);
+        fprintf(stderr,"Channel(%d) total number of packets received: %u, queued packets: %u|%u, "
+            "health: %d, loss: %d/1000, jitter: %dms, silence: %d/%dms\n", _channelId,
+            sample.received, (DWORD)_h265MediaPacketQueue.size(), (DWORD)_aacMediaPacketQueue.size(),
+            health.score, health.lossPermille, health.jitterMs, health.silenceMs, health.gapThresholdMs);
+        _lastHealthLogTime = now;
+    }
+    // Ĭʱ䳬˰ѧϰֵýԴݽ(EndOfStream)ˣ߶ˣ
+    if (stalled)
+    {
+        fprintf(stderr,"No packets has been received for too long!\n");
+        _health.Stop();
 
         if (_livenessCommandTask != nullptr)
             _scheduler->unscheduleDelayedTask(_livenessCommandTask);
@@ -793,19 +1194,122 @@ void CRtspSource::CheckInterPacketGaps()
                 _aacPin->ResetTimeBaselines();
 
             // Finally schedule reconnect task
-            _reconnectionTimerTask = _scheduler->scheduleDelayedTask(
-                _autoReconnectionMSecs * 1000, &CRtspSource::Reconnect, this);
+            ScheduleReconnectTask();
         }
     }
     else
     {
-        _totNumPacketsReceived = newTotNumPacketsReceived;
         // Schedule next inspection
         _interPacketGapCheckTimerTask = _scheduler->scheduleDelayedTask(
-            interPacketGapMaxTime * 1000, &CRtspSource::CheckInterPacketGaps, this);
+            healthCheckInterval * 1000, &CRtspSource::CheckInterPacketGaps, this);
     }
 }
 
+/*
+ * ̨ͨʡƵ롢Ƶûתͻ˵ֱỰ_idlePauseMSecsRTSP PAUSE
+ * ʱ¿ɼƵ㡢תͻˣͲRangePLAYָ
+ * ͣڼճOPTIONSָƵsinkһIRAPʼС
+ * ػỰǷڣڽ롢˳ͣ״̬
+ */
+bool CRtspSource::UpdateIdlePause(DWORD now)
+{
+    bool idle = _idlePauseMSecs > 0 && !_pauseRefused && _sessionDuration <= 0 && _standby == nullptr
+        && _videoMode == RtspSource::VideoNone && (_aacPin == nullptr || _audioMuted)
+        && !(_relay && _relay->IsWatched(_channelId));
+    if (!idle)
+        _idleSince = 0;
+    else if (_idleSince == 0)
+        _idleSince = now;
+
+    switch (_remotePause)
+    {
+    case RemotePause::None:
+        if (!idle || now - _idleSince < _idlePauseMSecs)
+            return false;
+        _remotePause = RemotePause::Pausing;
+        _rtsp->sendPauseCommand(*_rtsp->mediaSession, HandlePauseResponse, &_authenticator);
+        return true;
+
+    case RemotePause::Paused:
+        if (idle)
+            return true;
+        _remotePause = RemotePause::Resuming;
+        _rtsp->sendPlayCommand(*_rtsp->mediaSession, HandleResumeResponse, -1.0, -1.0, 1.0f, &_authenticator);
+        return true;
+
+    default:
+        return true;
+    }
+}
+
+void CRtspSource::HandlePauseResponse(RTSPClient* client, int resultCode, char* resultString)
+{
+    RtspClient* myClient = static_cast<RtspClient*>(client);
+    myClient->filter->HandlePauseResponse(resultCode, resultString);
+}
+
+void CRtspSource::HandlePauseResponse(int resultCode, char* resultString)
+{
+    delete[] resultString;
+
+    if (resultCode != 0)
+    {
+        // ֱ֧PAUSEգֻǲ롣
+        fprintf(stderr, "Channel(%d) PAUSE refused (%d), keep receiving in background\n", _channelId, resultCode);
+        _pauseRefused = true;
+        _remotePause = RemotePause::None;
+        _health.Resume(timeGetTime());
+        return;
+    }
+
+    fprintf(stderr, "Channel(%d) paused in background\n", _channelId);
+    _remotePause = RemotePause::Paused;
+    _health.Stop();
+    // ûRTP/RTCPֻܿOPTIONSάֻỰ
+    if (_livenessCommandTask == nullptr)
+    {
+        _livenessCommandTask = _scheduler->scheduleDelayedTask(
+            _sessionTimeout / 3 * 1000000, &CRtspSource::SendLivenessCommand, this);
+    }
+}
+
+void CRtspSource::HandleResumeResponse(RTSPClient* client, int resultCode, char* resultString)
+{
+    RtspClient* myClient = static_cast<RtspClient*>(client);
+    myClient->filter->HandleResumeResponse(resultCode, resultString);
+}
+
+void CRtspSource::HandleResumeResponse(int resultCode, char* resultString)
+{
+    delete[] resultString;
+    _remotePause = RemotePause::None;
+
+    if (resultCode == 0)
+    {
+        fprintf(stderr, "Channel(%d) resumed from background\n", _channelId);
+        _health.Resume(timeGetTime());
+        return;
+    }
+
+    // ỰѾڷ˳ʱˣߴ½Ự
+    fprintf(stderr, "Channel(%d) resume failed (%d), reconnecting\n", _channelId, resultCode);
+    if (_interPacketGapCheckTimerTask != nullptr)
+        _scheduler->unscheduleDelayedTask(_interPacketGapCheckTimerTask);
+    if (_livenessCommandTask != nullptr)
+        _scheduler->unscheduleDelayedTask(_livenessCommandTask);
+    if (_autoReconnectionMSecs == 0)
+    {
+        _h265MediaPacketQueue.push(MediaPacketSample());
+        _aacMediaPacketQueue.push(MediaPacketSample());
+        return;
+    }
+    if (_h265Pin)
+        _h265Pin->ResetTimeBaselines();
+    if (_aacPin)
+        _aacPin->ResetTimeBaselines();
+    ScheduleReconnectTask();
+}
+
 /*
  * Task:_livenessCommandTask:
  * Periodically requests OPTION command to the server to keep alive the session
@@ -818,6 +1322,13 @@ void CRtspSource::SendLivenessCommand(void* clientData)
     _ASSERT(self->_state == State::Playing);
 
     self->_livenessCommandTask = nullptr;
+    // յRTCP SR˵ӺͻỰţҲǵRRٷOPTIONS
+    if (self->_health.IsRtcpFresh(self->_sessionTimeout / 3 * 1000))
+    {
+        self->_livenessCommandTask = self->_scheduler->scheduleDelayedTask(
+            self->_sessionTimeout / 3 * 1000000, &CRtspSource::SendLivenessCommand, self);
+        return;
+    }
     self->_rtsp->sendOptionsCommand(HandleOptionsResponse_Liveness, &self->_authenticator);
 }
 
@@ -859,6 +1370,16 @@ void CRtspSource::Reconnect()
     _ASSERT(_state == State::Playing || _state == State::Reconnecting);
     _reconnectionTimerTask = nullptr;
 
+    // ȼ߻ȴͨռţԺ롣
+    if (_reconnectLimiter && !_reconnectLimiter->TryAcquire(_channelId, timeGetTime()))
+    {
+        _reconnectionTimerTask = _scheduler->scheduleDelayedTask(
+            (reconnectPollTime + our_random32() % (reconnectPollTime / 2)) * 1000, &CRtspSource::Reconnect, this);
+        return;
+    }
+
+    _health.NoteReconnect();
+
     // Called from worker thread as a delayed task
     fprintf(stderr,"Reconnect now!\n");
     AsyncReconnect();
@@ -932,6 +1453,12 @@ void CRtspSource::WorkerThread()
                 req.SetValue(RtspSource::WrongState);
                 break;
 
+            // Not streaming - next Run() opens the new url
+            case RtspSource::Switch:
+                _rtspUrl = req.GetArg();
+                req.SetValue(RtspSource::Success);
+                break;
+
             case RtspSource::Stop:
                 // Needed if filter is re-started and fails to start running for some reason
                 // and also output pins threads are already started and waiting for packets.
@@ -958,16 +1485,31 @@ void CRtspSource::WorkerThread()
                 req.SetValue(RtspSource::WrongState);
                 break;
 
+            // Session is set up but not playing - switch once Play() starts streaming
+            case RtspSource::Switch:
+                _pendingSwitchUrl = req.GetArg();
+                req.SetValue(RtspSource::Success);
+                break;
+
             // Start media streaming
             case RtspSource::Play:
                 _currentRequest = std::move(req);
                 _state = State::Playing;
                 Play();
+                if (!_pendingSwitchUrl.empty()) {
+                    if (_sessionDuration <= 0) // VoD֧л
+                        OpenStandby(_pendingSwitchUrl);
+                    _pendingSwitchUrl.clear();
+                }
                 break;
 
             // Back down from streaming - close media session and its sink(s)
             case RtspSource::Stop:
                 _currentRequest = std::move(req);
+                if (!_pendingSwitchUrl.empty()) {
+                    _rtspUrl = _pendingSwitchUrl; // Initial״̬һ£´ȡʹURL
+                    _pendingSwitchUrl.clear();
+                }
                 Shutdown();
                 break;
 
@@ -988,10 +1530,21 @@ void CRtspSource::WorkerThread()
                 req.SetValue(RtspSource::WrongState);
                 break;
 
+            // Switch to another stream of the same source at its next IRAP
+            case RtspSource::Switch:
+                if (_sessionDuration > 0) {
+                    req.SetValue(RtspSource::WrongState); // VoD֧л
+                    break;
+                }
+                OpenStandby(req.GetArg());
+                req.SetValue(RtspSource::Success);
+                break;
+
             // Try to reconnect
             case RtspSource::Reconnect:
                 _currentRequest = std::move(req);
                 _state = State::Reconnecting;
+                CloseStandby();
                 UnscheduleAllDelayedTasks();
                 CloseSession();
                 CloseClient();
@@ -1029,6 +1582,12 @@ void CRtspSource::WorkerThread()
                 OpenUrl(_rtspUrl);
                 break;
 
+            // Next reconnect attempt uses the new url
+            case RtspSource::Switch:
+                _rtspUrl = req.GetArg();
+                req.SetValue(RtspSource::Success);
+                break;
+
             // Giveup trying to reconnect
             case RtspSource::Stop:
                 _currentRequest = std::move(req);
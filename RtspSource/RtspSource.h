@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
 #include "ConcurrentQueue.h"
 #include "RtspAsyncRequest.h"
 #include "MediaPacketSample.h"
 #include "IRtspSource.h"
+#include "SyncGroup.h"
+#include "RtspRelay.h"
+#include "ReconnectLimiter.h"
+#include "ReplayBuffer.h"
+#include "StreamHealth.h"
 
 class RtspSourcePin;
 class RtspH265SourcePin;
@@ -26,6 +32,15 @@ public:
         Reconnecting
     };
 
+    // ̨ͨĻỰRTSP PAUSEͣ״ֻ̬live555߳зʡ
+    enum class RemotePause
+    {
+        None,
+        Pausing,
+        Paused,
+        Resuming
+    };
+
     static CUnknown* WINAPI CreateInstance(IUnknown* pUnk, HRESULT* phr);
 
     CRtspSource(IUnknown* pUnk, HRESULT* phr);
@@ -52,7 +67,17 @@ public:
     STDMETHODIMP_(void) SetLatency(DWORD dwMSecs);
     STDMETHODIMP_(void) SetSendLivenessCommand(BOOL sendLiveness);
     STDMETHODIMP_(void) SetNotifyReceiver(RtspSource::INotify* receiver);
+    STDMETHODIMP_(void) SetAudioMute(BOOL mute);
+    STDMETHODIMP_(void) SetSyncGroup(CSyncGroup* group);
+    STDMETHODIMP_(void) SetRelay(CRtspRelay* relay);
+    STDMETHODIMP_(void) SetReconnectLimiter(CReconnectLimiter* limiter);
+    STDMETHODIMP_(void) SetReplayBuffer(CReplayBuffer* replay);
+    STDMETHODIMP_(void) SetVideoMode(RtspSource::VideoMode mode);
+    STDMETHODIMP_(void) SetIdlePauseDelay(DWORD dwMSecs);
+    STDMETHODIMP_(void) SetStreamingPriority(int priority);
+    STDMETHODIMP_(void) GetHealth(RtspSource::Health* health);
     STDMETHOD(OpenURL(PCWSTR url, PCWSTR userName, PCWSTR password));
+    STDMETHOD(SwitchURL(PCWSTR url));
 
     void Fire_AvgFrameIntervalChanged(DWORD frameInterval);
 
@@ -92,6 +117,9 @@ private:
     RtspFutureResult AsyncReconnect() {
         return PostAsyncRequest(RtspSource::Reconnect, "");
     }
+    RtspFutureResult AsyncSwitch(const std::string& url) {
+        return PostAsyncRequest(RtspSource::Switch, url);
+    }
 
     // live555 schedulerִ߳еķ
     void OpenUrl(const std::string& url);
@@ -102,14 +130,33 @@ private:
     void CloseClient();
     void SetupSubsession();
     bool ScheduleNextReconnect();
+    void ScheduleReconnectTask();
+    void ReleaseReconnectSlot();
     void DescribeRequestTimeout();
     void UnscheduleAllDelayedTasks();
+    void StartSessionTimers();
+    void PrepareRtpSource(MediaSubsession& subsession);
+    void CloseMediaSession(class RtspClient* rtsp);
+    bool UpdateIdlePause(DWORD now);
+
+    // лûỰͬһlive555߳ｨյIRAPȡǰỰ
+    void OpenStandby(const std::string& url);
+    void SetupStandbySubsession();
+    void PromoteStandby();
+    void CloseStandby();
 
     // Thin proxies for real handlers
     static void HandleOptionsResponse_Liveness(RTSPClient* client, int resultCode, char* resultString);
     static void HandleDescribeResponse(RTSPClient* client, int resultCode, char* resultString);
     static void HandleSetupResponse(RTSPClient* client, int resultCode, char* resultString);
     static void HandlePlayResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandlePauseResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandleResumeResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandleStandbyDescribeResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandleStandbySetupResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandleStandbyPlayResponse(RTSPClient* client, int resultCode, char* resultString);
+    static void HandleStandbyReady(void* clientData);
+    static void StandbyTimeout(void* clientData);
 
     // Called when a stream's subsession (e.g., audio or video substream) ends
     static void HandleSubsessionFinished(void* clientData);
@@ -128,6 +175,11 @@ private:
     void HandleDescribeResponse(int resultCode, char* resultString);
     void HandleSetupResponse(int resultCode, char* resultString);
     void HandlePlayResponse(int resultCode, char* resultString);
+    void HandlePauseResponse(int resultCode, char* resultString);
+    void HandleResumeResponse(int resultCode, char* resultString);
+    void HandleStandbyDescribeResponse(int resultCode, char* resultString);
+    void HandleStandbySetupResponse(int resultCode, char* resultString);
+    void HandleStandbyPlayResponse(int resultCode, char* resultString);
     void CheckInterPacketGaps();
 
     void WorkerThread();
@@ -135,6 +187,10 @@ private:
 private:
     int _channelId = -1;
     RtspSource::INotify* _notifyReceiver = nullptr;
+    CSyncGroup* _syncGroup = nullptr; // weak_ptrС
+    CRtspRelay* _relay = nullptr; // weak_ptrС
+    CReconnectLimiter* _reconnectLimiter = nullptr; // weak_ptrС
+    CReplayBuffer* _replayBuffer = nullptr; // weak_ptrС
     RtspH265SourcePin* _h265Pin = nullptr;
     RtspAACSourcePin* _aacPin = nullptr;
     MediaPacketQueue _h265MediaPacketQueue;
@@ -142,10 +198,19 @@ private:
 
     bool _streamOverTcp;
     uint16_t _tunnelOverHttpPort;
-    uint32_t _autoReconnectionMSecs;
+    uint32_t _autoReconnectionMSecs; // ˱ܵĻ׼
+    unsigned _reconnectAttempts = 0; // ʧܵһε˱ʱ䡣ֻlive555߳зʡ
     std::mutex _criticalSection;
     uint32_t _latencyMSecs;
     bool _sendLivenessCommand;
+    std::atomic<bool> _audioMuted; // ʱƵlive555ֱ߳ӶС
+    std::atomic<bool> _audioResync; // ƵPin½ʱߡ
+    std::atomic<int> _videoMode; // RtspSource::VideoModeƵsinklive555߳̾ݴ˶
+    std::atomic<unsigned> _droppedNalus{ 0 }; // ƵPin򳬹޶NALU
+    DWORD _idlePauseMSecs = 0; // ҾôúRTSP PAUSE0ʾ͡
+    RemotePause _remotePause = RemotePause::None;
+    DWORD _idleSince = 0; // ʼRTSP PAUSEʱ䣬0ʾ㡣
+    bool _pauseRefused = false; // ܾPAUSEλỰٳԡ
 
     volatile State _state;
 
@@ -161,7 +226,8 @@ private:
     std::string _rtspUrl;
 
     uint32_t _sessionTimeout;
-    uint32_t _totNumPacketsReceived;
+    CStreamHealth _health;
+    DWORD _lastHealthLogTime = 0;
     TaskToken _interPacketGapCheckTimerTask;
     TaskToken _reconnectionTimerTask;
     TaskToken _firstCallTimeoutTask;
@@ -169,6 +235,11 @@ private:
     TaskToken _sessionTimerTask;
 
     class RtspClient* _rtsp;
+    class RtspClient* _standby = nullptr; // ȴIRAPıỰлɺΪ_rtsp
+    std::string _standbyUrl;
+    std::string _pendingSwitchUrl; // Ựѽδʱյл󣬿ʼźٽûỰ
+    int _numStandbySubsessions = 0;
+    TaskToken _standbyTimeoutTask = nullptr;
     int _numSubsessions;
 
     double _sessionDuration;
@@ -4,6 +4,8 @@
 #include "MediaPacketSample.h"
 #include "ConcurrentQueue.h"
 #include "H265StreamParser.h"
+#include "IMediaSideData.h"
+#include "MediaSampleSideData.h"
 
 const int constNALUStartCodesSize = 4;
 
@@ -163,13 +165,35 @@ HRESULT GetMediaTypeAAC(CMediaType& mediaType, MediaSubsession& mediaSubsession)
 }
 
 // Works only for H264/AVC1 || H265/HEVC
+// H.265 NALU头两个字节：forbidden_zero_bit(1) nal_unit_type(6) nuh_layer_id(6) nuh_temporal_id_plus1(3)
+inline int H265NaluType(const MediaPacketSample& mediaPacket)
+{
+    return (mediaPacket.data()[0] >> 1) & 0x3F;
+}
+
+// IRAP图像(BLA/IDR/CRA，类型16~23)是随机访问点。
 bool IsIdrFrame(const MediaPacketSample& mediaPacket)
 {
-    const uint8_t* data = mediaPacket.data();
-    // Take 5 LSBs and compare with 5 (IDR)
-    // More NAL types:
-    // http://gentlelogic.blogspot.com/2011/11/exploring-h264-part-2-h264-bitstream.html
-    return (data[0] & 0x1F) == 5;
+    if (mediaPacket.size() < 2)
+        return false;
+    int type = H265NaluType(mediaPacket);
+    return type >= 16 && type <= 23;
+}
+
+// 判断mediaPacket是否开始了一个新的访问单元，curTimestamp为当前访问单元的时间戳，
+// curHasVcl表示当前访问单元是否已经包含了图像的条带数据(VCL NALU)。
+// 参见H.265 7.4.2.4.4节：VCL NALU之后出现的VPS/SPS/PPS/AUD/前缀SEI等，属于下一个访问单元。
+bool IsNewAccessUnit(const MediaPacketSample& mediaPacket, int64_t curTimestamp, bool curHasVcl)
+{
+    if (mediaPacket.timestamp() != curTimestamp)
+        return true;
+    if (!curHasVcl || mediaPacket.size() < 3)
+        return false;
+
+    int type = H265NaluType(mediaPacket);
+    if (type < 32) // VCL NALU, first_slice_segment_in_pic_flag是条带头的第一个比特。
+        return (mediaPacket.data()[2] & 0x80) != 0;
+    return (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
 }
 
 
@@ -179,9 +203,17 @@ bool IsIdrFrame(const MediaPacketSample& mediaPacket)
 HRESULT RtspSourcePin::OnThreadCreate()
 {
     fprintf(stderr, "%S pin: %s\n", m_pName, __FUNCTION__);
+    ::SetThreadPriority(::GetCurrentThread(), _streamingPriority);
     return __super::OnThreadCreate();
 }
 
+void RtspSourcePin::SetStreamingPriority(int priority)
+{
+    _streamingPriority = priority;
+    if (ThreadExists())
+        ::SetThreadPriority(m_hThread, priority);
+}
+
 HRESULT RtspSourcePin::OnThreadDestroy()
 {
     fprintf(stderr, "%S pin: %s\n", m_pName, __FUNCTION__);
@@ -203,6 +235,8 @@ void RtspSourcePin::ResetTimeBaselines()
     _rtpPresentationTimeBaseline = 0;
     _streamTimeBaseline = 0;
     _currentPlayTime = 0;
+    _clockSkew.Reset();
+    _lastPresentationTime = 0;
 }
 
 REFERENCE_TIME RtspSourcePin::SynchronizeTimestamp(const MediaPacketSample& mediaSample)
@@ -235,22 +269,72 @@ REFERENCE_TIME RtspSourcePin::SynchronizeTimestamp(const MediaPacketSample& medi
     return mediaSample.timestamp() - _rtpPresentationTimeBaseline + _streamTimeBaseline;
 }
 
-REFERENCE_TIME RtspSourcePin::SynchronizeTimestamp2()
+// 视频的呈现时间由RTP时间戳换算到本地timeGetTime()时间轴（毫秒），渲染器按此时间呈现。
+// live555在收到RTCP SR之前按本地墙钟外推RTP时间戳，之后换算为发送端的NTP时间，
+// 两者之间会有一次跳变，此时重新建立偏移基线。
+// 呈现时间 = 发送端时间 - 时钟偏移 + 目标延迟。
+// 目标延迟取通道设置的延迟与三倍到达抖动中的较大者，并限制在[MIN_TARGET_LATENCY_MS, MAX_TARGET_LATENCY_MS]内。
+REFERENCE_TIME RtspSourcePin::SynchronizeRtpTimestamp(int64_t timestamp, DWORD arrivalTime, bool isRtcpSynced)
 {
-    if (_firstSample)
-    {
-        _firstSample = false;
-        _rtcpSynced = true; // 无需RTCP时钟同步机制，以本机呈现时钟为准。
-        _streamTimeBaseline = timeGetTime();
-        DWORD delayMS = static_cast<CRtspSource*>(m_pFilter)->_latencyMSecs;
-        _rtpPresentationTimeBaseline = _streamTimeBaseline + delayMS;
+    int64_t senderMs = timestamp / 10000;
+    int64_t arrivalMs = arrivalTime;
+
+    CRtspSource* filter = static_cast<CRtspSource*>(m_pFilter);
+    if (_firstSample) {
+        // 记录第一个访问单元对应的流时间，FillBuffer据此计算当前播放时长（断线重连时续播的位置）。
+        CRefTime streamTime;
+        m_pFilter->StreamTime(streamTime);
+        _streamTimeBaseline = streamTime.GetUnits() + filter->_latencyMSecs * 10000i64;
     }
-    else {
-        VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)_mediaType.Format();
-        DWORD dynamicFrameIntervalMS = (DWORD)(vih2->AvgTimePerFrame / 10000);
-        _rtpPresentationTimeBaseline += dynamicFrameIntervalMS;
+    if (_firstSample || (!_rtcpSynced && isRtcpSynced))
+        _clockSkew.Reset();
+    _firstSample = false;
+    _rtcpSynced = isRtcpSynced;
+
+    int64_t offset = _clockSkew.Update(senderMs, arrivalMs);
+
+    int64_t latency = filter->_latencyMSecs;
+    latency = max(latency, 3 * _clockSkew.Jitter());
+    latency = min(max(latency, (int64_t)MIN_TARGET_LATENCY_MS), (int64_t)MAX_TARGET_LATENCY_MS);
+    int64_t maxLatency = MAX_TARGET_LATENCY_MS;
+
+    // 只有经过RTCP同步的时间戳才是发送端的NTP时间，才能与其它通道对齐。
+    int64_t groupOffset = 0;
+    int64_t groupLatency = 0;
+    if (filter->_syncGroup && _rtcpSynced
+        && filter->_syncGroup->Update(filter->_channelId, offset, latency, (DWORD)arrivalMs, &groupOffset, &groupLatency)) {
+        offset = groupOffset;
+        latency = groupLatency;
+        maxLatency += CSyncGroup::MAX_EXTRA_LATENCY_MS;
     }
-    return _rtpPresentationTimeBaseline;
+
+    // 呈现时间不早于到达时间，不晚于到达时间加上延迟上限，并保持单调递增。
+    int64_t pts = senderMs - offset + latency;
+    pts = min(max(pts, arrivalMs), arrivalMs + maxLatency);
+    if (_lastPresentationTime != 0 && pts <= _lastPresentationTime && _lastPresentationTime - pts < ClockSkewEstimator::RESYNC_THRESHOLD_MS)
+        pts = _lastPresentationTime + 1;
+    _lastPresentationTime = pts;
+
+    return pts;
+}
+
+int64_t ClockSkewEstimator::Update(int64_t senderMs, int64_t localMs)
+{
+    int64_t d = senderMs - localMs;
+    if (!_valid || _abs64(d - Offset()) > RESYNC_THRESHOLD_MS) {
+        _valid = true;
+        _offsetQ8 = d << 8;
+        _jitterQ4 = 0;
+        return d;
+    }
+
+    int64_t e = (d << 8) - _offsetQ8;
+    if (e > 0)
+        _offsetQ8 += e / 8; // 时延变小，快速跟上。
+    else
+        _offsetQ8 += e / 256; // 时延变大或时钟漂移，缓慢跟随。
+    _jitterQ4 += _abs64(e >> 8) - ((_jitterQ4 + 8) >> 4);
+    return Offset();
 }
 
 HRESULT RtspSourcePin::GetMediaType(CMediaType* pMediaType)
@@ -283,6 +367,11 @@ void RtspH265SourcePin::ResetMediaSubsession(MediaSubsession* mediaSubsession)
 { 
     _mediaSubsession = mediaSubsession; 
     HRESULT hr = GetMediaTypeH265(_mediaType, *_mediaSubsession);
+    ApplyMediaType();
+}
+
+void RtspH265SourcePin::ApplyMediaType()
+{
     {
         VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)_mediaType.Format();
         _initAvgTimePerFrame = vih2->AvgTimePerFrame;
@@ -292,6 +381,138 @@ void RtspH265SourcePin::ResetMediaSubsession(MediaSubsession* mediaSubsession)
     _sendMediaType = true;
 }
 
+void RtspH265SourcePin::PrepareStreamSwitch(MediaSubsession* mediaSubsession)
+{
+    std::lock_guard<std::mutex> lock(_switchLock);
+    _switchSubsession = mediaSubsession;
+    GetMediaTypeH265(_switchMediaType, *mediaSubsession);
+}
+
+// 推流线程调用：取到了码流切换点的包，之后的包都属于新码流。
+// 新码流的RTP时间戳与旧码流无关，重新建立时间基线；首个样本前面会重新附上新码流的参数集。
+void RtspH265SourcePin::ApplyStreamSwitch()
+{
+    {
+        std::lock_guard<std::mutex> lock(_switchLock);
+        _mediaSubsession = _switchSubsession;
+        _mediaType = _switchMediaType;
+    }
+    ApplyMediaType();
+    ResetTimeBaselines();
+    _auStart = true;
+    _pendingNalu.setSwitchPoint(false);
+}
+
+// Append VPS SPS and PPS (they come out-band), returns the number of bytes copied
+long RtspH265SourcePin::CopyParameterSets(BYTE* pData, long length)
+{
+    // Retrieve them from media type format buffer
+    BYTE* decoderSpecific = (BYTE*)(((VIDEOINFOHEADER2*)_mediaType.Format()) + 1);
+    ULONG decoderSpecificLength = _mediaType.FormatLength() - sizeof(VIDEOINFOHEADER2);
+    memcpy_s(pData, length, decoderSpecific, decoderSpecificLength);
+    return (long)decoderSpecificLength;
+}
+
+HRESULT RtspH265SourcePin::OnThreadStartPlay()
+{
+    _auStart = true;
+    _auTimestamp = 0;
+    _pendingNalu = MediaPacketSample();
+    _endOfStream = false;
+    return __super::OnThreadStartPlay();
+}
+
+// 在取下一个空样本之前调整分配器的缓冲区大小：此时我们手上没有样本，
+// 只要下游也已经归还了全部样本，就可以安全地重新分配。
+HRESULT RtspH265SourcePin::GetDeliveryBuffer(IMediaSample** ppSample, REFERENCE_TIME* pStartTime, REFERENCE_TIME* pEndTime, DWORD dwFlags)
+{
+    if (_auStart && m_pAllocator && _maxAuSize + ALLOCATOR_BUF_PADDING > _bufferSize && _bufferSize < ALLOCATOR_BUF_MAX_SIZE)
+        GrowAllocator();
+    return __super::GetDeliveryBuffer(ppSample, pStartTime, pEndTime, dwFlags);
+}
+
+HRESULT RtspH265SourcePin::GrowAllocator()
+{
+    ALLOCATOR_PROPERTIES request, actual;
+    HRESULT hr = m_pAllocator->GetProperties(&request);
+    if (FAILED(hr))
+        return hr;
+
+    // 按观察到的最大访问单元预留50%余量，以64KB为粒度，避免频繁重新分配。
+    long size = _maxAuSize + _maxAuSize / 2 + ALLOCATOR_BUF_PADDING;
+    size = (size + 0xFFFF) & ~0xFFFF;
+    request.cbBuffer = min(size, (long)ALLOCATOR_BUF_MAX_SIZE);
+    if (request.cbBuffer <= _bufferSize)
+        return S_FALSE; // 已经到达上限，超大的访问单元分片传送。
+
+    m_pAllocator->Decommit();
+    hr = m_pAllocator->SetProperties(&request, &actual);
+    if (SUCCEEDED(hr)) {
+        _bufferSize = actual.cbBuffer;
+        DbgLog((LOG_TRACE, 10, L"%s pin: sample buffer grows to %ld bytes", m_pName, actual.cbBuffer));
+    }
+    // 下游还持有样本时SetProperties会失败，恢复原有缓冲区，等下一个访问单元再试。
+    HRESULT hrCommit = m_pAllocator->Commit();
+    return FAILED(hrCommit) ? hrCommit : hr;
+}
+
+HRESULT RtspH265SourcePin::InitAllocator(IMemAllocator** ppAlloc)
+{
+    CheckPointer(ppAlloc, E_POINTER);
+
+    HRESULT hr = S_OK;
+    CMediaSampleSideDataAllocator* pAlloc = new CMediaSampleSideDataAllocator(L"RtspH265Allocator", nullptr, &hr);
+    if (!pAlloc)
+        return E_OUTOFMEMORY;
+    if (FAILED(hr)) {
+        delete pAlloc;
+        return hr;
+    }
+    return pAlloc->QueryInterface(IID_IMemAllocator, (void**)ppAlloc);
+}
+
+// 优先使用我们自己的分配器，样本才能携带访问单元的边界信息(IMediaSideData)，
+// 下游解码器据此跳过HEVC parser，直接把完整的访问单元送入解码器。
+// 下游若不接受，再退回到默认的协商流程。
+HRESULT RtspH265SourcePin::DecideAllocator(IMemInputPin* pPin, IMemAllocator** ppAlloc)
+{
+    CheckPointer(pPin, E_POINTER);
+    CheckPointer(ppAlloc, E_POINTER);
+
+    ALLOCATOR_PROPERTIES prop;
+    ZeroMemory(&prop, sizeof(prop));
+    pPin->GetAllocatorRequirements(&prop);
+    if (prop.cbAlign == 0)
+        prop.cbAlign = 1;
+
+    HRESULT hr = InitAllocator(ppAlloc);
+    if (SUCCEEDED(hr)) {
+        hr = DecideBufferSize(*ppAlloc, &prop);
+        if (SUCCEEDED(hr)) {
+            hr = pPin->NotifyAllocator(*ppAlloc, FALSE);
+            if (SUCCEEDED(hr))
+                return S_OK;
+        }
+        SAFE_RELEASE(*ppAlloc);
+    }
+
+    return __super::DecideAllocator(pPin, ppAlloc);
+}
+
+void RtspH265SourcePin::SetAccessUnitSideData(IMediaSample* pSample, bool auStart, bool auEnd)
+{
+    IMediaSideData* pSideData = nullptr;
+    if (FAILED(pSample->QueryInterface(__uuidof(IMediaSideData), (void**)&pSideData)))
+        return; // 下游提供的分配器，不支持附带边信息，解码器只能自己用parser切分码流。
+
+    MediaSideDataAccessUnit au = { 0 };
+    au.au_start = auStart ? 1 : 0;
+    au.au_end = auEnd ? 1 : 0;
+    au.padding = ALLOCATOR_BUF_PADDING;
+    pSideData->SetSideData(IID_MediaSideDataAccessUnit, (const BYTE*)&au, sizeof(au));
+    SAFE_RELEASE(pSideData);
+}
+
 HRESULT RtspH265SourcePin::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pRequest)
 {
     CheckPointer(pAlloc, E_POINTER);
@@ -302,7 +523,7 @@ HRESULT RtspH265SourcePin::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PRO
         // Ensure a minimum number of buffers
         if (pRequest->cBuffers == 0)
             pRequest->cBuffers = ALLOCATOR_BUF_COUNT;
-        pRequest->cbBuffer = ALLOCATOR_BUF_SIZE; // Should be more than enough
+        pRequest->cbBuffer = ALLOCATOR_BUF_SIZE + ALLOCATOR_BUF_PADDING; // Should be more than enough
     }
 
     ALLOCATOR_PROPERTIES Actual;
@@ -312,45 +533,144 @@ HRESULT RtspH265SourcePin::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PRO
     // Is this allocator unsuitable?
     if (Actual.cbBuffer < pRequest->cbBuffer)
         return E_FAIL;
+    _bufferSize = Actual.cbBuffer;
     return S_OK;
 }
 
 HRESULT RtspH265SourcePin::FillBuffer(IMediaSample* pSample)
 {
-    MediaPacketSample mediaSample;
-    _mediaPacketQueue->pop(mediaSample);
-    if (mediaSample.invalid())
+    if (_endOfStream)
     {
         fprintf(stderr, "%S pin: End of streaming!\n", m_pName);
         return S_FALSE;
     }
 
-    BYTE* pData;
-    HRESULT hr = pSample->GetPointer(&pData);
+    BYTE* pBuffer;
+    HRESULT hr = pSample->GetPointer(&pBuffer);
     if (FAILED(hr))
         return hr;
-    long length = pSample->GetSize();
+    BYTE* pData = pBuffer;
+    long length = pSample->GetSize() - ALLOCATOR_BUF_PADDING;
+    bool discontinuity = false;
+
+    // 上一个样本在码流切换点前结束，切换点的包留在了_pendingNalu中。
+    if (_pendingNalu.isSwitchPoint())
+    {
+        ApplyStreamSwitch();
+        discontinuity = true;
+    }
 
     // Append VPS SPS and PPS to the first packet (they come out-band)
     if (_firstSample)
     {
-        // Retrieve them from media type format buffer
-        BYTE* decoderSpecific = (BYTE*)(((VIDEOINFOHEADER2*)_mediaType.Format()) + 1);
-        ULONG decoderSpecificLength = _mediaType.FormatLength() - sizeof(VIDEOINFOHEADER2);
-        memcpy_s(pData, length, decoderSpecific, decoderSpecificLength);
-        pData += decoderSpecificLength;
-        length -= decoderSpecificLength;
+        long copied = CopyParameterSets(pData, length);
+        pData += copied;
+        length -= copied;
+    }
+
+    // 把同一个访问单元(AU)的所有NALU聚合到一个样本中，每个NALU前面加上4字节的起始码。
+    // 遇到RTP的marker位，或者下一个NALU属于新的访问单元时结束；
+    // 访问单元比样本缓冲区还大时，先送出已经装入的部分，剩余的NALU放到下一个样本中。
+    bool auEnd = false;
+    bool syncPoint = false;
+    int naluCount = 0;
+    while (!auEnd)
+    {
+        if (_pendingNalu.invalid())
+        {
+            _mediaPacketQueue->pop(_pendingNalu);
+            if (_pendingNalu.invalid())
+            {
+                _endOfStream = true;
+                if (naluCount == 0)
+                {
+                    fprintf(stderr, "%S pin: End of streaming!\n", m_pName);
+                    return S_FALSE;
+                }
+                auEnd = true; // 先把手上已经聚合的部分送出去。
+                break;
+            }
+
+            // 码流切换点：旧码流已聚合的部分先送出去，新码流从下一个样本开始；
+            // 样本里还没有NALU时，丢掉已附上的旧参数集，就地切换。
+            if (_pendingNalu.isSwitchPoint())
+            {
+                if (naluCount > 0)
+                {
+                    auEnd = true;
+                    break;
+                }
+                ApplyStreamSwitch();
+                discontinuity = true;
+                pData = pBuffer;
+                length = pSample->GetSize() - ALLOCATOR_BUF_PADDING;
+                long copied = CopyParameterSets(pData, length);
+                pData += copied;
+                length -= copied;
+            }
+        }
+
+        const MediaPacketSample& nalu = _pendingNalu;
+        if (_auStart && naluCount == 0)
+        {
+            _auTimestamp = nalu.timestamp();
+            _auArrivalTime = nalu.arrivalTime();
+            _auRtcpSynced = nalu.isRtcpSynced();
+            _auHasVcl = false;
+            _auSize = 0;
+        }
+        else if (IsNewAccessUnit(nalu, _auTimestamp, _auHasVcl))
+        {
+            auEnd = true; // 上一个访问单元丢失了marker位，靠时间戳或条带头来切分。
+            break;
+        }
+
+        long naluLength = constNALUStartCodesSize + (long)nalu.size();
+        if (naluLength > length)
+        {
+            if (naluCount > 0 || pData != pBuffer)
+                break; // 样本已装满，访问单元剩余的NALU下次再送。
+
+            // 空样本也装不下这个NALU，只能丢弃，并让分配器在下一个访问单元之前扩大缓冲区。
+            // 丢弃次数通过GetHealth()报告给上层。
+            DbgLog((LOG_TRACE, 10, L"%s pin: drop %u bytes NALU, too large for sample buffer", m_pName, (unsigned)nalu.size()));
+            static_cast<CRtspSource*>(m_pFilter)->_droppedNalus++;
+            _maxAuSize = max(_maxAuSize, naluLength);
+            _pendingNalu = MediaPacketSample();
+            continue;
+        }
+
+        // Append 4-byte start code 00 00 00 01 in network byte order that precedes each NALU
+        ((uint32_t*)pData)[0] = 0x01000000;
+        pData += constNALUStartCodesSize;
+        length -= constNALUStartCodesSize;
+
+        // Finally copy media packet contens to IMediaSample
+        memcpy_s(pData, length, nalu.data(), nalu.size());
+        pData += nalu.size();
+        length -= (long)nalu.size();
+
+        syncPoint = syncPoint || IsIdrFrame(nalu);
+        _auHasVcl = _auHasVcl || H265NaluType(nalu) < 32;
+        _auSize += naluLength;
+        auEnd = nalu.isMarker();
+        ++naluCount;
+        _pendingNalu = MediaPacketSample();
     }
 
-    // Append 4-byte start code 00 00 00 01 in network byte order that precedes each NALU
-    ((uint32_t*)pData)[0] = 0x01000000;
-    pData += constNALUStartCodesSize;
-    length -= constNALUStartCodesSize;
+    long actualLength = (long)(pData - pBuffer);
+    memset(pBuffer + actualLength, 0, ALLOCATOR_BUF_PADDING);
+    pSample->SetActualDataLength(actualLength);
+    pSample->SetSyncPoint(syncPoint);
+    if (discontinuity)
+        pSample->SetDiscontinuity(TRUE);
 
-    // Finally copy media packet contens to IMediaSample
-    memcpy_s(pData, length, mediaSample.data(), mediaSample.size());
-    pSample->SetActualDataLength(mediaSample.size() + constNALUStartCodesSize);
-    pSample->SetSyncPoint(IsIdrFrame(mediaSample));
+    // 访问单元的边界随样本一起传给解码器，解码器据此跳过parser。
+    bool auStart = _auStart;
+    SetAccessUnitSideData(pSample, auStart, auEnd);
+    _auStart = auEnd;
+    if (auEnd)
+        _maxAuSize = max(_maxAuSize, _auSize);
 
     // 将最新的媒体类型设置在样本中，传递给下游解码器。
     if (_sendMediaType) {
@@ -358,18 +678,21 @@ HRESULT RtspH265SourcePin::FillBuffer(IMediaSample* pSample)
         _sendMediaType = false;
     }
 
-    // 实时源的时间戳用不着服务器给，来多少帧放多少帧，保证呈现时间间隔均匀平滑即可。
-    REFERENCE_TIME ts = SynchronizeTimestamp2(); // commented by yxs
+    // 呈现时间由访问单元的RTP时间戳换算而来，同一个访问单元的后续分片沿用第一个分片的时间戳。
+    REFERENCE_TIME ts = auStart ? SynchronizeRtpTimestamp(_auTimestamp, _auArrivalTime, _auRtcpSynced) : _lastPresentationTime;
     pSample->SetTime(&ts, NULL);
 #ifdef _DEBUG    
     //fprintf(stderr, "ts=%u\n", (DWORD)ts);
 #endif
 
     // Calculate current play time (does not include offset from initial time seek)
-    CRefTime streamTime;
-    m_pFilter->StreamTime(streamTime);
-    uint32_t latencyMSecs = static_cast<CRtspSource*>(m_pFilter)->_latencyMSecs;
-    _currentPlayTime = streamTime.GetUnits() - (_streamTimeBaseline - latencyMSecs * 10000i64);
+    // 基线在第一个访问单元打时间戳时建立，之前不更新播放时长。
+    if (!_firstSample) {
+        CRefTime streamTime;
+        m_pFilter->StreamTime(streamTime);
+        uint32_t latencyMSecs = static_cast<CRtspSource*>(m_pFilter)->_latencyMSecs;
+        _currentPlayTime = streamTime.GetUnits() - (_streamTimeBaseline - latencyMSecs * 10000i64);
+    }
 
     return S_OK;
 }
@@ -463,6 +786,12 @@ HRESULT RtspAACSourcePin::FillBuffer(IMediaSample* pSample)
         pSample->SetSyncPoint(FALSE);
     }
 
+    // 静音期间的音频包已被丢弃，解除静音后的第一个包重新对齐时间戳基线，并通知下游音频断续。
+    if (static_cast<CRtspSource*>(m_pFilter)->_audioResync.exchange(false)) {
+        _firstSample = true;
+        pSample->SetDiscontinuity(TRUE);
+    }
+
     REFERENCE_TIME ts = SynchronizeTimestamp(mediaSample); // commented by yxs
     pSample->SetTime(&ts, NULL);
 
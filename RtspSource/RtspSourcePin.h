@@ -7,16 +7,44 @@
 #include "MediaPacketSample.h"
 #include "IRtspSource.h"
 
+// Ͷýʱ뱾timeGetTime()ʱ֮ƫƹ
+// ƫ = Ͷʱ - ʱ = ʱӲ - ʱӡʱԽСƫԽ
+// ƫƱʱٸϣСʱֻ棺ֵСʱӶӦƫƣ
+// ʱӵƵƯƣskewգڼСʱۻɻĻӳٶѻ
+class ClockSkewEstimator
+{
+public:
+    enum { RESYNC_THRESHOLD_MS = 1000 }; // ƫֵΪʱ䣨RTCP״ͬ½ߡ
+
+    void Reset() { _valid = false; _offsetQ8 = 0; _jitterQ4 = 0; }
+    bool IsValid() const { return _valid; }
+    // һʱ䣨룩ƽƫƣ룩
+    int64_t Update(int64_t senderMs, int64_t localMs);
+    int64_t Offset() const { return _offsetQ8 >> 8; }
+    // ƽĵﶶ룩㷨ͬRFC 3550 A.8
+    int64_t Jitter() const { return _jitterQ4 >> 4; }
+
+private:
+    bool _valid = false;
+    int64_t _offsetQ8 = 0; // 8λΪС֡
+    int64_t _jitterQ4 = 0; // 4λΪС֡
+};
+
 // TODO:ռ취ϣı˼ع
 // ԣд߼һʵһٷֵĻԡ
 // ֮ͬϹϵþɡ
 class RtspSourcePin : public CSourceStream
 {
 public:
+    enum { MIN_TARGET_LATENCY_MS = 40 }; // Ŀӳٵޣһ֡Ľʱ䡣
+    enum { MAX_TARGET_LATENCY_MS = 400 }; // ĿӳٵޣƵɵ֡൱
+
     RtspSourcePin(LPCTSTR pObjectName, HRESULT* phr, CSource* pms, LPCWSTR pName)
         : CSourceStream(pObjectName, phr, pms, pName) {}
     void ResetTimeBaselines();
     REFERENCE_TIME CurrentPlayTime() const { return _currentPlayTime; }
+    // ˾״̬ڵã̵߳Ĵ˳Ҳ״̬ɡ
+    void SetStreamingPriority(int priority);
 
     HRESULT GetMediaType(CMediaType* pMediaType) override;
     STDMETHODIMP Notify(IBaseFilter* pSelf, Quality q) override { return E_FAIL; }
@@ -26,7 +54,7 @@ protected:
     HRESULT OnThreadDestroy() override;
     HRESULT OnThreadStartPlay() override;
     REFERENCE_TIME SynchronizeTimestamp(const MediaPacketSample& mediaSample);
-    REFERENCE_TIME SynchronizeTimestamp2();
+    REFERENCE_TIME SynchronizeRtpTimestamp(int64_t timestamp, DWORD arrivalTime, bool isRtcpSynced);
 
 protected:
     REFERENCE_TIME _currentPlayTime = 0;
@@ -34,6 +62,9 @@ protected:
     REFERENCE_TIME _streamTimeBaseline = 0;
     bool _firstSample = true;
     bool _rtcpSynced = false;
+    ClockSkewEstimator _clockSkew;
+    REFERENCE_TIME _lastPresentationTime = 0; // һĳʱ䣨timeGetTime()ʱᣬ룩
+    int _streamingPriority = THREAD_PRIORITY_NORMAL; // ̵߳ȼ̴߳ʱЧ
 
     MediaSubsession* _mediaSubsession = nullptr;
     MediaPacketQueue* _mediaPacketQueue = nullptr; // weak_ptr
@@ -46,13 +77,44 @@ protected:
 class RtspH265SourcePin : public RtspSourcePin
 {
 public:
-    enum { ALLOCATOR_BUF_SIZE = 256 * 1024 };
-    enum { ALLOCATOR_BUF_COUNT = 10 }; // ʱ10 * 40ms < 500ms
+    enum { ALLOCATOR_BUF_SIZE = 256 * 1024 }; // ʼС֮󰴹۲쵽ʵԪ
+    enum { ALLOCATOR_BUF_MAX_SIZE = 8 * 1024 * 1024 };
+    enum { ALLOCATOR_BUF_COUNT = 10 }; // ÿһ֡ʱ10 * 40ms < 500ms
+
+    enum { ALLOCATOR_BUF_PADDING = 64 }; // AV_INPUT_BUFFER_PADDING_SIZEһ£ԭضȡ追
 
     RtspH265SourcePin(HRESULT* phr, CSource* pFilter, MediaPacketQueue* mediaPacketQueue);
     void ResetMediaSubsession(MediaSubsession* mediaSubsession);
+    // live555̵߳ãýͣ߳ȡлİʱЧ
+    // δͳľ԰ɵýͺʱͳ
+    void PrepareStreamSwitch(MediaSubsession* mediaSubsession);
+    HRESULT InitAllocator(IMemAllocator** ppAlloc) override;
+    HRESULT DecideAllocator(IMemInputPin* pPin, IMemAllocator** ppAlloc) override;
     HRESULT DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pRequest) override;
+    HRESULT GetDeliveryBuffer(IMediaSample** ppSample, REFERENCE_TIME* pStartTime, REFERENCE_TIME* pEndTime, DWORD dwFlags) override;
     HRESULT FillBuffer(IMediaSample* pSample) override;
+
+protected:
+    HRESULT OnThreadStartPlay() override;
+    HRESULT GrowAllocator();
+    void SetAccessUnitSideData(IMediaSample* pSample, bool auStart, bool auEnd);
+    void ApplyMediaType();
+    void ApplyStreamSwitch();
+    long CopyParameterSets(BYTE* pData, long length);
+
+    bool _auStart = true; // һǷΪһ·ʵԪ(AU)Ŀʼ
+    bool _auHasVcl = false; // ǰʵԪǷѾݡ
+    int64_t _auTimestamp = 0; // ǰʵԪRTPʱ䡣
+    DWORD _auArrivalTime = 0; // ǰʵԪһNALUĵʱ䡣
+    bool _auRtcpSynced = false; // ǰʵԪRTPʱǷѾRTCPͬ
+    long _auSize = 0; // ǰʵԪѾۺϵֽ
+    long _maxAuSize = 0; // ۲쵽ʵԪֽڵĻС
+    long _bufferSize = 0; // ǰС
+    MediaPacketSample _pendingNalu; // ӶȡһʵԪ(һ)NALU
+    bool _endOfStream = false;
+    std::mutex _switchLock;
+    MediaSubsession* _switchSubsession = nullptr; // лӻỰýͣ_switchLock
+    CMediaType _switchMediaType;
 };
 
 class RtspAACSourcePin : public RtspSourcePin
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "StreamHealth.h"
+
+CStreamHealth::CStreamHealth()
+{
+}
+
+void CStreamHealth::Reset(DWORD now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _playing = true;
+    _lastArrival = now;
+    _lastReceived = 0;
+    _gapMean = 0;
+    _gapDev = 0;
+    _gapsLearned = 0;
+    for (int i = 0; i < GAP_WINDOWS; ++i)
+        _windowMaxGap[i] = 0;
+    _gapWindowStart = now;
+    _gapWindowIndex = 0;
+    _threshold = DEFAULT_GAP_THRESHOLD_MS;
+    _lossWindowStart = now;
+    _lossWindowReceived = 0;
+    _lossWindowExpected = 0;
+    _lossPermille = 0;
+    _jitterMs = 0;
+    _srAgeMs = -1;
+    _sampleTime = now;
+}
+
+void CStreamHealth::Stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _playing = false;
+}
+
+void CStreamHealth::Resume(DWORD now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _playing = true;
+    _lastArrival = now;
+    _lossWindowStart = now;
+    _sampleTime = now;
+    _srAgeMs = -1;
+}
+
+void CStreamHealth::Update(DWORD now, const Sample& sample)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_playing)
+        return;
+
+    if (sample.received != _lastReceived) {
+        LearnGap(now, (int)(now - _lastArrival));
+        _lastArrival = now;
+        _lastReceived = sample.received;
+    }
+
+    if (now - _lossWindowStart >= LOSS_WINDOW_MS) {
+        int received = (int)(sample.received - _lossWindowReceived);
+        int expected = (int)(sample.expected - _lossWindowExpected);
+        _lossPermille = expected > 0 ? std::max(0, expected - received) * 1000 / expected : 0;
+        _lossWindowStart = now;
+        _lossWindowReceived = sample.received;
+        _lossWindowExpected = sample.expected;
+    }
+
+    _jitterMs = sample.jitterMs;
+    _srAgeMs = sample.srAgeMs;
+    _sampleTime = now;
+}
+
+// ĬʱRFC 6298ķʽƽalpha=1/8beta=1/4¼ڵĬ
+void CStreamHealth::LearnGap(DWORD now, int gap)
+{
+    if (_gapsLearned == 0) {
+        _gapMean = gap;
+        _gapDev = gap / 2;
+    }
+    else {
+        _gapDev += (std::abs(gap - _gapMean) - _gapDev) / 4;
+        _gapMean += (gap - _gapMean) / 8;
+    }
+    ++_gapsLearned;
+
+    while (now - _gapWindowStart >= GAP_WINDOW_MS) {
+        _gapWindowIndex = (_gapWindowIndex + 1) % GAP_WINDOWS;
+        _windowMaxGap[_gapWindowIndex] = 0;
+        _gapWindowStart += GAP_WINDOW_MS;
+    }
+    _windowMaxGap[_gapWindowIndex] = std::max(_windowMaxGap[_gapWindowIndex], gap);
+
+    int recentMax = 0;
+    for (int i = 0; i < GAP_WINDOWS; ++i)
+        recentMax = std::max(recentMax, _windowMaxGap[i]);
+    int threshold = std::max(_gapMean + 4 * _gapDev, recentMax * 3 / 2);
+    if (_gapsLearned < LEARNING_GAPS)
+        threshold = std::max<int>(threshold, DEFAULT_GAP_THRESHOLD_MS);
+    _threshold = std::min<int>(std::max<int>(threshold, MIN_GAP_THRESHOLD_MS), MAX_GAP_THRESHOLD_MS);
+}
+
+int CStreamHealth::SilenceLimit(DWORD now) const
+{
+    int silence = (int)(now - _lastArrival);
+    int srAge = _srAgeMs >= 0 ? _srAgeMs + (int)(now - _sampleTime) : -1;
+    if (srAge >= 0 && srAge < silence)
+        return MAX_GAP_THRESHOLD_MS;
+    return _threshold;
+}
+
+bool CStreamHealth::IsStalled(DWORD now) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _playing && (int)(now - _lastArrival) > SilenceLimit(now);
+}
+
+bool CStreamHealth::IsRtcpFresh(int maxAgeMs) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _playing && _srAgeMs >= 0 && _srAgeMs <= maxAgeMs;
+}
+
+void CStreamHealth::NoteReconnect()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_reconnects;
+}
+
+// ֣10040֣20%20֣100ms
+// 15ûSR10֣Ĭʱӽֵ30֡δڲʱΪ0֡
+void CStreamHealth::Get(DWORD now, RtspSource::Health* health)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    health->reconnects = _reconnects;
+    health->gapThresholdMs = _threshold;
+    if (!_playing) {
+        health->score = 0;
+        health->lossPermille = 0;
+        health->jitterMs = 0;
+        health->srAgeMs = -1;
+        health->silenceMs = 0;
+        return;
+    }
+
+    int silence = (int)(now - _lastArrival);
+    int limit = SilenceLimit(now);
+    int srAge = _srAgeMs >= 0 ? _srAgeMs + (int)(now - _sampleTime) : -1;
+    int score = 100;
+    score -= std::min(40, _lossPermille / 5);
+    score -= std::min(20, _jitterMs / 5);
+    if (srAge < 0 || srAge > 15000)
+        score -= 10;
+    score -= std::min(30, silence * 30 / std::max(limit, 1));
+
+    health->score = std::max(score, 0);
+    health->lossPermille = _lossPermille;
+    health->jitterMs = _jitterMs;
+    health->srAgeMs = srAge;
+    health->silenceMs = silence;
+}
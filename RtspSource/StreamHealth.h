@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+#include "IRtspSource.h"
+
+//
+// RTSPỰĽ
+// live555̶߳ڰRTCPͳƣۼյ/ӦյİﶶһSRʱ䣩
+// ݴĶʣӵĽѧϰľĬʱ
+// ĬֵȡƽĬ + 4ƫͬTCPRTOƣ롰Ĭ1.5еĽϴߣ
+// [MIN_GAP_THRESHOLD_MS, MAX_GAP_THRESHOLD_MS]֮䡣֡ʵԼ1뼴жߣ
+// ʡʱ侲ֹŷᱻС
+// ĬڼRTCP SRʱ˵ͨģֻûýݣֵſޡ
+// Update/IsStalledlive555߳еãGet̵߳á
+//
+class CStreamHealth
+{
+public:
+    enum { MIN_GAP_THRESHOLD_MS = 1000 };
+    enum { MAX_GAP_THRESHOLD_MS = 10000 };
+    enum { DEFAULT_GAP_THRESHOLD_MS = 4000 }; // ѧϰ㹻ľĬ֮ǰʹõֵԭÿ2һε൱
+    enum { LEARNING_GAPS = 8 };
+    enum { GAP_WINDOW_MS = 15000 }; // Ĭ15һ¼GAP_WINDOWS
+    enum { GAP_WINDOWS = 8 };
+    enum { LOSS_WINDOW_MS = 1000 };
+
+    struct Sample
+    {
+        unsigned received; // ӻỰۼյİ
+        unsigned expected; // ӻỰۼӦյİż㣩
+        int jitterMs; // ӻỰĵﶶ
+        int srAgeMs; // һRTCP SRʱ䣬-1ʾûյ
+    };
+
+    CStreamHealth();
+
+    void Reset(DWORD now);
+    void Stop();
+    // ỰRTSP PAUSEָѧϰľĬࡣ
+    void Resume(DWORD now);
+    void Update(DWORD now, const Sample& sample);
+    bool IsStalled(DWORD now) const;
+    // maxAgeMsյRTCP SRỰҪı
+    bool IsRtcpFresh(int maxAgeMs) const;
+    void NoteReconnect();
+
+    void Get(DWORD now, RtspSource::Health* health);
+
+private:
+    void LearnGap(DWORD now, int gap);
+    int SilenceLimit(DWORD now) const;
+
+    mutable std::mutex _mutex;
+    bool _playing = false;
+    DWORD _lastArrival = 0;
+    unsigned _lastReceived = 0;
+    int _gapMean = 0;
+    int _gapDev = 0;
+    int _gapsLearned = 0;
+    int _windowMaxGap[GAP_WINDOWS] = { 0 };
+    DWORD _gapWindowStart = 0;
+    int _gapWindowIndex = 0;
+    int _threshold = DEFAULT_GAP_THRESHOLD_MS;
+
+    DWORD _lossWindowStart = 0;
+    unsigned _lossWindowReceived = 0;
+    unsigned _lossWindowExpected = 0;
+    int _lossPermille = 0;
+    int _jitterMs = 0;
+    int _srAgeMs = -1;
+    DWORD _sampleTime = 0;
+    unsigned _reconnects = 0;
+};
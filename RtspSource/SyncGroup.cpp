@@ -0,0 +1,104 @@
+#include "stdafx.h"
+#include "SyncGroup.h"
+
+CSyncGroup::CSyncGroup()
+{
+}
+
+void CSyncGroup::SetEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _enabled = enabled;
+    if (!enabled) {
+        for (int i = 0; i < MAX_CHANNELS; ++i)
+            _members[i].active = false;
+    }
+}
+
+bool CSyncGroup::Update(int channel, int64_t offsetMs, int64_t latencyMs, DWORD now,
+                        int64_t* groupOffsetMs, int64_t* groupLatencyMs)
+{
+    if (!_enabled || channel < 0 || channel >= MAX_CHANNELS)
+        return false;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Member& m = _members[channel];
+    m.active = true;
+    m.lastUpdate = now;
+    m.offset = offsetMs;
+    m.latency = latencyMs;
+    Recalculate(now);
+
+    *groupOffsetMs = _groupOffset;
+    *groupLatencyMs = _groupLatency;
+    return true;
+}
+
+void CSyncGroup::Leave(int channel)
+{
+    if (channel < 0 || channel >= MAX_CHANNELS)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _members[channel].active = false;
+}
+
+// ƫȡԱСƫƣʱͨƫСMAX_EXTRA_LATENCY_MS
+// ĿӳȡԱĿӳ١
+void CSyncGroup::Recalculate(DWORD now)
+{
+    bool any = false;
+    int64_t minOffset = 0;
+    int64_t maxOffset = 0;
+    int64_t maxLatency = 0;
+
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        Member& m = _members[i];
+        if (!m.active)
+            continue;
+        if (now - m.lastUpdate > MEMBER_TIMEOUT_MS) {
+            m.active = false;
+            continue;
+        }
+        if (!any) {
+            minOffset = maxOffset = m.offset;
+            maxLatency = m.latency;
+            any = true;
+        }
+        else {
+            minOffset = min(minOffset, m.offset);
+            maxOffset = max(maxOffset, m.offset);
+            maxLatency = max(maxLatency, m.latency);
+        }
+    }
+
+    if (any) {
+        _groupOffset = max(minOffset, maxOffset - (int64_t)MAX_EXTRA_LATENCY_MS);
+        _groupLatency = maxLatency;
+    }
+}
+
+void CSyncGroup::GetStats(ChannelStats stats[MAX_CHANNELS], int* maxSkewMs)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Recalculate(timeGetTime());
+
+    int maxSkew = 0;
+    for (int i = 0; i < MAX_CHANNELS; ++i) {
+        const Member& m = _members[i];
+        ChannelStats& s = stats[i];
+        s.member = _enabled && m.active;
+        s.addedLatencyMs = 0;
+        s.skewMs = 0;
+        if (!s.member)
+            continue;
+        int64_t d = m.offset - _groupOffset;
+        if (d >= 0)
+            s.addedLatencyMs = (int)d;
+        else
+            s.skewMs = (int)-d;
+        maxSkew = max(maxSkew, s.skewMs);
+    }
+    if (maxSkewMs)
+        *maxSkewMs = maxSkew;
+}
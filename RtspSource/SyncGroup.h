@@ -0,0 +1,59 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+
+//
+// ·ǽͬ顣
+// ͬͬһNTPʱԴRTCP SRÿһ·RTPʱӳ䵽NTPʱ
+// ͬһʱ̷¼ͨͬķͶʱ䡣
+// ÿͨԼƳ(NTP - ʱ)ƫƱͬ飬
+// ͬȡʱƫСͨƫΪƫƣͨƫƺ͹Ŀӳٳ֣
+// ʱӽСͨ໺һʱȴʱӽϴͨ
+// ໺ʱ䲻MAX_EXTRA_LATENCY_MSֵͨ޷룬skewʽ
+// з̰߳ȫģɸͨƵPin̵߳á
+//
+class CSyncGroup
+{
+public:
+    enum { MAX_CHANNELS = 16 };
+    enum { MAX_EXTRA_LATENCY_MS = 1000 }; // ΪӵĻӳޡ
+    enum { MEMBER_TIMEOUT_MS = 2000 }; // ʱûиµֹͨͣٲ㡣
+
+    struct ChannelStats
+    {
+        bool member; // Ƿͬ
+        int addedLatencyMs; // Ϊ˶ӵĻӳ١
+        int skewMs; // ޷Ĳ֣ͨȹʱĺ
+    };
+
+    CSyncGroup();
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const { return _enabled; }
+
+    // ͨԼƽƫƺĿӳ٣ȡعƫƺ͹Ŀӳ١
+    // ͬδûͨЧʱfalseͨӦʹԼƫƺӳ١
+    bool Update(int channel, int64_t offsetMs, int64_t latencyMs, DWORD now,
+                int64_t* groupOffsetMs, int64_t* groupLatencyMs);
+    void Leave(int channel);
+
+    void GetStats(ChannelStats stats[MAX_CHANNELS], int* maxSkewMs);
+
+private:
+    void Recalculate(DWORD now);
+
+    struct Member
+    {
+        bool active = false;
+        DWORD lastUpdate = 0;
+        int64_t offset = 0;
+        int64_t latency = 0;
+    };
+
+    std::mutex _mutex;
+    volatile bool _enabled = false;
+    Member _members[MAX_CHANNELS];
+    int64_t _groupOffset = 0;
+    int64_t _groupLatency = 0;
+};
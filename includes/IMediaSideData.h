@@ -156,3 +156,30 @@ DEFINE_GUID(IID_MediaSideDataEIA608CC,
   0x40fefd7f, 0x85dd, 0x4335, 0xa8, 0x4, 0x8a, 0x33, 0xb0, 0xbf, 0x7b, 0x81);
 
 // There is no struct definition. The data is supplied as a list of 3 byte CC data packets (control byte + cc_data1/2)
+
+// -----------------------------------------------------------------
+// Access Unit Side Data
+// -----------------------------------------------------------------
+
+// {3AFF09F5-9634-45C3-8716-AA7D2F3EDCFC}
+DEFINE_GUID(IID_MediaSideDataAccessUnit,
+  0x3aff09f5, 0x9634, 0x45c3, 0x87, 0x16, 0xaa, 0x7d, 0x2f, 0x3e, 0xdc, 0xfc);
+
+#pragma pack(push, 1)
+// Attached by sources which already know the NAL unit and access unit boundaries
+// of the bitstream (ie. from RTP depacketization), so the decoder can skip its parser.
+// The sample payload always consists of complete Annex B NAL units (with start codes).
+struct MediaSideDataAccessUnit
+{
+  // the sample starts a new access unit
+  unsigned int au_start;
+
+  // the sample ends the current access unit
+  // a sample with both au_start and au_end set holds one complete access unit
+  unsigned int au_end;
+
+  // number of zeroed bytes which follow the payload in the sample buffer,
+  // if large enough the decoder can read the sample in-place without copying
+  unsigned int padding;
+};
+#pragma pack(pop)
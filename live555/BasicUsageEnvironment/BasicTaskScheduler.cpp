@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "BasicUsageEnvironment.hh"
 #include "HandlerSet.hh"
 #include <stdio.h>
+#include <string.h>
 #if defined(_QNX4)
 #include <sys/select.h>
 #include <unix.h>
@@ -56,10 +57,90 @@ void BasicTaskScheduler::schedulerTickTask() {
 #define MILLION 1000000
 #endif
 
+void BasicTaskScheduler::copySocketSet(fd_set& to, fd_set const& from) const {
+  // Copy only the part of the set that's in use, rather than the whole (fixed-size) structure.
+  // (On Unix, "select()" and "nextReadyHandler()" never look past the first "fMaxNumSockets" bits.)
+#if defined(__WIN32__) || defined(_WIN32)
+  to.fd_count = from.fd_count;
+  memcpy(to.fd_array, from.fd_array, from.fd_count*sizeof from.fd_array[0]);
+#else
+  size_t const wordSize = sizeof (unsigned long);
+  size_t numBytes = ((fMaxNumSockets + 8*wordSize - 1)/(8*wordSize))*wordSize;
+  if (numBytes > sizeof (fd_set)) numBytes = sizeof (fd_set);
+  memcpy(&to, &from, numBytes);
+#endif
+}
+
+HandlerDescriptor* BasicTaskScheduler
+::nextReadyHandler(fd_set const& readSet, fd_set const& writeSet, fd_set const& exceptionSet, int& resultConditionSet) {
+  HandlerDescriptor* result = NULL;
+#if defined(__WIN32__) || defined(_WIN32)
+  // Winsock's "select()" compacts each set down to just the ready sockets, so walk those arrays.  Of the ready sockets, pick
+  // the lowest-numbered one after "fLastHandledSocketNum", else the lowest-numbered one overall (for forward progress):
+  fd_set const* const sets[3] = { &readSet, &writeSet, &exceptionSet };
+  int const conditions[3] = { SOCKET_READABLE, SOCKET_WRITABLE, SOCKET_EXCEPTION };
+  Boolean resultWrapped = False;
+  for (unsigned s = 0; s < 3; ++s) {
+    for (unsigned i = 0; i < sets[s]->fd_count; ++i) {
+      int sock = (int)sets[s]->fd_array[i];
+      Boolean wrapped = sock <= fLastHandledSocketNum;
+      if (result != NULL
+	  && (wrapped != resultWrapped ? wrapped : sock >= result->socketNum)) continue; // no better than what we have
+
+      HandlerDescriptor* handler = fHandlers->lookupHandler(sock);
+      if (handler == NULL || handler->handlerProc == NULL || (handler->conditionSet&conditions[s]) == 0) continue;
+      result = handler;
+      resultWrapped = wrapped;
+    }
+  }
+  if (result == NULL) return NULL;
+
+  // The result sets are short, so these checks are cheap:
+  int sock = result->socketNum;
+  resultConditionSet = 0;
+  if (FD_ISSET(sock, &readSet)) resultConditionSet |= SOCKET_READABLE;
+  if (FD_ISSET(sock, &writeSet)) resultConditionSet |= SOCKET_WRITABLE;
+  if (FD_ISSET(sock, &exceptionSet)) resultConditionSet |= SOCKET_EXCEPTION;
+  resultConditionSet &= result->conditionSet;
+#else
+  // Scan the bit sets, starting just past the last socket that we handled.  Words with no ready socket in any of the three
+  // sets are skipped whole, and handlers are looked up only for ready sockets:
+  unsigned long const* readBits = (unsigned long const*)&readSet;
+  unsigned long const* writeBits = (unsigned long const*)&writeSet;
+  unsigned long const* exceptionBits = (unsigned long const*)&exceptionSet;
+  int const bitsPerWord = 8*sizeof (unsigned long);
+  int const numSockets = fMaxNumSockets;
+  for (int n = 0; n < numSockets; ++n) {
+    int sock = (fLastHandledSocketNum + 1 + n)%numSockets;
+    int word = sock/bitsPerWord;
+    if ((readBits[word]|writeBits[word]|exceptionBits[word]) == 0) {
+      int toWordEnd = bitsPerWord - sock%bitsPerWord;
+      if (toWordEnd > numSockets - sock) toWordEnd = numSockets - sock;
+      n += toWordEnd - 1;
+      continue;
+    }
+
+    int conditionSet = 0;
+    if (FD_ISSET(sock, &readSet)) conditionSet |= SOCKET_READABLE;
+    if (FD_ISSET(sock, &writeSet)) conditionSet |= SOCKET_WRITABLE;
+    if (FD_ISSET(sock, &exceptionSet)) conditionSet |= SOCKET_EXCEPTION;
+    if (conditionSet == 0) continue;
+
+    HandlerDescriptor* handler = fHandlers->lookupHandler(sock);
+    if (handler == NULL || handler->handlerProc == NULL || (conditionSet&handler->conditionSet) == 0) continue;
+    result = handler;
+    resultConditionSet = conditionSet&handler->conditionSet;
+    break;
+  }
+#endif
+  return result;
+}
+
 void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
-  fd_set readSet = fReadSet; // make a copy for this select() call
-  fd_set writeSet = fWriteSet; // ditto
-  fd_set exceptionSet = fExceptionSet; // ditto
+  fd_set readSet, writeSet, exceptionSet;
+  copySocketSet(readSet, fReadSet); // make a copy for this select() call
+  copySocketSet(writeSet, fWriteSet); // ditto
+  copySocketSet(exceptionSet, fExceptionSet); // ditto
 
   DelayInterval const& timeToDelay = fDelayQueue.timeToNextAlarm();
   struct timeval tv_timeToDelay;
@@ -119,52 +200,15 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
   }
 
   // Call the handler function for one readable socket:
-  HandlerIterator iter(*fHandlers);
-  HandlerDescriptor* handler;
-  // To ensure forward progress through the handlers, begin past the last
-  // socket number that we handled:
-  if (fLastHandledSocketNum >= 0) {
-    while ((handler = iter.next()) != NULL) {
-      if (handler->socketNum == fLastHandledSocketNum) break;
-    }
-    if (handler == NULL) {
-      fLastHandledSocketNum = -1;
-      iter.reset(); // start from the beginning instead
-    }
-  }
-  while ((handler = iter.next()) != NULL) {
-    int sock = handler->socketNum; // alias
-    int resultConditionSet = 0;
-    if (FD_ISSET(sock, &readSet) && FD_ISSET(sock, &fReadSet)/*sanity check*/) resultConditionSet |= SOCKET_READABLE;
-    if (FD_ISSET(sock, &writeSet) && FD_ISSET(sock, &fWriteSet)/*sanity check*/) resultConditionSet |= SOCKET_WRITABLE;
-    if (FD_ISSET(sock, &exceptionSet) && FD_ISSET(sock, &fExceptionSet)/*sanity check*/) resultConditionSet |= SOCKET_EXCEPTION;
-    if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
-      fLastHandledSocketNum = sock;
-          // Note: we set "fLastHandledSocketNum" before calling the handler,
-          // in case the handler calls "doEventLoop()" reentrantly.
-      (*handler->handlerProc)(handler->clientData, resultConditionSet);
-      break;
-    }
-  }
-  if (handler == NULL && fLastHandledSocketNum >= 0) {
-    // We didn't call a handler, but we didn't get to check all of them,
-    // so try again from the beginning:
-    iter.reset();
-    while ((handler = iter.next()) != NULL) {
-      int sock = handler->socketNum; // alias
-      int resultConditionSet = 0;
-      if (FD_ISSET(sock, &readSet) && FD_ISSET(sock, &fReadSet)/*sanity check*/) resultConditionSet |= SOCKET_READABLE;
-      if (FD_ISSET(sock, &writeSet) && FD_ISSET(sock, &fWriteSet)/*sanity check*/) resultConditionSet |= SOCKET_WRITABLE;
-      if (FD_ISSET(sock, &exceptionSet) && FD_ISSET(sock, &fExceptionSet)/*sanity check*/) resultConditionSet |= SOCKET_EXCEPTION;
-      if ((resultConditionSet&handler->conditionSet) != 0 && handler->handlerProc != NULL) {
-	fLastHandledSocketNum = sock;
-	    // Note: we set "fLastHandledSocketNum" before calling the handler,
-            // in case the handler calls "doEventLoop()" reentrantly.
-	(*handler->handlerProc)(handler->clientData, resultConditionSet);
-	break;
-      }
-    }
-    if (handler == NULL) fLastHandledSocketNum = -1;//because we didn't call a handler
+  int resultConditionSet = 0;
+  HandlerDescriptor* handler = selectResult > 0 ? nextReadyHandler(readSet, writeSet, exceptionSet, resultConditionSet) : NULL;
+  if (handler != NULL) {
+    fLastHandledSocketNum = handler->socketNum;
+        // Note: we set "fLastHandledSocketNum" before calling the handler,
+        // in case the handler calls "doEventLoop()" reentrantly.
+    (*handler->handlerProc)(handler->clientData, resultConditionSet);
+  } else {
+    fLastHandledSocketNum = -1;//because we didn't call a handler
   }
 
   // Also handle any newly-triggered event (Note that we do this *after* calling a socket handler,
@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "BasicUsageEnvironment0.hh"
 #include "HandlerSet.hh"
+#include "HashTable.hh"
 
 ////////// A subclass of DelayQueueEntry,
 //////////     used to implement BasicTaskScheduler0::scheduleDelayedTask()
@@ -165,7 +166,7 @@ HandlerDescriptor::~HandlerDescriptor() {
 }
 
 HandlerSet::HandlerSet()
-  : fHandlers(&fHandlers) {
+  : fHandlers(&fHandlers), fSocketTable(HashTable::create(ONE_WORD_HASH_KEYS)) {
   fHandlers.socketNum = -1; // shouldn't ever get looked at, but in case...
 }
 
@@ -174,6 +175,7 @@ HandlerSet::~HandlerSet() {
   while (fHandlers.fNextHandler != &fHandlers) {
     delete fHandlers.fNextHandler; // changes fHandlers->fNextHandler
   }
+  delete fSocketTable;
 }
 
 void HandlerSet
@@ -183,6 +185,7 @@ void HandlerSet
   if (handler == NULL) { // No existing handler, so create a new descr:
     handler = new HandlerDescriptor(fHandlers.fNextHandler);
     handler->socketNum = socketNum;
+    fSocketTable->Add((char const*)(intptr_t)socketNum, handler);
   }
 
   handler->conditionSet = conditionSet;
@@ -192,23 +195,27 @@ void HandlerSet
 
 void HandlerSet::clearHandler(int socketNum) {
   HandlerDescriptor* handler = lookupHandler(socketNum);
-  delete handler;
+  if (handler != NULL) {
+    fSocketTable->Remove((char const*)(intptr_t)socketNum);
+    delete handler;
+  }
 }
 
 void HandlerSet::moveHandler(int oldSocketNum, int newSocketNum) {
   HandlerDescriptor* handler = lookupHandler(oldSocketNum);
   if (handler != NULL) {
+    // Any handler still registered for "newSocketNum" is stale; the moved one replaces it:
+    HandlerDescriptor* oldHandler = lookupHandler(newSocketNum);
+    if (oldHandler != handler) delete oldHandler;
+
+    fSocketTable->Remove((char const*)(intptr_t)oldSocketNum);
     handler->socketNum = newSocketNum;
+    fSocketTable->Add((char const*)(intptr_t)newSocketNum, handler);
   }
 }
 
 HandlerDescriptor* HandlerSet::lookupHandler(int socketNum) {
-  HandlerDescriptor* handler;
-  HandlerIterator iter(*this);
-  while ((handler = iter.next()) != NULL) {
-    if (handler->socketNum == socketNum) break;
-  }
-  return handler;
+  return (HandlerDescriptor*)(fSocketTable->Lookup((char const*)(intptr_t)socketNum));
 }
 
 HandlerIterator::HandlerIterator(HandlerSet& handlerSet)
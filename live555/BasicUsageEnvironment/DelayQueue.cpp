@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "DelayQueue.hh"
+#include "HashTable.hh"
 #include "GroupsockHelper.hh"
 
 static const int MILLION = 1000000;
@@ -95,8 +96,7 @@ const DelayInterval ETERNITY(INT_MAX, MILLION-1);
 intptr_t DelayQueueEntry::tokenCounter = 0;
 
 DelayQueueEntry::DelayQueueEntry(DelayInterval delay)
-  : fDeltaTimeRemaining(delay) {
-  fNext = fPrev = this;
+  : fDeltaTimeRemaining(delay), fHeapIndex(-1), fSequence(0) {
   fToken = ++tokenCounter;
 }
 
@@ -111,33 +111,42 @@ void DelayQueueEntry::handleTimeout() {
 ///// DelayQueue /////
 
 DelayQueue::DelayQueue()
-  : DelayQueueEntry(ETERNITY) {
+  : DelayQueueEntry(ETERNITY),
+    fHeap(NULL), fHeapSize(0), fHeapCapacity(0), fSequenceCounter(0),
+    fTokenTable(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fTimeToNextAlarm(ETERNITY) {
   fLastSyncTime = TimeNow();
 }
 
 DelayQueue::~DelayQueue() {
-  while (fNext != this) {
-    DelayQueueEntry* entryToRemove = fNext;
+  while (fHeapSize > 0) {
+    DelayQueueEntry* entryToRemove = head();
     removeEntry(entryToRemove);
     delete entryToRemove;
   }
+  delete[] fHeap;
+  delete fTokenTable;
 }
 
 void DelayQueue::addEntry(DelayQueueEntry* newEntry) {
-  synchronize();
-
-  DelayQueueEntry* cur = head();
-  while (newEntry->fDeltaTimeRemaining >= cur->fDeltaTimeRemaining) {
-    newEntry->fDeltaTimeRemaining -= cur->fDeltaTimeRemaining;
-    cur = cur->fNext;
+  if (newEntry == NULL || newEntry->fHeapIndex >= 0) return;
+
+  newEntry->fDeadline = synchronize();
+  newEntry->fDeadline += newEntry->fDeltaTimeRemaining;
+  newEntry->fSequence = ++fSequenceCounter;
+
+  if (fHeapSize == fHeapCapacity) {
+    unsigned newCapacity = fHeapCapacity == 0 ? 16 : 2*fHeapCapacity;
+    DelayQueueEntry** newHeap = new DelayQueueEntry*[newCapacity];
+    for (unsigned i = 0; i < fHeapSize; ++i) newHeap[i] = fHeap[i];
+    delete[] fHeap;
+    fHeap = newHeap;
+    fHeapCapacity = newCapacity;
   }
 
-  cur->fDeltaTimeRemaining -= newEntry->fDeltaTimeRemaining;
-
-  // Add "newEntry" to the queue, just before "cur":
-  newEntry->fNext = cur;
-  newEntry->fPrev = cur->fPrev;
-  cur->fPrev = newEntry->fPrev->fNext = newEntry;
+  placeEntry(newEntry, fHeapSize++);
+  siftUp(newEntry->fHeapIndex);
+  fTokenTable->Add((char const*)(newEntry->token()), newEntry);
 }
 
 void DelayQueue::updateEntry(DelayQueueEntry* entry, DelayInterval newDelay) {
@@ -154,13 +163,23 @@ void DelayQueue::updateEntry(intptr_t tokenToFind, DelayInterval newDelay) {
 }
 
 void DelayQueue::removeEntry(DelayQueueEntry* entry) {
-  if (entry == NULL || entry->fNext == NULL) return;
-
-  entry->fNext->fDeltaTimeRemaining += entry->fDeltaTimeRemaining;
-  entry->fPrev->fNext = entry->fNext;
-  entry->fNext->fPrev = entry->fPrev;
-  entry->fNext = entry->fPrev = NULL;
-  // in case we should try to remove it again
+  if (entry == NULL || entry->fHeapIndex < 0) return;
+  // (in case we should try to remove it again)
+
+  unsigned index = (unsigned)entry->fHeapIndex;
+  fTokenTable->Remove((char const*)(entry->token()));
+  entry->fHeapIndex = -1;
+
+  DelayQueueEntry* last = fHeap[--fHeapSize];
+  if (index < fHeapSize) {
+    // Move the last entry into the hole, then restore the heap order in whichever direction it is violated:
+    placeEntry(last, index);
+    if (index > 0 && entryPrecedes(last, fHeap[(index-1)/2])) {
+      siftUp(index);
+    } else {
+      siftDown(index);
+    }
+  }
 }
 
 DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
@@ -170,53 +189,75 @@ DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
 }
 
 DelayInterval const& DelayQueue::timeToNextAlarm() {
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) return DELAY_ZERO; // a common case
+  DelayQueueEntry* first = head();
+  if (first == NULL) return ETERNITY;
 
-  synchronize();
-  return head()->fDeltaTimeRemaining;
+  EventTime timeNow = synchronize();
+  fTimeToNextAlarm = first->fDeadline - timeNow; // DELAY_ZERO if already due
+  return fTimeToNextAlarm;
 }
 
 void DelayQueue::handleAlarm() {
-  if (head()->fDeltaTimeRemaining != DELAY_ZERO) synchronize();
+  DelayQueueEntry* first = head();
+  if (first == NULL) return;
 
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) {
+  if (first->fDeadline <= synchronize()) {
     // This event is due to be handled:
-    DelayQueueEntry* toRemove = head();
-    removeEntry(toRemove); // do this first, in case handler accesses queue
+    removeEntry(first); // do this first, in case handler accesses queue
 
-    toRemove->handleTimeout();
+    first->handleTimeout();
   }
 }
 
 DelayQueueEntry* DelayQueue::findEntryByToken(intptr_t tokenToFind) {
-  DelayQueueEntry* cur = head();
-  while (cur != this) {
-    if (cur->token() == tokenToFind) return cur;
-    cur = cur->fNext;
-  }
-
-  return NULL;
+  return (DelayQueueEntry*)(fTokenTable->Lookup((char const*)tokenToFind));
 }
 
-void DelayQueue::synchronize() {
-  // First, figure out how much time has elapsed since the last sync:
+EventTime DelayQueue::synchronize() {
   EventTime timeNow = TimeNow();
   if (timeNow < fLastSyncTime) {
-    // The system clock has apparently gone back in time; reset our sync time and return:
-    fLastSyncTime  = timeNow;
-    return;
+    // The system clock has apparently gone back in time.  Shift every deadline back by the same
+    // amount, so that pending entries keep the delay that they had left (as relative delays would):
+    DelayInterval timeShift = fLastSyncTime - timeNow;
+    for (unsigned i = 0; i < fHeapSize; ++i) fHeap[i]->fDeadline -= timeShift;
   }
-  DelayInterval timeSinceLastSync = timeNow - fLastSyncTime;
   fLastSyncTime = timeNow;
+  return timeNow;
+}
+
+int DelayQueue::entryPrecedes(DelayQueueEntry const* a, DelayQueueEntry const* b) const {
+  if (a->fDeadline < b->fDeadline) return 1;
+  if (b->fDeadline < a->fDeadline) return 0;
+  return (int)(a->fSequence - b->fSequence) < 0; // wrap-safe
+}
+
+void DelayQueue::placeEntry(DelayQueueEntry* entry, unsigned index) {
+  fHeap[index] = entry;
+  entry->fHeapIndex = (int)index;
+}
+
+void DelayQueue::siftUp(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (index > 0) {
+    unsigned parent = (index-1)/2;
+    if (!entryPrecedes(entry, fHeap[parent])) break;
+    placeEntry(fHeap[parent], index);
+    index = parent;
+  }
+  placeEntry(entry, index);
+}
 
-  // Then, adjust the delay queue for any entries whose time is up:
-  DelayQueueEntry* curEntry = head();
-  while (timeSinceLastSync >= curEntry->fDeltaTimeRemaining) {
-    timeSinceLastSync -= curEntry->fDeltaTimeRemaining;
-    curEntry->fDeltaTimeRemaining = DELAY_ZERO;
-    curEntry = curEntry->fNext;
+void DelayQueue::siftDown(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (True) {
+    unsigned child = 2*index + 1;
+    if (child >= fHeapSize) break;
+    if (child+1 < fHeapSize && entryPrecedes(fHeap[child+1], fHeap[child])) ++child;
+    if (!entryPrecedes(fHeap[child], entry)) break;
+    placeEntry(fHeap[child], index);
+    index = child;
   }
-  curEntry->fDeltaTimeRemaining -= timeSinceLastSync;
+  placeEntry(entry, index);
 }
 
 
@@ -67,6 +67,12 @@ protected:
   virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
   virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
 
+  void copySocketSet(fd_set& to, fd_set const& from) const;
+  class HandlerDescriptor* nextReadyHandler(fd_set const& readSet, fd_set const& writeSet, fd_set const& exceptionSet,
+					    int& resultConditionSet);
+      // Returns the handler of the first ready socket after "fLastHandledSocketNum" (wrapping around), or NULL.
+      // Only the sockets that "select()" reported are looked at.
+
 protected:
   unsigned fMaxSchedulerGranularity;
 
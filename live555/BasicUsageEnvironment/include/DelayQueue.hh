@@ -147,9 +147,10 @@ protected: // abstract base class
 
 private:
   friend class DelayQueue;
-  DelayQueueEntry* fNext;
-  DelayQueueEntry* fPrev;
-  DelayInterval fDeltaTimeRemaining;
+  DelayInterval fDeltaTimeRemaining; // the delay requested when (re)scheduled
+  EventTime fDeadline; // absolute time at which the entry is due
+  int fHeapIndex; // position within the delay queue's heap, or -1 if not queued
+  unsigned fSequence; // orders entries that share a deadline (FIFO)
 
   intptr_t fToken;
   static intptr_t tokenCounter;
@@ -157,6 +158,10 @@ private:
 
 ///// DelayQueue /////
 
+// Entries are kept in a binary min-heap ordered by absolute deadline, and
+// indexed by token in a hash table, so that scheduling, unscheduling and
+// rescheduling cost O(log n) rather than a walk over every pending timer.
+
 class DelayQueue: public DelayQueueEntry {
 public:
   DelayQueue();
@@ -172,10 +177,21 @@ public:
   void handleAlarm();
 
 private:
-  DelayQueueEntry* head() { return fNext; }
+  DelayQueueEntry* head() { return fHeapSize > 0 ? fHeap[0] : NULL; }
   DelayQueueEntry* findEntryByToken(intptr_t token);
-  void synchronize(); // bring the 'time remaining' fields up-to-date
-
+  EventTime synchronize(); // returns the current time, after allowing for the clock going backwards
+
+  int entryPrecedes(DelayQueueEntry const* a, DelayQueueEntry const* b) const;
+  void placeEntry(DelayQueueEntry* entry, unsigned index);
+  void siftUp(unsigned index);
+  void siftDown(unsigned index);
+
+  DelayQueueEntry** fHeap;
+  unsigned fHeapSize;
+  unsigned fHeapCapacity;
+  unsigned fSequenceCounter;
+  class HashTable* fTokenTable;
+  DelayInterval fTimeToNextAlarm;
   EventTime fLastSyncTime;
 };
 
@@ -53,12 +53,12 @@ public:
   void clearHandler(int socketNum);
   void moveHandler(int oldSocketNum, int newSocketNum);
 
-private:
-  HandlerDescriptor* lookupHandler(int socketNum);
+  HandlerDescriptor* lookupHandler(int socketNum); // returns NULL if none
 
 private:
   friend class HandlerIterator;
   HandlerDescriptor fHandlers;
+  class HashTable* fSocketTable; // socket number -> descriptor, so that lookups don't walk the list
 };
 
 class HandlerIterator {
@@ -0,0 +1,168 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2014, Live Networks, Inc.  All rights reserved
+// A test program that times the task scheduler's socket handling: the cost of one
+// event loop step that services one readable socket, and of turning a socket's
+// read handling off and on again (as "RTPInterface" does for each frame), with
+// 64, 256 and 900 loopback UDP sockets registered.
+// The "select()", "sendto()" and "recv()" calls that a step makes are timed on
+// their own and subtracted, so what's left is the scheduler's own dispatch cost.
+// It uses only the "TaskScheduler" API, so it can be built against older versions of
+// "HandlerSet" to compare them.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+
+static unsigned const socketCounts[] = { 64, 256, 900 };
+static unsigned const numOperations = 100000;
+static unsigned const numRounds = 20;
+static unsigned const operationsPerRound = numOperations/numRounds;
+
+static char buffer[100];
+static unsigned numHandled = 0;
+
+static void readHandler(void* clientData, int /*mask*/) {
+  int socketNum = (int)(intptr_t)clientData;
+  recv(socketNum, buffer, sizeof buffer, 0);
+  ++numHandled;
+}
+
+static int setupLoopbackSocket(UsageEnvironment& env) {
+  // We don't use "setupDatagramSocket()", because it sets "SO_REUSEPORT", which can
+  // give two of our sockets the same ephemeral port:
+  int newSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  MAKE_SOCKADDR_IN(name, htonl(INADDR_LOOPBACK), 0);
+  if (newSocket < 0 || bind(newSocket, (struct sockaddr*)&name, sizeof name) != 0) {
+    env << "Failed to set up a loopback socket\n";
+    exit(1);
+  }
+  return newSocket;
+}
+
+static double nanosecondsPerOperation(struct timeval const& start, unsigned count) {
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  double elapsed = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_usec - start.tv_usec)*1e3;
+  return elapsed/count;
+}
+
+static void sendDatagram(int senderSocket, struct sockaddr_in const& address) {
+  sendto(senderSocket, buffer, 1, 0, (struct sockaddr const*)&address, sizeof address);
+}
+
+static void timeOperations(UsageEnvironment& env, unsigned numSockets) {
+  BasicTaskScheduler0& scheduler = (BasicTaskScheduler0&)env.taskScheduler();
+
+  int* sockets = new int[numSockets];
+  struct sockaddr_in* addresses = new struct sockaddr_in[numSockets];
+  fd_set allSockets;
+  FD_ZERO(&allSockets);
+  int maxSocketNum = -1;
+  for (unsigned i = 0; i < numSockets; ++i) {
+    sockets[i] = setupLoopbackSocket(env);
+    Port port(0);
+    if (!getSourcePort(env, sockets[i], port)) {
+      env << "Failed to set up socket " << (int)i << ": " << env.getResultMsg() << "\n";
+      exit(1);
+    }
+    MAKE_SOCKADDR_IN(address, htonl(INADDR_LOOPBACK), port.num());
+    addresses[i] = address;
+    FD_SET((unsigned)sockets[i], &allSockets);
+    if (sockets[i] > maxSocketNum) maxSocketNum = sockets[i];
+  }
+  int senderSocket = setupLoopbackSocket(env);
+
+  unsigned* indices = new unsigned[numOperations];
+  for (unsigned i = 0; i < numOperations; ++i) indices[i] = our_random()%numSockets;
+
+  for (unsigned i = 0; i < numSockets; ++i) {
+    scheduler.turnOnBackgroundReadHandling(sockets[i], readHandler, (void*)(intptr_t)sockets[i]);
+  }
+
+  // Each event loop step is compared with the system calls that it makes: sending a datagram
+  // to one socket, "select()" on all of them, then reading the datagram.  "select()" dominates
+  // both, so we alternate between the two in short rounds, and keep the fastest round of each:
+  double systemCallTime = 0.0, stepTime = 0.0;
+  numHandled = 0;
+  for (unsigned round = 0; round < numRounds; ++round) {
+    unsigned const* roundIndices = &indices[round*operationsPerRound];
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    for (unsigned i = 0; i < operationsPerRound; ++i) {
+      unsigned k = roundIndices[i];
+      sendDatagram(senderSocket, addresses[k]);
+      fd_set readSet = allSockets;
+      struct timeval timeout; timeout.tv_sec = 1; timeout.tv_usec = 0;
+      if (select(maxSocketNum + 1, &readSet, NULL, NULL, &timeout) != 1 || !FD_ISSET(sockets[k], &readSet)) {
+        env << "Unexpected \"select()\" result\n";
+        exit(1);
+      }
+      recv(sockets[k], buffer, sizeof buffer, 0);
+    }
+    double roundTime = nanosecondsPerOperation(start, operationsPerRound);
+    if (round == 0 || roundTime < systemCallTime) systemCallTime = roundTime;
+
+    gettimeofday(&start, NULL);
+    for (unsigned i = 0; i < operationsPerRound; ++i) {
+      sendDatagram(senderSocket, addresses[roundIndices[i]]);
+      scheduler.SingleStep(0);
+    }
+    roundTime = nanosecondsPerOperation(start, operationsPerRound);
+    if (round == 0 || roundTime < stepTime) stepTime = roundTime;
+  }
+  if (numHandled != numRounds*operationsPerRound) {
+    env << "Handled " << numHandled << " events, expected " << numOperations << "\n";
+    exit(1);
+  }
+
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  for (unsigned i = 0; i < numOperations; ++i) {
+    int socketNum = sockets[indices[i]];
+    scheduler.turnOffBackgroundReadHandling(socketNum);
+    scheduler.turnOnBackgroundReadHandling(socketNum, readHandler, (void*)(intptr_t)socketNum);
+  }
+  double toggleTime = nanosecondsPerOperation(start, numOperations);
+
+  fprintf(stderr, "%8u %10.0f %13.0f %19.0f\n", numSockets, stepTime, stepTime - systemCallTime, toggleTime);
+
+  for (unsigned i = 0; i < numSockets; ++i) {
+    scheduler.turnOffBackgroundReadHandling(sockets[i]);
+    closeSocket(sockets[i]);
+  }
+  closeSocket(senderSocket);
+  delete[] indices;
+  delete[] addresses;
+  delete[] sockets;
+}
+
+int main(int argc, char** argv) {
+  // Use no scheduler 'tick', so that each step handles exactly one socket event:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew(0);
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  our_srandom(12345);
+
+  fprintf(stderr, " sockets   step(ns)  dispatch(ns)  turnOff+turnOn(ns)\n");
+  for (unsigned i = 0; i < sizeof socketCounts/sizeof socketCounts[0]; ++i) {
+    timeOperations(*env, socketCounts[i]);
+  }
+
+  env->reclaim();
+  delete scheduler;
+  return 0;
+}
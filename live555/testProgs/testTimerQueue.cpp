@@ -0,0 +1,148 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2014, Live Networks, Inc.  All rights reserved
+// A test program that checks the firing order of delayed tasks, then times
+// "scheduleDelayedTask()", "rescheduleDelayedTask()" and "unscheduleDelayedTask()"
+// with as many timers pending as 10, 100 and 1000 RTSP sessions keep.
+// It uses only the "TaskScheduler" API, so it can be built against older versions of
+// "DelayQueue" to compare them.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+
+// Each session keeps an RTCP report, a liveness command, an inter-packet gap check
+// and a reconnect timer pending:
+static unsigned const timersPerSession = 4;
+static unsigned const sessionCounts[] = { 10, 100, 1000 };
+static unsigned const numOperations = 200000;
+
+static unsigned const numOrderTimers = 200;
+static unsigned numFired = 0;
+static unsigned lastFired = 0;
+static Boolean orderOK = True;
+static char orderDone = 0;
+
+static void orderTask(void* clientData) {
+  // "clientData" is the timer's expected position in the firing order:
+  unsigned position = (unsigned)(uintptr_t)clientData;
+  if (numFired > 0 && position < lastFired) orderOK = False;
+  lastFired = position;
+  if (++numFired == numOrderTimers) orderDone = 1;
+}
+
+static void noOpTask(void* /*clientData*/) {
+}
+
+static int64_t randomDelay() {
+  // Between 1 and 60 seconds, so that no timer fires while we're measuring:
+  return 1000000 + our_random()%59000000;
+}
+
+static double nanosecondsPerOperation(struct timeval const& start) {
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  double elapsed = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_usec - start.tv_usec)*1e3;
+  return elapsed/numOperations;
+}
+
+static Boolean checkFiringOrder(TaskScheduler& scheduler) {
+  // Schedule pairs of timers with equal delays, in a shuffled order.  The two timers of a pair
+  // must fire in the order in which they were scheduled, so the first one scheduled gets the
+  // lower position:
+  unsigned pairs[numOrderTimers];
+  for (unsigned i = 0; i < numOrderTimers; ++i) pairs[i] = i/2;
+  for (unsigned i = numOrderTimers - 1; i > 0; --i) {
+    unsigned j = our_random()%(i + 1);
+    unsigned tmp = pairs[i]; pairs[i] = pairs[j]; pairs[j] = tmp;
+  }
+
+  TaskToken lateToken = scheduler.scheduleDelayedTask(500000, orderTask, (void*)(uintptr_t)numOrderTimers);
+  Boolean pairStarted[numOrderTimers/2];
+  for (unsigned i = 0; i < numOrderTimers/2; ++i) pairStarted[i] = False;
+  for (unsigned i = 0; i < numOrderTimers; ++i) {
+    unsigned pair = pairs[i];
+    unsigned position = 2*pair + (pairStarted[pair] ? 1 : 0);
+    pairStarted[pair] = True;
+    scheduler.scheduleDelayedTask(pair*1000, orderTask, (void*)(uintptr_t)position);
+  }
+
+  // A removed timer must not fire:
+  scheduler.unscheduleDelayedTask(lateToken);
+
+  scheduler.doEventLoop(&orderDone);
+  return orderOK && numFired == numOrderTimers;
+}
+
+static void timeOperations(TaskScheduler& scheduler, unsigned numSessions) {
+  unsigned const numTimers = numSessions*timersPerSession;
+  TaskToken* tokens = new TaskToken[numTimers];
+  unsigned* indices = new unsigned[numOperations];
+  int64_t* delays = new int64_t[numOperations];
+  for (unsigned i = 0; i < numOperations; ++i) {
+    indices[i] = our_random()%numTimers;
+    delays[i] = randomDelay();
+  }
+
+  for (unsigned i = 0; i < numTimers; ++i) {
+    tokens[i] = scheduler.scheduleDelayedTask(randomDelay(), noOpTask, NULL);
+  }
+
+  // What an RTCP report or a liveness command does each time it's sent:
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  for (unsigned i = 0; i < numOperations; ++i) {
+    scheduler.rescheduleDelayedTask(tokens[indices[i]], delays[i], noOpTask, NULL);
+  }
+  double rescheduleTime = nanosecondsPerOperation(start);
+
+  // What a session does when it's torn down and set up again:
+  gettimeofday(&start, NULL);
+  for (unsigned i = 0; i < numOperations; ++i) {
+    TaskToken& token = tokens[indices[i]];
+    scheduler.unscheduleDelayedTask(token);
+    token = scheduler.scheduleDelayedTask(delays[i], noOpTask, NULL);
+  }
+  double churnTime = nanosecondsPerOperation(start);
+
+  for (unsigned i = 0; i < numTimers; ++i) scheduler.unscheduleDelayedTask(tokens[i]);
+
+  fprintf(stderr, "%8u %8u %14.0f %22.0f\n", numSessions, numTimers, rescheduleTime, churnTime);
+
+  delete[] delays;
+  delete[] indices;
+  delete[] tokens;
+}
+
+int main(int argc, char** argv) {
+  // Use no scheduler 'tick', so that the only timers pending are our own:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew(0);
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  our_srandom(12345);
+
+  Boolean ok = checkFiringOrder(*scheduler);
+  fprintf(stderr, "firing order: %s\n", ok ? "OK" : "FAILED");
+
+  fprintf(stderr, "sessions   timers  reschedule(ns)  unschedule+schedule(ns)\n");
+  for (unsigned i = 0; i < sizeof sessionCounts/sizeof sessionCounts[0]; ++i) {
+    timeOperations(*scheduler, sessionCounts[i]);
+  }
+
+  env->reclaim();
+  delete scheduler;
+  return ok ? 0 : 1;
+}
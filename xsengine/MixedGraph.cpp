@@ -28,8 +28,13 @@ void CMixedGraph::TaskExecuteThread(int i)
         _pendingTaskQueue[i].pop(ti); // ܻᱻ
         if (ti == nullptr || ti->pFunc == nullptr)
             break;
+        _runningTask[i] = ti;
         hr = (this->*ti->pFunc)(ti->pArg);
+        _runningTask[i] = nullptr;
+        if (hr == E_PENDING)
+            continue; // ѽ̣߳ɺ󽻸
         _doneTaskQueue[i].push(ti);
+        ::SetEvent(_completionEvent); // ߳ɷɻص
     }
 }
 
@@ -49,33 +54,384 @@ HRESULT CMixedGraph::Open(xse_arg_t* arg)
         return hr;
     }
 
+    // ͬһͨȿֱٻط¼Դ˾ͻһԴȾӱ
+    SourceKind kind = !IsFileUrl(a->url) ? SourceKind::Rtsp : IsHeifPath(a->url) ? SourceKind::Heif : SourceKind::Mp4;
+    if (_source[i] != nullptr && _sourceKind[i] != kind) {
+        ReleaseSource(i);
+    }
     if (_source[i] == nullptr) {
-        VERIFY_HR(BuildRtspLiveSource(i));
+        switch (kind) {
+        case SourceKind::Rtsp: VERIFY_HR(BuildRtspLiveSource(i)); break;
+        case SourceKind::Mp4: VERIFY_HR(BuildMp4Source(i)); break;
+        case SourceKind::Heif: VERIFY_HR(BuildHeifSource(i)); break;
+        }
+    }
+    if (kind != SourceKind::Rtsp) {
+        return OpenFile(a);
     }
 
     // TODO:ԴRtspClient󣬹һͨѶselecṭ߳
     // ηַ߳жĻصУCDispatcherࣿ
     // о߱ܺʹ첽߳ϢĶҪ߳ͳһɷϢִлص
     // ϢݣҲһAPCַlambda
+    // /ǰӿڳߴ磨ûָȴһ
+    _streamUrl[i][0] = a->url;
+    _streamHeight[i][0] = a->stream_height[0];
+    _streamCount[i] = 1;
+    for (int s = 0; s < XSE_MAX_SUB_STREAM_COUNT && a->sub_url[s][0] != 0; ++s) {
+        _streamUrl[i][s + 1] = a->sub_url[s];
+        _streamHeight[i][s + 1] = a->stream_height[s + 1];
+        _streamCount[i] = s + 2;
+    }
+    _curStream[i] = 0;
+    if (_pinnedStream[i] >= _streamCount[i])
+        _pinnedStream[i] = XSE_AUTO_STREAM;
+    if (_pinnedStream[i] != XSE_AUTO_STREAM) {
+        _curStream[i] = _pinnedStream[i];
+    }
+    else if (_streamCount[i] > 1) {
+        _curStream[i] = AutoStream(i);
+    }
+
     CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
     {
         _threadState[i] = ThreadState::OpenPending;
         cmd->SetNotifyReceiver(this);
-        VERIFY_HR(cmd->OpenURL(a->url, a->user_name, a->password));
+        VERIFY_HR(cmd->OpenURL(_streamUrl[i][_curStream[i]].c_str(), a->user_name, a->password));
         _threadState[i] = ThreadState::Opened;
     }
+    if (SUCCEEDED(hr)) {
+        BuildAudioChain(i);
+    }
     if (SUCCEEDED(hr) && a->auto_run) {
-        {
-            xse_arg_pause_t a;
-            a.channel = i;
-            VERIFY_HR(CMixedGraph::Pause(&a));
+        VERIFY_HR(AutoRun(i));
+    }
+
+    return hr;
+}
+
+// ļûҲҪû롣
+HRESULT CMixedGraph::OpenFile(xse_arg_open_t* a)
+{
+    HRESULT hr = S_OK;
+    int i = a->channel;
+
+    const wchar_t* path = a->url;
+    if (_wcsnicmp(path, L"file://", 7) == 0) {
+        path += 7;
+        if (path[0] == L'/' && path[2] == L':')
+            ++path; // file:///C:/...
+    }
+
+    _streamUrl[i][0] = a->url;
+    _streamCount[i] = 1;
+    _curStream[i] = 0;
+
+    if (_sourceKind[i] == SourceKind::Heif) {
+        return OpenHeif(a, path);
+    }
+
+    CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+    _threadState[i] = ThreadState::OpenPending;
+    hr = cmd->OpenFile(path);
+    if (FAILED(hr)) {
+        _threadState[i] = ThreadState::Idle;
+        a->result = xse_err_fail;
+        return hr;
+    }
+    _threadState[i] = ThreadState::Opened;
+
+    if (a->auto_run) {
+        VERIFY_HR(AutoRun(i));
+    }
+
+    return hr;
+}
+
+// ̬ͼ򿪺һֱֵԴȾΪƴͼ֣ͼӿڣͼһ黭һ顣
+// Զʱͼƴ꣨HEIF_DECODE_TIMEOUT_MSٷأͼȫͼĺʱӷ
+// ȾĻΪֹȴһδˢµʱ䡣
+HRESULT CMixedGraph::OpenHeif(xse_arg_open_t* a, const wchar_t* path)
+{
+    HRESULT hr = S_OK;
+    int i = a->channel;
+    DWORD startTime = timeGetTime();
+
+    CComQIPtr<HeifSource::ICommand, &IID_IHeifSourceCommand> cmd(_source[i]);
+    HeifSource::ImageInfo info = { 0 };
+    _threadState[i] = ThreadState::OpenPending;
+    hr = cmd->OpenFile(path);
+    if (SUCCEEDED(hr)) {
+        hr = cmd->GetImageInfo(&info);
+    }
+    if (SUCCEEDED(hr)) {
+        VideoRenderer::MosaicDesc_t desc = { info.width, info.height, info.columns, info.rows, info.tileWidth, info.tileHeight };
+        hr = _videoRendererCmd->SetMosaic(i, &desc);
+    }
+    if (FAILED(hr)) {
+        _threadState[i] = ThreadState::Idle;
+        a->result = xse_err_fail;
+        return hr;
+    }
+    _threadState[i] = ThreadState::Opened;
+
+    a->image_width = info.width;
+    a->image_height = info.height;
+    a->image_tiles = info.columns * info.rows;
+    if (!a->auto_run)
+        return hr;
+
+    VERIFY_HR(AutoRun(i));
+    if (FAILED(hr))
+        return hr;
+
+    VideoRenderer::MosaicProgress_t progress = { 0 };
+    DWORD deadline = startTime + HEIF_DECODE_TIMEOUT_MS;
+    for (;;) {
+        _videoRendererCmd->GetMosaicProgress(i, &progress);
+        if (progress.completeTime != 0 || (int32_t)(timeGetTime() - deadline) >= 0)
+            break;
+        Sleep(HEIF_POLL_MS);
+    }
+    a->decoded_tiles = progress.tiles;
+    if (progress.thumbnailTime != 0) {
+        a->thumbnail_ms = (int)(progress.thumbnailTime - startTime);
+    }
+    if (progress.completeTime != 0) {
+        a->full_image_ms = (int)(progress.completeTime - startTime);
+    }
+
+    return hr;
+}
+
+HRESULT CMixedGraph::AutoRun(int i)
+{
+    HRESULT hr = S_OK;
+    {
+        xse_arg_pause_t a;
+        a.channel = i;
+        VERIFY_HR(CMixedGraph::Pause(&a));
+    }
+    if (SUCCEEDED(hr)) {
+        xse_arg_play_t a;
+        a.channel = i;
+        VERIFY_HR(CMixedGraph::Play(&a));
+    }
+    return hr;
+}
+
+// ̡̣߳ͨ߳
+HRESULT CMixedGraph::Replay(xse_arg_t* arg)
+{
+    HRESULT hr = S_OK;
+    xse_arg_replay_t* a = (xse_arg_replay_t*)arg;
+    int i = a->channel;
+
+    if (!CheckChannel(arg))
+        return hr;
+
+    _replayBuffer.SetLimits(a->keep_seconds, a->budget_mb);
+    if (a->seconds > 0) {
+        int source = a->source_channel == XSE_INVALID_CHANNEL_ID ? i : a->source_channel;
+        if (source < XSE_MIN_CHANNEL_ID || source > XSE_MAX_CHANNEL_ID) {
+            a->result = xse_err_invalid_channel;
+            return E_INVALIDARG;
         }
-        if (SUCCEEDED(hr)) {
-            xse_arg_play_t a;
-            a.channel = i;
-            VERIFY_HR(CMixedGraph::Play(&a));
+        hr = OpenReplay(a, source);
+    }
+
+    CReplayBuffer::Stats stats;
+    _replayBuffer.GetStats(&stats);
+    a->total_kb = (unsigned)(stats.bytes / 1024);
+    a->budget_kb = (unsigned)(stats.budget / 1024);
+    a->evicted_gops = stats.evictedGops;
+    for (int k = 0; k < CHANNEL_COUNT && k < XSE_MAX_CHANNEL_COUNT; ++k) {
+        a->channel_kb[k] = (unsigned)(stats.channelBytes[k] / 1024);
+        a->channel_ms[k] = stats.channelMs[k];
+    }
+
+    return hr;
+}
+
+// ͨļԴֱӴڴ򿪣̡
+// ֡ӳٴӷط𣬰ֹͣԭԴȡա͹ؼ֡롣
+HRESULT CMixedGraph::OpenReplay(xse_arg_replay_t* a, int source)
+{
+    HRESULT hr = S_OK;
+    int i = a->channel;
+    DWORD startTime = timeGetTime();
+
+    if (_threadState[i] != ThreadState::Idle) {
+        xse_arg_stop_t stop;
+        stop.channel = i;
+        VERIFY_HR(CMixedGraph::Stop(&stop));
+    }
+    if (_source[i] != nullptr && _sourceKind[i] != SourceKind::Mp4) {
+        ReleaseSource(i);
+    }
+    if (_source[i] == nullptr) {
+        VERIFY_HR(BuildMp4Source(i));
+    }
+    if (FAILED(hr)) {
+        a->result = xse_err_fail;
+        return hr;
+    }
+
+    _streamCount[i] = 1;
+    _curStream[i] = 0;
+
+    CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+    _threadState[i] = ThreadState::OpenPending;
+    hr = cmd->OpenReplay(&_replayBuffer, source, a->seconds);
+    if (FAILED(hr)) {
+        _threadState[i] = ThreadState::Idle;
+        a->result = hr == VFW_E_NOT_FOUND ? xse_err_no_more_data : xse_err_fail;
+        return hr;
+    }
+    _threadState[i] = ThreadState::Opened;
+
+    LONGLONG duration = 0;
+    cmd->GetDuration(&duration);
+    a->duration_ms = (int)duration;
+
+    // ֹͣ״̬¶λͷʼźܵȵһ֡ɡ
+    VERIFY_HR(cmd->Seek(0, TRUE, 0, nullptr));
+    if (SUCCEEDED(hr) && a->auto_run) {
+        VERIFY_HR(AutoRun(i));
+        DWORD latency = 0;
+        if (SUCCEEDED(hr) && cmd->WaitSeekComplete(SEEK_WAIT_TIMEOUT_MS, &latency) == S_OK) {
+            a->latency_ms = (int)(timeGetTime() - startTime);
         }
     }
 
     return hr;
 }
+
+// ̡̣߳ͨ߳
+// 󽻸Ⱦ󷵻E_PENDINGȱɣͨ߳̿Խִк
+// ߳дļʱֹͨͣOnSnapshotComplete֪ͨ
+HRESULT CMixedGraph::Snapshot(xse_arg_t* arg)
+{
+    xse_arg_snapshot_t* a = (xse_arg_snapshot_t*)arg;
+    int i = a->channel;
+
+    if (!CheckChannel(arg))
+        return E_INVALIDARG;
+    if (_source[i] == nullptr || _threadState[i] == ThreadState::Idle) {
+        a->result = xse_err_channel_not_started;
+        return S_OK;
+    }
+
+    SnapshotContext* ctx = new SnapshotContext;
+    ctx->graph = this;
+    ctx->task = _runningTask[i];
+    ctx->thread = i;
+    ctx->startTime = timeGetTime();
+    _videoRendererCmd->GetPresentJitter(&ctx->jitter);
+
+    a->path[XSE_MAX_URL_LEN] = 0;
+    VideoRenderer::SnapshotDesc_t desc = { 0 };
+    desc.path = a->path;
+    desc.format = a->format == xse_image_png ? VideoRenderer::SF_PNG : VideoRenderer::SF_JPEG;
+    desc.maxWidth = a->max_width;
+    desc.maxHeight = a->max_height;
+    desc.quality = a->quality;
+    desc.timeoutMs = (DWORD)max(a->timeout_ms, 0);
+    desc.cb = &CMixedGraph::OnSnapshotComplete;
+    desc.ctx = ctx;
+    HRESULT hr = _videoRendererCmd->Snapshot(i, &desc);
+    if (FAILED(hr)) {
+        delete ctx;
+        a->result = hr == E_INVALIDARG ? xse_err_invalid_arg : xse_err_fail;
+        return hr;
+    }
+    return E_PENDING;
+}
+
+// ̣߳ȾĿ̡߳
+void CALLBACK CMixedGraph::OnSnapshotComplete(void* ctx, const VideoRenderer::SnapshotResult_t* result)
+{
+    SnapshotContext* c = (SnapshotContext*)ctx;
+    CMixedGraph* g = c->graph;
+    xse_arg_snapshot_t* a = (xse_arg_snapshot_t*)c->task->pArg;
+
+    if (SUCCEEDED(result->hr)) {
+        a->width = result->width;
+        a->height = result->height;
+        a->bytes = result->bytes;
+        a->capture_ms = result->captureMs;
+        a->encode_ms = result->encodeMs;
+    }
+    else {
+        a->result = result->hr == E_INVALIDARG ? xse_err_invalid_arg : xse_err_fail;
+    }
+
+    // ȾʱĻصٲѯʱȾ
+    VideoRenderer::PresentJitter_t jitter = c->jitter;
+    if (result->hr != E_ABORT && g->_videoRendererCmd != nullptr) {
+        g->_videoRendererCmd->GetPresentJitter(&jitter);
+    }
+    LONGLONG frames = jitter.frames - c->jitter.frames;
+    a->present_frames = (unsigned)frames;
+    a->present_jitter_ms = frames > 0 ? (float)(jitter.totalMs - c->jitter.totalMs) / frames : 0;
+    a->late_frames = (unsigned)(jitter.lateFrames - c->jitter.lateFrames);
+
+    g->_doneTaskQueue[c->thread].push(c->task);
+    ::SetEvent(g->_completionEvent);
+    delete c;
+}
+
+// ̣߳MISC_THREAD_INDEX̣߳SyncUpdateÿGOVERNOR_PERIOD_MSͶһΣûɻص
+// ϵͳCPUռû֡޾ͽһ߶ҳGOVERNOR_RECOVER_PERIODSһ
+// ϵͳǱ̵CPUռжϣĽCPUʱͬ롣
+HRESULT CMixedGraph::GovernorTick(xse_arg_t* arg)
+{
+    FILETIME idle, kernel, user;
+    if (!::GetSystemTimes(&idle, &kernel, &user))
+        return S_OK;
+    // ں̬ʱ˿ʱ
+    ULONGLONG idleTime = ((ULONGLONG)idle.dwHighDateTime << 32) | idle.dwLowDateTime;
+    ULONGLONG busyTime = (((ULONGLONG)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime)
+        + (((ULONGLONG)user.dwHighDateTime << 32) | user.dwLowDateTime) - idleTime;
+    VideoRenderer::PresentJitter_t jitter = { 0 };
+    _videoRendererCmd->GetPresentJitter(&jitter);
+
+    if (_governorPrimed) {
+        ULONGLONG busy = busyTime - _lastBusyTime;
+        ULONGLONG total = busy + (idleTime - _lastIdleTime);
+        LONGLONG frames = jitter.frames - _lastPresentFrames;
+        LONGLONG late = jitter.lateFrames - _lastLateFrames;
+        _cpuPercent = total > 0 ? (int)(busy * 100 / total) : 0;
+        _latePermille = frames >= GOVERNOR_MIN_FRAMES ? (int)(late * 1000 / frames) : 0;
+
+        bool overloaded = _cpuPercent >= _cpuHighPercent || _latePermille >= LATE_HIGH_PERMILLE;
+        bool calm = _cpuPercent < _cpuLowPercent && _latePermille < LATE_LOW_PERMILLE;
+        int level = _shedLevel;
+        if (!_governorEnabled) {
+            _calmPeriods = 0;
+        }
+        else if (overloaded) {
+            _calmPeriods = 0;
+            level = min(level + 1, (int)MAX_SHED_LEVEL);
+        }
+        else if (!calm) {
+            _calmPeriods = 0;
+        }
+        else if (++_calmPeriods >= GOVERNOR_RECOVER_PERIODS) {
+            _calmPeriods = 0;
+            level = max(level - 1, (int)SHED_NONE);
+        }
+
+        if (level != _shedLevel) {
+            _shedLevel = level;
+            UpdateStreamSelection();
+        }
+    }
+
+    _governorPrimed = true;
+    _lastIdleTime = idleTime;
+    _lastBusyTime = busyTime;
+    _lastPresentFrames = jitter.frames;
+    _lastLateFrames = jitter.lateFrames;
+    return S_OK;
+}
@@ -6,6 +6,11 @@
 #pragma once
 #include "FixedGraph.h"
 
+// LAV Audio DecoderADMAudioDecodeṛCOMʽעᣩ
+// {E8E73B6B-4CB3-44A4-BE99-4F7BCB96E491}
+DEFINE_GUID(CLSID_LAVAudio,
+    0xe8e73b6b, 0x4cb3, 0x44a4, 0xbe, 0x99, 0x4f, 0x7b, 0xcb, 0x96, 0xe4, 0x91);
+
 class CMixedGraph : public CFixedGraph, public RtspSource::INotify
 {
 public:
@@ -47,9 +52,38 @@ public:
         ClosePending, // ֣ȡŴ...ز֡
     };
 
+    // ͨǰԴ࣬ĸԴ˾ӿڡ
+    enum class SourceKind {
+        Rtsp, // RtspSourceֱ
+        Mp4, // CMp4Source¼ļʱط
+        Heif, // CHeifSourceHEIF/HEIC̬ͼ
+    };
+
     enum { CHANNEL_COUNT = XSE_MAX_CHANNEL_ID + 1 };
     enum { THREAD_COUNT = CHANNEL_COUNT + 1 };
     enum { MISC_THREAD_INDEX = CHANNEL_COUNT }; // ͨض̵ִ߳±ꡣ
+    enum { SYNC_SEEK_DELAY_MS = 300 }; // ͬλʱͨԤʱ䣬֮ͬʱʼ֡
+    enum { SEEK_WAIT_TIMEOUT_MS = 3000 }; // ȴλĿ֡ɵʱ
+    enum { MAX_ZOOM = 16 }; // ֱ佹Ŵ
+    enum { HEIF_DECODE_TIMEOUT_MS = 5000 }; // Զž̬ͼʱȴͼƴʱ
+    enum { HEIF_POLL_MS = 5 };
+    enum { FOCUSED_DECODE_THREADS = 2 }; // ͨĽ߳һ֡ӳٻȡĽ
+    enum { GOVERNOR_PERIOD_MS = 1000 }; // صĲ
+    enum { GOVERNOR_RECOVER_PERIODS = 3 }; // ôڿвŻָһ
+    enum { DEFAULT_CPU_HIGH_PERCENT = 90 };
+    enum { DEFAULT_CPU_LOW_PERCENT = 70 };
+    enum { LATE_HIGH_PERMILLE = 250 }; // ֡ķ֮һΪ
+    enum { LATE_LOW_PERMILLE = 50 };
+    enum { GOVERNOR_MIN_FRAMES = 25 }; // һڳֵ̫֡ʱж
+
+    // صĽÿһǰĽ
+    enum ShedLevel {
+        SHED_NONE,
+        SHED_BACKGROUND_DECODE, // ֹ̨ͨͣ
+        SHED_VISIBLE_STREAM, // ɼͨ͵
+        SHED_VISIBLE_DECODE, // ɼֻͨؼ֡
+        MAX_SHED_LEVEL = SHED_VISIBLE_DECODE,
+    };
 
     typedef HRESULT(__thiscall CMixedGraph::* ApcFunc)(xse_arg_t*);
 
@@ -69,6 +103,44 @@ public:
     };
     typedef ConcurrentQueue<CMixedGraph::TaskItem*> TaskItemQueue;
 
+    // Ĺģһ̸ִͨ߳Ͷύͷ
+    struct BatchContext {
+        xse_arg_batch_t* arg = nullptr; // ύTaskItemӹͷ
+        volatile long remaining = 0; // δִͨ
+    };
+
+    // ģ̻߳صʱͷ
+    struct SnapshotContext {
+        CMixedGraph* graph = nullptr;
+        TaskItem* task = nullptr;
+        int thread = 0; // ڵִ߳
+        DWORD startTime = 0;
+        VideoRenderer::PresentJitter_t jitter = { 0 }; // ύʱĳֶۼֵ
+    };
+
+    // Ͷݵһ̵ͨ߳ĲֻЯָ룬ûɻص
+    struct BatchPartArg : xse_arg_t {
+        BatchContext* batch = nullptr;
+    };
+
+    // ͬλĹģͨͨĿ֡һɵͨͷ
+    struct SyncSeekContext {
+        TaskItem* task = nullptr; // λ
+        int thread = 0; // ִͨ߳
+        LONGLONG target = 0;
+        BOOL keyframeOnly = FALSE;
+        DWORD presentTime = 0; // ͨͬĳʱ
+        DWORD deadline = 0;
+        volatile long remaining = 0; // δɵͨ
+        volatile long failed = 0;
+        volatile long latency = 0; // ͨ֡ӳٵֵ
+    };
+
+    // ͬλͶݵ̵ͨ߳Ĳûɻص
+    struct SeekPartArg : xse_arg_t {
+        SyncSeekContext* seek = nullptr;
+    };
+
     static CMixedGraph* CreateInstace(HWND hwnd, HRESULT& hr);
 
     CMixedGraph(HWND hwnd, HRESULT& hr)
@@ -85,13 +157,30 @@ public:
             _source[i] = nullptr;
             _videoDecoder[i] = nullptr;
             _audioDecoder[i] = nullptr;
+            _audioRenderer[i] = nullptr;
+            _audioMuted[i] = false;
+            _zoomRect[i][0] = _zoomRect[i][1] = 0;
+            _zoomRect[i][2] = _zoomRect[i][3] = 1;
+            _streamCount[i] = 0;
+            _curStream[i] = 0;
+            _pinnedStream[i] = XSE_AUTO_STREAM;
+            _sourceKind[i] = SourceKind::Rtsp;
+            _paused[i] = false;
+            _hiddenVideoMode[i] = xse_decode_keyframe;
+            _pausedVideoMode[i] = xse_decode_none;
+            _idlePauseMs[i] = 0;
+            _videoMode[i] = xse_decode_full;
+            _qosClass[i] = xse_qos_auto;
         }
         _videoRendererCmd = nullptr;
         _videoRenderer = nullptr;
-        _audioRenderer = nullptr;
+        _audioFocus = XSE_INVALID_CHANNEL_ID;
+        _completionEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+        _frameEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
 
         for (int i = 0; i < THREAD_COUNT; ++i) {
             _threadState[i] = ThreadState::Idle;
+            _runningTask[i] = nullptr;
             _taskExecuteThread[i] = std::move(std::thread(&CMixedGraph::TaskExecuteThread, this, i));
         }
     }
@@ -136,11 +225,23 @@ public:
                 _source[i] = nullptr;
                 _videoDecoder[i] = nullptr;
                 _audioDecoder[i] = nullptr;
+                _audioRenderer[i] = nullptr;
             }
             _videoRendererCmd = nullptr;
             _videoRenderer = nullptr;
-            _audioRenderer = nullptr;
         }
+        // Ⱦʱ̰߳ѻûɵĿ񽻸ɶС
+        {
+            for (int i = 0; i < THREAD_COUNT; ++i) {
+                TaskItem* ti = nullptr;
+                while (_doneTaskQueue[i].try_pop(ti)) {
+                    SAFE_DELETE(ti);
+                }
+            }
+        }
+        // Ⱦ̶߳˳λ¼
+        SAFE_CLOSE_HANDLE(_completionEvent);
+        SAFE_CLOSE_HANDLE(_frameEvent);
         InterlockedDecrement(&_instanceCount);
     }
 
@@ -174,6 +275,15 @@ public:
 
     HRESULT DisconnectAudioRenderer() 
     {
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            if (_audioRenderer[i] == nullptr)
+                continue;
+            IPin* pIn = nullptr;
+            if (SUCCEEDED(FindConnectedPin(_audioRenderer[i], PINDIR_INPUT, &pIn))) {
+                pIn->Disconnect();
+                SAFE_RELEASE(pIn);
+            }
+        }
         return S_OK;
     }
 
@@ -199,6 +309,53 @@ public:
         return S_OK;
     }
 
+    // ̡̣߳߳
+    // ͨ飬ÿ漰ֻͨͶһȫִMISC߳ͳһύֲص
+    HRESULT PostBatch(xse_arg_t* arg)
+    {
+        xse_arg_batch_t* a = new xse_arg_batch_t;
+        memcpy(a, arg, sizeof(xse_arg_batch_t));
+        a->channel = XSE_INVALID_CHANNEL_ID;
+        a->result = xse_err_ok;
+        a->elapsed_ms = timeGetTime(); // ȼ¼ύʱ̣ύʱɺʱ
+        if (a->count < 0 || a->count > XSE_MAX_BATCH_ITEM_COUNT) {
+            a->result = xse_err_invalid_arg;
+            a->count = 0;
+            a->view_mode = -1;
+        }
+
+        bool involved[CHANNEL_COUNT] = { false };
+        long parts = 0;
+        for (int k = 0; k < a->count; ++k) {
+            xse_batch_item_t& item = a->items[k];
+            if (item.channel < XSE_MIN_CHANNEL_ID || item.channel > XSE_MAX_CHANNEL_ID) {
+                item.result = xse_err_invalid_channel;
+                continue;
+            }
+            item.result = xse_err_ok;
+            if (!involved[item.channel]) {
+                involved[item.channel] = true;
+                ++parts;
+            }
+        }
+
+        if (parts == 0)
+            return PostAPC(new TaskItem(&CMixedGraph::BatchCommit, a));
+
+        BatchContext* ctx = new BatchContext;
+        ctx->arg = a;
+        ctx->remaining = parts;
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            if (!involved[i])
+                continue;
+            BatchPartArg* p = new BatchPartArg;
+            p->channel = i;
+            p->batch = ctx;
+            PostAPC(new TaskItem(&CMixedGraph::BatchPart, p));
+        }
+        return S_OK;
+    }
+
     HRESULT PostQuitMsg()
     {
         _exitThread = true;
@@ -216,8 +373,8 @@ public:
     HRESULT DispatchCompletedAPC() 
     {
         for (int i = 0; i < THREAD_COUNT; ++i) {
-            if (_source[i] == nullptr)
-                continue;
+            if (i < CHANNEL_COUNT && SourceOf(i) == nullptr)
+                continue; // MISC߳ûжӦ֪ͨͨҪɷ
 
             TaskItem* ti = nullptr;
             while (_doneTaskQueue[i].try_pop(ti)) {
@@ -235,6 +392,9 @@ public:
         ASSERT(_videoRenderer == nullptr);
         GDIRenderer_CreateInstance(_hwndHost, &_videoRenderer);
         hr = _videoRenderer->QueryInterface(IID_IVideoRendererCommand, (void**)&_videoRendererCmd);
+        if (SUCCEEDED(hr)) {
+            _videoRendererCmd->SetFrameReadyEvent(_frameEvent);
+        }
 
         return hr;
     }
@@ -244,11 +404,12 @@ public:
         HRESULT hr = S_OK;
 
         ASSERT(_source[i] == nullptr);
-        ASSERT(_videoDecoder[i] == nullptr);
 
         // RTSPֱԴ
         {
-            RtspSource_CreateInstance(&_source[i]);
+            CComPtr<IBaseFilter> source;
+            RtspSource_CreateInstance(&source);
+            SetSource(i, source);
             CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
             cmd->SetChannelId(i);
             cmd->SetStreamingOverTcp(TRUE);
@@ -257,6 +418,29 @@ public:
             cmd->SetLatency(0);
             cmd->SetAutoReconnectionPeriod(5000);
             cmd->SetNotifyReceiver(static_cast<RtspSource::INotify*>(this));
+            cmd->SetSyncGroup(&_syncGroup);
+            cmd->SetRelay(&_relay);
+            cmd->SetReconnectLimiter(&_reconnectLimiter);
+            cmd->SetReplayBuffer(&_replayBuffer);
+            cmd->SetIdlePauseDelay(_idlePauseMs[i]);
+        }
+        _sourceKind[i] = SourceKind::Rtsp;
+        ApplyStreamingPriority(i);
+
+        VERIFY_HR(BuildVideoChain(i));
+
+        return hr;
+    }
+
+    // ԴƵPin -> Ƶ -> ȾĵiPin
+    // ͨԴRTSPļʱȾӶڣֻԴӵϡ
+    HRESULT BuildVideoChain(int i)
+    {
+        HRESULT hr = S_OK;
+
+        if (_videoDecoder[i] != nullptr) {
+            ConfigureDecoder(i);
+            return ConnectFilters(_source[i], _videoDecoder[i]);
         }
 
         // Ƶ
@@ -264,6 +448,7 @@ public:
             LAVVideo_CreateInstance(&_videoDecoder[i]);
             CComQIPtr<ILAVVideoConfig> cmd(_videoDecoder[i]);
             cmd->SetOutputBufferCount(5);
+            ConfigureDecoder(i);
             VERIFY_HR(ConnectFilters(_source[i], _videoDecoder[i]));
         }
 
@@ -272,6 +457,139 @@ public:
         return hr;
     }
 
+    // ͨԴֻͨ߳滻滻ʱ̶ͨ߳ԼԴؼ
+    // ̣߳MISC̡̣߳߳ͨSourceOf()ȡһõĸʹã
+    // ͨԴʱ˾Ҫȸͷź١
+    CComPtr<IBaseFilter> SourceOf(int i)
+    {
+        std::lock_guard<std::mutex> lock(_sourceLock);
+        return _source[i];
+    }
+
+    void SetSource(int i, IBaseFilter* source)
+    {
+        CComPtr<IBaseFilter> old; // ͷžɵԴ
+        std::lock_guard<std::mutex> lock(_sourceLock);
+        old.Attach(_source[i].Detach());
+        _source[i] = source;
+    }
+
+    // ͨǰԴֹֻͨͣIdleʱá
+    // PinԴϿȴӵԴϣƵ·´OpenʱԴؽ
+    void ReleaseSource(int i)
+    {
+        IPin* pIn = nullptr;
+        if (_videoDecoder[i] != nullptr && SUCCEEDED(FindConnectedPin(_videoDecoder[i], PINDIR_INPUT, &pIn))) {
+            pIn->Disconnect();
+            SAFE_RELEASE(pIn);
+        }
+        if (_audioDecoder[i] != nullptr) {
+            DisconnectFilter(_audioDecoder[i]);
+            _audioDecoder[i] = nullptr;
+            _audioRenderer[i] = nullptr;
+        }
+        DisconnectFilter(_source[i]);
+        SetSource(i, nullptr);
+        if (_sourceKind[i] == SourceKind::Heif) {
+            _videoRendererCmd->SetMosaic(i, nullptr);
+        }
+    }
+
+
+    // Ƶ·RtspSourceAACPin -> LAVƵ -> DirectSoundȾ
+    // AACPinSETUPӦŴԱOpenURL֮Pause֮ǰá
+    // ÿͨƵ·ԤãֻнͨRtspSource
+    // ͨƵlive555߳̾ͱȾڿ״̬
+    // ϵͳʼֻнͨ
+    // ƵȾʱֻͨƵΪ
+    HRESULT BuildAudioChain(int i)
+    {
+        HRESULT hr = S_OK;
+        IPin* pOut = nullptr;
+
+        if (_audioDecoder[i] != nullptr)
+            return S_OK; // StopٴOpenõ·
+
+        if (FAILED(FindUnconnectedPin(_source[i], PINDIR_OUTPUT, &pOut)))
+            return S_FALSE; // ·ûƵ
+
+        CHECK_HR(_audioDecoder[i].CoCreateInstance(CLSID_LAVAudio, nullptr, CLSCTX_INPROC));
+        CHECK_HR(ConnectFilters(pOut, _audioDecoder[i]));
+        CHECK_HR(_audioRenderer[i].CoCreateInstance(CLSID_DSoundRender, nullptr, CLSCTX_INPROC));
+        CHECK_HR(ConnectFilters(_audioDecoder[i], _audioRenderer[i]));
+
+    done:
+        SAFE_RELEASE(pOut);
+        if (FAILED(hr)) {
+            if (_audioDecoder[i] != nullptr)
+                DisconnectFilter(_audioDecoder[i]);
+            _audioDecoder[i] = nullptr;
+            _audioRenderer[i] = nullptr;
+            return S_FALSE;
+        }
+        ApplyAudioMute(i);
+        return hr;
+    }
+
+    // ԴýԴӵ֮ǰãԴĸʽ³ʼʱЧ
+    void ConfigureDecoder(int i)
+    {
+        ApplyDecodeThreads(i);
+        ApplyZoom(i);
+    }
+
+    // ̬ͼͼ黥̣֡߳ÿһ̣߳н룻
+    // ͨһ̣߳Ƶֵ̣ͨ߳ӽӳ١
+    // һ³ʼԴлĸʽ仯ʱЧ
+    void ApplyDecodeThreads(int i)
+    {
+        CComQIPtr<ILAVVideoConfig> cmd(_videoDecoder[i]);
+        if (cmd == nullptr)
+            return;
+        int threads = 1;
+        if (_sourceKind[i] == SourceKind::Heif)
+            threads = 0;
+        else if (QosClassOf(i) == xse_qos_focused)
+            threads = FOCUSED_DECODE_THREADS;
+        cmd->SetDecodeThreads(threads);
+    }
+
+    // ߳ͬ߳ȼCPUʱһ·ֵܷʱ䡣
+    void ApplyStreamingPriority(int i)
+    {
+        static const int priorities[] = {
+            THREAD_PRIORITY_NORMAL, // xse_qos_auto
+            THREAD_PRIORITY_ABOVE_NORMAL, // xse_qos_focused
+            THREAD_PRIORITY_NORMAL, // xse_qos_visible
+            THREAD_PRIORITY_BELOW_NORMAL, // xse_qos_background
+            THREAD_PRIORITY_LOWEST, // xse_qos_recording_only룬̼߳
+        };
+        CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
+        if (cmd != nullptr)
+            cmd->SetStreamingPriority(priorities[QosClassOf(i)]);
+    }
+
+    // ͨһδʱ֮ǰõı佹ʱЧ
+    // ̬ͼͼƴӣÿͼ鶼Ҫת佹ƵԴʱЧ
+    void ApplyZoom(int i)
+    {
+        static const float fullFrame[4] = { 0, 0, 1, 1 };
+        CComQIPtr<ILAVVideoConfig> cmd(_videoDecoder[i]);
+        if (cmd == nullptr)
+            return;
+        const float* r = _sourceKind[i] == SourceKind::Heif ? fullFrame : _zoomRect[i];
+        cmd->SetCropRect(r[0], r[1], r[2], r[3]);
+    }
+
+    // ͨʵʾ״̬ = û || ǽͨ
+    // ̣̣߳ͨ߳лƵMISC̡߳
+    void ApplyAudioMute(int i)
+    {
+        CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(SourceOf(i));
+        if (cmd == nullptr)
+            return; // ļԴûƵ
+        cmd->SetAudioMute((_audioMuted[i] || _audioFocus != i) ? TRUE : FALSE);
+    }
 
     HRESULT ConnectToRenderer(IBaseFilter* pSrc, int pinIndex)
     {
@@ -295,20 +613,62 @@ public:
         return hr;
     }
 
-    // HEIFһHEVCƵ+һAACƵADTSͷһЩԪݡ
-    // ֧ͼ̬I֡ǽһI֡ԤΪThumbNailСHEVCI֡
-    // HEIFڱʾƵļͳľ̬JPGļ
-    // HEIFʽֶ֧ͷͼƬֶ֧̬ȡ
-    // HEIFRTSPЭȼ۵Эơ
-    // RTSPýͨTCP|UDP䡣HEIFʽݿԴChannel|Storageȡ
-    HRESULT BuildHeifSource()
+    // HEIF/HEIC̬ͼԴֻƵͼÿͼ鶼ǶHEVC֡
+    // ̲߳н룬ȾѽͼƴϣͼΪռλ
+    HRESULT BuildHeifSource(int i)
     {
-        return E_NOTIMPL;
+        HRESULT hr = S_OK;
+
+        ASSERT(_source[i] == nullptr);
+
+        {
+            CComPtr<IBaseFilter> source;
+            HeifSource_CreateInstance(&source);
+            SetSource(i, source);
+            CComQIPtr<HeifSource::ICommand, &IID_IHeifSourceCommand> cmd(_source[i]);
+            cmd->SetChannelId(i);
+            cmd->SetNotifyReceiver(static_cast<RtspSource::INotify*>(this));
+        }
+        _sourceKind[i] = SourceKind::Heif;
+
+        VERIFY_HR(BuildVideoChain(i));
+
+        return hr;
     }
 
-    HRESULT BuildMp4Source()
+    // MP4/fMP4¼ļԴֻƵʱļŽȾʱơ
+    HRESULT BuildMp4Source(int i)
     {
-        return E_NOTIMPL;
+        HRESULT hr = S_OK;
+
+        ASSERT(_source[i] == nullptr);
+
+        {
+            CComPtr<IBaseFilter> source;
+            Mp4Source_CreateInstance(&source);
+            SetSource(i, source);
+            CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+            cmd->SetChannelId(i);
+            cmd->SetNotifyReceiver(static_cast<RtspSource::INotify*>(this));
+        }
+        _sourceKind[i] = SourceKind::Mp4;
+
+        VERIFY_HR(BuildVideoChain(i));
+
+        return hr;
+    }
+
+    // file://ǰ׺߲ЭͷĶļ·
+    static bool IsFileUrl(const wchar_t* url)
+    {
+        return _wcsnicmp(url, L"file://", 7) == 0 || wcsstr(url, L"://") == nullptr;
+    }
+
+    // ļչ־̬ͼ¼
+    static bool IsHeifPath(const wchar_t* path)
+    {
+        const wchar_t* ext = wcsrchr(path, L'.');
+        return ext != nullptr && (_wcsicmp(ext, L".heic") == 0 || _wcsicmp(ext, L".heif") == 0 || _wcsicmp(ext, L".hif") == 0);
     }
 
     //--------------------------------------------------------------------------
@@ -338,6 +698,8 @@ public:
         xse_arg_view_t* a = (xse_arg_view_t*)arg;
 
         hr = _videoRendererCmd->SetViewMode(a->mode);
+        UpdateStreamSelection();
+        UpdateReconnectPriority();
 
         // ˲Ի̵߳ģ߳ӵյĺϳĿӿڲϢ
         // ôݸ
@@ -362,6 +724,8 @@ public:
         xse_arg_sync_resize_t* a = (xse_arg_sync_resize_t*)arg;
 
         _videoRendererCmd->SetObjectRects(&a->pos_rect, &a->clip_rect);
+        UpdateStreamSelection();
+        UpdateReconnectPriority();
 
         return hr;
     }
@@ -374,6 +738,24 @@ public:
         tc.last_update_time = a->last_update_time;
         tc.cur_update_time = a->cur_update_time;
         a->result = _videoRendererCmd->Update(&tc) ? xse_err_ok : xse_err_no_more_data;
+
+        // ÿһ֡ãصʱ͵MISC߳̽С
+        DWORD now = timeGetTime();
+        if (now - _governorTickTime >= GOVERNOR_PERIOD_MS) {
+            _governorTickTime = now;
+            xse_arg_t* tick = new xse_arg_t;
+            tick->channel = XSE_INVALID_CHANNEL_ID;
+            PostAPC(new TaskItem(&CMixedGraph::GovernorTick, tick));
+        }
+        return S_OK;
+    }
+
+    HRESULT SyncGetEvents(xse_arg_t* arg)
+    {
+        xse_arg_sync_get_events_t* a = (xse_arg_sync_get_events_t*)arg;
+        a->completion_event = _completionEvent;
+        a->frame_event = _frameEvent;
+        a->result = (_completionEvent != NULL && _frameEvent != NULL) ? xse_err_ok : xse_err_fail;
         return S_OK;
     }
 
@@ -393,6 +775,14 @@ public:
     }
 
     HRESULT Open(xse_arg_t* arg);
+    HRESULT OpenFile(xse_arg_open_t* a);
+    HRESULT OpenHeif(xse_arg_open_t* a, const wchar_t* path);
+    HRESULT GovernorTick(xse_arg_t* arg);
+    HRESULT AutoRun(int i);
+    HRESULT Replay(xse_arg_t* arg);
+    HRESULT OpenReplay(xse_arg_replay_t* a, int source);
+    HRESULT Snapshot(xse_arg_t* arg);
+    static void CALLBACK OnSnapshotComplete(void* ctx, const VideoRenderer::SnapshotResult_t* result);
 
     // RtspSourcelive555 scheduler߳еõģ
     STDMETHODIMP_(void) OnOpenURLCompleted(void* ctx, RtspSource::ErrorCode err)
@@ -421,9 +811,15 @@ public:
             return E_INVALIDARG;
 
         // TODOͨοʱӣȡǰοʱQueryPerformanceCounter)
+        _paused[i] = false;
+        ApplyVideoMode(i);
         _threadState[i] = ThreadState::PlayPending;
         VERIFY_HR(_videoRendererCmd->Run(i, 0));
         VERIFY_HR(_videoDecoder[i]->Run(i));
+        if (_audioDecoder[i] != nullptr) {
+            VERIFY_HR(_audioRenderer[i]->Run(0));
+            VERIFY_HR(_audioDecoder[i]->Run(0));
+        }
         VERIFY_HR(_source[i]->Run(i));
         _threadState[i] = ThreadState::Playing;
 
@@ -443,8 +839,14 @@ public:
         _threadState[i] = ThreadState::PausePending;
         VERIFY_HR(_videoRendererCmd->Pause(i));
         VERIFY_HR(_videoDecoder[i]->Pause());
+        if (_audioDecoder[i] != nullptr) {
+            VERIFY_HR(_audioRenderer[i]->Pause());
+            VERIFY_HR(_audioDecoder[i]->Pause());
+        }
         VERIFY_HR(_source[i]->Pause());
         _threadState[i] = ThreadState::Paused;
+        _paused[i] = true;
+        ApplyVideoMode(i);
 
         return hr;
     }
@@ -468,9 +870,14 @@ public:
                 _threadState[i] = ThreadState::StopPending;
                 VERIFY_HR(_videoRendererCmd->Stop(i));
                 VERIFY_HR(_videoDecoder[i]->Stop());
+                if (_audioDecoder[i] != nullptr) {
+                    VERIFY_HR(_audioRenderer[i]->Stop());
+                    VERIFY_HR(_audioDecoder[i]->Stop());
+                }
                 VERIFY_HR(_source[i]->Stop());
                 _threadState[i] = ThreadState::Stopped;
                 _threadState[i] = ThreadState::Idle;
+                _paused[i] = false;
             }
         }
         else {
@@ -480,37 +887,397 @@ public:
         return hr;
     }
 
+    // ̡̣߳ͨ߳
+    // ͬλʱͨȶλٸÿͨͶһSeekPartͨԼ߳ﰴͬһʱ
+    // λȴĿ֡ɣMp4SourceĶλֻǳϴΡλȽ룬ܿ췵أ
+    // 񷵻E_PENDINGһɵ֮ͨͨ߳䲻ȴ
     HRESULT Seek(xse_arg_t* arg)
     {
+        xse_arg_seek_t* a = (xse_arg_seek_t*)arg;
         HRESULT hr = S_OK;
         int i = arg->channel;
 
         if (!CheckChannel(arg))
             return E_INVALIDARG;
+        if (_source[i] == nullptr || _threadState[i] == ThreadState::Idle) {
+            arg->result = xse_err_channel_not_started;
+            return hr;
+        }
+        CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+        if (cmd == nullptr) {
+            arg->result = xse_err_fail; // ֱԴܶλ
+            return E_NOTIMPL;
+        }
 
-        return hr;
+        LONGLONG origin = 0;
+        double fps = 25.0;
+        cmd->GetFrameRate(&fps);
+        if (a->mode == 1) {
+            VERIFY_HR(cmd->GetPosition(&origin));
+        }
+        else if (a->mode == 2) {
+            VERIFY_HR(cmd->GetDuration(&origin));
+        }
+        // ֡λʱ߰֡ȡĿǰһ֡ϡ
+        LONGLONG target = origin + a->offset_ms;
+        if (a->frames != 0) {
+            target += (LONGLONG)((a->frames + 0.5) * 1000 / fps);
+        }
+
+        bool syncFiles = (a->flags & xse_seek_sync_files) != 0;
+        BOOL keyframeOnly = (a->flags & xse_seek_keyframe) != 0;
+        DWORD presentTime = syncFiles ? timeGetTime() + SYNC_SEEK_DELAY_MS : 0;
+        LONGLONG actual = 0;
+        if (FAILED(cmd->Seek(target, keyframeOnly, presentTime, &actual))) {
+            arg->result = xse_err_fail;
+            return hr;
+        }
+        a->position_ms = actual;
+        a->latency_ms = 0;
+
+        // ֡ӳ٣ӷλĿ֡ɣGOP4KļҪԤϡ
+        DWORD deadline = timeGetTime() + SEEK_WAIT_TIMEOUT_MS;
+        if (!syncFiles) {
+            WaitSeekTarget(i, deadline, &a->latency_ms);
+            return hr;
+        }
+
+        SyncSeekContext* ctx = new SyncSeekContext;
+        ctx->task = _runningTask[i];
+        ctx->thread = i;
+        ctx->target = target;
+        ctx->keyframeOnly = keyframeOnly;
+        ctx->presentTime = presentTime;
+        ctx->deadline = deadline;
+        ctx->remaining = CHANNEL_COUNT;
+        for (int k = 0; k < CHANNEL_COUNT; ++k) {
+            if (k == i)
+                continue;
+            SeekPartArg* p = new SeekPartArg;
+            p->channel = k;
+            p->seek = ctx;
+            PostAPC(new TaskItem(&CMixedGraph::SeekPart, p));
+        }
+
+        DWORD latency = 0;
+        WaitSeekTarget(i, deadline, &latency);
+        CompleteSeekPart(ctx, true, latency);
+        return E_PENDING;
     }
 
+    // ̡̣߳ͨ߳ͬλбͨĲ֣ڲŵļͨʱֻ
+    HRESULT SeekPart(xse_arg_t* arg)
+    {
+        SyncSeekContext* ctx = ((SeekPartArg*)arg)->seek;
+        int i = arg->channel;
+        bool ok = true;
+        DWORD latency = 0;
+
+        if (_sourceKind[i] == SourceKind::Mp4 && _source[i] != nullptr && _threadState[i] != ThreadState::Idle) {
+            CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+            ok = SUCCEEDED(cmd->Seek(ctx->target, ctx->keyframeOnly, ctx->presentTime, nullptr));
+            if (ok)
+                WaitSeekTarget(i, ctx->deadline, &latency);
+        }
+        CompleteSeekPart(ctx, ok, latency);
+        return S_OK;
+    }
+
+    // ȴͨλĿ֡ɡͣʱĿ֡ҪȻָŲͳȴʱʱlatency
+    void WaitSeekTarget(int i, DWORD deadline, DWORD* latency)
+    {
+        if (_paused[i])
+            return;
+        CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+        DWORD remaining = max((int32_t)(deadline - timeGetTime()), 0);
+        DWORD elapsed = 0;
+        if (cmd->WaitSeekComplete(remaining, &elapsed) == S_OK)
+            *latency = elapsed;
+    }
+
+    // һͨͬλɺãһɵͨѽдط񲢽
+    void CompleteSeekPart(SyncSeekContext* ctx, bool ok, DWORD latency)
+    {
+        if (!ok)
+            InterlockedExchange(&ctx->failed, 1);
+        long cur = ctx->latency;
+        while ((long)latency > cur) {
+            long prev = InterlockedCompareExchange(&ctx->latency, (long)latency, cur);
+            if (prev == cur)
+                break;
+            cur = prev;
+        }
+        if (InterlockedDecrement(&ctx->remaining) != 0)
+            return;
+
+        xse_arg_seek_t* a = (xse_arg_seek_t*)ctx->task->pArg;
+        a->latency_ms = (DWORD)ctx->latency;
+        if (ctx->failed)
+            a->result = xse_err_fail;
+        _doneTaskQueue[ctx->thread].push(ctx->task);
+        ::SetEvent(_completionEvent);
+        delete ctx;
+    }
+
+    // ̡̣߳ͨ߳
     HRESULT Rate(xse_arg_t* arg)
     {
+        xse_arg_rate_t* a = (xse_arg_rate_t*)arg;
         HRESULT hr = S_OK;
         int i = arg->channel;
 
         if (!CheckChannel(arg))
             return E_INVALIDARG;
+        if (_source[i] == nullptr || _threadState[i] == ThreadState::Idle) {
+            arg->result = xse_err_channel_not_started;
+            return hr;
+        }
+        CComQIPtr<Mp4Source::ICommand, &IID_IMp4SourceCommand> cmd(_source[i]);
+        if (cmd == nullptr) {
+            arg->result = xse_err_fail; // ֱԴܱ
+            return E_NOTIMPL;
+        }
+
+        Mp4Source::FrameSelection selection = Mp4Source::SelectAll;
+        hr = cmd->SetRate(a->rate, &selection);
+        if (hr == E_INVALIDARG) {
+            arg->result = xse_err_invalid_arg;
+        }
+        else if (FAILED(hr)) {
+            arg->result = xse_err_fail;
+        }
+        a->frame_select = selection;
 
         return hr;
     }
 
+    // ̡̣߳ͨ߳
     HRESULT Zoom(xse_arg_t* arg)
     {
-        HRESULT hr = S_OK;
+        xse_arg_zoom_t* a = (xse_arg_zoom_t*)arg;
+        int i = arg->channel;
+
+        if (!CheckChannel(arg))
+            return E_INVALIDARG;
+
+        if (!(a->x >= 0 && a->x <= 1 && a->y >= 0 && a->y <= 1 &&
+            a->w >= 1 && a->w <= MAX_ZOOM && a->h >= 1 && a->h <= MAX_ZOOM)) {
+            arg->result = xse_err_invalid_arg;
+            return E_INVALIDARG;
+        }
+
+        // Ϊ1/w1/hĿԵʱƽƻػڡ
+        float halfW = 0.5f / a->w;
+        float halfH = 0.5f / a->h;
+        float left = max(0.0f, min(a->x - halfW, 1.0f - 2 * halfW));
+        float top = max(0.0f, min(a->y - halfH, 1.0f - 2 * halfH));
+        _zoomRect[i][0] = left;
+        _zoomRect[i][1] = top;
+        _zoomRect[i][2] = left + 2 * halfW;
+        _zoomRect[i][3] = top + 2 * halfH;
+        ApplyZoom(i);
+
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳
+    HRESULT Mute(xse_arg_t* arg)
+    {
+        xse_arg_mute_t* a = (xse_arg_mute_t*)arg;
+        int i = arg->channel;
+
+        if (!CheckChannel(arg))
+            return E_INVALIDARG;
+
+        _audioMuted[i] = a->mute;
+        ApplyAudioMute(i);
+
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳
+    // ĸӿڣͲǸӿڵɽͨȾ½ͨٽ
+    // л˲䲻·ͬʱ
+    HRESULT AudioFocus(xse_arg_t* arg)
+    {
+        xse_arg_audio_focus_t* a = (xse_arg_audio_focus_t*)arg;
+        int focus = a->focus_channel;
+
+        if (focus < XSE_INVALID_CHANNEL_ID || focus > XSE_MAX_CHANNEL_ID) {
+            arg->result = xse_err_invalid_channel;
+            return E_INVALIDARG;
+        }
+
+        int old = _audioFocus;
+        _audioFocus = focus;
+        if (old != XSE_INVALID_CHANNEL_ID)
+            ApplyAudioMute(old);
+        if (focus != XSE_INVALID_CHANNEL_ID)
+            ApplyAudioMute(focus);
+        UpdateStreamSelection(); // Զͨ潹ı
+        UpdateReconnectPriority();
+
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳
+    // úRTCPͬͨNTPʱ֣ͬһ¼ڻǽͬʱ֡
+    // Ƿ޸Ŀأ᷵ÿͨΪӵӳٺ޷ƫ
+    HRESULT SyncGroup(xse_arg_t* arg)
+    {
+        xse_arg_sync_group_t* a = (xse_arg_sync_group_t*)arg;
+        CSyncGroup::ChannelStats stats[CSyncGroup::MAX_CHANNELS];
+        int maxSkew = 0;
+
+        if (a->enable >= 0)
+            _syncGroup.SetEnabled(a->enable != 0);
+
+        _syncGroup.GetStats(stats, &maxSkew);
+        a->enabled = _syncGroup.IsEnabled();
+        a->max_skew_ms = maxSkew;
+        for (int i = 0; i < CHANNEL_COUNT && i < CSyncGroup::MAX_CHANNELS; ++i) {
+            a->member[i] = stats[i].member;
+            a->added_latency_ms[i] = stats[i].addedLatencyMs;
+            a->skew_ms[i] = stats[i].skewMs;
+        }
+
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳
+    // תǰڲŵͨҲȡԴֻпͻPLAYʱſݡ
+    HRESULT Restream(xse_arg_t* arg)
+    {
+        xse_arg_restream_t* a = (xse_arg_restream_t*)arg;
+
+        if (a->enable > 0) {
+            if (a->port == 0) {
+                arg->result = xse_err_invalid_arg;
+                return E_INVALIDARG;
+            }
+            if (!_relay.Start(a->port))
+                arg->result = xse_err_fail;
+        }
+        else if (a->enable == 0) {
+            _relay.Stop();
+        }
+
+        a->running = _relay.IsRunning();
+        a->clients = _relay.GetClientCount();
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳
+    HRESULT Reconnect(xse_arg_t* arg)
+    {
+        xse_arg_reconnect_t* a = (xse_arg_reconnect_t*)arg;
+        CReconnectLimiter::Stats stats;
+
+        _reconnectLimiter.SetLimits(a->max_concurrent, a->rate_per_sec);
+        _reconnectLimiter.GetStats(&stats);
+        a->in_flight = stats.inFlight;
+        a->peak_in_flight = stats.peakInFlight;
+        a->waiting = stats.waiting;
+        a->granted = stats.granted;
+
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳
+    HRESULT Health(xse_arg_t* arg)
+    {
+        xse_arg_health_t* a = (xse_arg_health_t*)arg;
+
+        for (int i = 0; i < CHANNEL_COUNT && i < XSE_MAX_CHANNEL_COUNT; ++i) {
+            CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(SourceOf(i));
+            if (cmd == nullptr)
+                continue; // δ򿪻ļԴ
+            RtspSource::Health health;
+            cmd->GetHealth(&health);
+            a->score[i] = health.score;
+            a->loss_permille[i] = health.lossPermille;
+            a->jitter_ms[i] = health.jitterMs;
+            a->sr_age_ms[i] = health.srAgeMs;
+            a->silence_ms[i] = health.silenceMs;
+            a->gap_threshold_ms[i] = health.gapThresholdMs;
+            a->reconnects[i] = health.reconnects;
+            a->dropped_nalus[i] = health.droppedNalus;
+        }
+
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳
+    // ͨûʱֻã򿪺Ч
+    HRESULT Background(xse_arg_t* arg)
+    {
+        xse_arg_background_t* a = (xse_arg_background_t*)arg;
         int i = arg->channel;
 
         if (!CheckChannel(arg))
             return E_INVALIDARG;
+        if (a->hidden_mode > xse_decode_none || a->paused_mode > xse_decode_none || a->idle_pause_ms < -1) {
+            arg->result = xse_err_invalid_arg;
+            return E_INVALIDARG;
+        }
+
+        if (a->hidden_mode >= 0)
+            _hiddenVideoMode[i] = a->hidden_mode;
+        if (a->paused_mode >= 0)
+            _pausedVideoMode[i] = a->paused_mode;
+        if (a->idle_pause_ms >= 0) {
+            _idlePauseMs[i] = a->idle_pause_ms;
+            CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
+            if (cmd != nullptr)
+                cmd->SetIdlePauseDelay(_idlePauseMs[i]);
+        }
+        ApplyVideoMode(i);
+        a->mode = (xse_decode_mode_t)_videoMode[i];
+
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳
+    // ͨûʱֻ𣬴򿪺Чȫ̹á
+    HRESULT Qos(xse_arg_t* arg)
+    {
+        xse_arg_qos_t* a = (xse_arg_qos_t*)arg;
+        int i = arg->channel;
+
+        if (!CheckChannel(arg))
+            return E_INVALIDARG;
+        if (a->qos_class < -1 || a->qos_class > xse_qos_recording_only || a->governor < -1 || a->governor > 1
+            || a->cpu_high_percent > 100 || a->cpu_low_percent > 100) {
+            arg->result = xse_err_invalid_arg;
+            return E_INVALIDARG;
+        }
+
+        if (a->cpu_high_percent > 0)
+            _cpuHighPercent = a->cpu_high_percent;
+        if (a->cpu_low_percent > 0)
+            _cpuLowPercent = a->cpu_low_percent;
+        if (a->governor >= 0 && _governorEnabled != (a->governor != 0)) {
+            _governorEnabled = a->governor != 0;
+            if (!_governorEnabled && _shedLevel != SHED_NONE) {
+                _shedLevel = SHED_NONE;
+                UpdateStreamSelection();
+            }
+        }
+        if (a->qos_class >= 0 && a->qos_class != _qosClass[i]) {
+            _qosClass[i] = a->qos_class;
+            ApplyQos(i);
+            UpdateReconnectPriority();
+        }
 
-        return E_NOTIMPL;
+        VideoRenderer::PresentJitter_t jitter = { 0 };
+        _videoRendererCmd->GetPresentJitter(&jitter);
+        a->effective_class = QosClassOf(i);
+        a->shed_level = _shedLevel;
+        a->cpu_percent = _cpuPercent;
+        a->late_permille = _latePermille;
+        a->presented_frames = jitter.channelFrames[i];
+
+        return S_OK;
     }
 
     HRESULT Layout(xse_arg_t* arg)
@@ -528,20 +1295,330 @@ public:
         vd.w = a->w;
         vd.h = a->h;
         hr = _videoRendererCmd->SetLayout(i, &vd);
+        UpdateStreamSelection();
+        UpdateReconnectPriority();
+
+        return hr;
+    }
+
+    // ̡̣߳ͨ߳˳ִڱͨĸ
+    // ӿڲֻУ飬BatchCommitͳһύ
+    HRESULT BatchPart(xse_arg_t* arg)
+    {
+        BatchContext* ctx = ((BatchPartArg*)arg)->batch;
+        xse_arg_batch_t* a = ctx->arg;
+        int i = arg->channel;
+
+        for (int k = 0; k < a->count; ++k) {
+            xse_batch_item_t& item = a->items[k];
+            if (item.channel != i)
+                continue;
+
+            xse_arg_t sub;
+            sub.op = item.op;
+            sub.channel = i;
+            switch (item.op) {
+            case xse_op_play:
+            case xse_op_pause:
+                if (_source[i] == nullptr) {
+                    item.result = xse_err_channel_not_started;
+                    break;
+                }
+                if (FAILED(item.op == xse_op_play ? Play(&sub) : Pause(&sub)))
+                    item.result = xse_err_fail;
+                break;
+            case xse_op_stop:
+                Stop(&sub);
+                item.result = sub.result;
+                break;
+            case xse_op_layout:
+                break;
+            default:
+                item.result = xse_err_invalid_arg;
+                break;
+            }
+        }
+
+        if (InterlockedDecrement(&ctx->remaining) == 0) {
+            PostAPC(new TaskItem(&CMixedGraph::BatchCommit, a));
+            delete ctx;
+        }
+        return S_OK;
+    }
+
+    // ̣߳MISC_THREAD_INDEX̡߳ͨִ
+    // ӿڲֺͼģʽһԽڴ̵߳һUpdateʱЧ
+    HRESULT BatchCommit(xse_arg_t* arg)
+    {
+        xse_arg_batch_t* a = (xse_arg_batch_t*)arg;
+        int channels[XSE_MAX_BATCH_ITEM_COUNT];
+        VideoRenderer::ViewportDesc_t descs[XSE_MAX_BATCH_ITEM_COUNT];
+        int n = 0;
+
+        for (int k = 0; k < a->count; ++k) {
+            const xse_batch_item_t& item = a->items[k];
+            if (item.result != xse_err_ok) {
+                a->result = xse_err_fail;
+            }
+            else if (item.op == xse_op_layout) {
+                channels[n] = item.channel;
+                descs[n].x = item.x;
+                descs[n].y = item.y;
+                descs[n].w = item.w;
+                descs[n].h = item.h;
+                ++n;
+            }
+        }
+        if (a->view_mode != -1 && (a->view_mode < XSE_MIN_VIEW_MODE_ID || a->view_mode > XSE_MAX_VIEW_MODE_ID)) {
+            a->result = xse_err_invalid_arg;
+            a->view_mode = -1;
+        }
+
+        if (n > 0 || a->view_mode != -1) {
+            if (FAILED(_videoRendererCmd->SetLayoutBatch(a->view_mode, n, channels, descs)))
+                a->result = xse_err_fail;
+            UpdateStreamSelection();
+            UpdateReconnectPriority();
+        }
+        a->elapsed_ms = timeGetTime() - a->elapsed_ms;
+
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳
+    HRESULT SelectStream(xse_arg_t* arg)
+    {
+        xse_arg_select_stream_t* a = (xse_arg_select_stream_t*)arg;
+        int i = arg->channel;
+
+        if (!CheckChannel(arg))
+            return E_INVALIDARG;
+        if (a->stream < XSE_AUTO_STREAM || a->stream > XSE_MAX_SUB_STREAM_COUNT
+            || (a->stream != XSE_AUTO_STREAM && a->stream >= _streamCount[i])) {
+            arg->result = xse_err_invalid_arg;
+            return E_INVALIDARG;
+        }
+
+        _pinnedStream[i] = a->stream;
+        if (FAILED(ApplyStreamSelection(i)))
+            arg->result = xse_err_fail;
+
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳ӿڳߴܱ仯UpdateStreamSelectionͶݣûɻص
+    HRESULT AutoSelectStream(xse_arg_t* arg)
+    {
+        ApplyQos(arg->channel);
+        return S_OK;
+    }
+
+    // ̡̣߳ͨ߳ͨǰ͵Ľ·Դ
+    void ApplyQos(int i)
+    {
+        ApplyStreamingPriority(i);
+        ApplyDecodeThreads(i);
+        ApplyVideoMode(i);
+        ApplyStreamSelection(i);
+    }
+
+    // ͼģʽ֡ؼߴ硢Ƶ򽵼仯ã
+    // ͨԼ߳ѡͽ뷽ʽ
+    void UpdateStreamSelection()
+    {
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            if (SourceOf(i) == nullptr)
+                continue;
+            xse_arg_select_stream_t* a = new xse_arg_select_stream_t;
+            a->channel = i;
+            PostAPC(new TaskItem(&CMixedGraph::AutoSelectStream, a));
+        }
+    }
+
+    // ûָͨƵͨΪ࣬ӿڿɼΪɼ࣬Ϊ̨ࡣ
+    int QosClassOf(int i)
+    {
+        int qosClass = _qosClass[i];
+        if (qosClass != xse_qos_auto)
+            return qosClass;
+        if (i == _audioFocus)
+            return xse_qos_focused;
+        SIZE size = { 0 };
+        if (_videoRendererCmd != nullptr)
+            _videoRendererCmd->GetViewportSize(i, &size);
+        return (size.cx > 0 && size.cy > 0) ? xse_qos_visible : xse_qos_background;
+    }
+
+    // ߵͨࡢɼࡢ̨˳ָֻ¼̨ͨһָ
+    // ʱطŻ峬ڴԤʱ෴˳ֻ̭¼ͨɼͬȱ
+    void UpdateReconnectPriority()
+    {
+        if (_videoRendererCmd == nullptr)
+            return;
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            CReconnectLimiter::Priority priority = CReconnectLimiter::PRIORITY_HIDDEN;
+            CReplayBuffer::Priority replayPriority = CReplayBuffer::PRIORITY_HIDDEN;
+            switch (QosClassOf(i)) {
+            case xse_qos_focused:
+                priority = CReconnectLimiter::PRIORITY_FOCUSED;
+                replayPriority = CReplayBuffer::PRIORITY_FOCUSED;
+                break;
+            case xse_qos_visible:
+                priority = CReconnectLimiter::PRIORITY_VISIBLE;
+                replayPriority = CReplayBuffer::PRIORITY_VISIBLE;
+                break;
+            case xse_qos_recording_only:
+                replayPriority = CReplayBuffer::PRIORITY_VISIBLE;
+                break;
+            }
+            _reconnectLimiter.SetPriority(i, priority);
+            _replayBuffer.SetPriority(i, replayPriority);
+        }
+    }
+
+    // ̡̣߳ͨ߳
+    // ͣͣͨʹɼҲһ֡棬ؽ롣
+    // ʱӺ̨࿪ʼٽ룬ʼȫ롣
+    void ApplyVideoMode(int i)
+    {
+        static const RtspSource::VideoMode videoModes[] = {
+            RtspSource::VideoFull, RtspSource::VideoKeyframesOnly, RtspSource::VideoNone
+        };
+
+        if (_source[i] == nullptr)
+            return;
+
+        int mode = xse_decode_full;
+        if (_paused[i]) {
+            mode = _pausedVideoMode[i];
+        }
+        else {
+            switch (QosClassOf(i)) {
+            case xse_qos_visible:
+                if (_shedLevel >= SHED_VISIBLE_DECODE)
+                    mode = xse_decode_keyframe;
+                break;
+            case xse_qos_background:
+                mode = _shedLevel >= SHED_BACKGROUND_DECODE ? xse_decode_none : _hiddenVideoMode[i];
+                break;
+            case xse_qos_recording_only:
+                mode = xse_decode_none;
+                break;
+            }
+        }
+        if (mode == _videoMode[i])
+            return;
+
+        _videoMode[i] = mode;
+        CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
+        if (cmd != nullptr)
+            cmd->SetVideoMode(videoModes[mode]);
+    }
+
+    // ȡ߶ȲСӿڸ߶ȵͷֱʱ
+    // ǰķŴ1.25ʱлߵӿڳߴֵ仯ʱл
+    int ChooseStream(int i, int tileHeight)
+    {
+        int best = 0;
+        for (int s = _streamCount[i] - 1; s > 0; --s) {
+            if (_streamHeight[i][s] >= tileHeight) {
+                best = s;
+                break;
+            }
+        }
+        int cur = _curStream[i];
+        if (best < cur && _streamHeight[i][cur] * 5 >= tileHeight * 4)
+            return cur;
+        return best;
+    }
+
+    // Զѡʱֻ¼̨ͨ͵
+    // ɼఴӿڸ߶ѡ񣬹صSHED_VISIBLE_STREAMʱҲ͵
+    int AutoStream(int i)
+    {
+        switch (QosClassOf(i)) {
+        case xse_qos_focused:
+        case xse_qos_recording_only:
+            return 0;
+        case xse_qos_visible:
+            if (_shedLevel < SHED_VISIBLE_STREAM) {
+                SIZE size = { 0 };
+                _videoRendererCmd->GetViewportSize(i, &size);
+                return ChooseStream(i, size.cy);
+            }
+            break;
+        }
+        return ChooseStream(i, 0);
+    }
+
+    // ̡̣߳ͨ߳
+    HRESULT ApplyStreamSelection(int i)
+    {
+        if (_source[i] == nullptr || _streamCount[i] <= 1)
+            return S_FALSE;
+
+        int stream = _pinnedStream[i];
+        if (stream == XSE_AUTO_STREAM)
+            stream = AutoStream(i);
+        if (stream == _curStream[i])
+            return S_OK;
+
+        // ڲʱں̨ȵIRAP滻δʱȼסURLʼŻ´ȡʱЧ
+        CComQIPtr<RtspSource::ICommand, &IID_IRtspSourceCommand> cmd(_source[i]);
+        HRESULT hr = cmd->SwitchURL(_streamUrl[i][stream].c_str());
+        if (SUCCEEDED(hr))
+            _curStream[i] = stream;
 
         return hr;
     }
 
 private:
     CSyncClock _refClock; // οʱ
+    CSyncGroup _syncGroup; // ͨNTPͬ飬Ĭϲá
+    CRtspRelay _relay; // RTSPתĬϲ
+    CReconnectLimiter _reconnectLimiter; // ȫ̵
+    CReplayBuffer _replayBuffer; // ȫ̵ļʱطŻ
     CComPtr<IGraphBuilder> _graphBuilder; // hold quarz.dll reference
     PlayState _playState[CHANNEL_COUNT];
     CComPtr<IBaseFilter> _source[CHANNEL_COUNT]; // ģʽRTSP IPCʵʱԤҲǿͻ˵¼ļ
+    std::mutex _sourceLock; // _source[]滻SourceOf()
     CComPtr<IBaseFilter> _videoDecoder[CHANNEL_COUNT];
     CComPtr<IBaseFilter> _audioDecoder[CHANNEL_COUNT];
     CComPtr<IBaseFilter> _videoRenderer = nullptr; // ۺƵ
     CComPtr<VideoRenderer::ICommand> _videoRendererCmd = nullptr;
-    CComPtr<IBaseFilter> _audioRenderer = nullptr; // ۺƵ
+    CComPtr<IBaseFilter> _audioRenderer[CHANNEL_COUNT]; // ϵͳͬһʱֻнͨݡ
+    volatile bool _audioMuted[CHANNEL_COUNT]; // ûõͨ״̬
+    volatile int _audioFocus; // ƵͨXSE_INVALID_CHANNEL_IDʾȫ
+    // ѡ״ֻ̬ͨ߳жд
+    std::wstring _streamUrl[CHANNEL_COUNT][XSE_MAX_SUB_STREAM_COUNT + 1]; // ±0Ϊ
+    int _streamHeight[CHANNEL_COUNT][XSE_MAX_SUB_STREAM_COUNT + 1];
+    volatile int _streamCount[CHANNEL_COUNT]; // ѡ1ʾֻ
+    int _curStream[CHANNEL_COUNT]; // ǰȡ
+    int _pinnedStream[CHANNEL_COUNT]; // ûָXSE_AUTO_STREAMʾԶѡ
+    SourceKind _sourceKind[CHANNEL_COUNT]; // ǰԴ
+    // º̨״ֻ̬ͨ߳жд
+    bool _paused[CHANNEL_COUNT]; // ͨͣ״̬
+    int _hiddenVideoMode[CHANNEL_COUNT]; // ӿڲɼʱĽ뷽ʽxse_decode_mode_t
+    int _pausedVideoMode[CHANNEL_COUNT]; // ͣʱĽ뷽ʽ
+    int _idlePauseMs[CHANNEL_COUNT]; // úRTSP PAUSE0ʾ͡
+    int _videoMode[CHANNEL_COUNT]; // ǰЧĽ뷽ʽ
+    float _zoomRect[CHANNEL_COUNT][4]; // ֱ佹򣨹һleft,top,right,bottomֻͨ߳жд
+    volatile int _qosClass[CHANNEL_COUNT]; // ûָȼxse_qos_class_tͨ߳д롣
+    // صú״̬MISC߳д룬̶ͨ߳ȡ
+    volatile bool _governorEnabled = true;
+    volatile int _cpuHighPercent = DEFAULT_CPU_HIGH_PERCENT;
+    volatile int _cpuLowPercent = DEFAULT_CPU_LOW_PERCENT;
+    volatile int _shedLevel = SHED_NONE; // ShedLevel
+    volatile int _cpuPercent = 0; // һڵϵͳCPUռ
+    volatile int _latePermille = 0; // һڳ֡
+    // ֻMISC߳жд
+    bool _governorPrimed = false; // һεĲ
+    ULONGLONG _lastIdleTime = 0; // һβʱϵͳۼƵĿʱæµʱ䣨100ns
+    ULONGLONG _lastBusyTime = 0;
+    LONGLONG _lastPresentFrames = 0;
+    LONGLONG _lastLateFrames = 0;
+    int _calmPeriods = 0; // е
+    DWORD _governorTickTime = 0; // һͶݲʱֻ̣߳жд
 
     //
     // ڲ߳ޣÿռ̷߳ڲòռЭ̷
@@ -557,6 +1634,9 @@ private:
     ThreadState _threadState[THREAD_COUNT];
     TaskItemQueue _pendingTaskQueue[THREAD_COUNT]; // ȴִе
     TaskItemQueue _doneTaskQueue[THREAD_COUNT]; // ɵ
+    TaskItem* _runningTask[THREAD_COUNT]; // ִеֻڸԵִ߳жд
+    HANDLE _completionEvent = NULL; // ɴɷʱλԶλȴxse_op_idle
+    HANDLE _frameEvent = NULL; // ȾյµĴʱλԶλȴUpdate/Render
     std::thread _taskExecuteThread[THREAD_COUNT];
     static volatile long _instanceCount; // Ծʵͳ
 };
@@ -18,6 +18,12 @@
 using namespace MediaFoundationSamples;
 
 #include "RtspSource/IRtspSource.h"
+#include "RtspSource/IMp4Source.h"
+#include "RtspSource/IHeifSource.h"
+#include "RtspSource/SyncGroup.h"
+#include "RtspSource/RtspRelay.h"
+#include "RtspSource/ReconnectLimiter.h"
+#include "RtspSource/ReplayBuffer.h"
 #include "ADMVideoDecoder/ILAVVideo.h"
 #include "ADMVideoRenderer/IVideoRenderer.h"
 
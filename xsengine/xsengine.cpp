@@ -140,11 +140,24 @@ HRESULT WINAPI xse_control(xse_t xse, xse_arg_t* arg)
     case xse_op_seek: return xse_async<xse_arg_seek_t>(g, &CMixedGraph::Seek, arg);
     case xse_op_rate: return xse_async<xse_arg_rate_t>(g, &CMixedGraph::Rate, arg);
     case xse_op_zoom: return xse_async<xse_arg_zoom_t>(g, &CMixedGraph::Zoom, arg);
+    case xse_op_replay: return xse_async<xse_arg_replay_t>(g, &CMixedGraph::Replay, arg);
+    case xse_op_snapshot: return xse_async<xse_arg_snapshot_t>(g, &CMixedGraph::Snapshot, arg);
     case xse_op_layout: return xse_async<xse_arg_layout_t>(g, &CMixedGraph::Layout, arg);
     case xse_op_view_mode: return xse_async<xse_arg_view_t>(g, &CMixedGraph::View, arg);
+    case xse_op_mute: return xse_async<xse_arg_mute_t>(g, &CMixedGraph::Mute, arg);
+    case xse_op_audio_focus: return xse_async<xse_arg_audio_focus_t>(g, &CMixedGraph::AudioFocus, arg);
+    case xse_op_sync_group: return xse_async<xse_arg_sync_group_t>(g, &CMixedGraph::SyncGroup, arg);
+    case xse_op_select_stream: return xse_async<xse_arg_select_stream_t>(g, &CMixedGraph::SelectStream, arg);
+    case xse_op_restream: return xse_async<xse_arg_restream_t>(g, &CMixedGraph::Restream, arg);
+    case xse_op_reconnect: return xse_async<xse_arg_reconnect_t>(g, &CMixedGraph::Reconnect, arg);
+    case xse_op_health: return xse_async<xse_arg_health_t>(g, &CMixedGraph::Health, arg);
+    case xse_op_background: return xse_async<xse_arg_background_t>(g, &CMixedGraph::Background, arg);
+    case xse_op_qos: return xse_async<xse_arg_qos_t>(g, &CMixedGraph::Qos, arg);
+    case xse_op_batch: return g->PostBatch(arg);
     case xse_op_sync_resize: return g->SyncResize(arg);
     case xse_op_sync_update: return g->SyncUpdate(arg);
     case xse_op_sync_render: return g->SyncRender(arg);
+    case xse_op_sync_get_events: return g->SyncGetEvents(arg);
     default: return g->PostQuitMsg();
     }
 } // end xse_control
@@ -28,13 +28,26 @@ enum xse_op_t {
     xse_op_stop,            // ֹֹ֣ͣͣȡseek0գ
     xse_op_seek,            // ֡
     xse_op_rate,            // ڲ
-    xse_op_zoom,            // ӿڣѡеľ
+    xse_op_zoom,            // ֱ佹Ŵеѡ
+    xse_op_replay,          // ʱطţֱͨڴһƵļţ
+    xse_op_snapshot,        // գͨһ̨֡űΪͼļ
     xse_op_layout,          // ӿڲ
     xse_op_view_mode,       // лͼģʽ
+    xse_op_mute,            // ͨ/
+    xse_op_audio_focus,     // лƵֻͨŽͨ
+    xse_op_sync_group,      // /ö֣ͨͬѯͨƫ
+    xse_op_select_stream,   // ѡͨ/ĬϰӿڳߴԶѡ
+    xse_op_restream,        // /ֹͣRTSPת񣬹̸
+    xse_op_reconnect,       // öĲƣѯͳ
+    xse_op_health,          // ѯͨ״RTCPĬ
+    xse_op_background,      // òɼͣĺֻ̨ͨؼ֡򲻽
+    xse_op_qos,             // ͨȼùصѯ״̬
+    xse_op_batch,           // ִжͨĲȫɺһλصЧ
     xse_op_sync_resize,     // ͻα仯֪ͨ
     xse_op_sync_get_time,   // ȡοʱ
     xse_op_sync_update,     // Ϣѭ߳ͬûϳUpdate
     xse_op_sync_render,     // Ϣѭ߳ͬûϳDraw
+    xse_op_sync_get_events, // ȡĿɵȴ¼Ϣѭݴȴѯ
 };
 
 // xsĴ
@@ -68,6 +81,38 @@ enum xse_const_int_t {
     XSE_MAX_CHANNEL_COUNT = XSE_MAX_CHANNEL_ID + 1,
     XSE_MIN_VIEW_MODE_ID = 0,
     XSE_MAX_VIEW_MODE_ID = 3,
+    XSE_MAX_SUB_STREAM_COUNT = 2, // ÿͨ
+    XSE_AUTO_STREAM = -1, // ӿڳߴԶѡ
+    XSE_MAX_BATCH_ITEM_COUNT = 64, // Ĳ
+};
+
+// ֡λѡɰλ
+enum xse_seek_flag_t {
+    xse_seek_accurate = 0,      // ȷλĿ֮ǰʵ㿪ʼ룬мֻ֡벻
+    xse_seek_keyframe = 1,      // 뵽Ŀʵ㣬϶ʱʹãӦ
+    xse_seek_sync_files = 2,    // ڲűļͨͬλͬһʱ㣬ͬһʱ̿ʼ
+};
+
+// յͼʽ
+enum xse_image_format_t {
+    xse_image_jpeg,
+    xse_image_png,
+};
+
+// ͨƵ뷽ʽ
+enum xse_decode_mode_t {
+    xse_decode_full,        // ȫ
+    xse_decode_keyframe,    // ֻؼ֡IRAP
+    xse_decode_none,        // 룬Ա
+};
+
+// ͨȼ𣬾ֵͨĽCPU뷽ʽ˳
+enum xse_qos_class_t {
+    xse_qos_auto,           // ƵӿǷɼԶ֮һĬϣ
+    xse_qos_focused,        // Աڿͨȫ롢߳ȼߣʱ
+    xse_qos_visible,        // ɼͨӿѡȫ룬ʱȽֻؼ֡
+    xse_qos_background,     // ̨ͨ͵̨뷽ʽ룬ʱֹͣ
+    xse_qos_recording_only, // ֻΪʱطŻȡ룬طŻɼͨͬȱ
 };
 
 struct xse_arg_t;
@@ -100,10 +145,24 @@ struct xse_arg_t {
 // ͣxse_general_result_t
 //
 struct xse_arg_open_t : xse_arg_t {
-    wchar_t url[XSE_MAX_URL_LEN + 1];
+    wchar_t url[XSE_MAX_URL_LEN + 1]; // MP4ļ·ɴfile://ǰ׺Ҳԣʱ
     wchar_t user_name[XSE_MAX_USER_NAME_LEN + 1]; // ɲ4GUID
     wchar_t password[XSE_MAX_PASSWORD_LEN + 1]; // ɲMD5ֵhash룬߲ö̬AccessTokenơ
     bool auto_run;
+    // ͬһֱɸߵУմʾûСû롣
+    wchar_t sub_url[XSE_MAX_SUB_STREAM_COUNT][XSE_MAX_URL_LEN + 1];
+    // Ļ߶ȣأ±0Ϊsub_urlһһӦ
+    // Զѡʱȡ߶ȲСӿڸ߶ȵͷֱ
+    int stream_height[XSE_MAX_SUB_STREAM_COUNT + 1];
+
+    // ΪHEIF/HEIC̬ͼ.heic/.heif/.hifʱ
+    // Զʱͼƴ꣨ʱɣʱύ𵽻ȾĻ-1ʾûеȵ
+    int image_width; // ͼĿ
+    int image_height;
+    int image_tiles; // ͼ
+    int decoded_tiles; // ʱѾϵͼ
+    int thumbnail_ms; // ͼһͼ飩ĺʱ
+    int full_image_ms; // ȫͼĺʱ
 
     xse_arg_open_t() {
         op = xse_op_open_url;
@@ -111,6 +170,18 @@ struct xse_arg_open_t : xse_arg_t {
         user_name[0] = 0;
         password[0] = 0;
         auto_run = true;
+        for (int i = 0; i < XSE_MAX_SUB_STREAM_COUNT; ++i) {
+            sub_url[i][0] = 0;
+        }
+        stream_height[0] = 1080; // IPC1080P640x360320x180
+        stream_height[1] = 360;
+        stream_height[2] = 180;
+        image_width = 0;
+        image_height = 0;
+        image_tiles = 0;
+        decoded_tiles = 0;
+        thumbnail_ms = -1;
+        full_image_ms = -1;
     }
 };
 
@@ -135,34 +206,56 @@ struct xse_arg_stop_t : xse_arg_t {
     }
 };
 
+//
 // ſ-֡λ֡Ĳ
+// Ŀλ = modeָ + frames֡ + offset_ms룬ֱֻ֧ļԴֱͨxse_err_fail
+// ͣʱλָʱĿ֡ʼͣʱ֡mode=1frames=1
+//
 struct xse_arg_seek_t : xse_arg_t {
     int mode; // 0=ļͷ1=ǰλã2=ļβ
-    int frames; // ʾˡҪʱ䶨λɽʱ֡
+    int frames; // ʾˡ
+    int offset_ms; // ʱ䶨λʱʹãʾˡ
+    int flags; // xse_seek_flag_t
+    LONGLONG position_ms; // ֵʵʶλλã룬ļͷ
+    DWORD latency_ms; // ֵӿʼλĿ֡ɵĺʱͬλʱȡֵͨͣʱʱΪ0
 
     xse_arg_seek_t() {
         op = xse_op_seek;
         mode = 0;
         frames = 0;
+        offset_ms = 0;
+        flags = xse_seek_accurate;
+        position_ms = 0;
+        latency_ms = 0;
     }
 };
 
+//
 // ſ-ʲĲ
+// ֱֻ֧ļԴֱͨxse_err_failԽ߽֡Խ٣ȫ룬
+// ıο֡ٸ߻ߵֻʵ(IRAP)Ҫʱһ
+//
 struct xse_arg_rate_t : xse_arg_t {
-    float rate; // 1.0ʾһ򲥷šʾ򲥷š
+    float rate; // 1.0ʾһ򲥷šʾ򲥷šֵֵ[1/32,32]
+    int frame_select; // ֵ0=ȫ룬1=ǲο֡2=ֻIRAP3=IRAP롣
 
     xse_arg_rate_t() {
         op = xse_op_rate; 
         rate = 1.0;
+        frame_select = 0;
     }
 };
 
-// ſ-ŲĲ
+//
+// ſ-ֱ佹Ĳ
+// ѡ(x,y)ΪģΪԭʼ1/w1/hʱƽƻػڣw=h=1֡
+// ֻѡתRGBȾٰ쵽ӿڣӿڴСԴֱ
+//
 struct xse_arg_zoom_t : xse_arg_t {
     float x; // ֵ[0,1]ԭʼĵxꡣ
     float y; // ֵ[0,1]ԭʼĵyꡣ
-    float w; // ֵ[0,16]űС1ЧΪС
-    float h; // ֵ[0,16]߶űС1ЧΪС
+    float w; // ֵ[1,16]ȷŴ
+    float h; // ֵ[1,16]߶ȷŴ
 
     xse_arg_zoom_t() {
         op = xse_op_zoom;
@@ -173,6 +266,90 @@ struct xse_arg_zoom_t : xse_arg_t {
     }
 };
 
+//
+// ſ-ʱطŲĲ
+// ֱͨڴбһѹƵĬ30룬ӹؼ֡ʼд̣
+// ͨϼƳڴԤʱ̭ɼͨġ̭ɼͨģ̭ͨ
+// طʱsource_channelsecondsĿΪʱļԴchannelϲţĽ·
+// 񱾵ļһͣλٺ͵ţصֱxse_op_open_url´򿪡
+// channelڲʱֹͣsource_channelԼݱ
+// secondsΪ0ʱֻ޸Ļòѯͳơ
+//
+struct xse_arg_replay_t : xse_arg_t {
+    int source_channel; // طĸͨĻ壬XSE_INVALID_CHANNEL_IDʾchannelͬ
+    int seconds; // ط룬0ʾطš
+    int keep_seconds; // ÿͨʱ룩<=0ʾ޸ġ
+    int budget_mb; // ͨϼƵڴԤ㣨MB<=0ʾ޸ġ
+    bool auto_run;
+    int duration_ms; // ֵطƬεʱӹؼ֡ʼܱsecondsԳ
+    int latency_ms; // ֵӷطŵһ֡ɵĺʱûеȵΪ-1
+    unsigned total_kb; // ֵͨռõڴ棨KB
+    unsigned budget_kb; // ֵڴԤ㣨KB
+    unsigned evicted_gops; // ֵ򳬳Ԥǰ̭GOP
+    unsigned channel_kb[XSE_MAX_CHANNEL_COUNT]; // ֵͨռõڴ棨KB
+    int channel_ms[XSE_MAX_CHANNEL_COUNT]; // ֵͨʱ룩
+
+    xse_arg_replay_t() {
+        op = xse_op_replay;
+        source_channel = XSE_INVALID_CHANNEL_ID;
+        seconds = 30;
+        keep_seconds = 0;
+        budget_mb = 0;
+        auto_run = true;
+        duration_ms = 0;
+        latency_ms = -1;
+        total_kb = 0;
+        budget_kb = 0;
+        evicted_gops = 0;
+        for (int i = 0; i < XSE_MAX_CHANNEL_COUNT; ++i) {
+            channel_kb[i] = 0;
+            channel_ms[i] = 0;
+        }
+    }
+};
+
+//
+// ſ-ղĲ
+// channelһѽֱ֡佹ʱǿɼǲ֣СΪJPEGPNGļдļص
+// ֻ߳֡ýȾĿ̣߳źͱ붼ڿ߳нУ
+// 16ͨͬʱҲƳٽͳ֡ͣȲ֡ʱtimeout_msxse_err_failص
+// ύصڼͨĳֶһأնԳֽĵӰ졣
+//
+struct xse_arg_snapshot_t : xse_arg_t {
+    wchar_t path[XSE_MAX_URL_LEN + 1]; // ͼļ·Ѵʱǡ
+    xse_image_format_t format;
+    int max_width; // С˿ߣŴ0ʾޡ
+    int max_height;
+    int quality; // JPEG[1,100]
+    int timeout_ms; // ȴ֡ʱ
+    int width; // ֵͼĿ
+    int height;
+    unsigned bytes; // ֵͼļֽ
+    int capture_ms; // ִֵ֡ĺʱûвΪ-1
+    int encode_ms; // ֵšдļĺʱ
+    unsigned present_frames; // ֵڼֵͨ֡
+    float present_jitter_ms; // ֵڼֶʵų̵ĳʱ֮ƽֵ
+    unsigned late_frames; // ֵڼ䶶10֡
+
+    xse_arg_snapshot_t() {
+        op = xse_op_snapshot;
+        path[0] = 0;
+        format = xse_image_jpeg;
+        max_width = 0;
+        max_height = 0;
+        quality = 90;
+        timeout_ms = 1000;
+        width = 0;
+        height = 0;
+        bytes = 0;
+        capture_ms = -1;
+        encode_ms = 0;
+        present_frames = 0;
+        present_jitter_ms = 0;
+        late_frames = 0;
+    }
+};
+
 //
 // ſ-ֵĲ
 // Բֻơӿڲ㼶㣺
@@ -209,6 +386,248 @@ struct xse_arg_view_t : xse_arg_t {
     }
 };
 
+//
+// ſ-ͨĲ
+// ֻͨδӵƵʱŻᷢ
+//
+struct xse_arg_mute_t : xse_arg_t {
+    bool mute; // trueʾ
+
+    xse_arg_mute_t() {
+        op = xse_op_mute;
+        mute = true;
+    }
+};
+
+//
+// ſ-ƵлĲ
+// ͬһʱֻһͨţͨƵڽն˼
+// δִκaudio_focusʱͨ
+//
+struct xse_arg_audio_focus_t : xse_arg_t {
+    int focus_channel; // ֵ[-1,15]-1ʾͨ
+
+    xse_arg_audio_focus_t() {
+        op = xse_op_audio_focus;
+        channel = XSE_INVALID_CHANNEL_ID; // MISCִ߳УͨŲá
+        focus_channel = XSE_INVALID_CHANNEL_ID;
+    }
+};
+
+//
+// ſ-ͨͬĲ
+// ú󣬹ͬһNTPʱӵĶ·RTCP SRNTPʱ֣
+// ʱСͨ⻺1ȴʱӴͨskew档
+// ɻصпɶȡͳƽ
+//
+struct xse_arg_sync_group_t : xse_arg_t {
+    int enable; // 1ã0ã-1ѯ
+    bool enabled; // ֵǰǷá
+    int max_skew_ms; // ֵͨ޷ƫ룩
+    bool member[XSE_MAX_CHANNEL_COUNT]; // ֵͨǷͬ
+    int added_latency_ms[XSE_MAX_CHANNEL_COUNT]; // ֵͨΪӵӳ٣룩
+    int skew_ms[XSE_MAX_CHANNEL_COUNT]; // ֵͨڹʱƫ룩
+
+    xse_arg_sync_group_t() {
+        op = xse_op_sync_group;
+        channel = XSE_INVALID_CHANNEL_ID; // MISCִ߳УͨŲá
+        enable = -1;
+        enabled = false;
+        max_skew_ms = 0;
+        for (int i = 0; i < XSE_MAX_CHANNEL_COUNT; ++i) {
+            member[i] = false;
+            added_latency_ms[i] = 0;
+            skew_ms[i] = 0;
+        }
+    }
+};
+
+//
+// ſ-ѡĲ
+// /URLڴͨʱԶģʽӿСʱлŴʱл
+// ں̨ȵĵһIRAP滻ǰ治жϡ
+// Զѡͨȼ͹ؽӰ죬xse_arg_qos_t
+//
+struct xse_arg_select_stream_t : xse_arg_t {
+    int stream; // ֵ[-1,XSE_MAX_SUB_STREAM_COUNT]-1Զѡ01Ϊ
+
+    xse_arg_select_stream_t() {
+        op = xse_op_select_stream;
+        stream = XSE_AUTO_STREAM;
+    }
+};
+
+//
+// ſ-RTSPתĲ
+// 󣬱̿Դrtsp://127.0.0.1:<port>/ch<ͨ>ȡͨǰRTP over TCP
+// ٸֻܱӣ±롣
+//
+struct xse_arg_restream_t : xse_arg_t {
+    int enable; // 10ֹͣ-1ѯ
+    unsigned short port; // ˿ڣʱЧ
+    bool running; // ֵǷС
+    int clients; // ֵȡĿͻ
+
+    xse_arg_restream_t() {
+        op = xse_op_restream;
+        channel = XSE_INVALID_CHANNEL_ID; // MISCִ߳УͨŲá
+        enable = -1;
+        port = 8554;
+        running = false;
+        clients = 0;
+    }
+};
+
+//
+// ſ-Ĳ
+// ָͨ˱ԣʼǰȫ̵
+// ͨͿɼͨȻָɻصпɶȡͳƽ
+//
+struct xse_arg_reconnect_t : xse_arg_t {
+    int max_concurrent; // ͬʱеޣ<=0ʾ޸ġ
+    int rate_per_sec; // ÿ뿪ʼޣ<=0ʾ޸ġ
+    int in_flight; // ֵֵͨ
+    int peak_in_flight; // ֲֵķֵ
+    int waiting; // ֵȴͨ
+    unsigned granted; // ֵۼƵִ
+
+    xse_arg_reconnect_t() {
+        op = xse_op_reconnect;
+        channel = XSE_INVALID_CHANNEL_ID; // MISCִ߳УͨŲá
+        max_concurrent = 0;
+        rate_per_sec = 0;
+        in_flight = 0;
+        peak_in_flight = 0;
+        waiting = 0;
+        granted = 0;
+    }
+};
+
+//
+// ſ-ѯĲ
+// ͨRTCPͳƺ͵֣жֵķӦ
+// ɻصпɶȡѯδ򿪵ͨΪ0
+//
+struct xse_arg_health_t : xse_arg_t {
+    int score[XSE_MAX_CHANNEL_COUNT]; // ֵ[0,100]
+    int loss_permille[XSE_MAX_CHANNEL_COUNT]; // ֵһĶʣǧֱȣ
+    int jitter_ms[XSE_MAX_CHANNEL_COUNT]; // ֵRTPﶶ룩
+    int sr_age_ms[XSE_MAX_CHANNEL_COUNT]; // ֵһRTCP SRʱ䣬-1ʾûյ
+    int silence_ms[XSE_MAX_CHANNEL_COUNT]; // ֵһյýʱ䡣
+    int gap_threshold_ms[XSE_MAX_CHANNEL_COUNT]; // ֵжֵ
+    unsigned reconnects[XSE_MAX_CHANNEL_COUNT]; // ֵۼ
+    unsigned dropped_nalus[XSE_MAX_CHANNEL_COUNT]; // ֵۼƶĳNALU8MBޣ
+
+    xse_arg_health_t() {
+        op = xse_op_health;
+        channel = XSE_INVALID_CHANNEL_ID; // MISCִ߳УͨŲá
+        for (int i = 0; i < XSE_MAX_CHANNEL_COUNT; ++i) {
+            score[i] = 0;
+            loss_permille[i] = 0;
+            jitter_ms[i] = 0;
+            sr_age_ms[i] = -1;
+            silence_ms[i] = 0;
+            gap_threshold_ms[i] = 0;
+            reconnects[i] = 0;
+            dropped_nalus[i] = 0;
+        }
+    }
+};
+
+//
+// ſ-̨ͨ뷽ʽĲ
+// ӿڲɼ1x1ͼµͨСֵͣͨΪ̨ͨ
+// ̨ͨԱӺͽգתӰ죩ֻڽն˶Ҫİ
+// Զѡʱɼͨͻлͷֱʵ
+// ¿ɼź󣬴һؼ֡ʼָȫٽ룬ڼ䱣һ֡档
+// Ĭϲɼʱֻؼ֡ͣʱ룬RTSP PAUSE
+//
+struct xse_arg_background_t : xse_arg_t {
+    int hidden_mode; // ӿڲɼʱĽ뷽ʽxse_decode_mode_t-1ʾ޸ġ
+    int paused_mode; // ͣʱĽ뷽ʽ-1ʾ޸ġ
+    int idle_pause_ms; // ҾôúRTSP PAUSE֧ʱ0ͣ-1޸ġ
+    int mode; // ֵͨǰЧĽ뷽ʽ
+
+    xse_arg_background_t() {
+        op = xse_op_background;
+        hidden_mode = -1;
+        paused_mode = -1;
+        idle_pause_ms = -1;
+        mode = xse_decode_full;
+    }
+};
+
+//
+// ſ-ȼصڲĲ
+// ͨȼԴ루̵߳ȼ߳뷽ʽԶѡ
+// ˳ͼʱطŻ̭˳
+// صÿһϵͳCPUռúͳ֡޾ͽһ
+// һ𼶴ӵȼͨʼ
+// 1ֹ̨ͨͣ룬2ɼͨ͵3ɼֻͨؼ֡ͨʼղ
+// ȫ̵ģһͨöͨЧ
+//
+struct xse_arg_qos_t : xse_arg_t {
+    int qos_class; // ͨȼxse_qos_class_t-1ʾ޸ġ
+    int governor; // 1ùصĬϣ0ͣòָн-1޸ġ
+    int cpu_high_percent; // ϵͳCPUռôﵽ˰ٷֱΪأ<=0ʾ޸ģĬ90
+    int cpu_low_percent; // ϵͳCPUռõڴ˰ٷֱΪУ<=0ʾ޸ģĬ70
+    int effective_class; // ֵͨǰЧ𣨲xse_qos_auto
+    int shed_level; // ֵصǰĽ[0,3]
+    int cpu_percent; // ֵһϵͳCPUռðٷֱȡ
+    int late_permille; // ֵһ֡ǧֱȣ
+    LONGLONG presented_frames; // ֵͨۼƳֵ֡βѯ֮ԼΪ֡ʡ
+
+    xse_arg_qos_t() {
+        op = xse_op_qos;
+        qos_class = -1;
+        governor = -1;
+        cpu_high_percent = 0;
+        cpu_low_percent = 0;
+        effective_class = xse_qos_visible;
+        shed_level = 0;
+        cpu_percent = 0;
+        late_permille = 0;
+        presented_frames = 0;
+    }
+};
+
+//
+// еһ
+//
+struct xse_batch_item_t {
+    xse_op_t op; // ֧xse_op_playxse_op_pausexse_op_stopxse_op_layout
+    int channel; // ֵ[0,15]
+    float x; // opΪxse_op_layoutʱӿͳߴ磬ͬxse_arg_layout_t
+    float y;
+    float w;
+    float h;
+    xse_err_t result; // ִֵн
+};
+
+//
+// ſ-Ĳ
+// ǽлȫ/ͣ/ֹͣȲͨxse_controlÿҪ¡߳Ͷݡ
+// صӿڻ䡣Ѹͨ飬ÿֻͨͶһΣڸԵͨ߳ϲִУ
+// ͬһͨĶ˳ִСȫִͨӿڲֺͼģʽһύ
+// һxse_op_sync_updateʱЧȻֻصһΡ
+// resultһʧʱΪxse_err_failĽitems[i].result
+//
+struct xse_arg_batch_t : xse_arg_t {
+    int view_mode; // ȫɺлͼģʽ-1ʾл
+    int count; // Чֵ[0,XSE_MAX_BATCH_ITEM_COUNT]
+    xse_batch_item_t items[XSE_MAX_BATCH_ITEM_COUNT];
+    DWORD elapsed_ms; // ֵύύĺʱ룩ںǽлӳ١
+
+    xse_arg_batch_t() {
+        op = xse_op_batch;
+        channel = XSE_INVALID_CHANNEL_ID;
+        view_mode = -1;
+        count = 0;
+        ZeroMemory(items, sizeof(items));
+        elapsed_ms = 0;
+    }
+};
+
 //
 // ſ-ؼͻα仯֪ͨ
 //
@@ -283,6 +702,25 @@ struct xse_arg_sync_render_t : xse_arg_t {
     }
 };
 
+//
+// ȡеɵȴ¼ԶλϢѭMsgWaitForMultipleObjectsȴ
+// Sleep(1)ʽѯ
+// completion_eventλʾ첽ɣӦһxse_op_idleɷɻص
+// frame_eventλʾĳͨµĴӦxse_op_sync_updatexse_op_sync_render
+// ¼洴͹رգxse_destroy֮ǰһֱЧùرջǡ
+//
+struct xse_arg_sync_get_events_t : xse_arg_t {
+    HANDLE completion_event; // ֵ첽¼
+    HANDLE frame_event; // ֵ֡¼
+
+    xse_arg_sync_get_events_t() {
+        op = xse_op_sync_get_events;
+        channel = XSE_INVALID_CHANNEL_ID;
+        completion_event = NULL;
+        frame_event = NULL;
+    }
+};
+
 
 
 //-------------------------------------------------------------------------------------------------
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "SoakMonitor.h"
+#include <psapi.h>
+
+namespace
+{
+    ULONGLONG ToULL(const FILETIME& ft)
+    {
+        return ((ULONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    }
+
+    ULONGLONG GetProcessCpuTime()
+    {
+        FILETIME creation, exit, kernel, user;
+        if (!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel, &user))
+            return 0;
+        return ToULL(kernel) + ToULL(user);
+    }
+}
+
+SoakMonitor::~SoakMonitor()
+{
+    Stop();
+}
+
+bool SoakMonitor::Start(xse_t xse, int channelCount, DWORD durationMs, PCWSTR logPath)
+{
+    Stop();
+    if (_wfopen_s(&m_file, logPath, L"w") != 0 || m_file == nullptr) {
+        fwprintf(stderr, L"soak: can not open %s\n", logPath);
+        m_file = nullptr;
+        return false;
+    }
+
+    SYSTEM_INFO si;
+    ::GetSystemInfo(&si);
+    m_processorCount = si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+    m_xse = xse;
+    m_channelCount = min(channelCount, XSE_MAX_CHANNEL_COUNT);
+    m_startTime = timeGetTime();
+    m_lastSampleTime = m_startTime;
+    m_duration = durationMs;
+    m_lastCpuTime = GetProcessCpuTime();
+    m_health = xse_arg_health_t();
+    m_reconnect = xse_arg_reconnect_t();
+    for (int i = 0; i < XSE_MAX_CHANNEL_COUNT; ++i) {
+        m_qos[i] = xse_arg_qos_t();
+        m_qosTime[i] = m_lastQosTime[i] = 0;
+        m_lastFrames[i] = 0;
+    }
+
+    fprintf(m_file, "elapsed_s,cpu_pct,working_set_mb,private_mb,fps,healthy_channels,min_score,avg_score,"
+                    "max_loss_permille,max_jitter_ms,max_silence_ms,reconnects,handshakes_in_flight,"
+                    "handshakes_peak,handshakes_waiting,shed_level,sys_cpu_pct,late_permille,"
+                    "focused_channel,focused_fps");
+    for (int i = 0; i < m_channelCount; ++i)
+        fprintf(m_file, ",score%d", i);
+    fprintf(m_file, "\n");
+    fflush(m_file);
+
+    Query();
+    return true;
+}
+
+void SoakMonitor::Stop()
+{
+    if (m_file != nullptr) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool SoakMonitor::Tick(DWORD now, int fps)
+{
+    if (m_file == nullptr)
+        return true;
+
+    m_fps = fps;
+    if (now - m_lastSampleTime < SAMPLE_INTERVAL_MS)
+        return true;
+
+    // дһֲѯĽٷһֲѯ
+    WriteRow(now);
+    m_lastSampleTime = now;
+    if (m_duration > 0 && now - m_startTime >= m_duration) {
+        Stop();
+        return false;
+    }
+    Query();
+    return true;
+}
+
+void SoakMonitor::Query()
+{
+    {
+        xse_arg_health_t a;
+        a.ctx = this;
+        a.cb = StaticOnHealth;
+        xse_control(m_xse, &a);
+    }
+    {
+        xse_arg_reconnect_t a;
+        a.ctx = this;
+        a.cb = StaticOnReconnect;
+        xse_control(m_xse, &a);
+    }
+    for (int i = 0; i < m_channelCount; ++i) {
+        xse_arg_qos_t a;
+        a.channel = i;
+        a.ctx = this;
+        a.cb = StaticOnQos;
+        xse_control(m_xse, &a);
+    }
+}
+
+void SoakMonitor::SampleProcess(DWORD now, double* cpuPercent, double* workingSetMB, double* privateMB)
+{
+    ULONGLONG cpuTime = GetProcessCpuTime();
+    DWORD wall = now - m_lastSampleTime;
+    *cpuPercent = wall > 0 ? (double)(cpuTime - m_lastCpuTime) / 10000.0 / wall / m_processorCount * 100.0 : 0.0;
+    m_lastCpuTime = cpuTime;
+
+    PROCESS_MEMORY_COUNTERS_EX pmc = { 0 };
+    pmc.cb = sizeof(pmc);
+    ::GetProcessMemoryInfo(::GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+    *workingSetMB = pmc.WorkingSetSize / (1024.0 * 1024.0);
+    *privateMB = pmc.PrivateUsage / (1024.0 * 1024.0);
+}
+
+void SoakMonitor::WriteRow(DWORD now)
+{
+    double cpu = 0, workingSet = 0, privateBytes = 0;
+    SampleProcess(now, &cpu, &workingSet, &privateBytes);
+
+    int healthy = 0, minScore = 100, sumScore = 0;
+    int maxLoss = 0, maxJitter = 0, maxSilence = 0;
+    unsigned reconnects = 0;
+    for (int i = 0; i < m_channelCount; ++i) {
+        if (m_health.score[i] >= 80)
+            ++healthy;
+        minScore = min(minScore, m_health.score[i]);
+        sumScore += m_health.score[i];
+        maxLoss = max(maxLoss, m_health.loss_permille[i]);
+        maxJitter = max(maxJitter, m_health.jitter_ms[i]);
+        maxSilence = max(maxSilence, m_health.silence_ms[i]);
+        reconnects += m_health.reconnects[i];
+    }
+
+    // ͨ֡ʣ֮ۼƳ֡βѯļ
+    int focused = -1;
+    double focusedFps = 0;
+    for (int i = 0; i < m_channelCount; ++i) {
+        if (focused < 0 && m_qos[i].effective_class == xse_qos_focused) {
+            focused = i;
+            DWORD wall = m_qosTime[i] - m_lastQosTime[i];
+            if (m_lastQosTime[i] != 0 && wall > 0)
+                focusedFps = (m_qos[i].presented_frames - m_lastFrames[i]) * 1000.0 / wall;
+        }
+        m_lastFrames[i] = m_qos[i].presented_frames;
+        m_lastQosTime[i] = m_qosTime[i];
+    }
+    const xse_arg_qos_t& qos = m_qos[0];
+
+    fprintf(m_file, "%.0f,%.1f,%.1f,%.1f,%d,%d,%d,%d,%d,%d,%d,%u,%d,%d,%d,%d,%d,%d,%d,%.1f",
+        (now - m_startTime) / 1000.0, cpu, workingSet, privateBytes, m_fps, healthy,
+        m_channelCount > 0 ? minScore : 0, m_channelCount > 0 ? sumScore / m_channelCount : 0,
+        maxLoss, maxJitter, maxSilence, reconnects,
+        m_reconnect.in_flight, m_reconnect.peak_in_flight, m_reconnect.waiting,
+        qos.shed_level, qos.cpu_percent, qos.late_permille, focused, focusedFps);
+    for (int i = 0; i < m_channelCount; ++i)
+        fprintf(m_file, ",%d", m_health.score[i]);
+    fprintf(m_file, "\n");
+    fflush(m_file);
+}
+
+void SoakMonitor::OnHealth(xse_arg_health_t* arg)
+{
+    m_health = *arg;
+}
+
+void SoakMonitor::OnReconnect(xse_arg_reconnect_t* arg)
+{
+    m_reconnect = *arg;
+}
+
+void SoakMonitor::OnQos(xse_arg_qos_t* arg)
+{
+    if (arg->channel < 0 || arg->channel >= XSE_MAX_CHANNEL_COUNT)
+        return;
+    m_qos[arg->channel] = *arg;
+    m_qosTime[arg->channel] = timeGetTime();
+}
+
+void CALLBACK SoakMonitor::StaticOnHealth(xse_arg_t* arg)
+{
+    ((SoakMonitor*)arg->ctx)->OnHealth((xse_arg_health_t*)arg);
+}
+
+void CALLBACK SoakMonitor::StaticOnReconnect(xse_arg_t* arg)
+{
+    ((SoakMonitor*)arg->ctx)->OnReconnect((xse_arg_reconnect_t*)arg);
+}
+
+void CALLBACK SoakMonitor::StaticOnQos(xse_arg_t* arg)
+{
+    ((SoakMonitor*)arg->ctx)->OnQos((xse_arg_qos_t*)arg);
+}
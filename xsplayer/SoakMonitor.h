@@ -0,0 +1,52 @@
+#pragma once
+
+//
+// ʱѹԣsoak
+// ÷xsplayer.exe -n 16 -url rtsp://127.0.0.1:8554/ch0 -soak 240 -log soak.csv
+// ÿSAMPLE_INTERVAL_MSѯһθͨĽ״ͳƺ͹ص״̬
+// ̵ͬCPUռáڴ桢֡ʺͽͨ֡׷ӵCSVļ趨ʱرڡ
+// з̣߳Ϣѭ̣߳еãĲѯҲ̵߳ɻصͻء
+//
+class SoakMonitor
+{
+public:
+    enum { SAMPLE_INTERVAL_MS = 10000 };
+
+    ~SoakMonitor();
+
+    bool Start(xse_t xse, int channelCount, DWORD durationMs, PCWSTR logPath);
+    void Stop();
+    bool IsRunning() const { return m_file != nullptr; }
+
+    // falseʾѵ趨ʱ
+    bool Tick(DWORD now, int fps);
+
+private:
+    void Query();
+    void WriteRow(DWORD now);
+    void SampleProcess(DWORD now, double* cpuPercent, double* workingSetMB, double* privateMB);
+
+    void OnHealth(xse_arg_health_t* arg);
+    void OnReconnect(xse_arg_reconnect_t* arg);
+    void OnQos(xse_arg_qos_t* arg);
+    static void CALLBACK StaticOnHealth(xse_arg_t* arg);
+    static void CALLBACK StaticOnReconnect(xse_arg_t* arg);
+    static void CALLBACK StaticOnQos(xse_arg_t* arg);
+
+private:
+    xse_t m_xse = nullptr;
+    FILE* m_file = nullptr;
+    int m_channelCount = 0;
+    DWORD m_startTime = 0;
+    DWORD m_duration = 0;
+    DWORD m_lastSampleTime = 0;
+    ULONGLONG m_lastCpuTime = 0; // ۼƵں̬+û̬ʱ䣨100ns
+    int m_processorCount = 1;
+    int m_fps = 0;
+    xse_arg_health_t m_health; // һβѯ
+    xse_arg_reconnect_t m_reconnect;
+    xse_arg_qos_t m_qos[XSE_MAX_CHANNEL_COUNT];
+    DWORD m_qosTime[XSE_MAX_CHANNEL_COUNT]; // յͨѯʱ
+    LONGLONG m_lastFrames[XSE_MAX_CHANNEL_COUNT]; // һдʱͨۼƳֵ֡
+    DWORD m_lastQosTime[XSE_MAX_CHANNEL_COUNT];
+};
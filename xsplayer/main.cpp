@@ -1,6 +1,8 @@
 #include "stdafx.h"
+#include <shellapi.h>
 #include "resource.h"
 #include "MM.h"
+#include "SoakMonitor.h"
 
 HINSTANCE g_hInstance = 0;
 xse_t g_xse = nullptr;
@@ -10,6 +12,8 @@ class BasicMainWindow
 public:
     enum { DRAW_TIMER_ID = 1000 };
     const DWORD TIMER_INTERVAL = 15; // ʱ
+    enum { FRAME_IDLE_MS = 500 }; // ôû֡Ϣѭֻֽٰȴ¼
+    enum { SEEK_STEP_MS = 5000 }; // ҷǰʱ
     // Сʱݻϳٶȶͳݶ̬ٻ߼١
     // ٶ(Debug)ԴδݻѹUI߳Ǵӻϳòݡ
     // ٶȿ(Release)ϳѽݣUIܼ߳ʱߣ
@@ -21,6 +25,7 @@ public:
     int m_channelCount = 1; // ӳ䲢ʹܵͨʽ
     bool m_channelSwitch[XSE_MAX_CHANNEL_COUNT]; // ͨʹܿأUIѡֵ
     std::wstring m_channelURL[XSE_MAX_CHANNEL_COUNT]; // ͨURLӳ
+    std::wstring m_url = L"rtsp://127.0.0.1:554/ss265.mkv"; // ͨ򿪵URL-urlָ
     RECT m_lastWindowRect = { 0 };
     DWORD m_styleWindowed = WS_OVERLAPPEDWINDOW;
     DWORD m_styleFullScreen = WS_POPUP;
@@ -32,7 +37,22 @@ public:
     enum { VIEW_MODE_COUNT = 4 };
     int m_modeList[VIEW_MODE_COUNT] = { 1, 4, 9, 16 };
     int m_curMode = 0;
+    int m_startMode = -1; // ʱͼģʽ-1ʾͨԶѡ񣬿-viewָ
+    int m_hiddenDecodeMode = -1; // ɼͨĽ뷽ʽxse_decode_mode_t-1ʾĬϣ-bgָ
+    float m_rate = 1.0f; // ļĲʣ-rateָ[]ټ٣R
+    float m_zoom = 1.0f; // ֱ佹-zoomָ+-ŴС
+    float m_zoomX = 0.5f; // 佹ģI/J/K/Lƽơ
+    float m_zoomY = 0.5f;
+    int m_replaySeconds = 30; // BطŽͨ룬Nصֱ-replayָ
+    int m_replayBudgetMB = 0; // ʱطŻڴԤ㣬0ʾĬϣ-replaymbָ
+    xse_image_format_t m_snapshotFormat = xse_image_jpeg; // SսͨDͨͬʱգ-snapָʽ
+    int m_snapshotMaxWidth = 0; // յȣ0ʾԭʼߴ磬-snapwָ
     bool m_isPaused = false;
+    int m_audioFocus = XSE_MIN_CHANNEL_ID; // Ƶͨ-1ʾȫ
+    DWORD m_batchSubmitTime = 0; // һύʱ䣬ͳлӳ١
+    DWORD m_replaySubmitTime = 0;
+    DWORD m_snapshotSubmitTime = 0;
+    int m_snapshotPending = 0; // δصĿ
     bool m_enableOnTimerRender = false; // ʹܶʱȾ
 
     HRESULT Create(PCWSTR lpWindowName, int nClientWidth, int nClientHeight)
@@ -98,6 +118,11 @@ public:
         assert(id == DRAW_TIMER_ID);
     }
 
+    void StopDrawTimer()
+    {
+        ::KillTimer(m_hwnd, DRAW_TIMER_ID);
+    }
+
     void EnableOnTimerRender(bool bEnable)
     {
         m_enableOnTimerRender = bEnable;
@@ -105,19 +130,31 @@ public:
 
     void StartAllChannels()
     {
-        for (int i = 0; i < m_channelCount; ++i) {
-            xse_arg_open_t a;
+        for (int i = 0; i < m_channelCount && m_hiddenDecodeMode >= 0; ++i) {
+            xse_arg_background_t a;
             a.channel = i;
-            wcscpy_s(a.url, _countof(a.url), L"rtsp://127.0.0.1:554/ss265.mkv");
-            //wcscpy_s(a.url, _countof(a.url), L"rtsp://192.168.0.64:554/");
-            wcscpy_s(a.user_name, _countof(a.user_name), L"admin");
-            wcscpy_s(a.password, _countof(a.user_name), L"codemi.net");
-            a.auto_run = true;
-            a.ctx = this;
-            a.cb = StaticOnPlayComplete;
+            a.hidden_mode = m_hiddenDecodeMode;
+            xse_control(g_xse, &a);
+        }
+
+        {
+            xse_arg_replay_t a;
+            a.seconds = 0; // ֻû
+            a.keep_seconds = m_replaySeconds;
+            a.budget_mb = m_replayBudgetMB;
             xse_control(g_xse, &a);
         }
 
+        for (int i = 0; i < m_channelCount; ++i) {
+            OpenChannel(i);
+        }
+        if (m_rate != 1.0f) {
+            SetRateAllChannels(m_rate); // ͬһͨ˳ִУ֮ŵʡ
+        }
+        if (m_zoom != 1.0f) {
+            ZoomAllChannels(m_zoom, m_zoomX, m_zoomY);
+        }
+
         // Զѡͼģʽ
         for (int i = 0; i < VIEW_MODE_COUNT; ++i) {
             m_curMode = i;
@@ -125,42 +162,153 @@ public:
                 break;
             }
         }
-        {
-            xse_arg_view_t a;
-            a.mode = m_curMode;
-            xse_control(g_xse, &a);
+        if (m_startMode >= 0)
+            m_curMode = m_startMode;
+        SetViewMode(m_curMode);
+        SetAudioFocus(m_audioFocus);
+    }
+
+    void OpenChannel(int i)
+    {
+        xse_arg_open_t a;
+        a.channel = i;
+        wcscpy_s(a.url, _countof(a.url), m_url.c_str());
+        //wcscpy_s(a.url, _countof(a.url), L"rtsp://192.168.0.64:554/");
+        wcscpy_s(a.user_name, _countof(a.user_name), L"admin");
+        wcscpy_s(a.password, _countof(a.user_name), L"codemi.net");
+        a.auto_run = true;
+        a.ctx = this;
+        a.cb = StaticOnPlayComplete;
+        xse_control(g_xse, &a);
+    }
+
+    // ͨԭӿϻطһƵصֱʱ´򿪣ۻ
+    void ReplayChannel(int channel, int seconds)
+    {
+        xse_arg_replay_t a;
+        a.channel = channel;
+        a.seconds = seconds;
+        a.ctx = this;
+        a.cb = StaticOnReplayComplete;
+        m_replaySubmitTime = timeGetTime();
+        xse_control(g_xse, &a);
+    }
+
+    // ļдǰĿ¼ļͨźύʱ̡
+    void SnapshotChannel(int channel)
+    {
+        xse_arg_snapshot_t a;
+        a.channel = channel;
+        a.format = m_snapshotFormat;
+        a.max_width = m_snapshotMaxWidth;
+        swprintf_s(a.path, _countof(a.path), L"snapshot_%d_%u.%s", channel, timeGetTime(),
+            m_snapshotFormat == xse_image_png ? L"png" : L"jpg");
+        a.ctx = this;
+        a.cb = StaticOnSnapshotComplete;
+        if (m_snapshotPending == 0)
+            m_snapshotSubmitTime = timeGetTime();
+        ++m_snapshotPending;
+        xse_control(g_xse, &a);
+    }
+
+    // ͼлҲ²ͬһγʱЧɻصˢ±
+    void SetViewMode(int mode)
+    {
+        m_curMode = mode;
+        xse_arg_batch_t a;
+        a.view_mode = mode;
+        SubmitBatch(&a);
+    }
+
+    void SubmitBatch(xse_arg_batch_t* a)
+    {
+        a->ctx = this;
+        a->cb = StaticOnBatchComplete;
+        m_batchSubmitTime = timeGetTime();
+        xse_control(g_xse, a);
+    }
+
+    // ִͨͬһһύһλص
+    void BatchAllChannels(xse_op_t op)
+    {
+        xse_arg_batch_t a;
+        for (int i = 0; i < m_channelCount && a.count < XSE_MAX_BATCH_ITEM_COUNT; ++i) {
+            a.items[a.count].op = op;
+            a.items[a.count].channel = i;
+            a.count++;
         }
+        SubmitBatch(&a);
+    }
+
+    void SetAudioFocus(int channel)
+    {
+        m_audioFocus = channel;
+        xse_arg_audio_focus_t a;
+        a.focus_channel = channel;
+        xse_control(g_xse, &a);
     }
 
     void PlayAllChannels()
     {
-        for (int i = 0; i < m_channelCount; ++i) {
-            xse_arg_play_t a;
-            a.channel = i;
-            xse_control(g_xse, &a);
-        }
+        BatchAllChannels(xse_op_play);
     }
 
     void PauseAllChannels()
     {
+        BatchAllChannels(xse_op_pause);
+    }
+
+    void StopAllChannels()
+    {
+        BatchAllChannels(xse_op_stop);
+    }
+
+    // ֱͨ᷵ʧܣԼɡ
+    void SetRateAllChannels(float rate)
+    {
+        m_rate = rate;
         for (int i = 0; i < m_channelCount; ++i) {
-            xse_arg_pause_t a;
+            xse_arg_rate_t a;
             a.channel = i;
+            a.rate = rate;
+            a.ctx = this;
+            a.cb = StaticOnRateComplete;
             xse_control(g_xse, &a);
         }
     }
 
-    void StopAllChannels()
+    // ĵ㱣ڻڣŴƽƲƳ档
+    void ZoomAllChannels(float zoom, float x, float y)
     {
+        m_zoom = max(1.0f, min(zoom, 16.0f));
+        float half = 0.5f / m_zoom;
+        m_zoomX = max(half, min(x, 1.0f - half));
+        m_zoomY = max(half, min(y, 1.0f - half));
         for (int i = 0; i < m_channelCount; ++i) {
-            xse_arg_stop_t a;
+            xse_arg_zoom_t a;
             a.channel = i;
-            a.ctx = this;
-            a.cb = StaticOnStopComplete;
+            a.x = m_zoomX;
+            a.y = m_zoomY;
+            a.w = m_zoom;
+            a.h = m_zoom;
             xse_control(g_xse, &a);
         }
     }
 
+    // 0ͨĵǰλΪ㣬бļͨͬλ
+    void SeekAllFiles(int frames, int offsetMs)
+    {
+        xse_arg_seek_t a;
+        a.channel = 0;
+        a.mode = 1;
+        a.frames = frames;
+        a.offset_ms = offsetMs;
+        a.flags = xse_seek_sync_files;
+        a.ctx = this;
+        a.cb = StaticOnSeekComplete;
+        xse_control(g_xse, &a);
+    }
+
     bool Render()
     {
         if (g_xse == nullptr)
@@ -218,6 +366,18 @@ private:
             OnTimer(wParam, (void*)lParam);
             return 0;
 
+        // ֻϵͳģ̬ѭ϶š˵ϢѭڼҪʱˢ
+        // ƽʱϢѭ¼ϣöʱת̡߳
+        case WM_ENTERSIZEMOVE:
+        case WM_ENTERMENULOOP:
+            StartDrawTimer();
+            break;
+
+        case WM_EXITSIZEMOVE:
+        case WM_EXITMENULOOP:
+            StopDrawTimer();
+            break;
+
         case WM_PAINT:
             PAINTSTRUCT ps;
             if (NULL != BeginPaint(m_hwnd, &ps)) {
@@ -229,18 +389,15 @@ private:
         case WM_KEYUP:
             {
                 if (wParam == 'V') {
-                    m_curMode = (m_curMode + 1) % VIEW_MODE_COUNT;
-                    xse_arg_view_t a;
-                    a.mode = m_curMode;
-                    xse_control(g_xse, &a);
-                    ::InvalidateRect(m_hwnd, nullptr, TRUE);
+                    SetViewMode((m_curMode + 1) % VIEW_MODE_COUNT);
                 }
                 else if (wParam >= '1' && wParam <= '4') {
-                    m_curMode = wParam - '1';
-                    xse_arg_view_t a;
-                    a.mode = m_curMode;
-                    xse_control(g_xse, &a);
-                    ::InvalidateRect(m_hwnd, nullptr, TRUE);
+                    SetViewMode(wParam - '1');
+                }
+                else if (wParam == 'A') {
+                    // лƵͨһ֮ͨлΪȫ
+                    int next = m_audioFocus + 1;
+                    SetAudioFocus(next < m_channelCount ? next : XSE_INVALID_CHANNEL_ID);
                 }
                 else if (wParam == VK_SPACE) {
                     if (m_isPaused) {
@@ -251,6 +408,53 @@ private:
                     }
                     m_isPaused = !m_isPaused;
                 }
+                else if (wParam == VK_LEFT || wParam == VK_RIGHT) {
+                    // ļͨһǰͣʱ֡
+                    int dir = wParam == VK_LEFT ? -1 : 1;
+                    if (m_isPaused) {
+                        SeekAllFiles(dir, 0);
+                    }
+                    else {
+                        SeekAllFiles(0, dir * SEEK_STEP_MS);
+                    }
+                }
+                else if (wParam == VK_OEM_4 || wParam == VK_OEM_6) {
+                    // [٣]٣ʵľֵ1/3232֮ɱ仯
+                    float speed = fabsf(m_rate) * (wParam == VK_OEM_6 ? 2.0f : 0.5f);
+                    speed = max(1.0f / 32, min(speed, 32.0f));
+                    SetRateAllChannels(m_rate > 0 ? speed : -speed);
+                }
+                else if (wParam == 'R') {
+                    SetRateAllChannels(-m_rate); // ֻؼ֡
+                }
+                else if (wParam == VK_OEM_PLUS || wParam == VK_OEM_MINUS) {
+                    ZoomAllChannels(m_zoom * (wParam == VK_OEM_PLUS ? 2.0f : 0.5f), m_zoomX, m_zoomY);
+                }
+                else if (wParam == 'I' || wParam == 'J' || wParam == 'K' || wParam == 'L') {
+                    // ÿƽƿɼķ֮һ
+                    float step = 0.25f / m_zoom;
+                    float dx = wParam == 'J' ? -step : (wParam == 'L' ? step : 0);
+                    float dy = wParam == 'I' ? -step : (wParam == 'K' ? step : 0);
+                    ZoomAllChannels(m_zoom, m_zoomX + dx, m_zoomY + dy);
+                }
+                else if (wParam == 'B' || wParam == 'N') {
+                    // ȫʱ0ͨ
+                    int channel = m_audioFocus != XSE_INVALID_CHANNEL_ID ? m_audioFocus : XSE_MIN_CHANNEL_ID;
+                    if (wParam == 'B') {
+                        ReplayChannel(channel, m_replaySeconds);
+                    }
+                    else {
+                        OpenChannel(channel);
+                    }
+                }
+                else if (wParam == 'S') {
+                    SnapshotChannel(m_audioFocus != XSE_INVALID_CHANNEL_ID ? m_audioFocus : XSE_MIN_CHANNEL_ID);
+                }
+                else if (wParam == 'D') {
+                    for (int i = 0; i < m_channelCount; ++i) {
+                        SnapshotChannel(i);
+                    }
+                }
                 else if (wParam == VK_F11 || (wParam == VK_ESCAPE && m_isFullScreen)) {
                     ToggleFullscreen();
                 }
@@ -355,12 +559,21 @@ private:
         m_isFullScreen = !m_isFullScreen;
     }
 
+    // 򿪾̬ͼʱӡͼȫͼĺʱ
     void OnPlayComplete(xse_arg_open_t* arg)
     {
+        if (arg->image_tiles > 0) {
+            fprintf(stderr, "image: ch=%d %dx%d tiles=%d/%d result=%d thumbnail=%dms full=%dms\n", arg->channel,
+                arg->image_width, arg->image_height, arg->decoded_tiles, arg->image_tiles, arg->result,
+                arg->thumbnail_ms, arg->full_image_ms);
+        }
     }
 
-    void OnStopComplete(xse_arg_stop_t* arg)
+    // ӡǽлĺʱengineΪύֽtotalΪύյص
+    void OnBatchComplete(xse_arg_batch_t* arg)
     {
+        fprintf(stderr, "batch: items=%d view=%d result=%d engine=%ums total=%ums\n", arg->count, arg->view_mode,
+            arg->result, arg->elapsed_ms, timeGetTime() - m_batchSubmitTime);
         ::InvalidateRect(m_hwnd, nullptr, TRUE); // ǿˢ
     }
 
@@ -369,12 +582,160 @@ private:
         ((BasicMainWindow*)arg->ctx)->OnPlayComplete((xse_arg_open_t*)arg);
     }
 
-    static void CALLBACK StaticOnStopComplete(xse_arg_t* arg)
+    // ӡλ֡ӳ٣ӿʼλĿ֡ɣͨȡֵ
+    void OnSeekComplete(xse_arg_seek_t* arg)
+    {
+        fprintf(stderr, "seek: result=%d position=%lldms latency=%ums\n", arg->result, arg->position_ms, arg->latency_ms);
+    }
+
+    // ӡطŵ֡ӳ٣ڴӷطŵһ֡ɣtotalŶӺͻصɷ
+    // ԼͨÿƵռõڴ档
+    void OnReplayComplete(xse_arg_replay_t* arg)
+    {
+        fprintf(stderr, "replay[%d]: result=%d duration=%dms latency=%dms total=%ums memory=%uKB/%uKB evicted=%u\n",
+            arg->channel, arg->result, arg->duration_ms, arg->latency_ms, timeGetTime() - m_replaySubmitTime,
+            arg->total_kb, arg->budget_kb, arg->evicted_gops);
+        for (int i = 0; i < m_channelCount; ++i) {
+            if (arg->channel_ms[i] > 0) {
+                fprintf(stderr, "replay buffer[%d]: %.1fs, %uKB, %.0fKB/min\n", i, arg->channel_ms[i] / 1000.0,
+                    arg->channel_kb[i], arg->channel_kb[i] * 60000.0 / arg->channel_ms[i]);
+            }
+        }
+    }
+
+    static void CALLBACK StaticOnReplayComplete(xse_arg_t* arg)
+    {
+        ((BasicMainWindow*)arg->ctx)->OnReplayComplete((xse_arg_replay_t*)arg);
+    }
+
+    // ӡÿſյĺʱڼĳֶһȫʱٴӡܺʱ
+    void OnSnapshotComplete(xse_arg_snapshot_t* arg)
+    {
+        fprintf(stderr, "snapshot[%d]: result=%d %dx%d %uKB capture=%dms encode=%dms present frames=%u jitter=%.1fms late=%u\n",
+            arg->channel, arg->result, arg->width, arg->height, arg->bytes / 1024, arg->capture_ms, arg->encode_ms,
+            arg->present_frames, arg->present_jitter_ms, arg->late_frames);
+        if (--m_snapshotPending == 0) {
+            fprintf(stderr, "snapshot: all done in %ums\n", timeGetTime() - m_snapshotSubmitTime);
+        }
+    }
+
+    static void CALLBACK StaticOnSnapshotComplete(xse_arg_t* arg)
+    {
+        ((BasicMainWindow*)arg->ctx)->OnSnapshotComplete((xse_arg_snapshot_t*)arg);
+    }
+
+    void OnRateComplete(xse_arg_rate_t* arg)
+    {
+        if (arg->result == xse_err_ok) {
+            fprintf(stderr, "rate[%d]: %.2fx, frame select=%d\n", arg->channel, arg->rate, arg->frame_select);
+        }
+    }
+
+    static void CALLBACK StaticOnRateComplete(xse_arg_t* arg)
+    {
+        ((BasicMainWindow*)arg->ctx)->OnRateComplete((xse_arg_rate_t*)arg);
+    }
+
+    static void CALLBACK StaticOnSeekComplete(xse_arg_t* arg)
+    {
+        ((BasicMainWindow*)arg->ctx)->OnSeekComplete((xse_arg_seek_t*)arg);
+    }
+
+    static void CALLBACK StaticOnBatchComplete(xse_arg_t* arg)
+    {
+        ((BasicMainWindow*)arg->ctx)->OnBatchComplete((xse_arg_batch_t*)arg);
+    }
+};
+
+// в
+//   -n <ͨ>        򿪵ͨĬ1
+//   -url <URL>         ͨ򿪵URL
+//   -soak <>       ѹʱʱԶ˳0ʾһֱС
+//   -log <ļ>        ѹԵCSVļĬsoak.csvָ-soak-logѹԼӡ
+//   -view <0-3>        ʱͼģʽ1/4/9/1601x1ӿڣͨת̨
+//   -bg <0-2>          ɼͨĽ뷽ʽ0ȫ룬1ֻؼ֡2롣
+//   -rate <>       ļĲʣΪţֵ[1/32,32]
+//   -zoom <>       ĵֱ佹[1,16]
+//   -replay <>       ÿֱͨڴбʱBطŽͨô룬Ĭ30
+//   -replaymb <MB>     ͨʱطŻϼƵڴԤ㣬Ĭ
+//   -snap <jpg|png>    S/DյͼʽĬjpg
+//   -snapw <>      յȣСĬԭʼߴ硣
+//   -burn <߳>     ôת߳CPUڹ۲صͽͨ֡ʡ
+// ȽϺ̨ͨCPUռãxsplayer.exe -n 16 -view 0 -bg 0 -soak 10-bg 1-bg 2һΡ
+// ȽϸٵCPUռãxsplayer.exe -n 16 -url D:\rec.mp4 -rate 8 -soak 5ٻ-rate 241632һΡ
+// Ƚϱ佹תӰ죺xsplayer.exe -url D:\4k.mp4 -view 0 -zoom 8 -soak 5ٻ-zoom 124һΡ
+// طڴ֡ӳ٣xsplayer.exe -n 16 -replay 60 -replaymb 1024һϺBreplayͷ
+// ͻնԳֽĵӰ죺xsplayer.exe -n 16 -snapw 640ȶDȽsnapshotjitter/late벻ʱĲ
+// CPUʱͨ֡ʣxsplayer.exe -n 16 -burn 8 -soak 10Aѡͨ
+// CSVеshed_levelfocused_fps-burn 0ա
+struct CommandLine
+{
+    int channelCount = 1;
+    int viewMode = -1;
+    int hiddenDecodeMode = -1;
+    float rate = 1.0f;
+    float zoom = 1.0f;
+    int replaySeconds = 30;
+    int replayBudgetMB = 0;
+    xse_image_format_t snapshotFormat = xse_image_jpeg;
+    int snapshotMaxWidth = 0;
+    int burnThreads = 0;
+    std::wstring url;
+    bool soak = false;
+    DWORD soakMinutes = 0;
+    std::wstring soakLog = L"soak.csv";
+
+    void Parse(LPWSTR lpCmdLine)
     {
-        ((BasicMainWindow*)arg->ctx)->OnStopComplete((xse_arg_stop_t*)arg);
+        int argc = 0;
+        LPWSTR* argv = ::CommandLineToArgvW(lpCmdLine, &argc);
+        if (argv == nullptr)
+            return;
+        for (int i = 0; i + 1 < argc; ++i) {
+            if (wcscmp(argv[i], L"-n") == 0)
+                channelCount = max(1, min(_wtoi(argv[++i]), XSE_MAX_CHANNEL_COUNT));
+            else if (wcscmp(argv[i], L"-url") == 0)
+                url = argv[++i];
+            else if (wcscmp(argv[i], L"-soak") == 0) {
+                soak = true;
+                soakMinutes = (DWORD)max(0, _wtoi(argv[++i]));
+            }
+            else if (wcscmp(argv[i], L"-log") == 0) {
+                soak = true;
+                soakLog = argv[++i];
+            }
+            else if (wcscmp(argv[i], L"-view") == 0)
+                viewMode = max(0, min(_wtoi(argv[++i]), 3));
+            else if (wcscmp(argv[i], L"-bg") == 0)
+                hiddenDecodeMode = max(0, min(_wtoi(argv[++i]), (int)xse_decode_none));
+            else if (wcscmp(argv[i], L"-rate") == 0)
+                rate = (float)_wtof(argv[++i]);
+            else if (wcscmp(argv[i], L"-zoom") == 0)
+                zoom = (float)_wtof(argv[++i]);
+            else if (wcscmp(argv[i], L"-replay") == 0)
+                replaySeconds = max(1, min(_wtoi(argv[++i]), 600));
+            else if (wcscmp(argv[i], L"-replaymb") == 0)
+                replayBudgetMB = max(0, _wtoi(argv[++i]));
+            else if (wcscmp(argv[i], L"-snap") == 0)
+                snapshotFormat = _wcsicmp(argv[++i], L"png") == 0 ? xse_image_png : xse_image_jpeg;
+            else if (wcscmp(argv[i], L"-snapw") == 0)
+                snapshotMaxWidth = max(0, _wtoi(argv[++i]));
+            else if (wcscmp(argv[i], L"-burn") == 0)
+                burnThreads = max(0, min(_wtoi(argv[++i]), 64));
+        }
+        ::LocalFree(argv);
     }
 };
 
+// ת˳߳ͨȼCPU
+static DWORD WINAPI CpuBurnThread(LPVOID)
+{
+    volatile unsigned spin = 0;
+    for (;;)
+        ++spin;
+    return 0;
+}
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
     g_hInstance = hInstance;
@@ -395,16 +756,51 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     fprintf(stdout, "hello, xsplayer host app.\n");
 //#endif
 
+    CommandLine cmdLine;
+    if (lpCmdLine != nullptr && lpCmdLine[0] != 0)
+        cmdLine.Parse(lpCmdLine);
+
     BasicMainWindow bmw;
+    bmw.m_channelCount = cmdLine.channelCount;
+    if (!cmdLine.url.empty())
+        bmw.m_url = cmdLine.url;
+    bmw.m_startMode = cmdLine.viewMode;
+    bmw.m_hiddenDecodeMode = cmdLine.hiddenDecodeMode;
+    if (cmdLine.rate != 0)
+        bmw.m_rate = cmdLine.rate;
+    bmw.m_zoom = max(1.0f, min(cmdLine.zoom, 16.0f));
+    bmw.m_replaySeconds = cmdLine.replaySeconds;
+    bmw.m_replayBudgetMB = cmdLine.replayBudgetMB;
+    bmw.m_snapshotFormat = cmdLine.snapshotFormat;
+    bmw.m_snapshotMaxWidth = cmdLine.snapshotMaxWidth;
     bmw.Create(L"XSPlayer", 1280, 720);
     xse_create(bmw.m_hwnd, &g_xse);
     bmw.StartAllChannels();
-    bmw.StartDrawTimer();
+
+    // Ŀɵȴ¼[0]ɻصɷ[1]֡֡
+    HANDLE events[2] = { NULL, NULL };
+    {
+        xse_arg_sync_get_events_t a;
+        xse_control(g_xse, &a);
+        events[0] = a.completion_event;
+        events[1] = a.frame_event;
+    }
+    DWORD eventCount = (events[0] != NULL && events[1] != NULL) ? 2 : 0;
+
+    SoakMonitor soak;
+    if (cmdLine.soak)
+        soak.Start(g_xse, cmdLine.channelCount, cmdLine.soakMinutes * 60 * 1000, cmdLine.soakLog.c_str());
+    for (int i = 0; i < cmdLine.burnThreads; ++i) {
+        HANDLE burn = ::CreateThread(nullptr, 0, CpuBurnThread, nullptr, 0, nullptr);
+        if (burn != NULL)
+            ::CloseHandle(burn);
+    }
 
     // ̵߳Ϣѭ
     int frameCount = 0;
     int loopCount = 0;
     DWORD lastCountTime = timeGetTime();
+    DWORD lastFrameTime = lastCountTime - BasicMainWindow::FRAME_IDLE_MS; // һյ֡¼ʱ
     for (bool bQuit = false; !bQuit;)
     {
         DWORD lastPTS = timeGetTime();
@@ -417,6 +813,8 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
         DWORD fpsInterval = timeGetTime() - lastCountTime;
         if (fpsInterval >= 2000) {
             fprintf(stderr, "fps=%d/%d\n", frameCount/2, loopCount/2);
+            if (!soak.Tick(timeGetTime(), frameCount / 2))
+                ::PostMessage(bmw.m_hwnd, WM_CLOSE, 0, 0); // ѹԵʱ
             lastCountTime = timeGetTime();
             frameCount = 0;
             loopCount = 0;
@@ -441,12 +839,22 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
                 xse_arg_t a;
                 xse_control(g_xse, &a);
             }
-            // һȴһʱ̵
+            // ȴϢ¼һʱ̣Sleep(1)ѯ
+            // ڳ֡ʱֽʱû֡ȫͣߣʱֻͳڵʱ
+            // ֡¼̣߳֡ӳ١
             {
                 DWORD curTime = timeGetTime();
                 if (curTime >= lastPTS + 16) // ΢60FPSСһ㣬֤ܴ60FPS
                     break;
-                Sleep(1);
+                bool streaming = curTime - lastFrameTime < BasicMainWindow::FRAME_IDLE_MS;
+                DWORD timeout = lastPTS + 16 - curTime;
+                if (!streaming) {
+                    DWORD sinceCount = curTime - lastCountTime;
+                    timeout = max(timeout, sinceCount < 2000 ? 2000 - sinceCount : 0);
+                }
+                DWORD ret = ::MsgWaitForMultipleObjectsEx(eventCount, events, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+                if (ret == WAIT_OBJECT_0 + 1)
+                    lastFrameTime = timeGetTime();
             }
         } while (!bQuit);
     }